@@ -19,13 +19,17 @@ namespace ssg {
                     int consumed = parse_flag(arg, next_arg, args);
                     i += consumed - 1;
                 } else if(args.command == Defaults::DEFAULT_COMMAND && i == 1) {
-                    if(arg == "build" || arg == "dev" || arg == "serve" || arg == "help" || arg == "version") {
+                    if(arg == "build" || arg == "dev" || arg == "serve" || arg == "merge-shards" || arg == "bench" ||
+                       arg == "query" || arg == "help" || arg == "version") {
                         args.command = arg;
                     } else {
                         args.project_path = std::filesystem::absolute(arg);
                     }
-                } else if(i == 2 && (args.command == "build" || args.command == "dev" || args.command == "serve")) {
+                } else if(i == 2 && (args.command == "build" || args.command == "dev" || args.command == "serve" ||
+                                     args.command == "merge-shards" || args.command == "bench" || args.command == "query")) {
                     args.project_path = std::filesystem::absolute(arg);
+                } else if(i > 2 && args.command == "merge-shards") {
+                    args.shard_dirs.push_back(std::filesystem::absolute(arg));
                 } else {
                     std::cerr << "⚠️  Warning: Ignoring unknown argument: " << arg << std::endl;
                 }
@@ -71,6 +75,16 @@ namespace ssg {
                 return 1;
             }
 
+            if(arg == "--streaming") {
+                args.streaming = true;
+                return 1;
+            }
+
+            if(arg == "--profile") {
+                args.profile = true;
+                return 1;
+            }
+
             if(arg == "--port" || arg == "-p") {
                 if(next_arg == nullptr) {
                     throw std::runtime_error("--port requires a value");
@@ -99,6 +113,116 @@ namespace ssg {
                 return 2;
             }
 
+            if(arg == "--tenants") {
+                if(next_arg == nullptr) {
+                    throw std::runtime_error("--tenants requires a directory");
+                }
+                args.tenants_dir = std::filesystem::absolute(next_arg);
+                return 2;
+            }
+
+            if(arg == "--cache-mb") {
+                if(next_arg == nullptr) {
+                    throw std::runtime_error("--cache-mb requires a value");
+                }
+                auto cache_mb = parse_int(next_arg);
+                if(!cache_mb) {
+                    throw std::runtime_error("Invalid cache size: " + std::string(next_arg));
+                }
+                args.cache_mb = *cache_mb;
+                return 2;
+            }
+
+            if(arg == "--only") {
+                if(next_arg == nullptr) {
+                    throw std::runtime_error("--only requires a glob pattern");
+                }
+                args.only.push_back(next_arg);
+                return 2;
+            }
+
+            if(arg == "--variant") {
+                if(next_arg == nullptr) {
+                    throw std::runtime_error("--variant requires a variant name");
+                }
+                args.variants.push_back(next_arg);
+                return 2;
+            }
+
+            if(arg == "--where") {
+                if(next_arg == nullptr) {
+                    throw std::runtime_error("--where requires a filter (e.g. --where tags=rust)");
+                }
+                args.where.push_back(next_arg);
+                return 2;
+            }
+
+            if(arg == "--fields") {
+                if(next_arg == nullptr) {
+                    throw std::runtime_error("--fields requires a comma-separated list of keys");
+                }
+                std::istringstream fields(next_arg);
+                std::string field;
+                while(std::getline(fields, field, ',')) {
+                    if(!field.empty()) {
+                        args.fields.push_back(field);
+                    }
+                }
+                return 2;
+            }
+
+            if(arg == "--out" || arg == "-o") {
+                if(next_arg == nullptr) {
+                    throw std::runtime_error("--out requires a directory, archive path or '-'");
+                }
+                args.out = next_arg;
+                return 2;
+            }
+
+            if(arg == "--corpus") {
+                if(next_arg == nullptr) {
+                    throw std::runtime_error("--corpus requires a directory");
+                }
+                args.bench_corpus = std::filesystem::absolute(next_arg);
+                return 2;
+            }
+
+            if(arg == "--pages") {
+                if(next_arg == nullptr) {
+                    throw std::runtime_error("--pages requires a value");
+                }
+                auto pages = parse_int(next_arg);
+                if(!pages) {
+                    throw std::runtime_error("Invalid page count: " + std::string(next_arg));
+                }
+                args.bench_pages = *pages;
+                return 2;
+            }
+
+            if(arg == "--save") {
+                if(next_arg == nullptr) {
+                    throw std::runtime_error("--save requires a file path");
+                }
+                args.bench_save = std::filesystem::absolute(next_arg);
+                return 2;
+            }
+
+            if(arg == "--baseline") {
+                if(next_arg == nullptr) {
+                    throw std::runtime_error("--baseline requires a file path");
+                }
+                args.bench_baseline = std::filesystem::absolute(next_arg);
+                return 2;
+            }
+
+            if(arg == "--shard") {
+                if(next_arg == nullptr) {
+                    throw std::runtime_error("--shard requires a value (e.g. --shard 1/4)");
+                }
+                args.shard = next_arg;
+                return 2;
+            }
+
             throw std::runtime_error("Unknown flag: " + arg);
         }
 
@@ -117,6 +241,10 @@ namespace ssg {
             std::cout << "  chisel build [project_path]        Build the site" << std::endl;
             std::cout << "  chisel dev [project_path]          Build and serve in development mode" << std::endl;
             std::cout << "  chisel serve [project_path]        Serve the built site" << std::endl;
+            std::cout << "  chisel merge-shards <project_path> <shard_dir>...  Combine sharded build outputs" << std::endl;
+            std::cout << "  chisel bench [project_path]        Time clean builds and HTTP serving of a site" << std::endl;
+            std::cout << "  chisel query [project_path]        List pages whose front matter matches --where filters"
+                      << std::endl;
             std::cout << "  chisel help                        Show this help message" << std::endl;
             std::cout << "  chisel version                     Show version information" << std::endl;
 
@@ -131,6 +259,39 @@ namespace ssg {
             std::cout << "  -w, --watch                        Watch for file changes (dev mode only)" << std::endl;
             std::cout << "  --config <path>                    Path to configuration file (default: chisel.config)"
                       << std::endl;
+            std::cout << "  --tenants <dir>                    Serve each subdirectory of <dir> as its own site, chosen by"
+                      << std::endl;
+            std::cout << "                                     Host (<name>.example.com) or /<name>/ prefix (serve only)"
+                      << std::endl;
+            std::cout << "  --cache-mb <n>                     Memory for cached files, shared across sites (default: 50)"
+                      << std::endl;
+            std::cout << "  --streaming                        Release page bodies after writing to bound memory"
+                      << std::endl;
+            std::cout << "  --profile                          Print build task timings and the critical path"
+                      << std::endl;
+            std::cout << "  -o, --out <target>                 Write the build to a directory, a .tar, a .pack archive, or"
+                      << std::endl;
+            std::cout << "                                     '-' for a tar stream on stdout (logs go to stderr)"
+                      << std::endl;
+            std::cout << "  --only <glob>                      Rebuild only pages whose source path or route matches"
+                      << std::endl;
+            std::cout << "                                     (or that include a matching snippet or shortcode)"
+                      << std::endl;
+            std::cout << "  --shard <i/N>                      Build only shard i of N (1-based) for multi-machine CI"
+                      << std::endl;
+            std::cout << "  --variant <name>                   Build only this [[variants]] entry (repeatable)" << std::endl;
+            std::cout << "  --where <filter>                   Query filter: key=value, key!=value, key~text, key<value,"
+                      << std::endl;
+            std::cout << "                                     key>=value, key or !key (repeatable, all must match)"
+                      << std::endl;
+            std::cout << "  --fields <a,b>                     Front matter keys to print after each route (default: title)"
+                      << std::endl;
+            std::cout << "  --corpus <dir>                     Benchmark a synthetic site generated into <dir> (bench only)"
+                      << std::endl;
+            std::cout << "  --pages <n>                        Pages in the synthetic corpus (default: 400)" << std::endl;
+            std::cout << "  --save <file>                      Write benchmark results to <file>" << std::endl;
+            std::cout << "  --baseline <file>                  Report speedups against results saved with --save"
+                      << std::endl;
             std::cout << "  --verbose                          Enable verbose logging" << std::endl;
             std::cout << "  -q, --quiet                        Suppress non-error output" << std::endl;
 
@@ -141,8 +302,20 @@ namespace ssg {
             std::cout << "  CHISEL_CONTENT_DIR                 Override content directory" << std::endl;
             std::cout << "  CHISEL_STYLES_DIR                  Override styles directory" << std::endl;
             std::cout << "  CHISEL_TEMPLATES_DIR               Override templates directory" << std::endl;
+            std::cout << "  CHISEL_I18N_DIR                    Override translation catalog directory" << std::endl;
+            std::cout << "  CHISEL_INCLUDES_DIR                Override include snippet directory" << std::endl;
             std::cout << "  CHISEL_SITE_NAME                   Override site name" << std::endl;
             std::cout << "  CHISEL_BASE_URL                    Override base URL" << std::endl;
+            std::cout << "  CHISEL_SYNTAX_HIGHLIGHTING         Highlight fenced code at build time (true/false)"
+                      << std::endl;
+            std::cout << "  CHISEL_LAZY_IMAGES                 Size local images and load them lazily (true/false)"
+                      << std::endl;
+            std::cout << "  CHISEL_HTML_PROFILE                Markdown class attributes (classic/compact/mapped)"
+                      << std::endl;
+            std::cout << "  CHISEL_STREAMING_BUILD             Enable the memory-bounded streaming build (true/false)"
+                      << std::endl;
+            std::cout << "  CHISEL_BUILD_THREADS               Worker threads for the build graph (0 = auto)"
+                      << std::endl;
             std::cout << "  CHISEL_VERBOSE                     Enable verbose logging (true/false)" << std::endl;
             std::cout << "  CI                                 Detected CI environment flag" << std::endl;
 
@@ -152,6 +325,15 @@ namespace ssg {
             std::cout << "  chisel dev --port 4000             Start dev server on port 4000" << std::endl;
             std::cout << "  chisel build --clean               Clean and build" << std::endl;
             std::cout << "  chisel serve --host 0.0.0.0        Serve on all interfaces" << std::endl;
+            std::cout << "  chisel serve --tenants /srv/previews --cache-mb 512  Serve every branch preview" << std::endl;
+            std::cout << "  chisel build --only 'blog/**'      Rebuild the blog section only" << std::endl;
+            std::cout << "  chisel build --only 'includes/**'  Rebuild the pages that use any include" << std::endl;
+            std::cout << "  chisel build --shard 2/4           Build the second of four shards" << std::endl;
+            std::cout << "  chisel build --variant docs        Build every language of the docs variant" << std::endl;
+            std::cout << "  chisel query --where tags=rust --where 'date>=2024'  List recent pages tagged rust"
+                      << std::endl;
+            std::cout << "  chisel build --out - | tar -x -C /srv  Stream the site as a tar" << std::endl;
+            std::cout << "  chisel bench --corpus /tmp/corpus  Benchmark the bundled synthetic site" << std::endl;
         }
 
         void ArgumentParser::show_version() {
@@ -187,6 +369,81 @@ namespace ssg {
                 return "Config file does not exist: " + *args.config_file;
             }
 
+            if(args.tenants_dir && args.command != "serve") {
+                return "--tenants can only be used with the serve command";
+            }
+
+            if(args.tenants_dir && !std::filesystem::is_directory(*args.tenants_dir)) {
+                return "Tenants directory does not exist: " + args.tenants_dir->string();
+            }
+
+            if(args.cache_mb && args.command != "serve" && args.command != "dev") {
+                return "--cache-mb can only be used with the serve and dev commands";
+            }
+
+            if(args.cache_mb && *args.cache_mb < 1) {
+                return "--cache-mb must be at least 1";
+            }
+
+            if(!args.only.empty() && args.command != "build") {
+                return "--only can only be used with the build command";
+            }
+
+            if(!args.only.empty() && args.clean) {
+                return "Cannot use --clean with --only: a partial build reuses the existing output";
+            }
+
+            if(args.shard && args.command != "build") {
+                return "--shard can only be used with the build command";
+            }
+
+            if(!args.variants.empty() && args.command != "build") {
+                return "--variant can only be used with the build command";
+            }
+
+            if((!args.where.empty() || !args.fields.empty()) && args.command != "query") {
+                return "--where and --fields can only be used with the query command";
+            }
+
+            if(args.out && args.command != "build") {
+                return "--out can only be used with the build command";
+            }
+
+            if(args.out && !args.only.empty()) {
+                std::string extension = std::filesystem::path(*args.out).extension().string();
+                if(*args.out == "-" || extension == ".tar" || extension == ".pack") {
+                    return "--only needs a directory --out: a partial build reuses the existing output";
+                }
+            }
+
+            bool bench_flags = args.bench_corpus || args.bench_pages || args.bench_save || args.bench_baseline;
+            if(bench_flags && args.command != "bench") {
+                return "--corpus, --pages, --save and --baseline can only be used with the bench command";
+            }
+
+            if(args.bench_pages && *args.bench_pages < 1) {
+                return "--pages must be at least 1";
+            }
+
+            if(args.bench_pages && !args.bench_corpus) {
+                return "--pages only applies to the synthetic corpus, pass --corpus <dir> as well";
+            }
+
+            if(args.bench_baseline && !std::filesystem::exists(*args.bench_baseline)) {
+                return "Baseline results do not exist: " + args.bench_baseline->string();
+            }
+
+            if(args.command == "merge-shards") {
+                if(args.shard_dirs.empty()) {
+                    return "merge-shards requires at least one shard directory";
+                }
+                for(const auto &shard_dir : args.shard_dirs) {
+                    if(!std::filesystem::is_directory(shard_dir)) {
+                        return "Shard directory does not exist: " + shard_dir.string();
+                    }
+                }
+            }
+
             return "";
         }
 
@@ -25,7 +25,30 @@ namespace ssg {
 
             bool watch = false;
             bool clean = false;
+            bool streaming = false;
+            bool profile = false;
             std::optional<std::string> config_file;
+
+            // serve: every subdirectory of tenants_dir is a site of its own, picked by Host header or path prefix.
+            std::optional<std::filesystem::path> tenants_dir;
+            std::optional<int> cache_mb;
+
+            // "-" streams a tar to stdout; see OutputSink::open for the other forms.
+            std::optional<std::string> out;
+            std::optional<std::string> shard;
+            std::vector<std::string> only;
+            std::vector<std::filesystem::path> shard_dirs;
+            // [[variants]] to build; "docs" also selects "docs/<language>". Empty builds all of them.
+            std::vector<std::string> variants;
+
+            // Filter terms and output columns for the query command; see MetadataQuery for the syntax.
+            std::vector<std::string> where;
+            std::vector<std::string> fields;
+
+            std::optional<std::filesystem::path> bench_corpus;
+            std::optional<int> bench_pages;
+            std::optional<std::filesystem::path> bench_save;
+            std::optional<std::filesystem::path> bench_baseline;
         };
 
         class ArgumentParser {
@@ -0,0 +1,63 @@
+#include "build_cache.hpp"
+
+#include "../utils/file_utils.hpp"
+
+namespace ssg {
+
+    std::shared_ptr<const std::string> BuildCache::read_file(const std::filesystem::path &path) {
+        std::string key = path.lexically_normal().string();
+        std::filesystem::file_time_type mtime = std::filesystem::last_write_time(path);
+        uintmax_t size = std::filesystem::file_size(path);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = files_.find(key);
+            if(it != files_.end() && it->second.mtime == mtime && it->second.size == size) {
+                file_hits_++;
+                return it->second.content;
+            }
+        }
+
+        // Read outside the lock; two tasks missing on the same file both read it, which is harmless.
+        auto content = std::make_shared<const std::string>(utils::FileUtils::read_file(path));
+        std::lock_guard<std::mutex> lock(mutex_);
+        files_[key] = {mtime, size, content};
+        return content;
+    }
+
+    std::shared_ptr<const BuildCache::Page> BuildCache::find_page(uint64_t key) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = pages_.find(key);
+        if(it == pages_.end()) {
+            return nullptr;
+        }
+        page_hits_++;
+        return it->second;
+    }
+
+    void BuildCache::store_page(uint64_t key, std::shared_ptr<const Page> page) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pages_[key] = std::move(page);
+    }
+
+    std::shared_ptr<const i18n::Catalog> BuildCache::catalog(const std::filesystem::path &dir, const std::string &language,
+                                                             const std::string &fallback_language) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto &catalog = catalogs_[{dir.string(), language, fallback_language}];
+        if(!catalog) {
+            catalog = std::make_shared<const i18n::Catalog>(i18n::Catalog::load(dir, language, fallback_language));
+        }
+        return catalog;
+    }
+
+    size_t BuildCache::file_hits() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return file_hits_;
+    }
+
+    size_t BuildCache::page_hits() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return page_hits_;
+    }
+
+} // namespace ssg
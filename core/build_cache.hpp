@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+
+#include "content.hpp"
+#include "i18n.hpp"
+
+namespace ssg {
+    // What the variants of one batch build can share because it does not depend on their config: source files
+    // (templates, stylesheets, markdown) by path, pages rendered from identical inputs, and compiled translation
+    // catalogs. Safe to use from concurrent page tasks.
+    class BuildCache {
+    public:
+        struct Page {
+            ContentMeta meta;
+            std::string rendered_html;
+        };
+
+        // Revalidated by size and modification time, so edits between variants are still picked up.
+        std::shared_ptr<const std::string> read_file(const std::filesystem::path &path);
+
+        std::shared_ptr<const Page> find_page(uint64_t key);
+        void store_page(uint64_t key, std::shared_ptr<const Page> page);
+
+        std::shared_ptr<const i18n::Catalog> catalog(const std::filesystem::path &dir, const std::string &language,
+                                                     const std::string &fallback_language);
+
+        size_t file_hits() const;
+        size_t page_hits() const;
+
+    private:
+        struct FileEntry {
+            std::filesystem::file_time_type mtime;
+            uintmax_t size = 0;
+            std::shared_ptr<const std::string> content;
+        };
+
+        mutable std::mutex mutex_;
+        std::unordered_map<std::string, FileEntry> files_;
+        std::unordered_map<uint64_t, std::shared_ptr<const Page>> pages_;
+        std::map<std::tuple<std::string, std::string, std::string>, std::shared_ptr<const i18n::Catalog>> catalogs_;
+        size_t file_hits_ = 0;
+        size_t page_hits_ = 0;
+    };
+} // namespace ssg
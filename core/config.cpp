@@ -1,10 +1,12 @@
 #include "config.hpp"
 
+#include <cctype>
 #include <cstdlib>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 
+#include "../parsers/markdown/markdown.hpp"
 #include "../parsers/toml/toml.hpp"
 #include "../utils/file_utils.hpp"
 
@@ -41,6 +43,18 @@ namespace ssg {
         if(output_dir == content_dir || output_dir == styles_dir || output_dir == templates_dir) {
             throw ConfigError("Output directory cannot be the same as content, styles, or templates directory");
         }
+
+        if(html_profile != "classic" && html_profile != "compact" && html_profile != "mapped") {
+            throw ConfigError("HTML profile must be 'classic', 'compact' or 'mapped', got '" + html_profile + "'");
+        }
+
+        if(html_profile == "mapped") {
+            try {
+                markdown::MappedClasses::from(html_classes);
+            } catch(const std::invalid_argument &e) {
+                throw ConfigError(std::string(e.what()) + " in [build.html_classes]");
+            }
+        }
     }
 
     void DevConfig::validate() const {
@@ -61,6 +75,10 @@ namespace ssg {
         if(max_file_size == 0) {
             throw ConfigError("Max file size must be greater than 0");
         }
+
+        if(build_threads < 0) {
+            throw ConfigError("Build threads cannot be negative");
+        }
     }
 
     void Config::load(const std::filesystem::path &config_path, const std::filesystem::path &project_root) {
@@ -78,20 +96,34 @@ namespace ssg {
         try {
             std::string config_content = utils::FileUtils::read_file(config_path);
 
+            toml::Value toml_root;
+            try {
+                toml_root = toml::Parser::deserialize(config_content);
+            } catch(const std::exception &e) {
+                throw ConfigError("Configuration schema validation failed: TOML parsing error: " + std::string(e.what()));
+            }
+
             std::string schema_error;
-            if(!validate_schema(config_content, schema_error)) {
+            if(!validate_schema(toml_root, schema_error)) {
                 throw ConfigError("Configuration schema validation failed: " + schema_error);
             }
 
-            load_from_string(config_content, project_root);
+            load_from_value(toml_root, project_root);
 
         } catch(const std::exception &e) { throw ConfigError("Failed to load configuration: " + std::string(e.what())); }
     }
 
     void Config::load_from_string(const std::string &toml_content, const std::filesystem::path &project_root) {
+        toml::Value toml_root;
         try {
-            auto toml_root = toml::Parser::deserialize(toml_content);
+            toml_root = toml::Parser::deserialize(toml_content);
+        } catch(const std::exception &e) { throw ConfigError("Failed to parse configuration: " + std::string(e.what())); }
+
+        load_from_value(toml_root, project_root);
+    }
 
+    void Config::load_from_value(const toml::Value &toml_root, const std::filesystem::path &project_root) {
+        try {
             if(!toml_root.is_object()) {
                 throw ConfigError("Config file must contain a TOML object at root level");
             }
@@ -102,6 +134,7 @@ namespace ssg {
             load_build_config(root);
             load_dev_config(root);
             load_performance_config(root);
+            load_variants(root);
             apply_env_overrides();
             resolve_paths(project_root);
             validate();
@@ -159,6 +192,8 @@ namespace ssg {
         content_path_ = std::filesystem::absolute(project_root / build.content_dir);
         styles_path_ = std::filesystem::absolute(project_root / build.styles_dir);
         templates_path_ = std::filesystem::absolute(project_root / build.templates_dir);
+        i18n_path_ = std::filesystem::absolute(project_root / build.i18n_dir);
+        includes_path_ = std::filesystem::absolute(project_root / build.includes_dir);
     }
 
     void Config::validate() const {
@@ -185,37 +220,94 @@ namespace ssg {
 
     bool Config::validate_schema(const std::string &toml_content, std::string &error_message) {
         try {
-            auto toml_root = toml::Parser::deserialize(toml_content);
+            return validate_schema(toml::Parser::deserialize(toml_content), error_message);
+        } catch(const std::exception &e) {
+            error_message = "TOML parsing error: " + std::string(e.what());
+            return false;
+        }
+    }
 
-            if(!toml_root.is_object()) {
-                error_message = "Root must be an object";
-                return false;
-            }
+    bool Config::validate_schema(const toml::Value &toml_root, std::string &error_message) {
+        if(!toml_root.is_object()) {
+            error_message = "Root must be an object";
+            return false;
+        }
 
-            const auto &root = toml_root.get_object();
+        const auto &root = toml_root.get_object();
 
-            const std::vector<std::string> valid_sections = {"site", "build", "dev", "performance", "layout_styles"};
+        const std::vector<std::string> valid_sections = {"site", "build", "dev", "performance", "layout_styles", "variants"};
 
-            for(const auto &[key, value] : root) {
-                bool found = false;
-                for(const auto &valid_section : valid_sections) {
-                    if(key == valid_section) {
-                        found = true;
-                        break;
-                    }
+        for(const auto &[key, value] : root) {
+            bool found = false;
+            for(const auto &valid_section : valid_sections) {
+                if(key == valid_section) {
+                    found = true;
+                    break;
                 }
-                if(!found) {
-                    error_message = "Unknown configuration section: " + key;
-                    return false;
+            }
+            if(!found) {
+                error_message = "Unknown configuration section: " + key;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    ConfigChanges Config::diff(const Config &previous) const {
+        ConfigChanges changes;
+        changes.site = !(site == previous.site);
+        changes.language = site.language != previous.site.language;
+        changes.dev = !(dev == previous.dev);
+        changes.performance = !(performance == previous.performance);
+        changes.global_styles = build.global_styles != previous.build.global_styles;
+
+        // A layout missing from layout_styles has no styles, same as one listed with [].
+        auto styles_of = [](const BuildConfig &config, const std::string &layout) {
+            auto it = config.layout_styles.find(layout);
+            return it != config.layout_styles.end() ? it->second : std::vector<std::string>{};
+        };
+        for(const auto *config : {&build, &previous.build}) {
+            for(const auto &[layout, styles] : config->layout_styles) {
+                if(styles_of(build, layout) != styles_of(previous.build, layout)) {
+                    changes.layouts.insert(layout);
                 }
             }
+        }
 
-            return true;
+        // Everything else under build changes what pages are made from or how markdown renders.
+        BuildConfig current_rest = build;
+        BuildConfig previous_rest = previous.build;
+        current_rest.global_styles = previous_rest.global_styles = {};
+        current_rest.layout_styles = previous_rest.layout_styles = {};
+        changes.build = !(current_rest == previous_rest);
 
-        } catch(const std::exception &e) {
-            error_message = "TOML parsing error: " + std::string(e.what());
+        return changes;
+    }
+
+    FileWatcher::FileWatcher(const std::filesystem::path &path) : path_(path) { exists_ = read_state(mtime_, size_); }
+
+    bool FileWatcher::poll() {
+        std::filesystem::file_time_type mtime;
+        uintmax_t size = 0;
+        bool exists = read_state(mtime, size);
+        if(exists == exists_ && (!exists || (mtime == mtime_ && size == size_))) {
             return false;
         }
+        exists_ = exists;
+        mtime_ = mtime;
+        size_ = size;
+        return true;
+    }
+
+    bool FileWatcher::read_state(std::filesystem::file_time_type &mtime, uintmax_t &size) const {
+        std::error_code error;
+        mtime = std::filesystem::last_write_time(path_, error);
+        if(error) {
+            return false;
+        }
+        size = std::filesystem::file_size(path_, error);
+        return !error;
     }
 
     void Config::apply_env_overrides() {
@@ -246,9 +338,20 @@ namespace ssg {
         if(auto env_val = get_env("CHISEL_TEMPLATES_DIR")) {
             build.templates_dir = *env_val;
         }
+        if(auto env_val = get_env("CHISEL_I18N_DIR")) {
+            build.i18n_dir = *env_val;
+        }
+        if(auto env_val = get_env("CHISEL_INCLUDES_DIR")) {
+            build.includes_dir = *env_val;
+        }
 
         build.minify_css = get_env_bool("CHISEL_MINIFY_CSS", build.minify_css);
         build.minify_html = get_env_bool("CHISEL_MINIFY_HTML", build.minify_html);
+        build.syntax_highlighting = get_env_bool("CHISEL_SYNTAX_HIGHLIGHTING", build.syntax_highlighting);
+        build.lazy_images = get_env_bool("CHISEL_LAZY_IMAGES", build.lazy_images);
+        if(auto env_val = get_env("CHISEL_HTML_PROFILE")) {
+            build.html_profile = *env_val;
+        }
 
         dev.port = get_env_int("CHISEL_DEV_PORT", dev.port);
         if(auto env_val = get_env("CHISEL_DEV_HOST")) {
@@ -260,6 +363,8 @@ namespace ssg {
         performance.enable_cache = get_env_bool("CHISEL_ENABLE_CACHE", performance.enable_cache);
         performance.cache_max_age = get_env_int("CHISEL_CACHE_MAX_AGE", performance.cache_max_age);
         performance.parallel_processing = get_env_bool("CHISEL_PARALLEL_PROCESSING", performance.parallel_processing);
+        performance.streaming_build = get_env_bool("CHISEL_STREAMING_BUILD", performance.streaming_build);
+        performance.build_threads = get_env_int("CHISEL_BUILD_THREADS", performance.build_threads);
 
         if(auto env_val = get_env("CHISEL_MAX_FILE_SIZE")) {
             try {
@@ -316,8 +421,27 @@ namespace ssg {
         get_string("content_dir", build.content_dir);
         get_string("styles_dir", build.styles_dir);
         get_string("templates_dir", build.templates_dir);
+        get_string("i18n_dir", build.i18n_dir);
+        get_string("includes_dir", build.includes_dir);
         get_bool("minify_css", build.minify_css);
         get_bool("minify_html", build.minify_html);
+        get_bool("syntax_highlighting", build.syntax_highlighting);
+        get_bool("lazy_images", build.lazy_images);
+        get_string("html_profile", build.html_profile);
+
+        // A class table on its own selects the mapped profile.
+        auto html_classes_it = build_obj.find("html_classes");
+        if(html_classes_it != build_obj.end() && html_classes_it->second.is_object()) {
+            build.html_classes.clear();
+            for(const auto &[element, name] : html_classes_it->second.get_object()) {
+                if(name.is_string()) {
+                    build.html_classes[element] = name.get_string();
+                }
+            }
+            if(build_obj.find("html_profile") == build_obj.end()) {
+                build.html_profile = "mapped";
+            }
+        }
 
         auto global_styles_it = build_obj.find("global_styles");
         if(global_styles_it != build_obj.end() && global_styles_it->second.is_array()) {
@@ -414,6 +538,8 @@ namespace ssg {
         get_bool("enable_cache", performance.enable_cache);
         get_int("cache_max_age", performance.cache_max_age);
         get_bool("parallel_processing", performance.parallel_processing);
+        get_bool("streaming_build", performance.streaming_build);
+        get_int("build_threads", performance.build_threads);
 
         auto max_file_it = perf_obj.find("max_file_size");
         if(max_file_it != perf_obj.end()) {
@@ -444,4 +570,91 @@ namespace ssg {
         }
     }
 
+    void Config::load_variants(const toml::Value::Object &root) {
+        variants.clear();
+        auto it = root.find("variants");
+        if(it == root.end()) {
+            return;
+        }
+        if(!it->second.is_array()) {
+            throw ConfigError("variants must be an array of tables ([[variants]])");
+        }
+
+        std::set<std::string> names;
+        for(const auto &entry : it->second.get_array()) {
+            if(!entry.is_object()) {
+                throw ConfigError("variants must be an array of tables ([[variants]])");
+            }
+            const auto &table = entry.get_object();
+
+            VariantConfig variant;
+            auto name_it = table.find("name");
+            if(name_it == table.end() || !name_it->second.is_string() || name_it->second.get_string().empty()) {
+                throw ConfigError("Every [[variants]] entry needs a name");
+            }
+            variant.name = name_it->second.get_string();
+            for(char c : variant.name) {
+                if(!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_') {
+                    throw ConfigError("Variant name '" + variant.name + "' may only use letters, digits, '-' and '_'");
+                }
+            }
+            if(!names.insert(variant.name).second) {
+                throw ConfigError("Duplicate variant name: " + variant.name);
+            }
+
+            auto languages_it = table.find("languages");
+            if(languages_it != table.end() && languages_it->second.is_array()) {
+                for(const auto &language : languages_it->second.get_array()) {
+                    if(language.is_string()) {
+                        variant.languages.push_back(language.get_string());
+                    }
+                }
+            }
+
+            variant.overrides = table;
+            variants.push_back(std::move(variant));
+        }
+    }
+
+    std::vector<std::pair<std::string, Config>> Config::expand_variants(const std::filesystem::path &project_root) const {
+        std::vector<std::pair<std::string, Config>> expanded;
+
+        for(const auto &variant : variants) {
+            std::vector<std::optional<std::string>> languages(variant.languages.begin(), variant.languages.end());
+            if(languages.empty()) {
+                languages.push_back(std::nullopt);
+            }
+
+            for(const auto &language : languages) {
+                std::string name = language ? variant.name + "/" + *language : variant.name;
+
+                Config config = *this;
+                config.variants.clear();
+                config.load_site_config(variant.overrides);
+                config.load_build_config(variant.overrides);
+                if(language) {
+                    config.site.language = *language;
+                }
+
+                bool own_output = false;
+                auto build_it = variant.overrides.find("build");
+                if(build_it != variant.overrides.end() && build_it->second.is_object()) {
+                    own_output = build_it->second.get_object().count("output_dir") > 0;
+                }
+                if(own_output && language) {
+                    config.build.output_dir = (std::filesystem::path(config.build.output_dir) / *language).generic_string();
+                } else if(!own_output) {
+                    config.build.output_dir = (std::filesystem::path(build.output_dir) / name).generic_string();
+                }
+
+                config.resolve_paths(project_root);
+                try {
+                    config.validate();
+                } catch(const ConfigError &e) { throw ConfigError("Variant " + name + ": " + e.what()); }
+                expanded.emplace_back(name, std::move(config));
+            }
+        }
+        return expanded;
+    }
+
 } // namespace ssg
@@ -3,6 +3,7 @@
 #include <filesystem>
 #include <map>
 #include <optional>
+#include <set>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -22,6 +23,8 @@ namespace ssg {
         std::string language = "en";
 
         void validate() const;
+
+        bool operator==(const SiteConfig &) const = default;
     };
 
     struct BuildConfig {
@@ -29,12 +32,24 @@ namespace ssg {
         std::string content_dir = "content";
         std::string styles_dir = "styles";
         std::string templates_dir = "templates";
+        // Translation catalogs, one <language>.toml per site language.
+        std::string i18n_dir = "i18n";
+        // Snippets for {{< include "file.md" >}}; shortcode templates live in <templates_dir>/shortcodes.
+        std::string includes_dir = "includes";
         std::vector<std::string> global_styles = {"base.css"};
         std::map<std::string, std::vector<std::string>> layout_styles = {{"default", {}}, {"post", {"post.css"}}};
         bool minify_css = false;
         bool minify_html = false;
+        bool syntax_highlighting = true;
+        bool lazy_images = true;
+        // Class attributes on rendered Markdown: "classic", "compact" (none) or "mapped" (html_classes only).
+        std::string html_profile = "classic";
+        // Classic class name to the one emitted instead, from [build.html_classes]; unlisted elements get none.
+        std::map<std::string, std::string> html_classes;
 
         void validate() const;
+
+        bool operator==(const BuildConfig &) const = default;
     };
 
     struct DevConfig {
@@ -44,6 +59,8 @@ namespace ssg {
         bool live_reload = false;
 
         void validate() const;
+
+        bool operator==(const DevConfig &) const = default;
     };
 
     struct PerformanceConfig {
@@ -51,8 +68,52 @@ namespace ssg {
         int cache_max_age = 3600;
         size_t max_file_size = 10 * 1024 * 1024;
         bool parallel_processing = true;
+        int build_threads = 0; // 0 = one per hardware thread
+        bool streaming_build = false;
 
         void validate() const;
+
+        bool operator==(const PerformanceConfig &) const = default;
+    };
+
+    // One [[variants]] entry: its own [site] and [build] keys over the rest of the config, built into its own
+    // output directory by one `chisel build`. With `languages` it stands for one variant per language.
+    struct VariantConfig {
+        std::string name;
+        std::vector<std::string> languages;
+        toml::Value::Object overrides;
+    };
+
+    // What a config reload touched, from the cheapest to the most expensive thing to redo.
+    struct ConfigChanges {
+        bool site = false;                // every page is re-templated; markdown is not re-rendered
+        bool global_styles = false;       // likewise, for the stylesheet links
+        bool language = false;            // site.language: the i18n catalog is reloaded too (implies site)
+        std::set<std::string> layouts;    // layouts whose layout_styles changed
+        bool dev = false;                 // the server may need restarting; nothing is rebuilt
+        bool performance = false;         // applies from the next full build
+        bool build = false;               // directories or render flags: needs a full rebuild
+
+        bool empty() const {
+            return !site && !global_styles && layouts.empty() && !dev && !performance && !build;
+        }
+    };
+
+    // Polls a file's modification time and size; used by `chisel dev` to notice chisel.config edits.
+    class FileWatcher {
+    public:
+        explicit FileWatcher(const std::filesystem::path &path);
+
+        // True once per change since the last call (or construction).
+        bool poll();
+
+    private:
+        std::filesystem::path path_;
+        std::filesystem::file_time_type mtime_;
+        uintmax_t size_ = 0;
+        bool exists_ = false;
+
+        bool read_state(std::filesystem::file_time_type &mtime, uintmax_t &size) const;
     };
 
     class Config {
@@ -61,11 +122,14 @@ namespace ssg {
         BuildConfig build;
         DevConfig dev;
         PerformanceConfig performance;
+        std::vector<VariantConfig> variants;
 
         Config() = default;
 
         void load(const std::filesystem::path &config_path, const std::filesystem::path &project_root);
         void load_from_string(const std::string &toml_content, const std::filesystem::path &project_root);
+        // Sections that differ from previous, with layout_styles compared per layout.
+        ConfigChanges diff(const Config &previous) const;
         static std::optional<std::string> get_env(const std::string &key);
         static int get_env_int(const std::string &key, int default_value);
         static bool get_env_bool(const std::string &key, bool default_value);
@@ -75,20 +139,30 @@ namespace ssg {
         std::filesystem::path get_content_path() const { return content_path_; }
         std::filesystem::path get_styles_path() const { return styles_path_; }
         std::filesystem::path get_templates_path() const { return templates_path_; }
+        std::filesystem::path get_i18n_path() const { return i18n_path_; }
+        std::filesystem::path get_includes_path() const { return includes_path_; }
+        // Every variant as a complete config, named "name" or "name/language". A variant without its own
+        // output_dir writes to <output_dir>/<name>.
+        std::vector<std::pair<std::string, Config>> expand_variants(const std::filesystem::path &project_root) const;
         void print_summary() const;
         static bool validate_schema(const std::string &toml_content, std::string &error_message);
+        static bool validate_schema(const toml::Value &root, std::string &error_message);
 
     private:
         std::filesystem::path output_path_;
         std::filesystem::path content_path_;
         std::filesystem::path styles_path_;
         std::filesystem::path templates_path_;
+        std::filesystem::path i18n_path_;
+        std::filesystem::path includes_path_;
 
         void apply_env_overrides();
+        void load_from_value(const toml::Value &toml_root, const std::filesystem::path &project_root);
         void load_site_config(const toml::Value::Object &root);
         void load_build_config(const toml::Value::Object &root);
         void load_dev_config(const toml::Value::Object &root);
         void load_performance_config(const toml::Value::Object &root);
+        void load_variants(const toml::Value::Object &root);
     };
 
     extern Config g_config;
@@ -1,25 +1,126 @@
 #include "content.hpp"
 
+#include <fstream>
 #include <iostream>
 #include <regex>
 
 #include "../parsers/markdown/markdown.hpp"
+#include "../parsers/markdown/snapshot.hpp"
 #include "../utils/file_utils.hpp"
+#include "build_cache.hpp"
+#include "metadata_index.hpp"
+#include "shortcodes.hpp"
 
 using ssg::utils::ends_with;
 using ssg::utils::starts_with;
 
 namespace ssg {
 
+    namespace {
+        constexpr size_t READ_BLOCK_SIZE = 64 * 1024;
+
+        // Where FrontmatterParser::parse would start the body of `path`, which it trims when there is front
+        // matter. Nullopt when the front matter is too large to read on its own.
+        struct BodyStart {
+            size_t offset = 0;
+            bool trim = false;
+        };
+
+        std::optional<BodyStart> find_body_start(const std::filesystem::path &path,
+                                                 std::map<std::string, std::string> *metadata = nullptr) {
+            std::optional<std::string> header = utils::FrontmatterParser::read_header(path);
+            if(!header) {
+                return std::nullopt;
+            }
+            utils::FrontmatterParser::ParseResult front = utils::FrontmatterParser::parse(*header);
+            if(metadata) {
+                *metadata = std::move(front.metadata);
+            }
+            if(front.content_start_pos == 0) {
+                return BodyStart{};
+            }
+            // The TOML form's position is the newline ending its closing delimiter.
+            return BodyStart{front.content_start_pos + (starts_with(*header, "+++") ? 1 : 0), true};
+        }
+
+        // Each line of `path` from `offset` on, without its newline, read a block at a time.
+        void for_each_line(const std::filesystem::path &path, size_t offset,
+                           const std::function<void(std::string_view)> &on_line) {
+            std::ifstream file(path, std::ios::binary);
+            if(!file.is_open()) {
+                throw std::runtime_error("Cannot open file: " + path.string());
+            }
+            file.seekg(static_cast<std::streamoff>(offset));
+
+            std::vector<char> block(READ_BLOCK_SIZE);
+            std::string partial;
+            while(file) {
+                file.read(block.data(), static_cast<std::streamsize>(block.size()));
+                std::string_view data(block.data(), static_cast<size_t>(file.gcount()));
+                while(!data.empty()) {
+                    size_t newline = data.find('\n');
+                    if(newline == std::string_view::npos) {
+                        partial.append(data);
+                        break;
+                    }
+                    if(partial.empty()) {
+                        on_line(data.substr(0, newline));
+                    } else {
+                        partial.append(data.substr(0, newline));
+                        on_line(partial);
+                        partial.clear();
+                    }
+                    data.remove_prefix(newline + 1);
+                }
+            }
+            if(file.bad()) {
+                throw std::runtime_error("Cannot read file: " + path.string());
+            }
+            if(!partial.empty()) {
+                on_line(partial);
+            }
+        }
+    } // namespace
+
     void ContentFile::generate_route(const std::filesystem::path &content_base_dir) {
         route = utils::FileUtils::path_to_route(source_path, content_base_dir);
         slug = utils::FileUtils::path_to_slug(source_path);
     }
 
-    void ContentFile::parse_content(const std::string &raw_content) {
+    void ContentFile::parse_content(const std::string &raw_content, utils::ThreadPool *pool,
+                                    const std::filesystem::path &snapshot_path) {
+        std::string content = parse_metadata(raw_content);
+        content = parse_inline_classes(content);
+
+        uint64_t source_hash = 0;
+        if(!snapshot_path.empty()) {
+            source_hash = utils::HashUtils::fnv1a(content);
+            if(auto snapshot = markdown::snapshot::Snapshot::open(snapshot_path, source_hash)) {
+                content_ast = markdown::Node();
+                content_snapshot = std::make_shared<const markdown::snapshot::Snapshot>(std::move(*snapshot));
+                content_loaded = true;
+                return;
+            }
+        }
+
+        content_snapshot.reset();
+        content_ast = pool ? markdown::Deserializer::deserialize_parallel(content, *pool)
+                           : markdown::Deserializer::deserialize(content);
+        if(!snapshot_path.empty() && !markdown::snapshot::write(snapshot_path, content_ast, source_hash)) {
+            std::cerr << "⚠️  Could not write AST snapshot " << snapshot_path << std::endl;
+        }
+        content_loaded = true;
+    }
+
+    std::string ContentFile::parse_metadata(const std::string &raw_content) {
         auto frontmatter_result = utils::FrontmatterParser::parse(raw_content);
+        apply_metadata(frontmatter_result.metadata);
+        return frontmatter_result.content;
+    }
 
-        for(const auto &[key, value] : frontmatter_result.metadata) {
+    void ContentFile::apply_metadata(const std::map<std::string, std::string> &metadata) {
+        meta = ContentMeta{};
+        for(const auto &[key, value] : metadata) {
             if(key == "title") {
                 meta.title = value;
             } else if(key == "layout") {
@@ -28,30 +129,59 @@ namespace ssg {
                 meta.date = value;
             } else if(key == "classes") {
                 if(starts_with(value, "[") && ends_with(value, "]")) {
-                    meta.classes = utils::StringUtils::parse_array(value);
+                    meta.classes = utils::Symbol::intern_all(utils::StringUtils::parse_array(value));
                 } else {
                     meta.classes = {value};
                 }
             } else if(key == "tags") {
                 if(starts_with(value, "[") && ends_with(value, "]")) {
-                    meta.tags = utils::StringUtils::parse_array(value);
+                    meta.tags = utils::Symbol::intern_all(utils::StringUtils::parse_array(value));
                 } else {
                     meta.tags = {value};
                 }
+            } else if(key == "aliases") {
+                if(starts_with(value, "[") && ends_with(value, "]")) {
+                    meta.aliases = utils::StringUtils::parse_array(value);
+                } else if(!value.empty()) {
+                    meta.aliases = {value};
+                }
             } else {
                 meta.custom_fields[key] = value;
             }
         }
+    }
 
-        std::string content = frontmatter_result.content;
-        content = parse_inline_classes(content);
-
-        content_ast = markdown::Deserializer::deserialize(content);
+    void ContentFile::render_html(const markdown::HtmlOptions &options) {
+        if(content_snapshot) {
+            rendered_html = markdown::Serializer::html<markdown::snapshot::ViewAccess>(content_snapshot->root(), options);
+        } else {
+            rendered_html = markdown::Serializer::html(content_ast, options);
+        }
     }
 
-    void ContentFile::render_html() { rendered_html = markdown::Serializer::html(content_ast); }
+    void ContentFile::stream_content(const std::string &raw_content, const markdown::HtmlOptions &options) {
+        std::string content = parse_inline_classes(parse_metadata(raw_content));
+        content_ast = markdown::Node();
+        content_snapshot.reset();
+        rendered_html.clear();
+
+        markdown::HtmlStreamWriter writer([this](std::string_view markup) { rendered_html.append(markup); }, options);
+        markdown::StreamingDeserializer parser([&writer](markdown::Node &&block) { writer.block(block); });
+        std::string_view input(content);
+        for(size_t offset = 0; offset < input.size(); offset += READ_BLOCK_SIZE) {
+            parser.feed(input.substr(offset, READ_BLOCK_SIZE));
+        }
+        parser.finish();
+        writer.finish();
+
+        content_loaded = true;
+    }
 
     std::string ContentFile::parse_inline_classes(const std::string &content) {
+        return strip_inline_classes(content, &meta.classes);
+    }
+
+    std::string ContentFile::strip_inline_classes(const std::string &content, std::vector<utils::Symbol> *classes) {
         std::string processed = content;
 
         std::regex inline_class_regex(R"((#+\s*[^-]+)\s*---\s*classes\[([^\]]+)\])");
@@ -61,14 +191,12 @@ namespace ssg {
             std::string heading = match[1].str();
             std::string classes_str = match[2].str();
 
-            std::vector<std::string> classes;
             std::regex class_regex("\"([^\"]+)\"");
             std::sregex_iterator start(classes_str.begin(), classes_str.end(), class_regex);
             std::sregex_iterator end;
 
-            for(std::sregex_iterator i = start; i != end; ++i) {
-                classes.push_back((*i)[1].str());
-                meta.classes.push_back((*i)[1].str());
+            for(std::sregex_iterator i = start; classes && i != end; ++i) {
+                classes->emplace_back((*i)[1].str());
             }
 
             processed = std::regex_replace(processed, inline_class_regex, heading, std::regex_constants::format_first_only);
@@ -77,38 +205,229 @@ namespace ssg {
         return processed;
     }
 
+    markdown::HtmlOptions ContentManager::options_for(const ContentFile &content) {
+        markdown::HtmlOptions options = html_options;
+        if(options.lazy_images) {
+            options.image_size = [this, &content](const std::string &src) { return resolve_image(content, src); };
+        }
+        return options;
+    }
+
+    std::optional<markdown::ImageSize> ContentManager::resolve_image(const ContentFile &content, const std::string &src) {
+        if(src.empty() || starts_with(src, "//") || starts_with(src, "data:") || src.find("://") != std::string::npos) {
+            return std::nullopt;
+        }
+
+        std::string path = src.substr(0, src.find_first_of("?#"));
+        std::vector<std::filesystem::path> candidates;
+        if(starts_with(path, "/")) {
+            candidates = {content_dir / path.substr(1), output_dir / path.substr(1)};
+        } else if(!content.source_path.empty()) {
+            candidates = {content.source_path.parent_path() / path, content_dir / path};
+        } else {
+            candidates = {content_dir / path};
+        }
+
+        for(const auto &candidate : candidates) {
+            if(auto probe = image_cache.probe(candidate)) {
+                return markdown::ImageSize{probe->width, probe->height};
+            }
+        }
+        return std::nullopt;
+    }
+
+    void ContentManager::parse(ContentFile &content, const std::string &raw_content) {
+        std::filesystem::path snapshot_path;
+        if(!snapshot_dir.empty()) {
+            std::string source = utils::FileUtils::relative_output_path(content.source_path, content_dir);
+            snapshot_path = snapshot_dir / (utils::HashUtils::to_hex(utils::HashUtils::fnv1a(source)) + ".mdast");
+        }
+        content.parse_content(raw_content, parse_pool, snapshot_path);
+    }
+
     ContentManager::ContentManager(const std::filesystem::path &content_path, const std::filesystem::path &output_path)
         : content_dir(content_path), output_dir(output_path) {}
 
-    void ContentManager::scan_content() {
+    void ContentManager::scan_metadata() {
         content_files.clear();
 
-        auto md_files = utils::FileUtils::get_files_with_extension(content_dir, ".md");
-
-        for(const auto &file_path : md_files) {
+        MetadataIndex index;
+        if(!metadata_index_path.empty()) {
+            index.load(metadata_index_path);
+        }
+        size_t previous_size = index.size();
+        MetadataIndex::RefreshStats stats = index.refresh(content_dir, parse_pool);
+        if(!metadata_index_path.empty() && (stats.scanned > 0 || index.size() != previous_size)) {
             try {
-                ContentFile content_file;
-                content_file.source_path = file_path;
-                content_file.generate_route(content_dir);
+                index.save(metadata_index_path);
+            } catch(const std::exception &e) {
+                std::cerr << "⚠️  " << e.what() << std::endl;
+            }
+        }
 
-                std::string raw_content = utils::FileUtils::read_file(file_path);
-                content_file.parse_content(raw_content);
-                content_file.render_html();
+        content_files.reserve(index.size());
+        for(size_t row = 0; row < index.size(); ++row) {
+            ContentFile content_file;
+            content_file.source_path = content_dir / index.source(row);
+            content_file.route = index.route(row);
+            content_file.slug = utils::FileUtils::path_to_slug(content_file.source_path);
+            content_file.apply_metadata(index.metadata(row));
+            content_files.push_back(std::move(content_file));
+        }
 
-                content_files.push_back(std::move(content_file));
+        std::cout << "🔎 Scanned metadata for " << content_files.size() << " pages (" << stats.scanned << " read, "
+                  << stats.reused << " unchanged)" << std::endl;
+    }
 
-                std::cout << "📄 Loaded: " << file_path.filename() << " -> " << content_file.route << std::endl;
+    void ContentManager::load_content(ContentFile &content) {
+        if(content.content_loaded || content.source_path.empty()) {
+            return;
+        }
 
-            } catch(const std::exception &e) {
-                std::cerr << "⚠️  Error processing " << file_path << ": " << e.what() << std::endl;
+        if(streaming) {
+            // A first pass over the body, one line at a time: heading classes feed the page's styles, which the
+            // layout writes before the body, and a shortcode means the whole source has to be expanded after all.
+            std::map<std::string, std::string> metadata;
+            std::optional<BodyStart> start = find_body_start(content.source_path, &metadata);
+            bool directives = false;
+            std::vector<utils::Symbol> inline_classes;
+            if(start) {
+                for_each_line(content.source_path, start->offset, [&](std::string_view line) {
+                    directives = directives || line.find("{{<") != std::string_view::npos;
+                    if(line.find("classes[") != std::string_view::npos) {
+                        ContentFile::strip_inline_classes(std::string(line), &inline_classes);
+                    }
+                });
+            }
+
+            if(!start || (directives && shortcodes)) {
+                auto raw_content = std::make_shared<const std::string>(utils::FileUtils::read_file(content.source_path));
+                content.stream_content(*expand_source(content, std::move(raw_content)), options_for(content));
+                return;
+            }
+
+            content.apply_metadata(metadata);
+            content.meta.classes.insert(content.meta.classes.end(), inline_classes.begin(), inline_classes.end());
+            if(page_dependencies) {
+                page_dependencies->set(utils::FileUtils::relative_output_path(content.source_path, content_dir), {});
+            }
+            content.content_ast = markdown::Node();
+            content.content_snapshot.reset();
+            content.rendered_html.clear();
+            content.body_deferred = true;
+            content.content_loaded = true;
+            return;
+        }
+
+        std::shared_ptr<const std::string> raw_content = expand_source(content, read_source(content.source_path));
+        uint64_t key = 0;
+        if(build_cache) {
+            key = page_key(content, *raw_content);
+            if(auto page = build_cache->find_page(key)) {
+                content.meta = page->meta;
+                content.rendered_html = page->rendered_html;
+                content.content_loaded = true;
+                return;
+            }
+        }
+
+        parse(content, *raw_content);
+        content.render_html(options_for(content));
+
+        if(build_cache) {
+            build_cache->store_page(key, std::make_shared<const BuildCache::Page>(
+                                             BuildCache::Page{content.meta, content.rendered_html}));
+        }
+    }
+
+    std::shared_ptr<const std::string> ContentManager::read_source(const std::filesystem::path &path) {
+        if(build_cache) {
+            return build_cache->read_file(path);
+        }
+        return std::make_shared<const std::string>(utils::FileUtils::read_file(path));
+    }
+
+    std::shared_ptr<const std::string> ContentManager::expand_source(const ContentFile &content,
+                                                                     std::shared_ptr<const std::string> raw_content) {
+        if(!shortcodes) {
+            return raw_content;
+        }
+        ShortcodeExpander::Expansion expansion;
+        try {
+            expansion = shortcodes->expand(std::move(raw_content));
+        } catch(const std::exception &e) {
+            throw std::runtime_error(content.source_path.string() + ": " + e.what());
+        }
+        if(page_dependencies) {
+            page_dependencies->set(utils::FileUtils::relative_output_path(content.source_path, content_dir),
+                                   expansion.dependencies);
+        }
+        return expansion.text;
+    }
+
+    uint64_t ContentManager::page_key(const ContentFile &content, std::string_view raw_content) const {
+        uint64_t key = utils::HashUtils::fnv1a(raw_content);
+        key = utils::HashUtils::fnv1a(content.source_path.string(), key);
+        key = utils::HashUtils::fnv1a(content_dir.string(), key);
+        char flags[3] = {html_options.highlight_code ? '1' : '0', html_options.lazy_images ? '1' : '0',
+                         static_cast<char>('0' + static_cast<int>(html_options.class_profile))};
+        key = utils::HashUtils::fnv1a(std::string_view(flags, sizeof(flags)), key);
+        if(html_options.class_profile == markdown::ClassProfile::Mapped && html_options.class_names) {
+            for(const auto &name : html_options.class_names->names) {
+                key = utils::HashUtils::fnv1a(name + '\n', key);
             }
         }
+        return key;
     }
 
-    void ContentManager::process_all() {
-        for(auto &content : content_files) {
-            content.render_html();
+    void ContentManager::stream_body(const ContentFile &content, const std::function<void(std::string_view)> &write) {
+        std::optional<BodyStart> start = find_body_start(content.source_path);
+        if(!start) {
+            throw std::runtime_error("Front matter too large to stream: " + content.source_path.string());
+        }
+
+        markdown::HtmlStreamWriter writer(write, options_for(content));
+        markdown::StreamingDeserializer parser([&writer](markdown::Node &&block) { writer.block(block); });
+        // A trimmed body loses its leading and trailing whitespace, so whitespace is held back until text follows.
+        bool leading = start->trim;
+        std::string held;
+        for_each_line(content.source_path, start->offset, [&](std::string_view line) {
+            size_t last = line.find_last_not_of(" \t\r");
+            if(last == std::string_view::npos) {
+                if(!leading) {
+                    held.append(line);
+                    held += '\n';
+                }
+                return;
+            }
+            if(leading) {
+                line.remove_prefix(line.find_first_not_of(" \t\r"));
+                last = line.find_last_not_of(" \t\r");
+                leading = false;
+            }
+            parser.feed(held);
+            std::string_view text = line.substr(0, last + 1);
+            if(text.find("classes[") != std::string_view::npos) {
+                parser.feed(ContentFile::strip_inline_classes(std::string(text)));
+            } else {
+                parser.feed(text);
+            }
+            held.assign(line.substr(last + 1));
+            held += '\n';
+        });
+        if(!start->trim) {
+            parser.feed(held);
         }
+        parser.finish();
+        writer.finish();
+    }
+
+    void ContentManager::release_content(ContentFile &content) {
+        content.content_ast = markdown::Node();
+        content.content_snapshot.reset();
+        std::string().swap(content.rendered_html);
+        content.content_loaded = false;
+        content.body_deferred = false;
     }
 
     const ContentFile *ContentManager::get_content(const std::string &route) const {
@@ -122,6 +441,8 @@ namespace ssg {
 
     const std::vector<ContentFile> &ContentManager::get_all_content() const { return content_files; }
 
+    std::vector<ContentFile> &ContentManager::get_all_content() { return content_files; }
+
     void ContentManager::generate_indexes() {
         std::map<std::string, std::vector<const ContentFile *>> directories;
 
@@ -149,33 +470,12 @@ namespace ssg {
                 }
 
                 index_file.content_ast = markdown::Deserializer::deserialize(index_content.str());
-                index_file.render_html();
+                index_file.content_loaded = true;
+                index_file.render_html(options_for(index_file));
 
                 content_files.push_back(std::move(index_file));
             }
         }
     }
 
-    void ContentManager::write_output() {
-        utils::FileUtils::ensure_directory(output_dir);
-
-        for(const auto &content : content_files) {
-            std::filesystem::path output_path = output_dir;
-
-            if(content.route == "/") {
-                output_path /= "index.html";
-            } else {
-                std::string route = content.route;
-                if(starts_with(route, "/")) {
-                    route = route.substr(1);
-                }
-                output_path /= route;
-                output_path += ".html";
-            }
-
-            utils::FileUtils::write_file(output_path, content.rendered_html);
-            std::cout << "📝 Written: " << output_path << std::endl;
-        }
-    }
-
 } // namespace ssg
\ No newline at end of file
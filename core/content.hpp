@@ -1,19 +1,35 @@
 #pragma once
 
 #include <filesystem>
+#include <functional>
 #include <map>
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
 #include "../parsers/markdown/markdown.hpp"
+#include "../utils/intern.hpp"
+#include "../utils/thread_pool.hpp"
+#include "images.hpp"
+
+namespace markdown::snapshot {
+    class Snapshot;
+}
 
 namespace ssg {
+    class BuildCache;
+    class PageDependencies;
+    class ShortcodeExpander;
+
     struct ContentMeta {
         std::string title;
-        std::string layout = "default";
+        utils::Symbol layout = "default";
         std::string date;
-        std::vector<std::string> classes;
-        std::vector<std::string> tags;
+        std::vector<utils::Symbol> classes;
+        std::vector<utils::Symbol> tags;
+        // Old URLs of this page; the build turns them into redirects rather than stub pages.
+        std::vector<std::string> aliases;
         std::map<std::string, std::string> custom_fields;
     };
 
@@ -23,13 +39,33 @@ namespace ssg {
         std::string slug;
         ContentMeta meta;
         markdown::Node content_ast;
+        // Set instead of content_ast when the body came from an AST snapshot; render_html walks it in place.
+        std::shared_ptr<const markdown::snapshot::Snapshot> content_snapshot;
         std::string rendered_html;
+        bool content_loaded = false;
+        // Set by a streaming load that left the body on disk: rendered_html stays empty and
+        // ContentManager::stream_body renders the body where the page needs it.
+        bool body_deferred = false;
 
         void generate_route(const std::filesystem::path &content_base_dir);
 
-        void parse_content(const std::string &raw_content);
+        // With a pool, large bodies are split at block boundaries and parsed in parallel. With a snapshot path, that
+        // snapshot is mapped into content_snapshot when it was taken from the same body, and written there otherwise.
+        void parse_content(const std::string &raw_content, utils::ThreadPool *pool = nullptr,
+                           const std::filesystem::path &snapshot_path = {});
+
+        std::string parse_metadata(const std::string &raw_content);
+
+        // Resets meta from already parsed front matter.
+        void apply_metadata(const std::map<std::string, std::string> &metadata);
 
-        void render_html();
+        void render_html(const markdown::HtmlOptions &options = {});
+
+        // parse_content + render_html without materializing the line list or the AST; content_ast stays empty.
+        void stream_content(const std::string &raw_content, const markdown::HtmlOptions &options = {});
+
+        // Drops `--- classes["a", "b"]` from headings, adding the classes to `classes` when given.
+        static std::string strip_inline_classes(const std::string &content, std::vector<utils::Symbol> *classes = nullptr);
 
     private:
         std::string parse_inline_classes(const std::string &content);
@@ -40,20 +76,81 @@ namespace ssg {
         std::filesystem::path content_dir;
         std::filesystem::path output_dir;
         std::vector<ContentFile> content_files;
+        markdown::HtmlOptions html_options;
+        ImageProbeCache image_cache;
+        bool streaming = false;
+        utils::ThreadPool *parse_pool = nullptr;
+        std::filesystem::path snapshot_dir;
+        std::filesystem::path metadata_index_path;
+        BuildCache *build_cache = nullptr;
+        ShortcodeExpander *shortcodes = nullptr;
+        PageDependencies *page_dependencies = nullptr;
+
+        markdown::HtmlOptions options_for(const ContentFile &content);
+
+        std::shared_ptr<const std::string> read_source(const std::filesystem::path &path);
+
+        // The page's source with includes and shortcodes expanded, recording what it was expanded from.
+        std::shared_ptr<const std::string> expand_source(const ContentFile &content,
+                                                         std::shared_ptr<const std::string> raw_content);
+
+        // Everything a page's HTML depends on: its expanded bytes, where it lives (relative images resolve against
+        // that) and the render flags.
+        uint64_t page_key(const ContentFile &content, std::string_view raw_content) const;
+
+        void parse(ContentFile &content, const std::string &raw_content);
+
+        std::optional<markdown::ImageSize> resolve_image(const ContentFile &content, const std::string &src);
 
     public:
         ContentManager(const std::filesystem::path &content_path, const std::filesystem::path &output_path);
 
-        void scan_content();
+        void set_html_options(const markdown::HtmlOptions &options) { html_options = options; }
+
+        ImageProbeCache &get_image_cache() { return image_cache; }
 
-        void process_all();
+        // Loaded pages keep their body on disk until stream_body renders it block by block.
+        void set_streaming(bool enabled) { streaming = enabled; }
+
+        // Pool that load_content may split large pages across; null parses every page on the calling thread.
+        void set_parse_pool(utils::ThreadPool *pool) { parse_pool = pool; }
+
+        // Directory for per-page AST snapshots; empty disables them.
+        void set_snapshot_dir(const std::filesystem::path &dir) { snapshot_dir = dir; }
+
+        // Where scan_metadata keeps its MetadataIndex between builds; empty rescans every file's front matter.
+        void set_metadata_index_path(const std::filesystem::path &path) { metadata_index_path = path; }
+
+        // Cache shared with the other variants of a batch build; pages it already holds are not parsed again.
+        // Streaming builds bypass it, since keeping every page would defeat them.
+        void set_build_cache(BuildCache *cache) { build_cache = cache; }
+
+        // Expands includes and shortcodes in page sources; null leaves them as written.
+        void set_shortcodes(ShortcodeExpander *expander) { shortcodes = expander; }
+
+        // Where each loaded page's include and shortcode files are recorded; null records nothing.
+        void set_page_dependencies(PageDependencies *dependencies) { page_dependencies = dependencies; }
+
+        // Front matter only, read through the metadata index on the parse pool; bodies wait for load_content.
+        void scan_metadata();
+
+        // When streaming, only the front matter and heading classes are read here and the body is deferred to
+        // stream_body. Pages with shortcodes are the exception: expanding them needs the whole source, so they are
+        // rendered into rendered_html through ContentFile::stream_content.
+        void load_content(ContentFile &content);
+
+        // Reads a deferred body a block at a time, parses it incrementally and hands each rendered block to
+        // `write`, so neither the source nor its HTML is ever held whole.
+        void stream_body(const ContentFile &content, const std::function<void(std::string_view)> &write);
+
+        void release_content(ContentFile &content);
 
         const ContentFile *get_content(const std::string &route) const;
 
         const std::vector<ContentFile> &get_all_content() const;
 
-        void generate_indexes();
+        std::vector<ContentFile> &get_all_content();
 
-        void write_output();
+        void generate_indexes();
     };
 } // namespace ssg
@@ -1,49 +1,171 @@
 #include "generator.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <regex>
+#include <set>
+#include <sstream>
 
+#include "../http/redirects.hpp"
+#include "../parsers/html/rewriter.hpp"
 #include "../parsers/template/template_engine.hpp"
 #include "../utils/file_utils.hpp"
 #include "config.hpp"
+#include "metadata_index.hpp"
+#include "task_graph.hpp"
 
 using ssg::utils::ends_with;
 using ssg::utils::starts_with;
 
 namespace ssg {
 
-    SiteGenerator::SiteGenerator(const std::filesystem::path &project_path)
-        : project_root(project_path), content_manager(g_config.get_content_path(), g_config.get_output_path()) {
+    namespace {
+        // The directory part of a page's route, as the generated index pages group them: "/blog/post" is in
+        // "/blog", top-level pages in "/".
+        std::string section_of(const ContentFile &content) {
+            std::string section = std::filesystem::path(content.route).parent_path().generic_string();
+            return section.empty() ? "/" : section;
+        }
+
+        // Stands in for a deferred page body in the rendered layout; control characters keep it out of real text.
+        constexpr std::string_view BODY_MARKER = "\x1f" "chisel:body" "\x1f";
+
+        // Whether every use of `content` in the template is a plain {{content}}, so the body can be spliced into
+        // the output where the marker appears instead of being passed through conditions or helpers.
+        bool splices_body(const std::string &template_html) {
+            static const std::regex tag(R"(\{\{([^}]*)\}\})");
+            static const std::regex content_word(R"((^|[^\w.])content($|[^\w]))");
+            for(std::sregex_iterator it(template_html.begin(), template_html.end(), tag), end; it != end; ++it) {
+                std::string inner = utils::StringUtils::trim((*it)[1].str());
+                if(inner != "content" && std::regex_search(inner, content_word)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Passes rendered chunks on to `write`, replacing each BODY_MARKER with the streamed body. A marker split
+        // across chunks is caught by holding back a possible marker prefix until the next chunk.
+        class BodySplicer {
+        public:
+            BodySplicer(const template_engine::ChunkWriter &write, std::function<void()> write_body)
+                : write_(write), write_body_(std::move(write_body)) {}
+
+            void write(std::string_view chunk) {
+                pending_.append(chunk);
+                std::string_view data(pending_);
+                size_t marker;
+                while((marker = data.find(BODY_MARKER)) != std::string_view::npos) {
+                    write_(data.substr(0, marker));
+                    write_body_();
+                    data.remove_prefix(marker + BODY_MARKER.size());
+                }
+                size_t keep = 0;
+                for(size_t n = std::min(data.size(), BODY_MARKER.size() - 1); n > 0; --n) {
+                    if(BODY_MARKER.substr(0, n) == data.substr(data.size() - n)) {
+                        keep = n;
+                        break;
+                    }
+                }
+                write_(data.substr(0, data.size() - keep));
+                pending_ = std::string(data.substr(data.size() - keep));
+            }
+
+            void finish() {
+                write_(pending_);
+                pending_.clear();
+            }
+
+        private:
+            const template_engine::ChunkWriter &write_;
+            std::function<void()> write_body_;
+            std::string pending_;
+        };
+    } // namespace
+
+    SiteGenerator::SiteGenerator(const std::filesystem::path &project_path, const BuildOptions &build_options)
+        : project_root(project_path), content_manager(g_config.get_content_path(), g_config.get_output_path()),
+          shortcodes(std::filesystem::absolute(project_path), g_config.get_includes_path(),
+                     g_config.get_templates_path() / "shortcodes"),
+          options(build_options), sink(build_options.sink) {
 
         content_dir = g_config.get_content_path();
         styles_dir = g_config.get_styles_path();
         output_dir = g_config.get_output_path();
+        if(!sink) {
+            sink = std::make_shared<FileSystemSink>(output_dir);
+        }
+
+        markdown::HtmlOptions html_options;
+        html_options.highlight_code = g_config.build.syntax_highlighting;
+        html_options.lazy_images = g_config.build.lazy_images;
+        if(g_config.build.html_profile == "compact") {
+            html_options.class_profile = markdown::ClassProfile::Compact;
+        } else if(g_config.build.html_profile == "mapped") {
+            html_options.class_profile = markdown::ClassProfile::Mapped;
+            html_options.class_names =
+                std::make_shared<const markdown::MappedClasses>(markdown::MappedClasses::from(g_config.build.html_classes));
+        }
+        content_manager.set_html_options(html_options);
+        content_manager.set_streaming(options.streaming);
+        content_manager.set_build_cache(options.streaming ? nullptr : options.cache.get());
+        content_manager.set_shortcodes(&shortcodes);
+        content_manager.set_page_dependencies(&page_dependencies);
+        if(g_config.performance.enable_cache) {
+            // Snapshots are checked against the page body, so variants building the same sources can share them.
+            content_manager.set_snapshot_dir(BuildManifest::state_dir(project_root) / "ast");
+            content_manager.set_metadata_index_path(
+                MetadataIndex::default_path(project_root, g_config.get_content_path()));
+        }
+        if(html_options.lazy_images) {
+            content_manager.get_image_cache().load(ImageProbeCache::default_path(project_root));
+        }
+        load_catalog();
+
+        if(options.is_partial()) {
+            // Outputs we do not rebuild stay valid, so start from what the previous build recorded.
+            if(!manifest.load(BuildManifest::default_path(project_root, options.variant))) {
+                std::cout << "⚠️  No previous build manifest found; a partial build may leave the output incomplete"
+                          << std::endl;
+            }
+            page_dependencies.load(BuildManifest::state_dir(project_root, options.variant) / PageDependencies::FILE_NAME);
+        }
     }
 
     void SiteGenerator::load_styles() {
         stylesheets.clear();
+        global_styles = utils::Symbol::intern_all(g_config.build.global_styles);
 
         if(!std::filesystem::exists(styles_dir)) {
             std::cout << "📁 No styles directory found" << std::endl;
             return;
         }
 
-        std::filesystem::path output_styles_dir = output_dir / "styles";
-        std::filesystem::create_directories(output_styles_dir);
-
         auto css_files = utils::FileUtils::get_files_with_extension(styles_dir, ".css");
+        std::optional<std::filesystem::path> sink_dir = sink->directory();
 
         for(const auto &css_file : css_files) {
             try {
                 StyleSheet stylesheet;
                 stylesheet.name = css_file.stem().string();
 
-                std::filesystem::path output_css_file = output_styles_dir / css_file.filename();
+                std::string relative_css_path = "styles/" + css_file.filename().generic_string();
+                std::optional<std::filesystem::path> output_css_file;
+                if(sink_dir) {
+                    output_css_file = *sink_dir / relative_css_path;
+                }
+
+                bool reuse_existing = options.is_partial() && output_css_file && std::filesystem::exists(*output_css_file);
+                if(!options.shard.owns(relative_css_path) || reuse_existing) {
+                    stylesheets[stylesheet.name] = std::move(stylesheet);
+                    continue;
+                }
 
                 if(css_file != output_css_file) {
-                    std::filesystem::copy_file(css_file, output_css_file, std::filesystem::copy_options::overwrite_existing);
+                    write_output(relative_css_path, read_source(css_file));
                     std::cout << "🎨 Copied stylesheet: " << stylesheet.name << ".css" << std::endl;
                 } else {
+                    manifest.record(relative_css_path, read_source(css_file));
                     std::cout << "🎨 Stylesheet already in place: " << stylesheet.name << ".css" << std::endl;
                 }
 
@@ -56,107 +178,529 @@ namespace ssg {
     }
 
     void SiteGenerator::load_layouts() {
-        layouts.clear();
+        {
+            std::lock_guard<std::mutex> lock(layouts_mutex);
+            layouts.clear();
+        }
 
+        for(const auto &template_file : layout_files()) {
+            load_layout(template_file);
+        }
+    }
+
+    std::vector<std::filesystem::path> SiteGenerator::layout_files() const {
         std::filesystem::path templates_dir = g_config.get_templates_path();
 
         if(!std::filesystem::exists(templates_dir)) {
             std::cout << "📁 No templates directory found" << std::endl;
-            return;
+            return {};
         }
 
-        auto template_files = utils::FileUtils::get_files_with_extension(templates_dir, ".html");
+        return utils::FileUtils::get_files_with_extension(templates_dir, ".html");
+    }
 
-        for(const auto &template_file : template_files) {
-            try {
-                Layout layout;
-                layout.name = template_file.stem().string();
-                layout.template_html = utils::FileUtils::read_file(template_file);
+    void SiteGenerator::load_layout(const std::filesystem::path &template_file) {
+        try {
+            Layout layout;
+            layout.name = template_file.stem().string();
+            layout.template_html = read_source(template_file);
 
-                auto layout_styles_it = g_config.build.layout_styles.find(layout.name);
-                if(layout_styles_it != g_config.build.layout_styles.end()) {
-                    layout.required_styles = layout_styles_it->second;
-                }
+            auto layout_styles_it = g_config.build.layout_styles.find(layout.name);
+            if(layout_styles_it != g_config.build.layout_styles.end()) {
+                layout.required_styles = utils::Symbol::intern_all(layout_styles_it->second);
+            }
 
+            std::string message = "📄 Loaded template: " + layout.name + ".html\n";
+            {
+                std::lock_guard<std::mutex> lock(layouts_mutex);
                 layouts[layout.name] = std::move(layout);
-                std::cout << "📄 Loaded template: " << layout.name << ".html" << std::endl;
+            }
+            std::cout << message << std::flush;
 
-            } catch(const std::exception &e) {
-                std::cerr << "⚠️  Error loading template " << template_file << ": " << e.what() << std::endl;
+        } catch(const std::exception &e) {
+            std::cerr << "⚠️  Error loading template " << template_file << ": " << e.what() << std::endl;
+        }
+    }
+
+    std::string SiteGenerator::read_source(const std::filesystem::path &path) const {
+        return options.cache ? *options.cache->read_file(path) : utils::FileUtils::read_file(path);
+    }
+
+    void SiteGenerator::load_catalog() {
+        std::filesystem::path i18n_dir = g_config.get_i18n_path();
+        std::string fallback = options.fallback_language;
+        if(options.cache) {
+            catalog = options.cache->catalog(i18n_dir, g_config.site.language, fallback);
+        } else {
+            catalog = std::make_shared<const i18n::Catalog>(i18n::Catalog::load(i18n_dir, g_config.site.language, fallback));
+        }
+        i18n::g_catalog = catalog;
+        i18n::register_template_helper();
+        if(catalog->size() > 0) {
+            std::cout << "🌍 " << catalog->size() << " translated strings for " << g_config.site.language << std::endl;
+        }
+    }
+
+    size_t SiteGenerator::build_thread_count() {
+        if(!g_config.performance.parallel_processing) {
+            return 1;
+        }
+        return g_config.performance.build_threads > 0 ? g_config.performance.build_threads
+                                                      : utils::ThreadPool::default_thread_count();
+    }
+
+    void SiteGenerator::build() {
+        utils::ThreadPool pool(build_thread_count());
+        TaskGraph graph(pool);
+
+        std::cout << "🚀 Starting site generation on " << pool.size() << " threads..." << std::endl;
+
+        {
+            std::lock_guard<std::mutex> lock(layouts_mutex);
+            layouts.clear();
+        }
+        shortcodes.clear();
+
+        TaskId styles_task = graph.add("styles", [this] { load_styles(); });
+
+        std::map<utils::Symbol, TaskId> layout_tasks;
+        for(const auto &template_file : layout_files()) {
+            layout_tasks[template_file.stem().string()] =
+                graph.add("layout " + template_file.filename().string(), [this, template_file] { load_layout(template_file); });
+        }
+
+        // Only front matter is read up front; each page task parses and renders its own body.
+        TaskId scan_task = graph.add("scan content", [this] {
+            print_generation_notes();
+            content_manager.scan_metadata();
+        });
+
+        // Page tasks can only be created once the content list is known; each one waits for its own layout
+        // (and the default layout it may fall back to) rather than for every template.
+        TaskId plan_task = 0;
+        plan_task = graph.add(
+            "plan pages",
+            [this, &graph, &plan_task, styles_task, layout_tasks] {
+                std::vector<TaskId> page_tasks = {styles_task};
+
+                for(ContentFile *content : plan_pages()) {
+                    std::vector<TaskId> dependencies = {plan_task, styles_task};
+                    for(utils::Symbol layout_name : {content->meta.layout, utils::Symbol("default")}) {
+                        auto layout_it = layout_tasks.find(layout_name);
+                        if(layout_it != layout_tasks.end()) {
+                            dependencies.push_back(layout_it->second);
+                        }
+                    }
+                    page_tasks.push_back(graph.add("page " + content->route, [this, content] { build_page(*content); },
+                                                   dependencies));
+                }
+
+                page_tasks.push_back(graph.add("redirects", [this] { write_redirects(); }, {plan_task}));
+
+                graph.add("manifest", [this] { finalize_manifest(); }, page_tasks);
+            },
+            {scan_task});
+
+        content_manager.set_parse_pool(&pool);
+        try {
+            graph.run();
+        } catch(...) {
+            content_manager.set_parse_pool(nullptr);
+            throw;
+        }
+        content_manager.set_parse_pool(nullptr);
+
+        if(options.profile) {
+            graph.print_profile(std::cout);
+        }
+
+        std::cout << "🎉 Site generation complete!" << std::endl;
+    }
+
+    void SiteGenerator::apply_config_changes(const ConfigChanges &changes) {
+        std::set<utils::Symbol> restyled_layouts;
+        {
+            std::lock_guard<std::mutex> lock(layouts_mutex);
+            for(const auto &layout_name : changes.layouts) {
+                auto layout_it = layouts.find(layout_name);
+                if(layout_it == layouts.end()) {
+                    continue;
+                }
+                auto styles_it = g_config.build.layout_styles.find(layout_name);
+                layout_it->second.required_styles = styles_it != g_config.build.layout_styles.end()
+                                                        ? utils::Symbol::intern_all(styles_it->second)
+                                                        : std::vector<utils::Symbol>{};
+                restyled_layouts.insert(layout_it->first);
             }
         }
+        if(changes.global_styles) {
+            global_styles = utils::Symbol::intern_all(g_config.build.global_styles);
+        }
+        if(changes.language) {
+            load_catalog();
+        }
+
+        // Same layout resolution as generate_page: a page falling back to the default template gets no layout
+        // styles, so it is unaffected by layout_styles edits.
+        bool every_page = changes.site || changes.global_styles;
+        auto &all_content = content_manager.get_all_content();
+        std::vector<ContentFile *> pages;
+        for(ContentFile *content : select_pages()) {
+            if(every_page || restyled_layouts.count(content->meta.layout)) {
+                pages.push_back(content);
+            }
+        }
+
+        if(pages.empty()) {
+            std::cout << "📋 No pages affected by the configuration change" << std::endl;
+            return;
+        }
+        std::cout << "🔁 Re-templating " << pages.size() << " of " << all_content.size() << " pages" << std::endl;
+        shortcodes.clear();
+
+        utils::ThreadPool pool(build_thread_count());
+        TaskGraph graph(pool);
+        std::vector<TaskId> page_tasks;
+        for(ContentFile *content : pages) {
+            page_tasks.push_back(graph.add("page " + content->route, [this, content] { build_page(*content); }));
+        }
+        graph.add("manifest", [this] { finalize_manifest(); }, page_tasks);
+        graph.run();
     }
 
-    void SiteGenerator::generate() {
-        std::cout << "🚀 Starting site generation..." << std::endl;
+    void SiteGenerator::print_generation_notes() const {
+        if(options.shard.is_sharded()) {
+            std::cout << "🧩 Building shard " << options.shard.index << "/" << options.shard.count << std::endl;
+        }
+        if(options.streaming) {
+            std::cout << "🌊 Streaming build: page bodies are released as soon as they are written" << std::endl;
+        }
+        if(options.is_partial()) {
+            std::cout << "🎯 Partial build: only pages matching " << utils::StringUtils::join(options.only, ", ")
+                      << " and their index pages" << std::endl;
+        }
+    }
 
-        content_manager.scan_content();
-        content_manager.process_all();
+    std::vector<ContentFile *> SiteGenerator::plan_pages() {
         content_manager.generate_indexes();
+        collect_site_pages();
+
+        if(auto sink_dir = sink->directory()) {
+            utils::FileUtils::ensure_directory(*sink_dir);
+        }
+        return select_pages();
+    }
 
-        const auto &all_content = content_manager.get_all_content();
+    std::vector<ContentFile *> SiteGenerator::select_pages() {
+        auto &all_content = content_manager.get_all_content();
 
-        utils::FileUtils::ensure_directory(output_dir);
+        std::set<std::string> selected_routes;
+        if(options.is_partial()) {
+            std::set<std::string> touched_dirs;
+            for(const auto &content : all_content) {
+                if(!content.source_path.empty() && matches_only_filter(content)) {
+                    selected_routes.insert(content.route);
+                    touched_dirs.insert(std::filesystem::path(content.route).parent_path().generic_string());
+                }
+            }
+            // Generated index pages list their directory's pages, so they follow any selected page.
+            for(const auto &content : all_content) {
+                if(content.source_path.empty() && (touched_dirs.count(content.route) || matches_only_filter(content))) {
+                    selected_routes.insert(content.route);
+                }
+            }
+            std::cout << "🎯 " << selected_routes.size() << " of " << all_content.size() << " pages selected" << std::endl;
+        }
+
+        std::vector<ContentFile *> pages;
+        for(auto &content : all_content) {
+            if(!options.shard.owns(content.route)) {
+                continue;
+            }
+            if(options.is_partial() && !selected_routes.count(content.route)) {
+                continue;
+            }
+            pages.push_back(&content);
+        }
+        return pages;
+    }
+
+    // Built from front matter only, so sharded, streaming and partial builds see the whole site too.
+    void SiteGenerator::collect_site_pages() {
+        std::vector<template_engine::TemplateValue> pages;
+        for(const auto &content : content_manager.get_all_content()) {
+            if(content.source_path.empty()) {
+                continue;
+            }
+            std::map<std::string, template_engine::TemplateValue> page;
+            for(const auto &[key, value] : content.meta.custom_fields) {
+                page[key] = template_engine::TemplateValue(value);
+            }
+            page["title"] = template_engine::TemplateValue(content.meta.title);
+            page["url"] = template_engine::TemplateValue(content.route);
+            page["section"] = template_engine::TemplateValue(section_of(content));
+            page["date"] = template_engine::TemplateValue(content.meta.date);
+            page["layout"] = template_engine::TemplateValue(content.meta.layout.str());
+            page["tags"] = template_engine::TemplateValue(utils::Symbol::to_strings(content.meta.tags));
+            pages.emplace_back(page);
+        }
+        site_pages = template_engine::TemplateValue::collection(std::move(pages));
+    }
+
+    void SiteGenerator::build_page(ContentFile &content) {
+        content_manager.load_content(content);
+
+        std::filesystem::path output_path = output_path_for(content);
+        std::string relative_path = utils::FileUtils::relative_output_path(output_path, output_dir);
+        if(g_config.build.minify_html) {
+            // The minifier needs the whole page, so minified pages are still rendered into one string.
+            write_output(relative_path, html::minify(generate_page(content, content.meta.layout)));
+        } else {
+            stream_output(relative_path, [&](const template_engine::ChunkWriter &write_chunk) {
+                generate_page(content, content.meta.layout, write_chunk);
+            });
+        }
+
+        std::ostringstream message;
+        message << "✨ Generated: " << output_path.filename() << "\n";
+        std::cout << message.str() << std::flush;
+
+        if(options.streaming) {
+            content_manager.release_content(content);
+        }
+    }
 
-        for(const auto &content : all_content) {
-            std::string final_html = generate_page(content, content.meta.layout);
+    void SiteGenerator::write_redirects() {
+        if(!options.shard.owns(http::RedirectTable::FILE_NAME)) {
+            return;
+        }
 
-            std::filesystem::path output_path = output_dir;
+        std::set<std::string> routes;
+        std::vector<const ContentFile *> pages;
+        for(const auto &content : content_manager.get_all_content()) {
+            routes.insert(http::RedirectTable::normalize(content.route));
+            if(!content.meta.aliases.empty()) {
+                pages.push_back(&content);
+            }
+        }
+        // Scan order follows the directory listing, so sort to make the winner of a conflict reproducible.
+        std::sort(pages.begin(), pages.end(),
+                  [](const ContentFile *a, const ContentFile *b) { return a->route < b->route; });
+
+        std::vector<http::Redirect> redirects;
+        std::map<std::string, std::string> claimed;
+        for(const ContentFile *content : pages) {
+            std::string target = content->route;
+            if(target != "/" && content->source_path.stem() == "index") {
+                target += "/";
+            }
+            for(const auto &alias : content->meta.aliases) {
+                std::string from = http::RedirectTable::normalize(alias);
+                if(routes.count(from)) {
+                    std::cerr << "⚠️  Alias " << alias << " of " << content->route << " is an existing page, skipped"
+                              << std::endl;
+                    continue;
+                }
+                auto [it, inserted] = claimed.emplace(from, content->route);
+                if(!inserted) {
+                    std::cerr << "⚠️  Alias " << alias << " of " << content->route << " is already claimed by "
+                              << it->second << ", skipped" << std::endl;
+                    continue;
+                }
+                redirects.push_back({from, target, 301});
+            }
+        }
+
+        // An emptied table still has to replace the one an earlier build left in the output directory.
+        std::optional<std::filesystem::path> sink_dir = sink->directory();
+        bool stale_table = sink_dir && std::filesystem::exists(*sink_dir / http::RedirectTable::FILE_NAME);
+        if(redirects.empty() && !stale_table) {
+            return;
+        }
+
+        write_output(http::RedirectTable::TEXT_FILE_NAME, http::RedirectTable::to_text(redirects));
+        write_output(http::RedirectTable::FILE_NAME, http::RedirectTable::build(redirects).serialize());
+        if(!redirects.empty()) {
+            std::cout << "↪️  " << redirects.size() << " redirects written to " << http::RedirectTable::TEXT_FILE_NAME
+                      << std::endl;
+        }
+    }
+
+    std::filesystem::path SiteGenerator::output_path_for(const ContentFile &content) const {
+        std::filesystem::path output_path = output_dir;
+
+        if(content.route == "/") {
+            output_path /= "index.html";
+        } else {
+            std::string route = content.route;
+            if(starts_with(route, "/")) {
+                route = route.substr(1);
+            }
 
-            if(content.route == "/") {
+            std::string filename = content.source_path.filename().stem().string();
+            if(filename == "index") {
+                output_path /= route;
                 output_path /= "index.html";
             } else {
-                std::string route = content.route;
-                if(starts_with(route, "/")) {
-                    route = route.substr(1);
-                }
+                output_path /= route;
+                output_path += ".html";
+            }
+        }
 
-                std::string filename = content.source_path.filename().stem().string();
-                if(filename == "index") {
-                    output_path /= route;
-                    utils::FileUtils::ensure_directory(output_path);
-                    output_path /= "index.html";
-                } else {
-                    output_path /= route;
-                    output_path += ".html";
+        return output_path;
+    }
+
+    bool SiteGenerator::matches_only_filter(const ContentFile &content) const {
+        std::string relative_source;
+        if(!content.source_path.empty()) {
+            relative_source = std::filesystem::relative(content.source_path, content_dir).generic_string();
+        }
+
+        // Snippet and shortcode paths are relative to the project root, as the user would name them.
+        std::vector<std::string> dependencies = page_dependencies.of(relative_source);
+        for(const auto &pattern : options.only) {
+            if(utils::StringUtils::glob_match(pattern, content.route)) {
+                return true;
+            }
+            if(!relative_source.empty() && utils::StringUtils::glob_match(pattern, relative_source)) {
+                return true;
+            }
+            for(const auto &dependency : dependencies) {
+                if(utils::StringUtils::glob_match(pattern, dependency)) {
+                    return true;
                 }
             }
+        }
+        return false;
+    }
+
+    void SiteGenerator::write_output(const std::string &relative_path, const std::string &content) {
+        sink->write(relative_path, content);
+        manifest.record(relative_path, content);
+    }
+
+    void SiteGenerator::stream_output(const std::string &relative_path,
+                                      const std::function<void(const template_engine::ChunkWriter &)> &produce) {
+        std::unique_ptr<OutputFile> file = sink->open_file(relative_path);
+        uint64_t hash = utils::HashUtils::fnv1a({});
+        size_t size = 0;
+        produce([&](std::string_view chunk) {
+            file->write(chunk);
+            hash = utils::HashUtils::fnv1a(chunk, hash);
+            size += chunk.size();
+        });
+        file->close();
+        manifest.record(relative_path, ManifestEntry{utils::HashUtils::to_hex(hash), size});
+    }
 
-            utils::FileUtils::write_file(output_path, final_html);
-            std::cout << "✨ Generated: " << output_path.filename() << std::endl;
+    void SiteGenerator::finalize_manifest() {
+        if(g_config.build.lazy_images) {
+            content_manager.get_image_cache().save(ImageProbeCache::default_path(project_root));
         }
 
-        std::cout << "🎉 Site generation complete!" << std::endl;
+        ShortcodeExpander::Stats expansion_stats = shortcodes.stats();
+        if(expansion_stats.expanded > 0) {
+            std::cout << "📎 Expanded " << expansion_stats.expanded << " includes and shortcodes ("
+                      << expansion_stats.memoized << " reused)" << std::endl;
+        }
+
+        if(options.shard.is_sharded()) {
+            sink->write(ShardManifest::FILE_NAME, ShardManifest::to_json(options.shard, manifest));
+            std::cout << "🧩 Shard " << options.shard.index << "/" << options.shard.count << " wrote "
+                      << manifest.entries().size() << " files, partial manifest: " << ShardManifest::FILE_NAME << " in "
+                      << sink->describe() << std::endl;
+            return;
+        }
+
+        page_dependencies.save(BuildManifest::state_dir(project_root, options.variant) / PageDependencies::FILE_NAME);
+
+        // The manifest describes what is in the configured output directory; a build sent to an archive, stdout
+        // or some other directory must not make the next build of dist/ think its files are already there.
+        auto written_to = sink->directory();
+        if(!written_to ||
+           std::filesystem::weakly_canonical(*written_to) != std::filesystem::weakly_canonical(output_dir)) {
+            std::cout << "📦 Output went to " << sink->describe() << "; build manifest for " << output_dir
+                      << " left unchanged" << std::endl;
+            return;
+        }
+
+        ChangeSet changes = manifest.publish(project_root, options.variant);
+
+        std::cout << "📦 Changes since last build: " << changes.added.size() << " added, " << changes.modified.size()
+                  << " modified, " << changes.removed.size() << " removed" << std::endl;
+        std::cout << "📦 Change set written to: " << BuildManifest::changes_path(project_root, options.variant)
+                  << std::endl;
     }
 
-    std::string SiteGenerator::generate_page(const ContentFile &content, const std::string &layout_name) {
+    std::string SiteGenerator::generate_page(const ContentFile &content, utils::Symbol layout_name) {
+        auto [template_html, styles] = page_template(content, layout_name);
+        auto context = page_context(content, styles);
+        if(content.body_deferred) {
+            context["content"] = template_engine::TemplateValue(deferred_body(content));
+        }
+        return template_engine::TemplateEngine::render(template_html, context);
+    }
+
+    void SiteGenerator::generate_page(const ContentFile &content, utils::Symbol layout_name,
+                                      const template_engine::ChunkWriter &write_chunk) {
+        auto [template_html, styles] = page_template(content, layout_name);
+        auto context = page_context(content, styles);
+        if(!content.body_deferred) {
+            template_engine::TemplateEngine::render(template_html, context, write_chunk);
+            return;
+        }
+        if(!splices_body(template_html)) {
+            context["content"] = template_engine::TemplateValue(deferred_body(content));
+            template_engine::TemplateEngine::render(template_html, context, write_chunk);
+            return;
+        }
+
+        context["content"] = template_engine::TemplateValue(std::string(BODY_MARKER));
+        BodySplicer splicer(write_chunk, [&] { content_manager.stream_body(content, write_chunk); });
+        template_engine::TemplateEngine::render(template_html, context,
+                                                [&splicer](std::string_view chunk) { splicer.write(chunk); });
+        splicer.finish();
+    }
+
+    std::string SiteGenerator::deferred_body(const ContentFile &content) {
+        std::string body;
+        content_manager.stream_body(content, [&body](std::string_view markup) { body.append(markup); });
+        return body;
+    }
+
+    std::pair<std::string, std::string> SiteGenerator::page_template(const ContentFile &content,
+                                                                     utils::Symbol layout_name) {
+        static const utils::Symbol default_layout = "default";
+
         std::string template_html;
-        std::vector<std::string> required_styles;
+        std::vector<utils::Symbol> required_styles;
 
+        std::unique_lock<std::mutex> layouts_lock(layouts_mutex);
         if(layouts.find(layout_name) != layouts.end()) {
             const auto &layout = layouts.at(layout_name);
             template_html = layout.template_html;
             required_styles = layout.required_styles;
         } else {
-            if(layouts.find("default") != layouts.end()) {
-                template_html = layouts.at("default").template_html;
+            if(layouts.find(default_layout) != layouts.end()) {
+                template_html = layouts.at(default_layout).template_html;
             } else {
                 template_html = R"(<!DOCTYPE html>
 <html><head><title>{{title}}</title><style>{{styles}}</style></head>
 <body>{{content}}</body></html>)";
             }
         }
+        layouts_lock.unlock();
 
         std::string combined_styles = collect_styles(required_styles, content.meta.classes);
 
-        return apply_template(template_html, content, combined_styles);
+        return {std::move(template_html), std::move(combined_styles)};
     }
 
-    std::string SiteGenerator::collect_styles(const std::vector<std::string> &required_styles,
-                                              const std::vector<std::string> &content_classes) {
+    std::string SiteGenerator::collect_styles(const std::vector<utils::Symbol> &required_styles,
+                                              const std::vector<utils::Symbol> &content_classes) {
         std::vector<std::string> link_tags;
 
-        for(const auto &global_style : g_config.build.global_styles) {
+        for(const auto &global_style : global_styles) {
             if(stylesheets.find(global_style) != stylesheets.end()) {
                 link_tags.push_back("<link rel=\"stylesheet\" href=\"/styles/" + global_style + ".css\">");
             }
@@ -183,8 +727,8 @@ namespace ssg {
         return result;
     }
 
-    std::string SiteGenerator::apply_template(const std::string &template_html, const ContentFile &content,
-                                              const std::string &styles) {
+    std::map<std::string, template_engine::TemplateValue> SiteGenerator::page_context(const ContentFile &content,
+                                                                                      const std::string &styles) {
         std::map<std::string, template_engine::TemplateValue> context;
 
         context["title"] = template_engine::TemplateValue(content.meta.title);
@@ -196,19 +740,23 @@ namespace ssg {
         context["site_author"] = template_engine::TemplateValue(g_config.site.author);
         context["site_language"] = template_engine::TemplateValue(g_config.site.language);
         context["date"] = template_engine::TemplateValue(content.meta.date);
+        context["url"] = template_engine::TemplateValue(content.route);
+        context["section"] = template_engine::TemplateValue(section_of(content));
+        context["pages"] = site_pages;
 
-        std::string content_classes = utils::StringUtils::join(content.meta.classes, " ");
+        std::string content_classes = utils::StringUtils::join(utils::Symbol::to_strings(content.meta.classes), " ");
         context["content_classes"] = template_engine::TemplateValue(content_classes);
 
-        context["tags"] = template_engine::TemplateValue(content.meta.tags);
-        std::string tags_string = utils::StringUtils::join(content.meta.tags, ", ");
+        std::vector<std::string> tags = utils::Symbol::to_strings(content.meta.tags);
+        context["tags"] = template_engine::TemplateValue(tags);
+        std::string tags_string = utils::StringUtils::join(tags, ", ");
         context["tags_string"] = template_engine::TemplateValue(tags_string);
 
         for(const auto &[key, value] : content.meta.custom_fields) {
             context[key] = template_engine::TemplateValue(value);
         }
 
-        return template_engine::TemplateEngine::render(template_html, context);
+        return context;
     }
 
     void SiteGenerator::serve(int port) {
@@ -1,23 +1,52 @@
 #pragma once
 
 #include <filesystem>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 #include "../parsers/template/template_engine.hpp"
+#include "../utils/intern.hpp"
+#include "build_cache.hpp"
+#include "config.hpp"
 #include "content.hpp"
+#include "manifest.hpp"
+#include "output_sink.hpp"
+#include "shards.hpp"
+#include "shortcodes.hpp"
 
 namespace ssg {
     struct StyleSheet {
-        std::string name;
+        utils::Symbol name;
         std::string content;
     };
 
     struct Layout {
-        std::string name;
+        utils::Symbol name;
         std::string template_html;
-        std::vector<std::string> required_styles;
+        std::vector<utils::Symbol> required_styles;
+    };
+
+    struct BuildOptions {
+        ShardSpec shard;
+        bool streaming = false;
+        // Glob filters on source path (relative to the content directory) or route; empty means build everything.
+        std::vector<std::string> only;
+        // Print per-task timings and the critical path of the build graph.
+        bool profile = false;
+        // Where pages and stylesheets are written; null means the configured output directory.
+        std::shared_ptr<OutputSink> sink;
+        // Set when this build is one variant of a batch: names its state directory under .chisel/variants.
+        std::string variant;
+        // Shared with the batch's other variants; null reads and renders everything itself.
+        std::shared_ptr<BuildCache> cache;
+        // Language whose catalog fills in strings the site's own language lacks; empty means none.
+        std::string fallback_language;
+
+        bool is_partial() const { return !only.empty(); }
     };
 
     class SiteGenerator {
@@ -28,28 +57,95 @@ namespace ssg {
         std::filesystem::path output_dir;
 
         ContentManager content_manager;
-        std::map<std::string, StyleSheet> stylesheets;
-        std::map<std::string, Layout> layouts;
+        std::map<utils::Symbol, StyleSheet> stylesheets;
+        std::vector<utils::Symbol> global_styles;
+        std::map<utils::Symbol, Layout> layouts;
+        std::mutex layouts_mutex;
+        BuildManifest manifest;
+        ShortcodeExpander shortcodes;
+        // Kept from the previous build for partial builds, which match --only against a page's snippets too.
+        PageDependencies page_dependencies;
+        BuildOptions options;
+        std::shared_ptr<OutputSink> sink;
+        std::shared_ptr<const i18n::Catalog> catalog;
+        // Every content page's metadata as `pages` in templates, shared by all pages of a build so sort orders
+        // taken through collection views are computed once.
+        template_engine::TemplateValue site_pages;
 
     public:
-        SiteGenerator(const std::filesystem::path &project_path);
+        SiteGenerator(const std::filesystem::path &project_path, const BuildOptions &build_options = {});
 
         void load_styles();
 
         void load_layouts();
 
-        void generate();
+        // Runs styles, layouts, content scanning and page rendering as a dependency graph on a thread pool.
+        void build();
 
-        std::string generate_page(const ContentFile &content, const std::string &layout_name = "default");
+        // Redoes only what a config reload invalidated, once g_config holds the new config: pages this build owns
+        // (same shard and --only selection as build()) are re-templated from their already rendered markdown, after
+        // reloading the i18n catalog if the language changed. Changes with changes.build set need a new generator.
+        void apply_config_changes(const ConfigChanges &changes);
 
-        std::string collect_styles(const std::vector<std::string> &required_styles,
-                                   const std::vector<std::string> &content_classes);
+        std::string generate_page(const ContentFile &content, utils::Symbol layout_name = "default");
+
+        // Same page, handed to `write_chunk` in fixed-size pieces as it renders; a deferred body goes out block by block.
+        void generate_page(const ContentFile &content, utils::Symbol layout_name,
+                           const template_engine::ChunkWriter &write_chunk);
+
+        std::string collect_styles(const std::vector<utils::Symbol> &required_styles,
+                                   const std::vector<utils::Symbol> &content_classes);
 
         void serve(int port = 3000);
 
+        const BuildManifest &get_manifest() const { return manifest; }
+
     private:
         ContentMeta parse_frontmatter(const std::string &content, size_t &content_start);
 
-        std::string apply_template(const std::string &template_html, const ContentFile &content, const std::string &styles);
+        std::filesystem::path output_path_for(const ContentFile &content) const;
+
+        bool matches_only_filter(const ContentFile &content) const;
+
+        std::vector<std::filesystem::path> layout_files() const;
+
+        void load_layout(const std::filesystem::path &template_file);
+
+        std::string read_source(const std::filesystem::path &path) const;
+
+        void load_catalog();
+
+        void print_generation_notes() const;
+
+        std::vector<ContentFile *> plan_pages();
+
+        // The pages of all_content this build renders: the shard's, narrowed to the --only selection.
+        std::vector<ContentFile *> select_pages();
+
+        void collect_site_pages();
+
+        void build_page(ContentFile &content);
+
+        void write_redirects();
+
+        static size_t build_thread_count();
+
+        void write_output(const std::string &relative_path, const std::string &content);
+
+        // write_output for content produced piecewise; the manifest hash is taken over the pieces as they pass.
+        void stream_output(const std::string &relative_path,
+                           const std::function<void(const template_engine::ChunkWriter &)> &produce);
+
+        void finalize_manifest();
+
+        // The layout's template and the stylesheet links for a page.
+        std::pair<std::string, std::string> page_template(const ContentFile &content, utils::Symbol layout_name);
+
+        // A deferred body rendered into one string, for minified pages and layouts that do more with {{content}}
+        // than print it.
+        std::string deferred_body(const ContentFile &content);
+
+        std::map<std::string, template_engine::TemplateValue> page_context(const ContentFile &content,
+                                                                           const std::string &styles);
     };
 } // namespace ssg
@@ -0,0 +1,136 @@
+#include "i18n.hpp"
+
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+
+#include "../parsers/template/template_engine.hpp"
+#include "../parsers/toml/toml.hpp"
+#include "../utils/file_utils.hpp"
+
+namespace ssg {
+    namespace i18n {
+        std::shared_ptr<const Catalog> g_catalog;
+
+        namespace {
+            void flatten(const toml::Value::Object &table, const std::string &prefix,
+                         std::map<std::string, std::string> &out) {
+                for(const auto &[key, value] : table) {
+                    std::string path = prefix.empty() ? key : prefix + "." + key;
+                    if(value.is_object()) {
+                        flatten(value.get_object(), path, out);
+                    } else if(value.is_string()) {
+                        out[path] = value.get_string();
+                    }
+                }
+            }
+        } // namespace
+
+        Catalog Catalog::compile(const std::string &language,
+                                 const std::vector<std::map<std::string, std::string>> &layers) {
+            std::map<std::string, std::string> merged;
+            for(const auto &layer : layers) {
+                for(const auto &[key, value] : layer) {
+                    merged[key] = value;
+                }
+            }
+
+            Catalog catalog;
+            catalog.language_ = language;
+            size_t slot_count = 1;
+            while(slot_count < merged.size() * 2) {
+                slot_count <<= 1;
+            }
+            catalog.slots_.assign(slot_count, 0);
+
+            for(const auto &[key, value] : merged) {
+                Entry entry;
+                entry.hash = hash(key);
+                entry.key_offset = static_cast<uint32_t>(catalog.strings_.size());
+                entry.key_size = static_cast<uint32_t>(key.size());
+                catalog.strings_ += key;
+                entry.value_offset = static_cast<uint32_t>(catalog.strings_.size());
+                entry.value_size = static_cast<uint32_t>(value.size());
+                catalog.strings_ += value;
+
+                size_t slot = entry.hash & (slot_count - 1);
+                while(catalog.slots_[slot] != 0) {
+                    slot = (slot + 1) & (slot_count - 1);
+                }
+                catalog.entries_.push_back(entry);
+                catalog.slots_[slot] = static_cast<uint32_t>(catalog.entries_.size());
+            }
+            return catalog;
+        }
+
+        std::map<std::string, std::string> Catalog::read_file(const std::filesystem::path &path) {
+            toml::Value root = toml::Parser::deserialize(utils::FileUtils::read_file(path));
+            if(!root.is_object()) {
+                throw std::runtime_error("Translation catalog must be a TOML table: " + path.string());
+            }
+            std::map<std::string, std::string> strings;
+            flatten(root.get_object(), "", strings);
+            return strings;
+        }
+
+        Catalog Catalog::load(const std::filesystem::path &dir, const std::string &language,
+                              const std::string &fallback_language) {
+            std::vector<std::string> languages = {fallback_language};
+            if(language != fallback_language) {
+                languages.push_back(language);
+            }
+
+            std::vector<std::map<std::string, std::string>> layers;
+            for(const auto &layer_language : languages) {
+                std::filesystem::path file = dir / (layer_language + ".toml");
+                if(!layer_language.empty() && std::filesystem::exists(file)) {
+                    layers.push_back(read_file(file));
+                }
+            }
+            return compile(language, layers);
+        }
+
+        std::optional<std::string_view> Catalog::find(std::string_view key) const {
+            if(entries_.empty()) {
+                return std::nullopt;
+            }
+            uint64_t key_hash = hash(key);
+            size_t mask = slots_.size() - 1;
+            for(size_t slot = key_hash & mask; slots_[slot] != 0; slot = (slot + 1) & mask) {
+                const Entry &entry = entries_[slots_[slot] - 1];
+                if(entry.hash == key_hash && key_of(entry) == key) {
+                    return std::string_view(strings_).substr(entry.value_offset, entry.value_size);
+                }
+            }
+            return std::nullopt;
+        }
+
+        std::string_view Catalog::translate(std::string_view key) const { return find(key).value_or(key); }
+
+        uint64_t Catalog::hash(std::string_view key) {
+            uint64_t h = utils::HashUtils::fnv1a(key);
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdull;
+            return h ^ (h >> 33);
+        }
+
+        std::string_view Catalog::key_of(const Entry &entry) const {
+            return std::string_view(strings_).substr(entry.key_offset, entry.key_size);
+        }
+
+        void register_template_helper() {
+            static std::once_flag registered;
+            std::call_once(registered, [] {
+                template_engine::TemplateEngine::register_helper(
+                    "t", [](const std::vector<template_engine::TemplateValue> &args) -> std::string {
+                        if(args.empty()) {
+                            return "";
+                        }
+                        std::string key = args[0].to_string();
+                        std::shared_ptr<const Catalog> catalog = g_catalog;
+                        return catalog ? std::string(catalog->translate(key)) : key;
+                    });
+            });
+        }
+    } // namespace i18n
+} // namespace ssg
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ssg {
+    namespace i18n {
+        // Translation strings compiled into one open-addressing table: the keys, values and their hashes sit in
+        // flat arrays, so a lookup is one hash and usually one key comparison, with no allocation.
+        class Catalog {
+        public:
+            Catalog() = default;
+
+            // Later maps win, so pass the fallback language first and the variant's language last.
+            static Catalog compile(const std::string &language,
+                                   const std::vector<std::map<std::string, std::string>> &layers);
+
+            // Nested tables become dotted keys: [nav] home = "Start" is "nav.home".
+            static std::map<std::string, std::string> read_file(const std::filesystem::path &path);
+
+            // <dir>/<fallback>.toml under <dir>/<language>.toml; missing files contribute nothing.
+            static Catalog load(const std::filesystem::path &dir, const std::string &language,
+                                const std::string &fallback_language);
+
+            std::optional<std::string_view> find(std::string_view key) const;
+
+            // The key itself when there is no translation, so a missing string shows up on the page.
+            std::string_view translate(std::string_view key) const;
+
+            const std::string &language() const { return language_; }
+            size_t size() const { return entries_.size(); }
+
+        private:
+            struct Entry {
+                uint64_t hash;
+                uint32_t key_offset;
+                uint32_t key_size;
+                uint32_t value_offset;
+                uint32_t value_size;
+            };
+
+            std::string language_;
+            std::vector<Entry> entries_;
+            // Entry index + 1; 0 marks a free slot. The size is a power of two at least twice the entry count.
+            std::vector<uint32_t> slots_;
+            std::string strings_;
+
+            static uint64_t hash(std::string_view key);
+            std::string_view key_of(const Entry &entry) const;
+        };
+
+        // The catalog the `t` template helper reads; set for the duration of each build, like g_config.
+        extern std::shared_ptr<const Catalog> g_catalog;
+
+        // Registers {{#t "key"}} with the template engine; idempotent.
+        void register_template_helper();
+    } // namespace i18n
+} // namespace ssg
@@ -0,0 +1,334 @@
+#include "images.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <sstream>
+
+#include "../parsers/json/json.hpp"
+#include "../utils/file_utils.hpp"
+
+namespace ssg {
+
+    namespace {
+        // Large enough for the PNG/GIF/WebP headers and for the opening <svg> tag of any sane SVG.
+        constexpr size_t HEADER_BYTES = 8192;
+
+        uint32_t be16(const unsigned char *p) { return (uint32_t(p[0]) << 8) | p[1]; }
+        uint32_t be32(const unsigned char *p) { return (be16(p) << 16) | be16(p + 2); }
+        uint32_t le16(const unsigned char *p) { return uint32_t(p[0]) | (uint32_t(p[1]) << 8); }
+        uint32_t le24(const unsigned char *p) { return le16(p) | (uint32_t(p[2]) << 16); }
+
+        std::optional<ImageProbe> make_probe(const char *format, uint32_t width, uint32_t height) {
+            if(width == 0 || height == 0 || width > 1000000 || height > 1000000) {
+                return std::nullopt;
+            }
+            return ImageProbe{format, static_cast<int>(width), static_cast<int>(height)};
+        }
+
+        std::optional<ImageProbe> probe_png(const unsigned char *data, size_t size) {
+            static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+            if(size < 24 || !std::equal(signature, signature + 8, data) ||
+               std::string_view((const char *)data + 12, 4) != "IHDR") {
+                return std::nullopt;
+            }
+            return make_probe("png", be32(data + 16), be32(data + 20));
+        }
+
+        std::optional<ImageProbe> probe_gif(const unsigned char *data, size_t size) {
+            std::string_view magic((const char *)data, std::min<size_t>(size, 6));
+            if(size < 10 || (magic != "GIF87a" && magic != "GIF89a")) {
+                return std::nullopt;
+            }
+            return make_probe("gif", le16(data + 6), le16(data + 8));
+        }
+
+        std::optional<ImageProbe> probe_webp(const unsigned char *data, size_t size) {
+            if(size < 30 || std::string_view((const char *)data, 4) != "RIFF" ||
+               std::string_view((const char *)data + 8, 4) != "WEBP") {
+                return std::nullopt;
+            }
+
+            std::string_view chunk((const char *)data + 12, 4);
+            if(chunk == "VP8 ") {
+                // Lossy: 3-byte frame tag and 3-byte start code, then 14-bit dimensions.
+                if(data[23] != 0x9d || data[24] != 0x01 || data[25] != 0x2a) {
+                    return std::nullopt;
+                }
+                return make_probe("webp", le16(data + 26) & 0x3fff, le16(data + 28) & 0x3fff);
+            }
+            if(chunk == "VP8L") {
+                if(data[20] != 0x2f) {
+                    return std::nullopt;
+                }
+                uint32_t bits = le16(data + 21) | (le16(data + 23) << 16);
+                return make_probe("webp", (bits & 0x3fff) + 1, ((bits >> 14) & 0x3fff) + 1);
+            }
+            if(chunk == "VP8X") {
+                return make_probe("webp", le24(data + 24) + 1, le24(data + 27) + 1);
+            }
+            return std::nullopt;
+        }
+
+        // JPEG keeps its size in the first SOFn segment, which may follow large EXIF or ICC segments, so this walks
+        // segment headers with seeks instead of relying on the buffered prefix.
+        std::optional<ImageProbe> probe_jpeg(std::ifstream &file) {
+            unsigned char header[2];
+            file.seekg(0);
+            if(!file.read((char *)header, 2) || header[0] != 0xff || header[1] != 0xd8) {
+                return std::nullopt;
+            }
+
+            while(file) {
+                int byte = file.get();
+                if(byte != 0xff) {
+                    return std::nullopt;
+                }
+                int marker;
+                do {
+                    marker = file.get();
+                } while(marker == 0xff);
+                if(marker == EOF || marker == 0xd9 || marker == 0xda) {
+                    return std::nullopt;
+                }
+                if(marker == 0x01 || (marker >= 0xd0 && marker <= 0xd7)) {
+                    continue;
+                }
+
+                unsigned char length_bytes[2];
+                if(!file.read((char *)length_bytes, 2)) {
+                    return std::nullopt;
+                }
+                uint32_t length = be16(length_bytes);
+                if(length < 2) {
+                    return std::nullopt;
+                }
+
+                bool is_sof = marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 && marker != 0xcc;
+                if(is_sof) {
+                    unsigned char sof[5];
+                    if(!file.read((char *)sof, 5)) {
+                        return std::nullopt;
+                    }
+                    return make_probe("jpeg", be16(sof + 3), be16(sof + 1));
+                }
+                file.seekg(length - 2, std::ios::cur);
+            }
+            return std::nullopt;
+        }
+
+        // Parses an SVG length in user units; percentages and font-relative units have no intrinsic size.
+        std::optional<double> svg_length(const std::string &value) {
+            static const std::regex length_regex(R"(^\s*([0-9]*\.?[0-9]+)\s*(px)?\s*$)");
+            std::smatch match;
+            if(!std::regex_match(value, match, length_regex)) {
+                return std::nullopt;
+            }
+            return std::stod(match[1].str());
+        }
+
+        std::optional<ImageProbe> probe_svg(const std::string &text) {
+            static const std::regex svg_tag_regex(R"(<svg\b[^>]*>)", std::regex::icase);
+            static const std::regex attribute_regex(R"(([A-Za-z_:][-A-Za-z0-9_:.]*)\s*=\s*(["'])(.*?)\2)");
+
+            std::smatch tag;
+            if(!std::regex_search(text, tag, svg_tag_regex)) {
+                return std::nullopt;
+            }
+
+            std::optional<double> width;
+            std::optional<double> height;
+            std::string view_box;
+            std::string tag_text = tag.str();
+            for(std::sregex_iterator it(tag_text.begin(), tag_text.end(), attribute_regex), end; it != end; ++it) {
+                std::string name = (*it)[1].str();
+                if(name == "width") {
+                    width = svg_length((*it)[3].str());
+                } else if(name == "height") {
+                    height = svg_length((*it)[3].str());
+                } else if(name == "viewBox") {
+                    view_box = (*it)[3].str();
+                }
+            }
+
+            if(!width || !height) {
+                std::replace(view_box.begin(), view_box.end(), ',', ' ');
+                std::istringstream box(view_box);
+                double min_x, min_y, box_width, box_height;
+                if(!(box >> min_x >> min_y >> box_width >> box_height)) {
+                    return std::nullopt;
+                }
+                // A single given dimension keeps the viewBox aspect ratio.
+                if(width && box_width > 0) {
+                    height = *width * box_height / box_width;
+                } else if(height && box_height > 0) {
+                    width = *height * box_width / box_height;
+                } else {
+                    width = box_width;
+                    height = box_height;
+                }
+            }
+
+            return make_probe("svg", static_cast<uint32_t>(std::lround(*width)),
+                              static_cast<uint32_t>(std::lround(*height)));
+        }
+
+        int64_t modification_time(const std::filesystem::path &path, std::error_code &error) {
+            auto time = std::filesystem::last_write_time(path, error);
+            return error ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+        }
+    } // namespace
+
+    std::optional<ImageProbe> probe_image_file(const std::filesystem::path &path) {
+        std::ifstream file(path, std::ios::binary);
+        if(!file) {
+            return std::nullopt;
+        }
+
+        std::string header(HEADER_BYTES, '\0');
+        file.read(header.data(), header.size());
+        header.resize(static_cast<size_t>(file.gcount()));
+        file.clear();
+
+        auto data = reinterpret_cast<const unsigned char *>(header.data());
+        if(header.size() >= 2 && data[0] == 0xff && data[1] == 0xd8) {
+            return probe_jpeg(file);
+        }
+        if(auto png = probe_png(data, header.size())) {
+            return png;
+        }
+        if(auto gif = probe_gif(data, header.size())) {
+            return gif;
+        }
+        if(auto webp = probe_webp(data, header.size())) {
+            return webp;
+        }
+        if(utils::StringUtils::to_lower(path.extension().string()) == ".svg") {
+            return probe_svg(header);
+        }
+        return std::nullopt;
+    }
+
+    std::optional<ImageProbe> ImageProbeCache::probe(const std::filesystem::path &path) {
+        std::error_code error;
+        int64_t mtime = modification_time(path, error);
+        if(error) {
+            return std::nullopt;
+        }
+
+        std::string key = path.lexically_normal().string();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = entries_.find(key);
+            if(it != entries_.end() && it->second.mtime == mtime) {
+                return it->second.probe;
+            }
+        }
+
+        // Probed outside the lock; two tasks racing on a new image both read its header, which is harmless.
+        auto result = probe_image_file(path);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_[key] = Entry{mtime, result};
+        ++probes_performed_;
+        return result;
+    }
+
+    size_t ImageProbeCache::probes_performed() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return probes_performed_;
+    }
+
+    bool ImageProbeCache::load(const std::filesystem::path &path) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+
+        if(!std::filesystem::exists(path)) {
+            return false;
+        }
+
+        try {
+            auto root = json::Parser::deserialize(utils::FileUtils::read_file(path));
+            if(!root.is_object()) {
+                return false;
+            }
+
+            const auto &obj = root.get_object();
+            auto version_it = obj.find("version");
+            if(version_it == obj.end() || !version_it->second.is_number() ||
+               static_cast<int>(version_it->second.get_number()) != FORMAT_VERSION) {
+                return false;
+            }
+
+            auto images_it = obj.find("images");
+            if(images_it == obj.end() || !images_it->second.is_object()) {
+                return false;
+            }
+
+            for(const auto &[image_path, value] : images_it->second.get_object()) {
+                if(!value.is_object()) {
+                    continue;
+                }
+                const auto &image_obj = value.get_object();
+                auto mtime_it = image_obj.find("mtime");
+                if(mtime_it == image_obj.end() || !mtime_it->second.is_string()) {
+                    continue;
+                }
+
+                Entry entry;
+                // mtimes are nanosecond counts, which a JSON number cannot hold exactly.
+                entry.mtime = std::stoll(mtime_it->second.get_string());
+
+                auto format_it = image_obj.find("format");
+                auto width_it = image_obj.find("width");
+                auto height_it = image_obj.find("height");
+                if(format_it != image_obj.end() && format_it->second.is_string() && width_it != image_obj.end() &&
+                   width_it->second.is_number() && height_it != image_obj.end() && height_it->second.is_number()) {
+                    entry.probe = ImageProbe{format_it->second.get_string(), static_cast<int>(width_it->second.get_number()),
+                                             static_cast<int>(height_it->second.get_number())};
+                }
+                entries_[image_path] = entry;
+            }
+            return true;
+
+        } catch(const std::exception &e) {
+            std::cerr << "⚠️  Failed to read image cache " << path << ": " << e.what() << std::endl;
+            entries_.clear();
+            return false;
+        }
+    }
+
+    void ImageProbeCache::save(const std::filesystem::path &path) const {
+        std::map<std::string, Entry> sorted;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            sorted.insert(entries_.begin(), entries_.end());
+        }
+
+        std::string out = "{\n  \"version\": " + std::to_string(FORMAT_VERSION) + ",\n  \"images\": {";
+        bool first = true;
+        for(const auto &[image_path, entry] : sorted) {
+            out += first ? "\n    " : ",\n    ";
+            first = false;
+            json::Value(image_path).serialize(out);
+            out += ": {\"mtime\": \"" + std::to_string(entry.mtime) + "\"";
+            if(entry.probe) {
+                out += ", \"format\": ";
+                json::Value(entry.probe->format).serialize(out);
+                out += ", \"width\": " + std::to_string(entry.probe->width) +
+                       ", \"height\": " + std::to_string(entry.probe->height);
+            }
+            out += "}";
+        }
+        out += sorted.empty() ? "}\n}\n" : "\n  }\n}\n";
+        utils::FileUtils::write_file(path, out);
+    }
+
+    std::filesystem::path ImageProbeCache::default_path(const std::filesystem::path &project_root) {
+        return project_root / ".chisel" / "images.json";
+    }
+
+} // namespace ssg
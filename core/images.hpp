@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace ssg {
+    struct ImageProbe {
+        std::string format;
+        int width = 0;
+        int height = 0;
+    };
+
+    // Reads just enough of a PNG, JPEG, GIF, WebP or SVG file to find its intrinsic size; pixels are never decoded.
+    // Returns nullopt for unreadable files, other formats and SVGs without a usable width/height or viewBox.
+    std::optional<ImageProbe> probe_image_file(const std::filesystem::path &path);
+
+    // Memoizes probe_image_file by path and modification time. Safe to share between page tasks, and persisted
+    // under .chisel/ so unchanged images are not reopened on the next build.
+    class ImageProbeCache {
+    public:
+        static constexpr int FORMAT_VERSION = 1;
+
+        std::optional<ImageProbe> probe(const std::filesystem::path &path);
+
+        bool load(const std::filesystem::path &path);
+        void save(const std::filesystem::path &path) const;
+
+        size_t probes_performed() const;
+
+        static std::filesystem::path default_path(const std::filesystem::path &project_root);
+
+    private:
+        struct Entry {
+            int64_t mtime = 0;
+            std::optional<ImageProbe> probe;
+        };
+
+        mutable std::mutex mutex_;
+        std::unordered_map<std::string, Entry> entries_;
+        size_t probes_performed_ = 0;
+    };
+} // namespace ssg
@@ -0,0 +1,196 @@
+#include "manifest.hpp"
+
+#include <iostream>
+
+#include "../parsers/json/json.hpp"
+#include "../utils/file_utils.hpp"
+
+namespace ssg {
+
+    namespace {
+        std::string json_string(const std::string &value) {
+            std::string out;
+            json::Value(value).serialize(out);
+            return out;
+        }
+
+        void append_entries(std::string &out, const char *name, const std::vector<ChangeSetEntry> &entries) {
+            out += "  " + json_string(name) + ": [";
+            for(size_t i = 0; i < entries.size(); ++i) {
+                out += i == 0 ? "\n" : ",\n";
+                out += "    {\"path\": " + json_string(entries[i].path) + ", \"hash\": " + json_string(entries[i].entry.hash) +
+                       ", \"size\": " + std::to_string(entries[i].entry.size) + "}";
+            }
+            out += entries.empty() ? "]" : "\n  ]";
+        }
+    } // namespace
+
+    std::string ChangeSet::to_json() const {
+        std::string out = "{\n";
+        append_entries(out, "added", added);
+        out += ",\n";
+        append_entries(out, "modified", modified);
+        out += ",\n";
+        append_entries(out, "removed", removed);
+        out += "\n}\n";
+        return out;
+    }
+
+    BuildManifest::BuildManifest(const BuildManifest &other) { entries_ = other.entries(); }
+
+    BuildManifest &BuildManifest::operator=(const BuildManifest &other) {
+        if(this != &other) {
+            auto copy = other.entries();
+            std::lock_guard<std::mutex> lock(mutex_);
+            entries_ = std::move(copy);
+        }
+        return *this;
+    }
+
+    void BuildManifest::record(const std::string &relative_path, std::string_view content) {
+        ManifestEntry entry;
+        entry.hash = utils::HashUtils::to_hex(utils::HashUtils::fnv1a(content));
+        entry.size = content.size();
+        record(relative_path, entry);
+    }
+
+    void BuildManifest::record(const std::string &relative_path, const ManifestEntry &entry) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_[relative_path] = entry;
+    }
+
+    std::map<std::string, ManifestEntry> BuildManifest::entries() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_;
+    }
+
+    bool BuildManifest::contains(const std::string &relative_path) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.count(relative_path) > 0;
+    }
+
+    ChangeSet BuildManifest::diff(const BuildManifest &previous) const {
+        ChangeSet changes;
+        auto current_entries = entries();
+        auto previous_entries = previous.entries();
+
+        for(const auto &[path, entry] : current_entries) {
+            auto it = previous_entries.find(path);
+            if(it == previous_entries.end()) {
+                changes.added.push_back({path, entry});
+            } else if(!(it->second == entry)) {
+                changes.modified.push_back({path, entry});
+            }
+        }
+
+        for(const auto &[path, entry] : previous_entries) {
+            if(current_entries.find(path) == current_entries.end()) {
+                changes.removed.push_back({path, entry});
+            }
+        }
+
+        return changes;
+    }
+
+    bool BuildManifest::load(const std::filesystem::path &path) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.clear();
+
+        if(!std::filesystem::exists(path)) {
+            return false;
+        }
+
+        try {
+            auto root = json::Parser::deserialize(utils::FileUtils::read_file(path));
+            if(!root.is_object()) {
+                return false;
+            }
+
+            const auto &obj = root.get_object();
+            auto version_it = obj.find("version");
+            if(version_it == obj.end() || !version_it->second.is_number() ||
+               static_cast<int>(version_it->second.get_number()) != FORMAT_VERSION) {
+                std::cerr << "⚠️  Ignoring build manifest with unsupported version: " << path << std::endl;
+                return false;
+            }
+
+            auto files_it = obj.find("files");
+            if(files_it == obj.end() || !files_it->second.is_object()) {
+                return false;
+            }
+
+            for(const auto &[file_path, value] : files_it->second.get_object()) {
+                if(!value.is_object()) {
+                    continue;
+                }
+                const auto &file_obj = value.get_object();
+                auto hash_it = file_obj.find("hash");
+                auto size_it = file_obj.find("size");
+                if(hash_it == file_obj.end() || !hash_it->second.is_string()) {
+                    continue;
+                }
+
+                ManifestEntry entry;
+                entry.hash = hash_it->second.get_string();
+                if(size_it != file_obj.end() && size_it->second.is_number()) {
+                    entry.size = static_cast<size_t>(size_it->second.get_number());
+                }
+                entries_[file_path] = entry;
+            }
+            return true;
+
+        } catch(const std::exception &e) {
+            std::cerr << "⚠️  Failed to read build manifest " << path << ": " << e.what() << std::endl;
+            entries_.clear();
+            return false;
+        }
+    }
+
+    void BuildManifest::save(const std::filesystem::path &path) const { utils::FileUtils::write_file(path, to_json()); }
+
+    std::string BuildManifest::to_json(const std::string &extra_fields) const {
+        auto current_entries = entries();
+
+        std::string out = "{\n  \"version\": " + std::to_string(FORMAT_VERSION) + ",\n";
+        if(!extra_fields.empty()) {
+            out += "  " + extra_fields + ",\n";
+        }
+        out += "  \"files\": {";
+        bool first = true;
+        for(const auto &[file_path, entry] : current_entries) {
+            out += first ? "\n" : ",\n";
+            first = false;
+            out += "    " + json_string(file_path) + ": {\"hash\": " + json_string(entry.hash) +
+                   ", \"size\": " + std::to_string(entry.size) + "}";
+        }
+        out += current_entries.empty() ? "}\n}\n" : "\n  }\n}\n";
+        return out;
+    }
+
+    ChangeSet BuildManifest::publish(const std::filesystem::path &project_root, const std::string &variant) const {
+        BuildManifest previous;
+        previous.load(default_path(project_root, variant));
+
+        ChangeSet changes = diff(previous);
+
+        save(default_path(project_root, variant));
+        utils::FileUtils::write_file(changes_path(project_root, variant), changes.to_json());
+        return changes;
+    }
+
+    std::filesystem::path BuildManifest::state_dir(const std::filesystem::path &project_root, const std::string &variant) {
+        std::filesystem::path dir = project_root / ".chisel";
+        return variant.empty() ? dir : dir / "variants" / variant;
+    }
+
+    std::filesystem::path BuildManifest::default_path(const std::filesystem::path &project_root,
+                                                      const std::string &variant) {
+        return state_dir(project_root, variant) / "manifest.json";
+    }
+
+    std::filesystem::path BuildManifest::changes_path(const std::filesystem::path &project_root,
+                                                      const std::string &variant) {
+        return state_dir(project_root, variant) / "changes.json";
+    }
+
+} // namespace ssg
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ssg {
+    struct ManifestEntry {
+        std::string hash;
+        size_t size = 0;
+
+        bool operator==(const ManifestEntry &other) const { return hash == other.hash && size == other.size; }
+    };
+
+    struct ChangeSetEntry {
+        std::string path;
+        ManifestEntry entry;
+    };
+
+    struct ChangeSet {
+        std::vector<ChangeSetEntry> added;
+        std::vector<ChangeSetEntry> modified;
+        std::vector<ChangeSetEntry> removed;
+
+        bool empty() const { return added.empty() && modified.empty() && removed.empty(); }
+
+        std::string to_json() const;
+    };
+
+    // Records every file the generator writes (path relative to the output directory, with a content hash)
+    // so the next build can report what changed without re-reading the output tree.
+    class BuildManifest {
+    public:
+        static constexpr int FORMAT_VERSION = 1;
+
+        BuildManifest() = default;
+        BuildManifest(const BuildManifest &other);
+        BuildManifest &operator=(const BuildManifest &other);
+
+        void record(const std::string &relative_path, std::string_view content);
+        void record(const std::string &relative_path, const ManifestEntry &entry);
+
+        std::map<std::string, ManifestEntry> entries() const;
+        bool contains(const std::string &relative_path) const;
+
+        ChangeSet diff(const BuildManifest &previous) const;
+
+        bool load(const std::filesystem::path &path);
+        void save(const std::filesystem::path &path) const;
+
+        // Diffs against the manifest from the previous build, then replaces it and writes the change set.
+        ChangeSet publish(const std::filesystem::path &project_root, const std::string &variant = "") const;
+
+        // extra_fields is spliced into the top-level object verbatim, e.g. "\"shard\": {...}".
+        std::string to_json(const std::string &extra_fields = "") const;
+
+        // Each variant of a batch build keeps its manifest and change set apart, under .chisel/variants/<name>.
+        static std::filesystem::path state_dir(const std::filesystem::path &project_root, const std::string &variant = "");
+        static std::filesystem::path default_path(const std::filesystem::path &project_root,
+                                                  const std::string &variant = "");
+        static std::filesystem::path changes_path(const std::filesystem::path &project_root,
+                                                  const std::string &variant = "");
+
+    private:
+        mutable std::mutex mutex_;
+        std::map<std::string, ManifestEntry> entries_;
+    };
+} // namespace ssg
@@ -0,0 +1,451 @@
+#include "metadata_index.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "../utils/file_utils.hpp"
+
+namespace ssg {
+
+    namespace {
+        // Runs work(i) for every i < count. The calling thread claims items too and never waits on queued jobs,
+        // as in Deserializer::deserialize_parallel; work must not throw.
+        void parallel_for(size_t count, utils::ThreadPool *pool, const std::function<void(size_t)> &work) {
+            if(pool == nullptr || pool->size() < 2 || count < 2) {
+                for(size_t i = 0; i < count; ++i) {
+                    work(i);
+                }
+                return;
+            }
+
+            struct Job {
+                std::function<void(size_t)> work;
+                size_t count = 0;
+                std::atomic<size_t> next{0};
+                std::mutex mutex;
+                std::condition_variable all_done;
+                size_t done = 0;
+
+                void run() {
+                    for(size_t i = next++; i < count; i = next++) {
+                        work(i);
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if(++done == count) {
+                            all_done.notify_all();
+                        }
+                    }
+                }
+            };
+
+            auto job = std::make_shared<Job>();
+            job->work = work;
+            job->count = count;
+            size_t helpers = std::min(pool->size(), count - 1);
+            for(size_t i = 0; i < helpers; ++i) {
+                pool->submit([job] { job->run(); });
+            }
+            job->run();
+
+            std::unique_lock<std::mutex> lock(job->mutex);
+            job->all_done.wait(lock, [&job] { return job->done == job->count; });
+        }
+
+        void put_u32(std::string &out, uint32_t value) {
+            for(int i = 0; i < 4; ++i) {
+                out += static_cast<char>((value >> (8 * i)) & 0xff);
+            }
+        }
+
+        void put_u64(std::string &out, uint64_t value) {
+            for(int i = 0; i < 8; ++i) {
+                out += static_cast<char>((value >> (8 * i)) & 0xff);
+            }
+        }
+
+        void put_string(std::string &out, std::string_view value) {
+            put_u32(out, static_cast<uint32_t>(value.size()));
+            out += value;
+        }
+
+        uint64_t get_le(std::string_view data, size_t &pos, size_t width) {
+            if(pos + width > data.size()) {
+                throw std::runtime_error("Truncated metadata index");
+            }
+            uint64_t value = 0;
+            for(size_t i = 0; i < width; ++i) {
+                value |= static_cast<uint64_t>(static_cast<unsigned char>(data[pos + i])) << (8 * i);
+            }
+            pos += width;
+            return value;
+        }
+
+        std::string get_string(std::string_view data, size_t &pos) {
+            size_t length = get_le(data, pos, 4);
+            if(pos + length > data.size()) {
+                throw std::runtime_error("Truncated metadata index");
+            }
+            std::string value(data.substr(pos, length));
+            pos += length;
+            return value;
+        }
+
+        struct FileScan {
+            std::filesystem::path path;
+            std::string source;
+            int64_t mtime = 0;
+            uint64_t size = 0;
+            std::optional<size_t> cached_row;
+            std::map<std::string, std::string> metadata;
+            bool failed = false;
+        };
+    } // namespace
+
+    MetadataIndex::RefreshStats MetadataIndex::refresh(const std::filesystem::path &content_dir,
+                                                       utils::ThreadPool *pool) {
+        std::string root = content_dir.lexically_normal().string();
+        if(root != content_dir_) {
+            clear();
+            content_dir_ = root;
+        }
+
+        std::unordered_map<std::string, size_t> previous_rows;
+        for(size_t row = 0; row < sources_.size(); ++row) {
+            previous_rows.emplace(sources_[row], row);
+        }
+
+        std::vector<FileScan> files;
+        std::vector<size_t> changed;
+        for(const auto &path : utils::FileUtils::get_files_with_extension(content_dir, ".md")) {
+            FileScan file;
+            file.path = path;
+            file.source = utils::FileUtils::relative_output_path(path, content_dir);
+            std::error_code error;
+            file.mtime = static_cast<int64_t>(std::filesystem::last_write_time(path, error).time_since_epoch().count());
+            file.size = error ? 0 : std::filesystem::file_size(path, error);
+
+            auto previous = previous_rows.find(file.source);
+            if(!error && previous != previous_rows.end() && mtimes_[previous->second] == file.mtime &&
+               sizes_[previous->second] == file.size) {
+                file.cached_row = previous->second;
+            } else {
+                changed.push_back(files.size());
+            }
+            files.push_back(std::move(file));
+        }
+
+        std::mutex log_mutex;
+        parallel_for(changed.size(), pool, [&](size_t i) {
+            FileScan &file = files[changed[i]];
+            try {
+                // Oversized front matter is rare enough that reading the whole file is fine.
+                auto header = utils::FrontmatterParser::read_header(file.path);
+                file.metadata =
+                    utils::FrontmatterParser::parse(header ? *header : utils::FileUtils::read_file(file.path)).metadata;
+            } catch(const std::exception &e) {
+                file.failed = true;
+                std::lock_guard<std::mutex> lock(log_mutex);
+                std::cerr << "⚠️  Error scanning " << file.path << ": " << e.what() << std::endl;
+            }
+        });
+
+        RefreshStats stats;
+        std::vector<std::string> sources;
+        std::vector<std::string> routes;
+        std::vector<int64_t> mtimes;
+        std::vector<uint64_t> sizes;
+        std::map<std::string, std::vector<std::string>, std::less<>> columns;
+        std::map<std::string, std::vector<char>, std::less<>> present;
+
+        // Failed files get no row, so the next refresh reads them again.
+        size_t row_count = files.size();
+        for(const auto &file : files) {
+            row_count -= file.failed ? 1 : 0;
+        }
+        auto set = [&](const std::string &key, size_t row, const std::string &value) {
+            auto &values = columns[key];
+            auto &flags = present[key];
+            values.resize(row_count);
+            flags.resize(row_count);
+            values[row] = value;
+            flags[row] = 1;
+        };
+
+        for(auto &file : files) {
+            if(file.failed) {
+                stats.failed++;
+                continue;
+            }
+            size_t row = sources.size();
+            if(file.cached_row) {
+                stats.reused++;
+                for(const auto &[key, values] : columns_) {
+                    if(present_[key][*file.cached_row]) {
+                        set(key, row, values[*file.cached_row]);
+                    }
+                }
+                routes.push_back(std::move(routes_[*file.cached_row]));
+            } else {
+                stats.scanned++;
+                for(const auto &[key, value] : file.metadata) {
+                    set(key, row, value);
+                }
+                routes.push_back(utils::FileUtils::path_to_route(file.path, content_dir));
+            }
+            sources.push_back(std::move(file.source));
+            mtimes.push_back(file.mtime);
+            sizes.push_back(file.size);
+        }
+
+        sources_ = std::move(sources);
+        routes_ = std::move(routes);
+        mtimes_ = std::move(mtimes);
+        sizes_ = std::move(sizes);
+        columns_ = std::move(columns);
+        present_ = std::move(present);
+        return stats;
+    }
+
+    const std::vector<std::string> *MetadataIndex::column(std::string_view key) const {
+        if(key == "path") {
+            return &sources_;
+        }
+        if(key == "route") {
+            return &routes_;
+        }
+        auto it = columns_.find(key);
+        return it == columns_.end() ? nullptr : &it->second;
+    }
+
+    bool MetadataIndex::has(std::string_view key, size_t row) const {
+        if(key == "path" || key == "route") {
+            return true;
+        }
+        auto it = present_.find(key);
+        return it != present_.end() && it->second[row];
+    }
+
+    std::map<std::string, std::string> MetadataIndex::metadata(size_t row) const {
+        std::map<std::string, std::string> result;
+        for(const auto &[key, values] : columns_) {
+            if(present_.at(key)[row]) {
+                result.emplace(key, values[row]);
+            }
+        }
+        return result;
+    }
+
+    std::vector<std::string> MetadataIndex::keys() const {
+        std::vector<std::string> result;
+        for(const auto &[key, values] : columns_) {
+            result.push_back(key);
+        }
+        return result;
+    }
+
+    void MetadataIndex::clear() {
+        content_dir_.clear();
+        sources_.clear();
+        routes_.clear();
+        mtimes_.clear();
+        sizes_.clear();
+        columns_.clear();
+        present_.clear();
+    }
+
+    // Layout: magic, version, content dir, row count, the fixed per-row columns, then each key followed by its
+    // row_count values, each a presence byte and a string. Integers are little-endian, strings length-prefixed.
+    bool MetadataIndex::load(const std::filesystem::path &path) {
+        clear();
+        if(!std::filesystem::exists(path)) {
+            return false;
+        }
+
+        try {
+            std::string data = utils::FileUtils::read_file(path);
+            size_t pos = sizeof(MAGIC);
+            if(data.compare(0, sizeof(MAGIC), MAGIC, sizeof(MAGIC)) != 0 || get_le(data, pos, 4) != VERSION) {
+                return false;
+            }
+
+            content_dir_ = get_string(data, pos);
+            size_t row_count = get_le(data, pos, 4);
+            if(row_count > data.size()) {
+                throw std::runtime_error("Corrupt row count");
+            }
+            for(size_t row = 0; row < row_count; ++row) {
+                sources_.push_back(get_string(data, pos));
+                routes_.push_back(get_string(data, pos));
+                mtimes_.push_back(static_cast<int64_t>(get_le(data, pos, 8)));
+                sizes_.push_back(get_le(data, pos, 8));
+            }
+
+            size_t column_count = get_le(data, pos, 4);
+            for(size_t i = 0; i < column_count; ++i) {
+                std::string key = get_string(data, pos);
+                std::vector<std::string> &values = columns_[key];
+                std::vector<char> &flags = present_[key];
+                values.reserve(row_count);
+                flags.reserve(row_count);
+                for(size_t row = 0; row < row_count; ++row) {
+                    flags.push_back(get_le(data, pos, 1) != 0);
+                    values.push_back(get_string(data, pos));
+                }
+            }
+            if(pos != data.size()) {
+                throw std::runtime_error("Trailing bytes");
+            }
+            return true;
+
+        } catch(const std::exception &e) {
+            std::cerr << "⚠️  Failed to read metadata index " << path << ": " << e.what() << std::endl;
+            clear();
+            return false;
+        }
+    }
+
+    void MetadataIndex::save(const std::filesystem::path &path) const {
+        std::string out(MAGIC, sizeof(MAGIC));
+        put_u32(out, VERSION);
+        put_string(out, content_dir_);
+        put_u32(out, static_cast<uint32_t>(sources_.size()));
+        for(size_t row = 0; row < sources_.size(); ++row) {
+            put_string(out, sources_[row]);
+            put_string(out, routes_[row]);
+            put_u64(out, static_cast<uint64_t>(mtimes_[row]));
+            put_u64(out, sizes_[row]);
+        }
+
+        put_u32(out, static_cast<uint32_t>(columns_.size()));
+        for(const auto &[key, values] : columns_) {
+            put_string(out, key);
+            const std::vector<char> &flags = present_.at(key);
+            for(size_t row = 0; row < values.size(); ++row) {
+                out += static_cast<char>(flags[row]);
+                put_string(out, values[row]);
+            }
+        }
+
+        utils::FileUtils::ensure_directory(path.parent_path());
+        std::filesystem::path temp_path = path;
+        temp_path += ".tmp";
+        {
+            std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+            file.write(out.data(), static_cast<std::streamsize>(out.size()));
+            file.close();
+            if(!file) {
+                throw std::runtime_error("Cannot write metadata index: " + temp_path.string());
+            }
+        }
+        std::error_code error;
+        std::filesystem::rename(temp_path, path, error);
+        if(error) {
+            throw std::runtime_error("Cannot write metadata index: " + path.string() + ": " + error.message());
+        }
+    }
+
+    std::filesystem::path MetadataIndex::default_path(const std::filesystem::path &project_root,
+                                                      const std::filesystem::path &content_dir) {
+        std::string root = std::filesystem::absolute(content_dir).lexically_normal().generic_string();
+        return project_root / ".chisel" / ("metadata-" + utils::HashUtils::to_hex(utils::HashUtils::fnv1a(root)) + ".bin");
+    }
+
+    MetadataQuery MetadataQuery::parse(const std::vector<std::string> &terms) {
+        static const std::pair<const char *, Op> operators[] = {
+            {"!=", Op::NotEqual}, {"<=", Op::LessEqual}, {">=", Op::GreaterEqual}, {"=", Op::Equal},
+            {"~", Op::Contains},  {"<", Op::Less},       {">", Op::Greater},
+        };
+
+        MetadataQuery query;
+        for(const auto &text : terms) {
+            Term term{"", Op::Set, ""};
+            size_t op_pos = text.find_first_of("!=~<>", 1);
+            if(op_pos == std::string::npos) {
+                term.key = text;
+                if(utils::starts_with(text, "!")) {
+                    term.key = text.substr(1);
+                    term.op = Op::Unset;
+                }
+            } else {
+                for(const auto &[symbol, op] : operators) {
+                    if(text.compare(op_pos, std::char_traits<char>::length(symbol), symbol) == 0) {
+                        term.key = text.substr(0, op_pos);
+                        term.op = op;
+                        term.value = text.substr(op_pos + std::char_traits<char>::length(symbol));
+                        break;
+                    }
+                }
+            }
+
+            term.key = utils::StringUtils::trim(term.key);
+            term.value = utils::StringUtils::trim(term.value);
+            if(term.key.empty() || term.key.find_first_of("!=~<>") != std::string::npos) {
+                throw std::runtime_error("Invalid filter '" + text + "', expected e.g. tags=rust or date>=2024-01-01");
+            }
+            query.terms_.push_back(std::move(term));
+        }
+        return query;
+    }
+
+    std::vector<size_t> MetadataQuery::run(const MetadataIndex &index) const {
+        std::vector<char> selected(index.size(), 1);
+
+        for(const auto &term : terms_) {
+            const std::vector<std::string> *values = index.column(term.key);
+            for(size_t row = 0; row < selected.size(); ++row) {
+                if(selected[row]) {
+                    selected[row] = matches(term, values && index.has(term.key, row) ? &(*values)[row] : nullptr);
+                }
+            }
+        }
+
+        std::vector<size_t> rows;
+        for(size_t row = 0; row < selected.size(); ++row) {
+            if(selected[row]) {
+                rows.push_back(row);
+            }
+        }
+        return rows;
+    }
+
+    bool MetadataQuery::matches(const Term &term, const std::string *value) {
+        switch(term.op) {
+        case Op::Set:
+            return value && *value != "false";
+        case Op::Unset:
+            return !value || *value == "false";
+        case Op::Contains:
+            return value && value->find(term.value) != std::string::npos;
+        case Op::Less:
+            return value && *value < term.value;
+        case Op::LessEqual:
+            return value && *value <= term.value;
+        case Op::Greater:
+            return value && *value > term.value;
+        case Op::GreaterEqual:
+            return value && *value >= term.value;
+        case Op::Equal:
+        case Op::NotEqual:
+            break;
+        }
+
+        if(!value) {
+            return term.op == Op::NotEqual;
+        }
+        bool equal = *value == term.value;
+        if(!equal && utils::starts_with(*value, "[") && utils::ends_with(*value, "]")) {
+            auto items = utils::StringUtils::parse_array(*value);
+            equal = std::find(items.begin(), items.end(), term.value) != items.end();
+        }
+        return term.op == Op::Equal ? equal : !equal;
+    }
+
+} // namespace ssg
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../utils/thread_pool.hpp"
+
+namespace ssg {
+    // Front matter of every page under a content directory, stored column by column: one value vector per key,
+    // indexed by row, so a filter only walks the columns it names. Rows are filled from the front matter block
+    // alone and persisted under .chisel/, so a file whose size and mtime are unchanged is not reopened.
+    class MetadataIndex {
+    public:
+        static constexpr char MAGIC[4] = {'C', 'H', 'M', 'I'};
+        static constexpr uint32_t VERSION = 2;
+
+        struct RefreshStats {
+            size_t scanned = 0;
+            size_t reused = 0;
+            size_t failed = 0;
+        };
+
+        // Brings the rows in line with the .md files under content_dir, in directory order. With a pool the
+        // changed files are read in parallel; the calling thread takes part, so this is safe inside a pool task.
+        RefreshStats refresh(const std::filesystem::path &content_dir, utils::ThreadPool *pool = nullptr);
+
+        size_t size() const { return sources_.size(); }
+
+        // Relative to the content directory, '/'-separated.
+        const std::string &source(size_t row) const { return sources_[row]; }
+        const std::string &route(size_t row) const { return routes_[row]; }
+
+        // Null for keys no page sets. "path" and "route" name the two fixed columns. Rows that do not set the key
+        // hold ""; has() tells them apart from an explicit empty value.
+        const std::vector<std::string> *column(std::string_view key) const;
+
+        bool has(std::string_view key, size_t row) const;
+
+        // The row's front matter as FrontmatterParser produced it; keys the page does not set are left out.
+        std::map<std::string, std::string> metadata(size_t row) const;
+
+        std::vector<std::string> keys() const;
+
+        // An index written for another content directory, or in another format, is rejected and the index left empty.
+        bool load(const std::filesystem::path &path);
+        // Written to a temporary name and renamed, so an interrupted save leaves the previous index intact.
+        void save(const std::filesystem::path &path) const;
+
+        // One index per content directory, so variants with their own content do not overwrite each other's.
+        static std::filesystem::path default_path(const std::filesystem::path &project_root,
+                                                  const std::filesystem::path &content_dir);
+
+    private:
+        std::string content_dir_;
+        std::vector<std::string> sources_;
+        std::vector<std::string> routes_;
+        std::vector<int64_t> mtimes_;
+        std::vector<uint64_t> sizes_;
+        std::map<std::string, std::vector<std::string>, std::less<>> columns_;
+        // Per key, 1 for rows whose front matter sets it.
+        std::map<std::string, std::vector<char>, std::less<>> present_;
+
+        void clear();
+    };
+
+    // All terms must hold. `key=value`, `key!=value`, `key~text` (substring), `key<value`, `key<=value`,
+    // `key>value`, `key>=value` (byte order, which sorts ISO dates), a bare `key` (set and not "false") and `!key`.
+    // Against a list such as tags = ["a", "b"], = and != test membership.
+    class MetadataQuery {
+    public:
+        static MetadataQuery parse(const std::vector<std::string> &terms);
+
+        // Matching rows in index order.
+        std::vector<size_t> run(const MetadataIndex &index) const;
+
+    private:
+        enum class Op { Equal, NotEqual, Contains, Less, LessEqual, Greater, GreaterEqual, Set, Unset };
+
+        struct Term {
+            std::string key;
+            Op op;
+            std::string value;
+        };
+
+        std::vector<Term> terms_;
+
+        // value is null when the page does not set the key.
+        static bool matches(const Term &term, const std::string *value);
+    };
+} // namespace ssg
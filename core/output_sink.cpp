@@ -0,0 +1,343 @@
+#include "output_sink.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "../utils/file_utils.hpp"
+
+namespace ssg {
+
+    namespace {
+        void put_u32(std::string &out, uint32_t value) {
+            for(int i = 0; i < 4; ++i) {
+                out += static_cast<char>((value >> (8 * i)) & 0xff);
+            }
+        }
+
+        void put_u64(std::string &out, uint64_t value) {
+            for(int i = 0; i < 8; ++i) {
+                out += static_cast<char>((value >> (8 * i)) & 0xff);
+            }
+        }
+
+        uint64_t get_le(std::string_view data, size_t pos, size_t width) {
+            if(pos + width > data.size()) {
+                throw std::runtime_error("Truncated archive");
+            }
+            uint64_t value = 0;
+            for(size_t i = 0; i < width; ++i) {
+                value |= static_cast<uint64_t>(static_cast<unsigned char>(data[pos + i])) << (8 * i);
+            }
+            return value;
+        }
+
+        // Right-aligned, zero-padded octal filling width - 1 digits plus the terminating NUL.
+        void put_octal(char *field, size_t width, uint64_t value) {
+            std::memset(field, '0', width - 1);
+            field[width - 1] = '\0';
+            for(size_t i = width - 1; i > 0 && value > 0; --i, value >>= 3) {
+                field[i - 1] = static_cast<char>('0' + (value & 7));
+            }
+            if(value > 0) {
+                throw std::runtime_error("Value does not fit a tar header field");
+            }
+        }
+
+        constexpr size_t TAR_BLOCK = 512;
+
+        class BufferedOutputFile : public OutputFile {
+        public:
+            BufferedOutputFile(OutputSink &sink, std::string relative_path)
+                : sink_(sink), relative_path_(std::move(relative_path)) {}
+
+            void write(std::string_view chunk) override { content_.append(chunk.data(), chunk.size()); }
+            void close() override { sink_.write(relative_path_, content_); }
+
+        private:
+            OutputSink &sink_;
+            std::string relative_path_;
+            std::string content_;
+        };
+
+        class StreamedFile : public OutputFile {
+        public:
+            explicit StreamedFile(std::filesystem::path path) : path_(std::move(path)) {
+                utils::FileUtils::ensure_directory(path_.parent_path());
+                file_.open(path_, std::ios::binary | std::ios::trunc);
+                if(!file_.is_open()) {
+                    throw std::runtime_error("Cannot write file: " + path_.string());
+                }
+            }
+
+            void write(std::string_view chunk) override {
+                file_.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            }
+
+            void close() override {
+                file_.close();
+                if(!file_) {
+                    throw std::runtime_error("Failed to write file: " + path_.string());
+                }
+            }
+
+        private:
+            std::filesystem::path path_;
+            std::ofstream file_;
+        };
+    } // namespace
+
+    std::unique_ptr<OutputFile> OutputSink::open_file(const std::string &relative_path) {
+        return std::make_unique<BufferedOutputFile>(*this, relative_path);
+    }
+
+    std::shared_ptr<OutputSink> OutputSink::open(const std::filesystem::path &target) {
+        std::string extension = target.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if(extension == ".tar") {
+            return std::make_shared<TarSink>(target);
+        }
+        if(extension == ".pack") {
+            return std::make_shared<ArchiveSink>(target);
+        }
+        return std::make_shared<FileSystemSink>(target);
+    }
+
+    FileSystemSink::FileSystemSink(std::filesystem::path root) : root_(std::move(root)) {}
+
+    void FileSystemSink::write(const std::string &relative_path, std::string_view content) {
+        std::filesystem::path path = root_ / relative_path;
+        utils::FileUtils::ensure_directory(path.parent_path());
+
+        std::ofstream file(path, std::ios::binary);
+        if(!file.is_open()) {
+            throw std::runtime_error("Cannot write file: " + path.string());
+        }
+        file.write(content.data(), static_cast<std::streamsize>(content.size()));
+        file.close();
+        if(!file) {
+            throw std::runtime_error("Failed to write file: " + path.string());
+        }
+    }
+
+    std::unique_ptr<OutputFile> FileSystemSink::open_file(const std::string &relative_path) {
+        return std::make_unique<StreamedFile>(root_ / relative_path);
+    }
+
+    std::string FileSystemSink::describe() const { return root_.string(); }
+
+    void MemorySink::write(const std::string &relative_path, std::string_view content) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        files_[relative_path] = std::string(content);
+    }
+
+    std::string MemorySink::describe() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return "memory (" + std::to_string(files_.size()) + " files)";
+    }
+
+    std::optional<std::string> MemorySink::read(const std::string &relative_path) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = files_.find(relative_path);
+        if(it == files_.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    std::map<std::string, std::string> MemorySink::files() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return files_;
+    }
+
+    ArchiveSink::ArchiveSink(std::filesystem::path path) : path_(std::move(path)) {
+        utils::FileUtils::ensure_directory(path_.parent_path());
+        out_.open(path_, std::ios::binary | std::ios::trunc);
+        if(!out_.is_open()) {
+            throw std::runtime_error("Cannot write archive: " + path_.string());
+        }
+        out_.write(MAGIC, sizeof(MAGIC));
+        offset_ = sizeof(MAGIC);
+    }
+
+    ArchiveSink::~ArchiveSink() {
+        try {
+            close();
+        } catch(...) {}
+    }
+
+    void ArchiveSink::write(const std::string &relative_path, std::string_view content) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(closed_) {
+            throw std::logic_error("Write to closed archive: " + relative_path);
+        }
+        // A rewritten path leaves its old body as dead bytes; only the index entry moves.
+        out_.write(content.data(), static_cast<std::streamsize>(content.size()));
+        if(!out_) {
+            throw std::runtime_error("Failed to write " + relative_path + " to " + path_.string());
+        }
+        index_[relative_path] = {offset_, content.size()};
+        offset_ += content.size();
+    }
+
+    void ArchiveSink::close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(closed_) {
+            return;
+        }
+        closed_ = true;
+
+        std::string index;
+        for(const auto &[path, entry] : index_) {
+            put_u32(index, static_cast<uint32_t>(path.size()));
+            index += path;
+            put_u64(index, entry.offset);
+            put_u64(index, entry.size);
+        }
+        put_u64(index, offset_);
+        put_u32(index, static_cast<uint32_t>(index_.size()));
+        index.append(MAGIC, sizeof(MAGIC));
+
+        out_.write(index.data(), static_cast<std::streamsize>(index.size()));
+        out_.close();
+        if(!out_) {
+            throw std::runtime_error("Failed to write archive: " + path_.string());
+        }
+    }
+
+    std::string ArchiveSink::describe() const { return path_.string(); }
+
+    std::map<std::string, std::string> ArchiveSink::read(const std::filesystem::path &path) {
+        std::string data = utils::FileUtils::read_file(path);
+        constexpr size_t footer_size = 8 + 4 + sizeof(MAGIC);
+        if(data.size() < sizeof(MAGIC) + footer_size || data.compare(0, sizeof(MAGIC), MAGIC, sizeof(MAGIC)) != 0 ||
+           data.compare(data.size() - sizeof(MAGIC), sizeof(MAGIC), MAGIC, sizeof(MAGIC)) != 0) {
+            throw std::runtime_error("Not a chisel archive: " + path.string());
+        }
+
+        size_t footer = data.size() - footer_size;
+        size_t pos = get_le(data, footer, 8);
+        uint64_t count = get_le(data, footer + 8, 4);
+
+        std::map<std::string, std::string> files;
+        for(uint64_t i = 0; i < count; ++i) {
+            size_t length = get_le(data, pos, 4);
+            if(pos + 4 + length > footer) {
+                throw std::runtime_error("Corrupt archive index: " + path.string());
+            }
+            std::string name = data.substr(pos + 4, length);
+            pos += 4 + length;
+            uint64_t offset = get_le(data, pos, 8);
+            uint64_t size = get_le(data, pos + 8, 8);
+            pos += 16;
+            if(offset + size > footer) {
+                throw std::runtime_error("Corrupt archive entry " + name + ": " + path.string());
+            }
+            files[name] = data.substr(offset, size);
+        }
+        return files;
+    }
+
+    TarSink::TarSink(std::streambuf *out) : out_(out), description_("tar stream on stdout"), mtime_(std::time(nullptr)) {}
+
+    TarSink::TarSink(const std::filesystem::path &path)
+        : out_(nullptr), description_(path.string()), mtime_(std::time(nullptr)) {
+        utils::FileUtils::ensure_directory(path.parent_path());
+        file_.open(path, std::ios::binary | std::ios::trunc);
+        if(!file_.is_open()) {
+            throw std::runtime_error("Cannot write tar file: " + path.string());
+        }
+        out_.rdbuf(file_.rdbuf());
+    }
+
+    TarSink::~TarSink() {
+        try {
+            close();
+        } catch(...) {}
+    }
+
+    void TarSink::write(const std::string &relative_path, std::string_view content) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(closed_) {
+            throw std::logic_error("Write to closed tar stream: " + relative_path);
+        }
+        write_entry(relative_path, '0', content);
+        if(!out_) {
+            throw std::runtime_error("Failed to write " + relative_path + " to " + description_);
+        }
+    }
+
+    void TarSink::close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(closed_) {
+            return;
+        }
+        closed_ = true;
+
+        static const char zeros[2 * TAR_BLOCK] = {};
+        out_.write(zeros, sizeof(zeros));
+        out_.flush();
+        if(file_.is_open()) {
+            file_.close();
+        }
+        if(!out_) {
+            throw std::runtime_error("Failed to finish " + description_);
+        }
+    }
+
+    std::string TarSink::describe() const { return description_; }
+
+    void TarSink::write_entry(std::string_view name, char type, std::string_view content) {
+        char header[TAR_BLOCK] = {};
+        std::string_view stored_name = name;
+        std::string_view prefix;
+
+        if(name.size() > 100) {
+            // ustar splits long paths at a '/' into a 155-byte prefix and a 100-byte name.
+            size_t split = name.rfind('/', 155);
+            if(split != std::string_view::npos && split > 0 && name.size() - split - 1 <= 100 &&
+               name.size() - split - 1 > 0) {
+                prefix = name.substr(0, split);
+                stored_name = name.substr(split + 1);
+            } else {
+                std::string long_name(name);
+                long_name += '\0';
+                write_entry("././@LongLink", 'L', long_name);
+                stored_name = name.substr(0, 100);
+            }
+        }
+
+        std::memcpy(header, stored_name.data(), stored_name.size());
+        put_octal(header + 100, 8, 0644);
+        put_octal(header + 108, 8, 0);
+        put_octal(header + 116, 8, 0);
+        put_octal(header + 124, 12, content.size());
+        put_octal(header + 136, 12, static_cast<uint64_t>(mtime_));
+        header[156] = type;
+        std::memcpy(header + 257, "ustar", 6);
+        std::memcpy(header + 263, "00", 2);
+        std::memcpy(header + 345, prefix.data(), prefix.size());
+
+        // The checksum is computed with its own field read as spaces.
+        std::memset(header + 148, ' ', 8);
+        uint32_t checksum = 0;
+        for(unsigned char c : header) {
+            checksum += c;
+        }
+        put_octal(header + 148, 7, checksum);
+        header[155] = ' ';
+
+        out_.write(header, TAR_BLOCK);
+        out_.write(content.data(), static_cast<std::streamsize>(content.size()));
+        write_padding(content.size());
+    }
+
+    void TarSink::write_padding(size_t size) {
+        static const char zeros[TAR_BLOCK] = {};
+        size_t remainder = size % TAR_BLOCK;
+        if(remainder != 0) {
+            out_.write(zeros, static_cast<std::streamsize>(TAR_BLOCK - remainder));
+        }
+    }
+
+} // namespace ssg
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ssg {
+    // One output file written in pieces. Only close() makes it complete; one dropped without it may be partial.
+    class OutputFile {
+    public:
+        virtual ~OutputFile() = default;
+
+        virtual void write(std::string_view chunk) = 0;
+        virtual void close() = 0;
+    };
+
+    // Where a build's files go. Paths are '/'-separated and relative to the site root; write() is called
+    // concurrently from page tasks, so implementations serialize internally.
+    class OutputSink {
+    public:
+        virtual ~OutputSink() = default;
+
+        virtual void write(const std::string &relative_path, std::string_view content) = 0;
+
+        // Streams one file. The default collects the pieces and passes them to write() on close, for formats
+        // that need a file's size or whole body up front.
+        virtual std::unique_ptr<OutputFile> open_file(const std::string &relative_path);
+
+        // Finishes the output (archive index, tar trailer). Nothing may be written afterwards.
+        virtual void close() {}
+
+        // Set only for sinks backed by a directory, whose earlier contents a partial build can reuse.
+        virtual std::optional<std::filesystem::path> directory() const { return std::nullopt; }
+
+        virtual std::string describe() const = 0;
+
+        // "*.tar" writes a tar file, "*.pack" a packed archive, anything else is a directory. "-" (a tar on
+        // stdout) is left to the caller, which has to move its own logging off stdout first.
+        static std::shared_ptr<OutputSink> open(const std::filesystem::path &target);
+    };
+
+    class FileSystemSink : public OutputSink {
+    public:
+        explicit FileSystemSink(std::filesystem::path root);
+
+        void write(const std::string &relative_path, std::string_view content) override;
+        std::unique_ptr<OutputFile> open_file(const std::string &relative_path) override;
+        std::optional<std::filesystem::path> directory() const override { return root_; }
+        std::string describe() const override;
+
+    private:
+        std::filesystem::path root_;
+    };
+
+    // Keeps every file in memory, keyed by path; for tools and tests that consume a build without touching disk.
+    class MemorySink : public OutputSink {
+    public:
+        void write(const std::string &relative_path, std::string_view content) override;
+        std::string describe() const override;
+
+        std::optional<std::string> read(const std::string &relative_path) const;
+        std::map<std::string, std::string> files() const;
+
+    private:
+        mutable std::mutex mutex_;
+        std::map<std::string, std::string> files_;
+    };
+
+    // Single-file archive that can be written front to back: file bodies as they arrive, then an index of
+    // (path, offset, size) and a fixed footer locating it, so readers seek to the end and never scan the bodies.
+    class ArchiveSink : public OutputSink {
+    public:
+        static constexpr char MAGIC[8] = {'C', 'H', 'P', 'A', 'C', 'K', '1', '\0'};
+
+        explicit ArchiveSink(std::filesystem::path path);
+        ~ArchiveSink() override;
+
+        void write(const std::string &relative_path, std::string_view content) override;
+        void close() override;
+        std::string describe() const override;
+
+        static std::map<std::string, std::string> read(const std::filesystem::path &path);
+
+    private:
+        struct Entry {
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        std::filesystem::path path_;
+        std::ofstream out_;
+        std::mutex mutex_;
+        uint64_t offset_ = 0;
+        std::map<std::string, Entry> index_;
+        bool closed_ = false;
+    };
+
+    // POSIX ustar stream, written entry by entry so nothing is buffered beyond the file being added. Paths over
+    // the ustar limits get a GNU long-name entry, which GNU and BSD tar both read.
+    class TarSink : public OutputSink {
+    public:
+        // Writes to `out`, which must outlive the sink; the second form owns a file.
+        explicit TarSink(std::streambuf *out);
+        explicit TarSink(const std::filesystem::path &path);
+        ~TarSink() override;
+
+        void write(const std::string &relative_path, std::string_view content) override;
+        void close() override;
+        std::string describe() const override;
+
+    private:
+        std::ofstream file_;
+        std::ostream out_;
+        std::string description_;
+        std::mutex mutex_;
+        std::time_t mtime_;
+        bool closed_ = false;
+
+        void write_entry(std::string_view name, char type, std::string_view content);
+        void write_padding(size_t size);
+    };
+} // namespace ssg
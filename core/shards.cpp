@@ -0,0 +1,211 @@
+#include "shards.hpp"
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <stdexcept>
+
+#include "../parsers/json/json.hpp"
+#include "../utils/file_utils.hpp"
+
+namespace ssg {
+    namespace {
+        // A normalized manifest path that stays under the output directory once joined to it.
+        bool is_inside_output(const std::filesystem::path &relative) {
+            return !relative.empty() && !relative.has_root_path() && *relative.begin() != "..";
+        }
+    } // namespace
+
+    bool ShardSpec::owns(const std::string &key) const {
+        if(count <= 1) {
+            return true;
+        }
+        uint64_t bucket = utils::HashUtils::fnv1a(key) % static_cast<uint64_t>(count);
+        return static_cast<int>(bucket) == index - 1;
+    }
+
+    std::optional<ShardSpec> ShardSpec::parse(const std::string &value) {
+        auto slash = value.find('/');
+        if(slash == std::string::npos) {
+            return std::nullopt;
+        }
+
+        try {
+            size_t index_end = 0;
+            size_t count_end = 0;
+            std::string index_str = value.substr(0, slash);
+            std::string count_str = value.substr(slash + 1);
+
+            ShardSpec shard;
+            shard.index = std::stoi(index_str, &index_end);
+            shard.count = std::stoi(count_str, &count_end);
+
+            if(index_end != index_str.size() || count_end != count_str.size()) {
+                return std::nullopt;
+            }
+            if(shard.count < 1 || shard.index < 1 || shard.index > shard.count) {
+                return std::nullopt;
+            }
+            return shard;
+        } catch(const std::exception &) { return std::nullopt; }
+    }
+
+    std::string ShardManifest::to_json(const ShardSpec &shard, const BuildManifest &manifest) {
+        std::string shard_fields = "\"shard\": {\"index\": " + std::to_string(shard.index) +
+                                   ", \"count\": " + std::to_string(shard.count) + "}";
+        return manifest.to_json(shard_fields);
+    }
+
+    void ShardManifest::save(const std::filesystem::path &output_dir, const ShardSpec &shard,
+                             const BuildManifest &manifest) {
+        utils::FileUtils::write_file(output_dir / FILE_NAME, to_json(shard, manifest));
+    }
+
+    bool ShardManifest::load(const std::filesystem::path &shard_dir, ShardSpec &shard, BuildManifest &manifest) {
+        std::filesystem::path path = shard_dir / FILE_NAME;
+        if(!manifest.load(path)) {
+            return false;
+        }
+
+        auto root = json::Parser::deserialize(utils::FileUtils::read_file(path));
+        const auto &obj = root.get_object();
+        auto shard_it = obj.find("shard");
+        if(shard_it == obj.end() || !shard_it->second.is_object()) {
+            return false;
+        }
+
+        const auto &shard_obj = shard_it->second.get_object();
+        auto index_it = shard_obj.find("index");
+        auto count_it = shard_obj.find("count");
+        if(index_it == shard_obj.end() || count_it == shard_obj.end() || !index_it->second.is_number() ||
+           !count_it->second.is_number()) {
+            return false;
+        }
+
+        shard.index = static_cast<int>(index_it->second.get_number());
+        shard.count = static_cast<int>(count_it->second.get_number());
+        return true;
+    }
+
+    BuildManifest merge_shards(const std::vector<std::filesystem::path> &shard_dirs,
+                               const std::filesystem::path &output_dir) {
+        if(shard_dirs.empty()) {
+            throw std::runtime_error("No shard directories given");
+        }
+
+        struct LoadedShard {
+            std::filesystem::path dir;
+            ShardSpec spec;
+            BuildManifest manifest;
+        };
+
+        // Everything is checked before the first copy, so a merge that fails leaves output_dir as it was.
+        std::vector<LoadedShard> shards;
+        std::set<int> shard_indices;
+        int shard_count = 0;
+
+        for(const auto &shard_dir : shard_dirs) {
+            LoadedShard shard{shard_dir, {}, {}};
+            if(!ShardManifest::load(shard_dir, shard.spec, shard.manifest)) {
+                throw std::runtime_error("Missing or invalid shard manifest in: " + shard_dir.string());
+            }
+
+            if(shard_count == 0) {
+                shard_count = shard.spec.count;
+            } else if(shard.spec.count != shard_count) {
+                throw std::runtime_error("Shard count mismatch in " + shard_dir.string() + ": expected " +
+                                         std::to_string(shard_count) + ", found " + std::to_string(shard.spec.count));
+            }
+
+            if(shard.spec.index < 1 || shard.spec.index > shard.spec.count) {
+                throw std::runtime_error("Invalid shard " + std::to_string(shard.spec.index) + "/" +
+                                         std::to_string(shard.spec.count) + " in: " + shard_dir.string());
+            }
+            if(!shard_indices.insert(shard.spec.index).second) {
+                throw std::runtime_error("Shard " + std::to_string(shard.spec.index) + "/" +
+                                         std::to_string(shard.spec.count) + " given more than once");
+            }
+
+            shards.push_back(std::move(shard));
+        }
+
+        if(static_cast<int>(shard_indices.size()) != shard_count) {
+            std::string missing;
+            for(int i = 1; i <= shard_count; ++i) {
+                if(!shard_indices.count(i)) {
+                    missing += (missing.empty() ? "" : ", ") + std::to_string(i);
+                }
+            }
+            throw std::runtime_error("Missing shards: " + missing + " of " + std::to_string(shard_count));
+        }
+
+        BuildManifest merged;
+        std::map<std::string, ManifestEntry> seen;
+        std::vector<std::pair<std::filesystem::path, std::filesystem::path>> copies;
+        for(const auto &shard : shards) {
+            for(const auto &[relative_path, entry] : shard.manifest.entries()) {
+                std::filesystem::path relative = std::filesystem::path(relative_path).lexically_normal();
+                if(!is_inside_output(relative)) {
+                    throw std::runtime_error("Shard output outside the output directory in " + shard.dir.string() +
+                                             ": " + relative_path);
+                }
+
+                auto seen_it = seen.find(relative_path);
+                if(seen_it != seen.end()) {
+                    if(!(seen_it->second == entry)) {
+                        throw std::runtime_error("Conflicting shard outputs for: " + relative_path);
+                    }
+                    continue;
+                }
+
+                std::filesystem::path source = shard.dir / relative;
+                if(!std::filesystem::is_regular_file(source)) {
+                    throw std::runtime_error("Shard output listed in manifest is missing: " + source.string());
+                }
+
+                seen[relative_path] = entry;
+                merged.record(relative_path, entry);
+                copies.emplace_back(source, output_dir / relative);
+            }
+        }
+
+        for(const auto &[source, target] : copies) {
+            if(!std::filesystem::exists(target) || !std::filesystem::equivalent(source, target)) {
+                utils::FileUtils::ensure_directory(target.parent_path());
+                std::filesystem::copy_file(source, target, std::filesystem::copy_options::overwrite_existing);
+            }
+        }
+
+        for(const auto &shard : shards) {
+            std::cout << "🧩 Merged shard " << shard.spec.index << "/" << shard.spec.count << " from " << shard.dir
+                      << " (" << shard.manifest.entries().size() << " files)" << std::endl;
+        }
+
+        std::filesystem::path merged_shard_manifest = output_dir / ShardManifest::FILE_NAME;
+        if(std::filesystem::exists(merged_shard_manifest)) {
+            std::filesystem::remove(merged_shard_manifest);
+        }
+
+        return merged;
+    }
+
+    size_t remove_stale_outputs(const ChangeSet &changes, const std::filesystem::path &output_dir) {
+        size_t removed = 0;
+        for(const auto &change : changes.removed) {
+            std::filesystem::path relative = std::filesystem::path(change.path).lexically_normal();
+            if(!is_inside_output(relative)) {
+                std::cerr << "⚠️  Not removing output outside " << output_dir << ": " << change.path << std::endl;
+                continue;
+            }
+            std::error_code ec;
+            if(std::filesystem::remove(output_dir / relative, ec)) {
+                ++removed;
+            } else if(ec) {
+                throw std::runtime_error("Cannot remove stale output " + (output_dir / relative).string() + ": " +
+                                         ec.message());
+            }
+        }
+        return removed;
+    }
+
+} // namespace ssg
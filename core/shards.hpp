@@ -0,0 +1,40 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "manifest.hpp"
+
+namespace ssg {
+    // One slice of a sharded build. Indices are 1-based on the command line ("--shard 2/4") and every output
+    // path is assigned to exactly one shard by a stable hash, so all machines agree on the partition.
+    struct ShardSpec {
+        int index = 1;
+        int count = 1;
+
+        bool is_sharded() const { return count > 1; }
+        bool owns(const std::string &key) const;
+
+        static std::optional<ShardSpec> parse(const std::string &value);
+    };
+
+    class ShardManifest {
+    public:
+        static constexpr const char *FILE_NAME = ".chisel-shard.json";
+
+        static std::string to_json(const ShardSpec &shard, const BuildManifest &manifest);
+        static void save(const std::filesystem::path &output_dir, const ShardSpec &shard, const BuildManifest &manifest);
+        static bool load(const std::filesystem::path &shard_dir, ShardSpec &shard, BuildManifest &manifest);
+    };
+
+    // Copies the outputs of every shard into output_dir and combines their partial manifests. Throws, before
+    // copying anything, if the shards disagree on the shard count, a shard is missing or repeated, two shards wrote
+    // different content to the same path, or a listed path would land outside output_dir.
+    BuildManifest merge_shards(const std::vector<std::filesystem::path> &shard_dirs, const std::filesystem::path &output_dir);
+
+    // Deletes the files a merge dropped (changes.removed) from output_dir, so the change set matches the tree.
+    // Returns how many were deleted.
+    size_t remove_stale_outputs(const ChangeSet &changes, const std::filesystem::path &output_dir);
+} // namespace ssg
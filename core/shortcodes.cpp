@@ -0,0 +1,386 @@
+#include "shortcodes.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+
+#include "../parsers/json/json.hpp"
+#include "../parsers/template/template_engine.hpp"
+#include "../utils/file_utils.hpp"
+
+namespace ssg {
+    namespace {
+        constexpr std::string_view OPEN = "{{<";
+        constexpr std::string_view CLOSE = ">}}";
+
+        struct Directive {
+            std::string name;
+            std::vector<std::string> positional;
+            std::map<std::string, std::string> named;
+        };
+
+        bool is_name_char(char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-'; }
+
+        // `name arg key=value key="quoted value"`; nullopt when it does not start with a name.
+        std::optional<Directive> parse_directive(std::string_view body) {
+            Directive directive;
+            size_t i = 0;
+            auto skip_space = [&] {
+                while(i < body.size() && std::isspace(static_cast<unsigned char>(body[i]))) {
+                    ++i;
+                }
+            };
+            auto read_value = [&] {
+                std::string value;
+                if(i < body.size() && body[i] == '"') {
+                    for(++i; i < body.size() && body[i] != '"'; ++i) {
+                        if(body[i] == '\\' && i + 1 < body.size()) {
+                            ++i;
+                        }
+                        value += body[i];
+                    }
+                    ++i;
+                } else {
+                    while(i < body.size() && !std::isspace(static_cast<unsigned char>(body[i]))) {
+                        value += body[i++];
+                    }
+                }
+                return value;
+            };
+
+            skip_space();
+            while(i < body.size() && is_name_char(body[i])) {
+                directive.name += body[i++];
+            }
+            if(directive.name.empty()) {
+                return std::nullopt;
+            }
+
+            for(skip_space(); i < body.size(); skip_space()) {
+                size_t key_end = i;
+                while(key_end < body.size() && is_name_char(body[key_end])) {
+                    ++key_end;
+                }
+                if(key_end > i && key_end < body.size() && body[key_end] == '=') {
+                    std::string key(body.substr(i, key_end - i));
+                    i = key_end + 1;
+                    directive.named[key] = read_value();
+                } else {
+                    directive.positional.push_back(read_value());
+                }
+            }
+            return directive;
+        }
+
+        // Length of a leading front matter block, which is copied through untouched.
+        size_t front_matter_length(std::string_view text) {
+            for(std::string_view fence : {"---", "+++"}) {
+                if(text.substr(0, 3) != fence || (text.size() > 3 && text[3] != '\n' && text[3] != '\r')) {
+                    continue;
+                }
+                size_t close = text.find(std::string("\n") + std::string(fence), 3);
+                if(close == std::string_view::npos) {
+                    return 0;
+                }
+                size_t line_end = text.find('\n', close + 1);
+                return line_end == std::string_view::npos ? text.size() : line_end + 1;
+            }
+            return 0;
+        }
+
+        bool is_fence(std::string_view line) {
+            size_t indent = 0;
+            while(indent < line.size() && indent < 3 && line[indent] == ' ') {
+                ++indent;
+            }
+            line.remove_prefix(indent);
+            return line.substr(0, 3) == "```" || line.substr(0, 3) == "~~~";
+        }
+
+        std::string trim_trailing_newlines(std::string text) {
+            while(!text.empty() && (text.back() == '\n' || text.back() == '\r')) {
+                text.pop_back();
+            }
+            return text;
+        }
+    } // namespace
+
+    ShortcodeExpander::ShortcodeExpander(std::filesystem::path project_root, std::filesystem::path includes_dir,
+                                         std::filesystem::path shortcodes_dir)
+        : project_root_(std::move(project_root)), includes_dir_(std::move(includes_dir)),
+          shortcodes_dir_(std::move(shortcodes_dir)) {}
+
+    ShortcodeExpander::Expansion ShortcodeExpander::expand(std::shared_ptr<const std::string> source) {
+        if(source->find(OPEN) == std::string::npos) {
+            return {std::move(source), {}};
+        }
+
+        std::string_view text(*source);
+        size_t header = front_matter_length(text);
+        Result result;
+        result.text.reserve(source->size());
+        result.text.append(text.substr(0, header));
+        std::vector<std::string> stack;
+        expand_into(text.substr(header), result, stack);
+
+        return {std::make_shared<const std::string>(std::move(result.text)),
+                std::vector<std::string>(result.dependencies.begin(), result.dependencies.end())};
+    }
+
+    ShortcodeExpander::Stats ShortcodeExpander::stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    void ShortcodeExpander::clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        files_.clear();
+        includes_.clear();
+        shortcodes_.clear();
+        stats_ = Stats{};
+    }
+
+    void ShortcodeExpander::expand_into(std::string_view text, Result &out, std::vector<std::string> &stack) {
+        bool in_fence = false;
+        while(!text.empty()) {
+            size_t line_end = text.find('\n');
+            std::string_view line = text.substr(0, line_end == std::string_view::npos ? text.size() : line_end + 1);
+            text.remove_prefix(line.size());
+
+            if(is_fence(line)) {
+                in_fence = !in_fence;
+            }
+            if(in_fence || line.find(OPEN) == std::string_view::npos) {
+                out.text.append(line);
+                continue;
+            }
+
+            size_t pos = 0;
+            while(pos < line.size()) {
+                size_t open = line.find(OPEN, pos);
+                size_t close = open == std::string_view::npos ? open : line.find(CLOSE, open + OPEN.size());
+                if(close == std::string_view::npos) {
+                    out.text.append(line.substr(pos));
+                    break;
+                }
+                out.text.append(line.substr(pos, open - pos));
+                pos = close + CLOSE.size();
+
+                // An odd number of backticks before the directive puts it inside a code span.
+                size_t ticks = std::count(line.begin(), line.begin() + open, '`');
+                auto directive = parse_directive(line.substr(open + OPEN.size(), close - open - OPEN.size()));
+                if(ticks % 2 == 1 || !directive) {
+                    out.text.append(line.substr(open, pos - open));
+                    continue;
+                }
+
+                std::shared_ptr<const Result> expanded;
+                if(directive->name == "include") {
+                    auto path_it = directive->named.find("path");
+                    std::string target = path_it != directive->named.end() ? path_it->second
+                                         : directive->positional.empty() ? std::string()
+                                                                         : directive->positional.front();
+                    expanded = include(target, stack);
+                } else {
+                    expanded = shortcode(directive->name, directive->positional, directive->named, stack);
+                }
+                out.text.append(expanded->text);
+                out.dependencies.insert(expanded->dependencies.begin(), expanded->dependencies.end());
+            }
+        }
+    }
+
+    std::shared_ptr<const ShortcodeExpander::Result> ShortcodeExpander::include(const std::string &target,
+                                                                                std::vector<std::string> &stack) {
+        std::filesystem::path relative = std::filesystem::path(target).lexically_normal();
+        if(target.empty() || relative.is_absolute() || relative.begin() == relative.end() || *relative.begin() == "..") {
+            throw std::runtime_error("Invalid include path: \"" + target + "\"");
+        }
+        std::filesystem::path path = includes_dir_ / relative;
+        const File *file = read(path);
+        if(!file) {
+            throw std::runtime_error("Include not found: " + dependency_name(path));
+        }
+
+        std::string name = dependency_name(path);
+        uint64_t key = utils::HashUtils::fnv1a(name, file->hash);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = includes_.find(key);
+            if(it != includes_.end()) {
+                ++stats_.memoized;
+                return it->second;
+            }
+        }
+
+        if(std::find(stack.begin(), stack.end(), name) != stack.end() || stack.size() >= MAX_DEPTH) {
+            throw std::runtime_error("Include cycle or nesting too deep at " + name);
+        }
+        stack.push_back(name);
+        auto result = std::make_shared<Result>();
+        result->dependencies.insert(name);
+        expand_into(*file->bytes, *result, stack);
+        result->text = trim_trailing_newlines(std::move(result->text));
+        stack.pop_back();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.expanded;
+        return includes_.emplace(key, std::move(result)).first->second;
+    }
+
+    std::shared_ptr<const ShortcodeExpander::Result>
+    ShortcodeExpander::shortcode(const std::string &name, const std::vector<std::string> &positional,
+                                 const std::map<std::string, std::string> &named, std::vector<std::string> &stack) {
+        std::filesystem::path path = shortcodes_dir_ / (name + ".md");
+        const File *file = read(path);
+        if(!file) {
+            throw std::runtime_error("Unknown shortcode \"" + name + "\": no " + dependency_name(path));
+        }
+
+        std::string key = name + '\0' + utils::HashUtils::to_hex(file->hash);
+        for(const auto &value : positional) {
+            key += '\0' + value;
+        }
+        for(const auto &[arg, value] : named) {
+            key += '\1' + arg + '=' + value;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = shortcodes_.find(key);
+            if(it != shortcodes_.end()) {
+                ++stats_.memoized;
+                return it->second;
+            }
+        }
+
+        std::string dependency = dependency_name(path);
+        if(std::find(stack.begin(), stack.end(), dependency) != stack.end() || stack.size() >= MAX_DEPTH) {
+            throw std::runtime_error("Shortcode cycle or nesting too deep at " + dependency);
+        }
+
+        std::map<std::string, template_engine::TemplateValue> context;
+        for(const auto &[arg, value] : named) {
+            context[arg] = template_engine::TemplateValue(value);
+        }
+        context["args"] = template_engine::TemplateValue(positional);
+
+        stack.push_back(dependency);
+        auto result = std::make_shared<Result>();
+        result->dependencies.insert(dependency);
+        expand_into(template_engine::TemplateEngine::render(*file->bytes, context), *result, stack);
+        result->text = trim_trailing_newlines(std::move(result->text));
+        stack.pop_back();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.expanded;
+        return shortcodes_.emplace(std::move(key), std::move(result)).first->second;
+    }
+
+    const ShortcodeExpander::File *ShortcodeExpander::read(const std::filesystem::path &path) {
+        std::string key = path.string();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = files_.find(key);
+            if(it != files_.end()) {
+                return &it->second;
+            }
+        }
+
+        std::error_code ec;
+        if(!std::filesystem::is_regular_file(path, ec)) {
+            return nullptr;
+        }
+        auto bytes = std::make_shared<const std::string>(utils::FileUtils::read_file(path));
+        File file{utils::HashUtils::fnv1a(*bytes), std::move(bytes)};
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        return &files_.emplace(std::move(key), std::move(file)).first->second;
+    }
+
+    std::string ShortcodeExpander::dependency_name(const std::filesystem::path &path) const {
+        return path.lexically_relative(project_root_).generic_string();
+    }
+
+    void PageDependencies::set(const std::string &page, const std::vector<std::string> &dependencies) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(dependencies.empty()) {
+            pages_.erase(page);
+        } else {
+            pages_[page] = dependencies;
+        }
+    }
+
+    std::vector<std::string> PageDependencies::of(const std::string &page) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = pages_.find(page);
+        return it == pages_.end() ? std::vector<std::string>{} : it->second;
+    }
+
+    bool PageDependencies::load(const std::filesystem::path &path) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pages_.clear();
+
+        if(!std::filesystem::exists(path)) {
+            return false;
+        }
+
+        try {
+            auto root = json::Parser::deserialize(utils::FileUtils::read_file(path));
+            if(!root.is_object()) {
+                return false;
+            }
+
+            const auto &obj = root.get_object();
+            auto version_it = obj.find("version");
+            if(version_it == obj.end() || !version_it->second.is_number() ||
+               static_cast<int>(version_it->second.get_number()) != FORMAT_VERSION) {
+                return false;
+            }
+
+            auto pages_it = obj.find("pages");
+            if(pages_it == obj.end() || !pages_it->second.is_object()) {
+                return false;
+            }
+
+            for(const auto &[page, value] : pages_it->second.get_object()) {
+                if(!value.is_array()) {
+                    continue;
+                }
+                std::vector<std::string> dependencies;
+                for(const auto &dependency : value.get_array()) {
+                    if(dependency.is_string()) {
+                        dependencies.push_back(dependency.get_string());
+                    }
+                }
+                pages_[page] = std::move(dependencies);
+            }
+            return true;
+
+        } catch(const std::exception &e) {
+            std::cerr << "⚠️  Failed to read page dependencies " << path << ": " << e.what() << std::endl;
+            pages_.clear();
+            return false;
+        }
+    }
+
+    void PageDependencies::save(const std::filesystem::path &path) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::string out = "{\n  \"version\": " + std::to_string(FORMAT_VERSION) + ",\n  \"pages\": {";
+        bool first = true;
+        for(const auto &[page, dependencies] : pages_) {
+            out += first ? "\n    " : ",\n    ";
+            first = false;
+            json::Value(page).serialize(out);
+            out += ": [";
+            for(size_t i = 0; i < dependencies.size(); ++i) {
+                out += i == 0 ? "" : ", ";
+                json::Value(dependencies[i]).serialize(out);
+            }
+            out += "]";
+        }
+        out += pages_.empty() ? "}\n}\n" : "\n  }\n}\n";
+        utils::FileUtils::write_file(path, out);
+    }
+} // namespace ssg
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ssg {
+    // Expands `{{< include "file.md" >}}` and `{{< name key="value" >}}` in page sources before they are parsed.
+    // An include is the file under includes_dir; a shortcode renders shortcodes_dir/<name>.md through the template
+    // engine with its arguments (named ones by key, all positional ones as `args`). Both produce markdown, which is
+    // expanded again, so snippets may use shortcodes. Directives inside fenced code or inline code are left alone.
+    //
+    // Results are memoized until clear(): files by path, includes by the hash of the file's bytes, shortcodes by
+    // name, template hash and arguments. Safe to call from several page tasks at once.
+    class ShortcodeExpander {
+    public:
+        static constexpr size_t MAX_DEPTH = 16;
+
+        struct Expansion {
+            std::shared_ptr<const std::string> text;
+            // Snippet and shortcode files the text was built from, relative to the project root, sorted.
+            std::vector<std::string> dependencies;
+        };
+
+        ShortcodeExpander(std::filesystem::path project_root, std::filesystem::path includes_dir,
+                          std::filesystem::path shortcodes_dir);
+
+        // A source without directives comes back as the same pointer. Throws std::runtime_error for an unknown
+        // shortcode, a missing or out-of-tree include, and include cycles.
+        Expansion expand(std::shared_ptr<const std::string> source);
+
+        struct Stats {
+            size_t expanded = 0;
+            size_t memoized = 0;
+        };
+
+        Stats stats() const;
+
+        // Forgets every file read and expansion made, so snippets edited since are read again. Called at the start
+        // of each build; not while pages are being expanded.
+        void clear();
+
+    private:
+        struct File {
+            uint64_t hash;
+            std::shared_ptr<const std::string> bytes;
+        };
+
+        struct Result {
+            std::string text;
+            std::set<std::string> dependencies;
+        };
+
+        std::filesystem::path project_root_;
+        std::filesystem::path includes_dir_;
+        std::filesystem::path shortcodes_dir_;
+
+        mutable std::mutex mutex_;
+        std::unordered_map<std::string, File> files_;
+        std::unordered_map<uint64_t, std::shared_ptr<const Result>> includes_;
+        std::unordered_map<std::string, std::shared_ptr<const Result>> shortcodes_;
+        Stats stats_;
+
+        const File *read(const std::filesystem::path &path);
+        std::string dependency_name(const std::filesystem::path &path) const;
+
+        void expand_into(std::string_view text, Result &out, std::vector<std::string> &stack);
+        std::shared_ptr<const Result> include(const std::string &target, std::vector<std::string> &stack);
+        std::shared_ptr<const Result> shortcode(const std::string &name, const std::vector<std::string> &positional,
+                                                const std::map<std::string, std::string> &named,
+                                                std::vector<std::string> &stack);
+    };
+
+    // Which snippet and shortcode files each page was expanded from, kept between builds so a partial build
+    // naming a snippet (--only 'includes/callout.md') rebuilds exactly the pages that use it.
+    class PageDependencies {
+    public:
+        static constexpr int FORMAT_VERSION = 1;
+        static constexpr const char *FILE_NAME = "dependencies.json";
+
+        // page is the source path relative to the content directory; an empty list forgets the page.
+        void set(const std::string &page, const std::vector<std::string> &dependencies);
+
+        std::vector<std::string> of(const std::string &page) const;
+
+        bool load(const std::filesystem::path &path);
+        void save(const std::filesystem::path &path) const;
+
+    private:
+        mutable std::mutex mutex_;
+        std::map<std::string, std::vector<std::string>> pages_;
+    };
+} // namespace ssg
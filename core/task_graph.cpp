@@ -0,0 +1,186 @@
+#include "task_graph.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+namespace ssg {
+
+    TaskGraph::TaskGraph(utils::ThreadPool &pool) : pool_(pool), epoch_(std::chrono::steady_clock::now()) {}
+
+    TaskId TaskGraph::add(const std::string &name, std::function<void()> work, const std::vector<TaskId> &dependencies) {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        TaskId id = tasks_.size();
+        Task task;
+        task.name = name;
+        task.work = std::move(work);
+        task.dependencies = dependencies;
+
+        for(TaskId dependency : dependencies) {
+            if(dependency >= id) {
+                throw std::invalid_argument("Task '" + name + "' depends on an unknown task");
+            }
+            if(!tasks_[dependency].finished) {
+                tasks_[dependency].dependents.push_back(id);
+                ++task.pending_dependencies;
+            }
+        }
+
+        tasks_.push_back(std::move(task));
+        ++unfinished_;
+
+        if(running_ && tasks_[id].pending_dependencies == 0) {
+            schedule(id);
+        }
+        return id;
+    }
+
+    void TaskGraph::run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        running_ = true;
+        epoch_ = std::chrono::steady_clock::now();
+
+        for(TaskId id = 0; id < tasks_.size(); ++id) {
+            if(!tasks_[id].finished && tasks_[id].pending_dependencies == 0) {
+                schedule(id);
+            }
+        }
+
+        all_done_.wait(lock, [this] { return unfinished_ == 0; });
+        running_ = false;
+
+        if(first_error_) {
+            std::exception_ptr error = first_error_;
+            first_error_ = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    void TaskGraph::schedule(TaskId id) {
+        pool_.submit([this, id] { execute(id); });
+    }
+
+    void TaskGraph::execute(TaskId id) {
+        std::function<void()> work;
+        bool skip = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            work = std::move(tasks_[id].work);
+            skip = first_error_ != nullptr;
+            tasks_[id].start = std::chrono::steady_clock::now();
+        }
+
+        std::exception_ptr error;
+        if(!skip && work) {
+            try {
+                work();
+            } catch(...) { error = std::current_exception(); }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        Task &task = tasks_[id];
+        task.end = std::chrono::steady_clock::now();
+        task.finished = true;
+        if(error && !first_error_) {
+            first_error_ = error;
+        }
+
+        for(TaskId dependent : task.dependents) {
+            if(--tasks_[dependent].pending_dependencies == 0) {
+                schedule(dependent);
+            }
+        }
+
+        if(--unfinished_ == 0) {
+            all_done_.notify_all();
+        }
+    }
+
+    TaskTiming TaskGraph::timing_for(const Task &task) const {
+        using ms = std::chrono::duration<double, std::milli>;
+        TaskTiming timing;
+        timing.name = task.name;
+        timing.start_ms = ms(task.start - epoch_).count();
+        timing.end_ms = ms(task.end - epoch_).count();
+        return timing;
+    }
+
+    std::vector<TaskTiming> TaskGraph::timings() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<TaskTiming> result;
+        for(const auto &task : tasks_) {
+            if(task.finished) {
+                result.push_back(timing_for(task));
+            }
+        }
+        return result;
+    }
+
+    std::vector<TaskTiming> TaskGraph::critical_path() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<TaskTiming> path;
+
+        const Task *current = nullptr;
+        for(const auto &task : tasks_) {
+            if(task.finished && (current == nullptr || task.end > current->end)) {
+                current = &task;
+            }
+        }
+
+        while(current != nullptr) {
+            path.push_back(timing_for(*current));
+
+            const Task *latest = nullptr;
+            for(TaskId dependency : current->dependencies) {
+                const Task &candidate = tasks_[dependency];
+                if(latest == nullptr || candidate.end > latest->end) {
+                    latest = &candidate;
+                }
+            }
+            current = latest;
+        }
+
+        std::reverse(path.begin(), path.end());
+        return path;
+    }
+
+    void TaskGraph::print_profile(std::ostream &out, size_t top_count) const {
+        auto all = timings();
+        auto path = critical_path();
+
+        double wall_ms = 0.0;
+        double busy_ms = 0.0;
+        for(const auto &timing : all) {
+            wall_ms = std::max(wall_ms, timing.end_ms);
+            busy_ms += timing.duration_ms();
+        }
+
+        out << std::fixed << std::setprecision(2);
+        out << "⏱️  Build profile: " << all.size() << " tasks on " << pool_.size() << " threads, " << wall_ms
+            << " ms wall, " << busy_ms << " ms busy";
+        if(wall_ms > 0.0) {
+            out << " (" << busy_ms / wall_ms << "x parallelism)";
+        }
+        out << std::endl;
+
+        std::sort(all.begin(), all.end(),
+                  [](const TaskTiming &a, const TaskTiming &b) { return a.duration_ms() > b.duration_ms(); });
+        out << "⏱️  Slowest tasks:" << std::endl;
+        for(size_t i = 0; i < all.size() && i < top_count; ++i) {
+            out << "   " << std::setw(10) << all[i].duration_ms() << " ms  " << all[i].name << std::endl;
+        }
+
+        double path_ms = 0.0;
+        for(const auto &timing : path) {
+            path_ms += timing.duration_ms();
+        }
+        out << "⏱️  Critical path (" << path_ms << " ms of work, " << wall_ms << " ms wall):" << std::endl;
+        for(const auto &timing : path) {
+            out << "   " << std::setw(10) << timing.start_ms << " → " << std::setw(10) << timing.end_ms << " ms  "
+                << timing.name << std::endl;
+        }
+        out << std::defaultfloat;
+    }
+
+} // namespace ssg
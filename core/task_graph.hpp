@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../utils/thread_pool.hpp"
+
+namespace ssg {
+    using TaskId = size_t;
+
+    struct TaskTiming {
+        std::string name;
+        double start_ms = 0.0;
+        double end_ms = 0.0;
+
+        double duration_ms() const { return end_ms - start_ms; }
+    };
+
+    // Dependency graph of build steps executed on a thread pool. A task starts as soon as all of its
+    // dependencies have finished; tasks may add further tasks while the graph is running (e.g. one render
+    // task per page once content has been scanned). If any task throws, tasks that have not started yet are
+    // skipped and run() rethrows the first exception.
+    class TaskGraph {
+    public:
+        explicit TaskGraph(utils::ThreadPool &pool);
+
+        TaskId add(const std::string &name, std::function<void()> work, const std::vector<TaskId> &dependencies = {});
+
+        // Blocks until every task, including ones added while running, has finished.
+        void run();
+
+        std::vector<TaskTiming> timings() const;
+
+        // Chain of tasks that determined the wall time: starting from the task that finished last, repeatedly
+        // follow the dependency that finished last.
+        std::vector<TaskTiming> critical_path() const;
+
+        void print_profile(std::ostream &out, size_t top_count = 10) const;
+
+    private:
+        struct Task {
+            std::string name;
+            std::function<void()> work;
+            std::vector<TaskId> dependencies;
+            std::vector<TaskId> dependents;
+            size_t pending_dependencies = 0;
+            bool finished = false;
+            std::chrono::steady_clock::time_point start;
+            std::chrono::steady_clock::time_point end;
+        };
+
+        utils::ThreadPool &pool_;
+        mutable std::mutex mutex_;
+        std::condition_variable all_done_;
+        std::vector<Task> tasks_;
+        size_t unfinished_ = 0;
+        bool running_ = false;
+        std::exception_ptr first_error_;
+        std::chrono::steady_clock::time_point epoch_;
+
+        void schedule(TaskId id);
+        void execute(TaskId id);
+        TaskTiming timing_for(const Task &task) const;
+    };
+} // namespace ssg
@@ -0,0 +1,918 @@
+#include "../includes/tests.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../utils/file_utils.hpp"
+#include "build_cache.hpp"
+#include "config.hpp"
+#include "i18n.hpp"
+#include "metadata_index.hpp"
+#include "output_sink.hpp"
+#include "shards.hpp"
+#include "shortcodes.hpp"
+
+namespace {
+    // A scratch directory under the system temp dir, emptied on creation and removed with the object.
+    class TempDir {
+    public:
+        explicit TempDir(const std::string &name) : path_(std::filesystem::temp_directory_path() / name) {
+            std::filesystem::remove_all(path_);
+            std::filesystem::create_directories(path_);
+        }
+        ~TempDir() {
+            std::error_code ec;
+            std::filesystem::remove_all(path_, ec);
+        }
+
+        const std::filesystem::path &path() const { return path_; }
+
+    private:
+        std::filesystem::path path_;
+    };
+
+    void write_text(const std::filesystem::path &path, const std::string &text) {
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << text;
+    }
+
+    std::string read_text(const std::filesystem::path &path) { return ssg::utils::FileUtils::read_file(path); }
+
+    // Writes the given files into dir and records them in its shard manifest, as a sharded build would.
+    void write_shard(const std::filesystem::path &dir, int index, int count,
+                     const std::vector<std::pair<std::string, std::string>> &files) {
+        ssg::BuildManifest manifest;
+        for(const auto &[relative_path, content] : files) {
+            write_text(dir / relative_path, content);
+            manifest.record(relative_path, content);
+        }
+        ssg::ShardManifest::save(dir, ssg::ShardSpec{index, count}, manifest);
+    }
+
+    bool merge_throws(const std::vector<std::filesystem::path> &shard_dirs, const std::filesystem::path &output_dir) {
+        try {
+            ssg::merge_shards(shard_dirs, output_dir);
+        } catch(const std::runtime_error &) {
+            return true;
+        }
+        return false;
+    }
+    // Reads back a ustar stream: prefix/name pairs, GNU long names and header checksums.
+    std::map<std::string, std::string> read_tar(const std::string &data) {
+        auto field = [](const char *start, size_t width) {
+            std::string_view value(start, width);
+            return std::string(value.substr(0, value.find('\0')));
+        };
+
+        std::map<std::string, std::string> files;
+        std::string long_name;
+        size_t pos = 0;
+        while(pos + 512 <= data.size()) {
+            const char *header = data.data() + pos;
+            if(std::string_view(header, 512).find_first_not_of('\0') == std::string_view::npos) {
+                break;
+            }
+
+            uint32_t checksum = 0;
+            for(size_t i = 0; i < 512; ++i) {
+                checksum += (i >= 148 && i < 156) ? ' ' : static_cast<unsigned char>(header[i]);
+            }
+            if(checksum != std::stoul(field(header + 148, 8), nullptr, 8)) {
+                throw std::runtime_error("Bad tar header checksum at " + std::to_string(pos));
+            }
+
+            size_t size = std::stoull(field(header + 124, 12), nullptr, 8);
+            std::string content = data.substr(pos + 512, size);
+            pos += 512 + (size + 511) / 512 * 512;
+
+            if(header[156] == 'L') {
+                long_name = field(content.data(), content.size());
+                continue;
+            }
+            std::string name = field(header, 100);
+            std::string prefix = field(header + 345, 155);
+            if(!long_name.empty()) {
+                name = long_name;
+                long_name.clear();
+            } else if(!prefix.empty()) {
+                name = prefix + "/" + name;
+            }
+            files[name] = content;
+        }
+        return files;
+    }
+
+    // Paths that exercise each way a tar header can hold a name.
+    std::map<std::string, std::string> sample_files() {
+        std::string binary("\0\x01\xff\r\n", 5);
+        return {
+            {"index.html", "<h1>home</h1>"},
+            {"empty.txt", ""},
+            {"images/pixel.bin", binary},
+            {"styles/main.css", std::string(1500, 'c')},
+            {std::string(70, 'a') + "/" + std::string(60, 'b') + "/index.html", "split into prefix and name"},
+            {std::string(120, 'x') + ".html", "no slash, so a long-name entry"},
+            {"posts/" + std::string(110, 'y') + ".html", "file name alone over 100 bytes"},
+        };
+    }
+    // A project with includes/ and templates/shortcodes/, and an expander over it.
+    struct ShortcodeProject {
+        TempDir root;
+        ssg::ShortcodeExpander expander;
+
+        explicit ShortcodeProject(const std::string &name)
+            : root(name), expander(root.path(), root.path() / "includes", root.path() / "templates/shortcodes") {}
+
+        void include(const std::string &name, const std::string &text) { write_text(root.path() / "includes" / name, text); }
+        void shortcode(const std::string &name, const std::string &text) {
+            write_text(root.path() / "templates/shortcodes" / (name + ".md"), text);
+        }
+
+        ssg::ShortcodeExpander::Expansion expand(const std::string &source) {
+            return expander.expand(std::make_shared<const std::string>(source));
+        }
+
+        bool rejects(const std::string &source) {
+            try {
+                expand(source);
+            } catch(const std::runtime_error &) {
+                return true;
+            }
+            return false;
+        }
+    };
+    // Writes a page with YAML front matter; fields are "key: value" lines.
+    void write_page(const std::filesystem::path &path, const std::vector<std::string> &fields,
+                    const std::string &body = "Body\n") {
+        std::string text = "---\n";
+        for(const auto &field : fields) {
+            text += field + "\n";
+        }
+        write_text(path, text + "---\n" + body);
+    }
+
+    // Sources of the rows a query selects, sorted; rows themselves are in directory order.
+    std::vector<std::string> query_sources(const ssg::MetadataIndex &index, const std::vector<std::string> &terms) {
+        std::vector<std::string> sources;
+        for(size_t row : ssg::MetadataQuery::parse(terms).run(index)) {
+            sources.push_back(index.source(row));
+        }
+        std::sort(sources.begin(), sources.end());
+        return sources;
+    }
+
+    std::map<std::string, std::string> metadata_of(const ssg::MetadataIndex &index, const std::string &source) {
+        for(size_t row = 0; row < index.size(); ++row) {
+            if(index.source(row) == source) {
+                return index.metadata(row);
+            }
+        }
+        throw std::runtime_error("No row for " + source);
+    }
+} // namespace
+
+TEST(ShardSpecParse) {
+    auto shard = ssg::ShardSpec::parse("2/4");
+    ASSERT_TRUE(shard.has_value());
+    ASSERT_EQ(shard->index, 2);
+    ASSERT_EQ(shard->count, 4);
+    ASSERT_TRUE(shard->is_sharded());
+
+    ASSERT_TRUE(!ssg::ShardSpec::parse("0/4").has_value());
+    ASSERT_TRUE(!ssg::ShardSpec::parse("5/4").has_value());
+    ASSERT_TRUE(!ssg::ShardSpec::parse("2/").has_value());
+    ASSERT_TRUE(!ssg::ShardSpec::parse("2").has_value());
+    ASSERT_TRUE(!ssg::ShardSpec::parse("2x/4").has_value());
+    ASSERT_TRUE(!ssg::ShardSpec().is_sharded());
+    std::cout << "Shard specs parsed, out-of-range and malformed ones rejected";
+}
+
+TEST(ShardSpecOwnsEachPathOnce) {
+    const int count = 4;
+    size_t owned_once = 0;
+    std::set<int> used;
+    for(int i = 0; i < 200; ++i) {
+        std::string key = "posts/post-" + std::to_string(i) + "/index.html";
+        int owners = 0;
+        for(int index = 1; index <= count; ++index) {
+            if(ssg::ShardSpec{index, count}.owns(key)) {
+                ++owners;
+                used.insert(index);
+            }
+        }
+        if(owners == 1) {
+            ++owned_once;
+        }
+    }
+    ASSERT_EQ(owned_once, 200u);
+    ASSERT_EQ(used.size(), static_cast<size_t>(count));
+    ASSERT_TRUE(ssg::ShardSpec().owns("index.html"));
+    std::cout << "Every path owned by exactly one of " << count << " shards";
+}
+
+TEST(ShardManifestRoundTrip) {
+    TempDir dir("chisel_core_shard_manifest");
+    ssg::BuildManifest manifest;
+    manifest.record("index.html", std::string_view("<h1>home</h1>"));
+    manifest.record("styles/main.css", std::string_view("body{}"));
+    ssg::ShardManifest::save(dir.path(), ssg::ShardSpec{3, 5}, manifest);
+
+    ssg::ShardSpec shard;
+    ssg::BuildManifest loaded;
+    ASSERT_TRUE(ssg::ShardManifest::load(dir.path(), shard, loaded));
+    ASSERT_EQ(shard.index, 3);
+    ASSERT_EQ(shard.count, 5);
+    ASSERT_TRUE(loaded.entries() == manifest.entries());
+
+    ssg::BuildManifest plain;
+    plain.save(dir.path() / ssg::ShardManifest::FILE_NAME);
+    ASSERT_TRUE(!ssg::ShardManifest::load(dir.path(), shard, loaded));
+    std::cout << "Shard manifest keeps its spec and entries; a plain manifest is rejected";
+}
+
+TEST(MergeShardsComplete) {
+    TempDir root("chisel_core_merge_complete");
+    auto one = root.path() / "one";
+    auto two = root.path() / "two";
+    auto out = root.path() / "dist";
+    write_shard(one, 1, 2, {{"index.html", "home"}, {"styles/main.css", "body{}"}});
+    write_shard(two, 2, 2, {{"posts/a/index.html", "post a"}, {"styles/main.css", "body{}"}});
+
+    ssg::BuildManifest merged = ssg::merge_shards({one, two}, out);
+    ASSERT_EQ(merged.entries().size(), 3u);
+    ASSERT_EQ(read_text(out / "index.html"), "home");
+    ASSERT_EQ(read_text(out / "posts/a/index.html"), "post a");
+    ASSERT_EQ(read_text(out / "styles/main.css"), "body{}");
+    ASSERT_TRUE(!std::filesystem::exists(out / ssg::ShardManifest::FILE_NAME));
+    std::cout << "Two shards merged, shared identical output kept once";
+}
+
+TEST(MergeShardsMissingShardWritesNothing) {
+    TempDir root("chisel_core_merge_missing");
+    auto one = root.path() / "one";
+    auto three = root.path() / "three";
+    auto out = root.path() / "dist";
+    write_shard(one, 1, 3, {{"index.html", "new home"}});
+    write_shard(three, 3, 3, {{"about/index.html", "about"}});
+    write_text(out / "index.html", "old home");
+
+    ASSERT_TRUE(merge_throws({one, three}, out));
+    ASSERT_EQ(read_text(out / "index.html"), "old home");
+    ASSERT_TRUE(!std::filesystem::exists(out / "about/index.html"));
+
+    ASSERT_TRUE(merge_throws({one, one}, out));
+    ASSERT_TRUE(merge_throws({}, out));
+    std::cout << "Missing and repeated shards rejected before dist/ is touched";
+}
+
+TEST(MergeShardsConflict) {
+    TempDir root("chisel_core_merge_conflict");
+    auto one = root.path() / "one";
+    auto two = root.path() / "two";
+    auto out = root.path() / "dist";
+    write_shard(one, 1, 2, {{"index.html", "home"}, {"sitemap.xml", "<urlset>1</urlset>"}});
+    write_shard(two, 2, 2, {{"sitemap.xml", "<urlset>2</urlset>"}});
+
+    ASSERT_TRUE(merge_throws({one, two}, out));
+    ASSERT_TRUE(!std::filesystem::exists(out / "index.html"));
+
+    auto mismatched = root.path() / "mismatched";
+    write_shard(mismatched, 2, 3, {{"about/index.html", "about"}});
+    ASSERT_TRUE(merge_throws({one, mismatched}, out));
+    std::cout << "Conflicting outputs and shard counts rejected";
+}
+
+TEST(MergeShardsRejectsTraversal) {
+    TempDir root("chisel_core_merge_traversal");
+    auto one = root.path() / "one";
+    auto two = root.path() / "two";
+    auto out = root.path() / "dist";
+    write_shard(one, 1, 2, {{"index.html", "home"}});
+    write_shard(two, 2, 2, {});
+    write_text(root.path() / "escape.html", "shard file");
+
+    ssg::BuildManifest escaping;
+    escaping.record("../escape.html", std::string_view("shard file"));
+    ssg::ShardManifest::save(two, ssg::ShardSpec{2, 2}, escaping);
+
+    ASSERT_TRUE(merge_throws({one, two}, out));
+    ASSERT_TRUE(!std::filesystem::exists(out / "index.html"));
+
+    ssg::BuildManifest absolute;
+    absolute.record((root.path() / "absolute.html").string(), std::string_view("x"));
+    ssg::ShardManifest::save(two, ssg::ShardSpec{2, 2}, absolute);
+    ASSERT_TRUE(merge_throws({one, two}, out));
+    ASSERT_TRUE(!std::filesystem::exists(root.path() / "absolute.html"));
+    std::cout << "Paths with .. or a root rejected";
+}
+
+TEST(RemoveStaleOutputsStaysInside) {
+    TempDir root("chisel_core_remove_stale");
+    auto out = root.path() / "dist";
+    write_text(out / "old/index.html", "old");
+    write_text(root.path() / "keep.txt", "outside");
+
+    ssg::ChangeSet changes;
+    changes.removed.push_back({"old/index.html", {}});
+    changes.removed.push_back({"../keep.txt", {}});
+    changes.removed.push_back({"missing.html", {}});
+
+    ASSERT_EQ(ssg::remove_stale_outputs(changes, out), 1u);
+    ASSERT_TRUE(!std::filesystem::exists(out / "old/index.html"));
+    ASSERT_TRUE(std::filesystem::exists(root.path() / "keep.txt"));
+    std::cout << "Stale outputs removed, paths outside dist/ left alone";
+}
+
+TEST(TarSinkRoundTrip) {
+    auto files = sample_files();
+    std::stringbuf buffer;
+    {
+        ssg::TarSink sink(&buffer);
+        for(const auto &[path, content] : files) {
+            sink.write(path, content);
+        }
+        sink.close();
+    }
+    std::string data = buffer.str();
+    ASSERT_EQ(data.size() % 512, 0u);
+    ASSERT_TRUE(data.size() >= 1024 && data.find_first_not_of('\0', data.size() - 1024) == std::string::npos);
+    ASSERT_TRUE(read_tar(data) == files);
+
+    TempDir dir("chisel_core_tar_sink");
+    {
+        auto sink = ssg::OutputSink::open(dir.path() / "site.tar");
+        for(const auto &[path, content] : files) {
+            auto file = sink->open_file(path);
+            file->write(std::string_view(content).substr(0, content.size() / 2));
+            file->write(std::string_view(content).substr(content.size() / 2));
+            file->close();
+        }
+        sink->close();
+    }
+    ASSERT_TRUE(read_tar(read_text(dir.path() / "site.tar")) == files);
+    std::cout << "Tar entries read back byte for byte, long paths included";
+}
+
+TEST(ArchiveSinkRoundTrip) {
+    auto files = sample_files();
+    TempDir dir("chisel_core_archive_sink");
+    auto path = dir.path() / "site.pack";
+    {
+        auto sink = ssg::OutputSink::open(path);
+        for(const auto &[relative_path, content] : files) {
+            sink->write(relative_path, content);
+        }
+        sink->close();
+    }
+    ASSERT_TRUE(ssg::ArchiveSink::read(path) == files);
+
+    std::string data = read_text(path);
+    ASSERT_EQ(data.compare(0, sizeof(ssg::ArchiveSink::MAGIC), ssg::ArchiveSink::MAGIC, sizeof(ssg::ArchiveSink::MAGIC)),
+              0);
+
+    auto rejects = [&](const std::string &bytes) {
+        write_text(dir.path() / "bad.pack", bytes);
+        try {
+            ssg::ArchiveSink::read(dir.path() / "bad.pack");
+        } catch(const std::runtime_error &) {
+            return true;
+        }
+        return false;
+    };
+    ASSERT_TRUE(rejects(""));
+    ASSERT_TRUE(rejects(data.substr(0, data.size() - 1)));
+    ASSERT_TRUE(rejects(data.substr(sizeof(ssg::ArchiveSink::MAGIC))));
+    std::cout << "Pack index locates every body; truncated archives rejected";
+}
+
+TEST(FileSystemSinkRoundTrip) {
+    auto files = sample_files();
+    TempDir dir("chisel_core_fs_sink");
+    {
+        auto sink = ssg::OutputSink::open(dir.path() / "dist");
+        ASSERT_TRUE(sink->directory().has_value());
+        for(const auto &[path, content] : files) {
+            auto file = sink->open_file(path);
+            file->write(content);
+            file->close();
+        }
+        sink->close();
+    }
+    size_t matched = 0;
+    for(const auto &[path, content] : files) {
+        if(read_text(dir.path() / "dist" / path) == content) {
+            ++matched;
+        }
+    }
+    ASSERT_EQ(matched, files.size());
+    std::cout << "Directory sink writes every file as given";
+}
+
+TEST(MemorySinkRoundTrip) {
+    auto files = sample_files();
+    ssg::MemorySink sink;
+    for(const auto &[path, content] : files) {
+        auto file = sink.open_file(path);
+        file->write(std::string_view(content).substr(0, content.size() / 2));
+        file->write(std::string_view(content).substr(content.size() / 2));
+        file->close();
+    }
+    sink.close();
+    ASSERT_TRUE(sink.files() == files);
+    for(const auto &[path, content] : files) {
+        auto stored = sink.read(path);
+        ASSERT_TRUE(stored.has_value() && *stored == content);
+    }
+    ASSERT_TRUE(!sink.read("missing.html").has_value());
+    std::cout << "Memory sink keeps every file as given";
+}
+
+TEST(ShortcodeExpanderIncludes) {
+    ShortcodeProject project("chisel_core_shortcode_include");
+    project.include("note.md", "> A note\n\n");
+    project.include("nested.md", "Before {{< include \"note.md\" >}}\n");
+
+    auto plain = std::make_shared<const std::string>("No directives here.\n");
+    ASSERT_TRUE(project.expander.expand(plain).text == plain);
+
+    auto expansion = project.expand("---\ntitle: x\n---\n{{< include \"nested.md\" >}}\nAfter\n");
+    ASSERT_EQ(*expansion.text, "---\ntitle: x\n---\nBefore > A note\nAfter\n");
+    ASSERT_EQ(expansion.dependencies.size(), 2u);
+    ASSERT_EQ(expansion.dependencies[0], "includes/nested.md");
+    ASSERT_EQ(expansion.dependencies[1], "includes/note.md");
+
+    project.expand("{{< include path=\"note.md\" >}}\n");
+    ASSERT_TRUE(project.expander.stats().memoized >= 1);
+    std::cout << "Nested includes expanded and recorded as dependencies";
+}
+
+TEST(ShortcodeExpanderArguments) {
+    ShortcodeProject project("chisel_core_shortcode_args");
+    project.shortcode("callout", "**{{kind}}**: {{#each args}}[{{this}}]{{/each}}\n");
+
+    auto expansion = project.expand("{{< callout kind=\"warning \\\"hot\\\"\" first second >}}\n");
+    ASSERT_EQ(*expansion.text, "**warning \"hot\"**: [first][second]\n");
+    ASSERT_EQ(expansion.dependencies.size(), 1u);
+    ASSERT_EQ(expansion.dependencies[0], "templates/shortcodes/callout.md");
+
+    ASSERT_TRUE(project.rejects("{{< missing >}}\n"));
+    std::cout << "Named and positional shortcode arguments reach the template";
+}
+
+TEST(ShortcodeExpanderSkipsCode) {
+    ShortcodeProject project("chisel_core_shortcode_code");
+    project.include("note.md", "NOTE");
+
+    std::string source = "```\n{{< include \"note.md\" >}}\n```\n"
+                         "Inline `{{< include \"note.md\" >}}` stays, {{< include \"note.md\" >}} expands\n"
+                         "~~~\n{{< missing >}}\n~~~\n";
+    auto expansion = project.expand(source);
+    ASSERT_EQ(*expansion.text, "```\n{{< include \"note.md\" >}}\n```\n"
+                               "Inline `{{< include \"note.md\" >}}` stays, NOTE expands\n"
+                               "~~~\n{{< missing >}}\n~~~\n");
+    std::cout << "Directives in fences and code spans left as written";
+}
+
+TEST(ShortcodeExpanderRejectsCyclesAndEscapes) {
+    ShortcodeProject project("chisel_core_shortcode_cycle");
+    project.include("a.md", "{{< include \"b.md\" >}}");
+    project.include("b.md", "{{< include \"a.md\" >}}");
+    project.include("self.md", "{{< include \"self.md\" >}}");
+    project.shortcode("loop", "{{< loop >}}");
+    write_text(project.root.path() / "secret.md", "outside");
+
+    ASSERT_TRUE(project.rejects("{{< include \"a.md\" >}}\n"));
+    ASSERT_TRUE(project.rejects("{{< include \"self.md\" >}}\n"));
+    ASSERT_TRUE(project.rejects("{{< loop >}}\n"));
+    ASSERT_TRUE(project.rejects("{{< include \"../secret.md\" >}}\n"));
+    ASSERT_TRUE(project.rejects("{{< include \"sub/../../secret.md\" >}}\n"));
+    ASSERT_TRUE(project.rejects("{{< include \"" + (project.root.path() / "secret.md").string() + "\" >}}\n"));
+    ASSERT_TRUE(project.rejects("{{< include \"missing.md\" >}}\n"));
+    std::cout << "Cycles, ../ and absolute include paths rejected";
+}
+
+TEST(ShortcodeExpanderClearRereadsFiles) {
+    ShortcodeProject project("chisel_core_shortcode_clear");
+    project.include("note.md", "first");
+    ASSERT_EQ(*project.expand("{{< include \"note.md\" >}}\n").text, "first\n");
+
+    project.include("note.md", "second");
+    ASSERT_EQ(*project.expand("{{< include \"note.md\" >}}\n").text, "first\n");
+    project.expander.clear();
+    ASSERT_EQ(*project.expand("{{< include \"note.md\" >}}\n").text, "second\n");
+    ASSERT_EQ(project.expander.stats().memoized, 0u);
+    std::cout << "clear() drops memoized snippets";
+}
+
+TEST(PageDependenciesRoundTrip) {
+    TempDir dir("chisel_core_page_dependencies");
+    ssg::PageDependencies dependencies;
+    dependencies.set("posts/a.md", {"includes/note.md", "templates/shortcodes/callout.md"});
+    dependencies.set("about.md", {"includes/note.md"});
+    dependencies.set("gone.md", {"includes/x.md"});
+    dependencies.set("gone.md", {});
+    dependencies.save(dir.path() / ssg::PageDependencies::FILE_NAME);
+
+    ssg::PageDependencies loaded;
+    ASSERT_TRUE(loaded.load(dir.path() / ssg::PageDependencies::FILE_NAME));
+    ASSERT_TRUE(loaded.of("posts/a.md") == dependencies.of("posts/a.md"));
+    ASSERT_EQ(loaded.of("about.md").size(), 1u);
+    ASSERT_TRUE(loaded.of("gone.md").empty());
+
+    write_text(dir.path() / "old.json", "{\"version\": 0, \"pages\": {}}");
+    ASSERT_TRUE(!loaded.load(dir.path() / "old.json"));
+    ASSERT_TRUE(loaded.of("posts/a.md").empty());
+    ASSERT_TRUE(!loaded.load(dir.path() / "missing.json"));
+    std::cout << "Page dependencies survive a save and load; other versions rejected";
+}
+
+TEST(MetadataIndexReusesUnchangedFiles) {
+    TempDir root("chisel_core_metadata_reuse");
+    auto content = root.path() / "content";
+    write_page(content / "a.md", {"title: A"});
+    write_page(content / "b.md", {"title: B"});
+    write_page(content / "posts/c.md", {"title: C"});
+
+    ssg::MetadataIndex index;
+    auto first = index.refresh(content);
+    ASSERT_EQ(first.scanned, 3u);
+    ASSERT_EQ(first.reused, 0u);
+    auto index_path = root.path() / "metadata.bin";
+    index.save(index_path);
+
+    ssg::MetadataIndex loaded;
+    ASSERT_TRUE(loaded.load(index_path));
+    auto unchanged = loaded.refresh(content);
+    ASSERT_EQ(unchanged.scanned, 0u);
+    ASSERT_EQ(unchanged.reused, 3u);
+    ASSERT_EQ(loaded.size(), 3u);
+
+    write_page(content / "a.md", {"title: A, longer"});
+    auto mtime = std::filesystem::last_write_time(content / "b.md");
+    write_page(content / "b.md", {"title: Z"});
+    std::filesystem::last_write_time(content / "b.md", mtime);
+    auto posts_mtime = std::filesystem::last_write_time(content / "posts/c.md");
+    std::filesystem::last_write_time(content / "posts/c.md", posts_mtime + std::chrono::seconds(5));
+
+    auto changed = loaded.refresh(content);
+    ASSERT_EQ(changed.scanned, 2u);
+    ASSERT_EQ(changed.reused, 1u);
+    ASSERT_EQ(metadata_of(loaded, "a.md").at("title"), "A, longer");
+    ASSERT_EQ(metadata_of(loaded, "b.md").at("title"), "B");
+    std::cout << "Rows reused while size and mtime match, reread when either changes";
+}
+
+TEST(MetadataIndexRejectsForeignIndex) {
+    TempDir root("chisel_core_metadata_foreign");
+    write_page(root.path() / "content/a.md", {"title: A"});
+    write_page(root.path() / "other/a.md", {"title: A"});
+    std::filesystem::last_write_time(root.path() / "other/a.md",
+                                     std::filesystem::last_write_time(root.path() / "content/a.md"));
+
+    ssg::MetadataIndex index;
+    index.refresh(root.path() / "content");
+    auto index_path = root.path() / "metadata.bin";
+    index.save(index_path);
+
+    ssg::MetadataIndex other;
+    ASSERT_TRUE(other.load(index_path));
+    auto stats = other.refresh(root.path() / "other");
+    ASSERT_EQ(stats.reused, 0u);
+    ASSERT_EQ(stats.scanned, 1u);
+
+    std::string bytes = read_text(index_path);
+    std::string old_version = bytes;
+    old_version[sizeof(ssg::MetadataIndex::MAGIC)] = static_cast<char>(ssg::MetadataIndex::VERSION - 1);
+    write_text(index_path, old_version);
+    ssg::MetadataIndex rejected;
+    ASSERT_TRUE(!rejected.load(index_path));
+    ASSERT_EQ(rejected.size(), 0u);
+
+    write_text(index_path, bytes.substr(0, bytes.size() - 1));
+    ASSERT_TRUE(!rejected.load(index_path));
+    ASSERT_EQ(rejected.size(), 0u);
+    ASSERT_TRUE(!rejected.load(root.path() / "missing.bin"));
+    ASSERT_TRUE(ssg::MetadataIndex::default_path(root.path(), root.path() / "content") !=
+                ssg::MetadataIndex::default_path(root.path(), root.path() / "other"));
+    std::cout << "Index from another content dir rescanned; other versions and truncated files rejected";
+}
+
+TEST(MetadataQueryOperators) {
+    TempDir root("chisel_core_metadata_query");
+    auto content = root.path() / "content";
+    write_page(content / "a.md", {"title: Alpha", "date: 2024-01-10", "tags: [rust, web]", "draft: true"});
+    write_page(content / "b.md", {"title: Beta", "date: 2024-03-01", "tags: [go]", "draft: false"});
+    write_page(content / "c.md", {"title: Gamma", "date: 2023-12-31"});
+
+    ssg::MetadataIndex index;
+    index.refresh(content);
+
+    using Sources = std::vector<std::string>;
+    ASSERT_TRUE(query_sources(index, {"title=Beta"}) == Sources({"b.md"}));
+    ASSERT_TRUE(query_sources(index, {"title!=Beta"}) == Sources({"a.md", "c.md"}));
+    ASSERT_TRUE(query_sources(index, {"title~amm"}) == Sources({"c.md"}));
+    ASSERT_TRUE(query_sources(index, {"date<2024-01-10"}) == Sources({"c.md"}));
+    ASSERT_TRUE(query_sources(index, {"date<=2024-01-10"}) == Sources({"a.md", "c.md"}));
+    ASSERT_TRUE(query_sources(index, {"date>2024-01-10"}) == Sources({"b.md"}));
+    ASSERT_TRUE(query_sources(index, {"date>=2024-01-10"}) == Sources({"a.md", "b.md"}));
+    ASSERT_TRUE(query_sources(index, {"draft"}) == Sources({"a.md"}));
+    ASSERT_TRUE(query_sources(index, {"!draft"}) == Sources({"b.md", "c.md"}));
+    ASSERT_TRUE(query_sources(index, {"date>=2024-01-01", "!draft"}) == Sources({"b.md"}));
+    ASSERT_TRUE(query_sources(index, {"path=c.md"}) == Sources({"c.md"}));
+    ASSERT_TRUE(query_sources(index, {}) == Sources({"a.md", "b.md", "c.md"}));
+    std::cout << "Every filter operator selects the expected pages";
+}
+
+TEST(MetadataQueryListMembership) {
+    TempDir root("chisel_core_metadata_lists");
+    auto content = root.path() / "content";
+    write_page(content / "a.md", {"tags: [rust, web]"});
+    write_page(content / "b.md", {"tags: [go]"});
+    write_page(content / "c.md", {"title: untagged"});
+
+    ssg::MetadataIndex index;
+    index.refresh(content);
+
+    using Sources = std::vector<std::string>;
+    ASSERT_TRUE(query_sources(index, {"tags=web"}) == Sources({"a.md"}));
+    ASSERT_TRUE(query_sources(index, {"tags=go"}) == Sources({"b.md"}));
+    ASSERT_TRUE(query_sources(index, {"tags!=rust"}) == Sources({"b.md", "c.md"}));
+    ASSERT_TRUE(query_sources(index, {"tags=we"}).empty());
+    ASSERT_EQ(metadata_of(index, "a.md").count("tags"), 1u);
+    ASSERT_EQ(metadata_of(index, "c.md").count("tags"), 0u);
+
+    auto rejects = [](const std::string &term) {
+        try {
+            ssg::MetadataQuery::parse({term});
+        } catch(const std::runtime_error &) {
+            return true;
+        }
+        return false;
+    };
+    ASSERT_TRUE(rejects("=web"));
+    ASSERT_TRUE(rejects("!"));
+    ASSERT_TRUE(!rejects("tags=web"));
+    std::cout << "= and != test list membership; malformed filters rejected";
+}
+
+TEST(ConfigDiffFlagsWhatChanged) {
+    struct Case {
+        const char *name;
+        std::function<void(ssg::Config &)> edit;
+        ssg::ConfigChanges expected;
+    };
+    auto changes = [](std::function<void(ssg::ConfigChanges &)> set) {
+        ssg::ConfigChanges expected;
+        set(expected);
+        return expected;
+    };
+
+    const std::vector<Case> cases = {
+        {"nothing", [](ssg::Config &) {}, {}},
+        {"site.name", [](ssg::Config &c) { c.site.name = "Other"; }, changes([](auto &e) { e.site = true; })},
+        {"site.language", [](ssg::Config &c) { c.site.language = "de"; },
+         changes([](auto &e) { e.site = e.language = true; })},
+        {"global_styles", [](ssg::Config &c) { c.build.global_styles.push_back("extra.css"); },
+         changes([](auto &e) { e.global_styles = true; })},
+        {"layout_styles edit", [](ssg::Config &c) { c.build.layout_styles["post"] = {"post.css", "code.css"}; },
+         changes([](auto &e) { e.layouts = {"post"}; })},
+        {"layout_styles added", [](ssg::Config &c) { c.build.layout_styles["gallery"] = {"gallery.css"}; },
+         changes([](auto &e) { e.layouts = {"gallery"}; })},
+        {"layout_styles removed", [](ssg::Config &c) { c.build.layout_styles.erase("post"); },
+         changes([](auto &e) { e.layouts = {"post"}; })},
+        {"layout_styles empty listed", [](ssg::Config &c) { c.build.layout_styles["page"] = {}; }, {}},
+        {"build.output_dir", [](ssg::Config &c) { c.build.output_dir = "public"; },
+         changes([](auto &e) { e.build = true; })},
+        {"build.minify_html", [](ssg::Config &c) { c.build.minify_html = true; },
+         changes([](auto &e) { e.build = true; })},
+        {"build.html_classes", [](ssg::Config &c) { c.build.html_classes["p"] = "prose"; },
+         changes([](auto &e) { e.build = true; })},
+        {"performance", [](ssg::Config &c) { c.performance.build_threads = 2; },
+         changes([](auto &e) { e.performance = true; })},
+        {"dev", [](ssg::Config &c) { c.dev.port = 4000; }, changes([](auto &e) { e.dev = true; })},
+        {"several", [](ssg::Config &c) {
+             c.site.author = "A";
+             c.dev.live_reload = true;
+             c.build.syntax_highlighting = false;
+         },
+         changes([](auto &e) { e.site = e.dev = e.build = true; })},
+    };
+
+    size_t passed = 0;
+    for(const auto &test_case : cases) {
+        ssg::Config previous;
+        ssg::Config next;
+        test_case.edit(next);
+        ssg::ConfigChanges actual = next.diff(previous);
+        const ssg::ConfigChanges &expected = test_case.expected;
+        bool same = actual.site == expected.site && actual.global_styles == expected.global_styles &&
+                    actual.language == expected.language && actual.layouts == expected.layouts &&
+                    actual.dev == expected.dev && actual.performance == expected.performance &&
+                    actual.build == expected.build;
+        if(!same) {
+            std::cerr << "Config::diff case '" << test_case.name << "' flagged the wrong sections\n";
+        }
+        passed += same ? 1 : 0;
+        ASSERT_EQ(actual.empty(), expected.empty());
+    }
+    ASSERT_EQ(passed, cases.size());
+    std::cout << passed << " config edits flag exactly their sections";
+}
+
+TEST(FileWatcherNoticesChanges) {
+    TempDir dir("chisel_core_file_watcher");
+    auto path = dir.path() / "chisel.config";
+
+    ssg::FileWatcher missing(path);
+    ASSERT_TRUE(!missing.poll());
+
+    write_text(path, "[site]\nname = \"a\"\n");
+    ASSERT_TRUE(missing.poll());
+    ssg::FileWatcher watcher(path);
+    ASSERT_TRUE(!watcher.poll());
+
+    write_text(path, "[site]\nname = \"longer\"\n");
+    ASSERT_TRUE(watcher.poll());
+    ASSERT_TRUE(!watcher.poll());
+
+    auto mtime = std::filesystem::last_write_time(path);
+    write_text(path, "[site]\nname = \"LONGER\"\n");
+    std::filesystem::last_write_time(path, mtime + std::chrono::seconds(2));
+    ASSERT_TRUE(watcher.poll());
+    ASSERT_TRUE(!watcher.poll());
+
+    std::filesystem::remove(path);
+    ASSERT_TRUE(watcher.poll());
+    ASSERT_TRUE(!watcher.poll());
+    write_text(path, "");
+    ASSERT_TRUE(watcher.poll());
+    std::cout << "Size, mtime, removal and recreation each reported once";
+}
+
+TEST(VariantsExpandOverBaseConfig) {
+    TempDir root("chisel_core_variants");
+    ssg::Config config;
+    config.load_from_string("[site]\n"
+                            "name = \"Docs\"\n"
+                            "language = \"en\"\n"
+                            "[build]\n"
+                            "output_dir = \"dist\"\n"
+                            "minify_html = true\n"
+                            "\n"
+                            "[[variants]]\n"
+                            "name = \"beta\"\n"
+                            "[variants.site]\n"
+                            "name = \"Docs Beta\"\n"
+                            "\n"
+                            "[[variants]]\n"
+                            "name = \"intl\"\n"
+                            "languages = [\"de\", \"fr\"]\n"
+                            "\n"
+                            "[[variants]]\n"
+                            "name = \"mirror\"\n"
+                            "languages = [\"de\"]\n"
+                            "[variants.build]\n"
+                            "output_dir = \"mirror\"\n",
+                            root.path());
+    ASSERT_EQ(config.variants.size(), 3u);
+
+    auto expanded = config.expand_variants(root.path());
+    ASSERT_EQ(expanded.size(), 4u);
+    std::map<std::string, ssg::Config> by_name(expanded.begin(), expanded.end());
+    ASSERT_EQ(by_name.count("beta") + by_name.count("intl/de") + by_name.count("intl/fr") + by_name.count("mirror/de"), 4u);
+
+    const ssg::Config &beta = by_name.at("beta");
+    ASSERT_EQ(beta.site.name, "Docs Beta");
+    ASSERT_EQ(beta.site.language, "en");
+    ASSERT_EQ(beta.build.output_dir, "dist/beta");
+    ASSERT_TRUE(beta.build.minify_html);
+    ASSERT_TRUE(beta.variants.empty());
+
+    ASSERT_EQ(by_name.at("intl/fr").site.name, "Docs");
+    ASSERT_EQ(by_name.at("intl/fr").site.language, "fr");
+    ASSERT_EQ(by_name.at("intl/de").build.output_dir, "dist/intl/de");
+    ASSERT_EQ(by_name.at("mirror/de").build.output_dir, "mirror/de");
+    ASSERT_TRUE(by_name.at("mirror/de").get_output_path() == root.path() / "mirror/de");
+
+    ASSERT_EQ(config.site.name, "Docs");
+    ASSERT_EQ(config.build.output_dir, "dist");
+    std::cout << expanded.size() << " variants expanded, each over the base config";
+}
+
+TEST(VariantsRejectInvalidEntries) {
+    TempDir root("chisel_core_variants_invalid");
+    auto rejects = [&](const std::string &toml) {
+        try {
+            ssg::Config config;
+            config.load_from_string(toml, root.path());
+            config.expand_variants(root.path());
+        } catch(const std::exception &) {
+            return true;
+        }
+        return false;
+    };
+
+    ASSERT_TRUE(!rejects("[[variants]]\nname = \"ok\"\n"));
+    ASSERT_TRUE(rejects("[[variants]]\nlanguages = [\"de\"]\n"));
+    ASSERT_TRUE(rejects("[[variants]]\nname = \"\"\n"));
+    ASSERT_TRUE(rejects("[[variants]]\nname = \"a b\"\n"));
+    ASSERT_TRUE(rejects("[[variants]]\nname = \"a\"\n[[variants]]\nname = \"a\"\n"));
+    ASSERT_TRUE(rejects("[[variants]]\nname = \"a\"\nlanguages = [\"english\"]\n"));
+    ASSERT_TRUE(rejects("variants = 3\n"));
+    std::cout << "Unnamed, badly named, duplicate and invalid variants rejected";
+}
+
+TEST(CatalogLookupAndFallback) {
+    TempDir dir("chisel_core_catalog");
+    write_text(dir.path() / "en.toml", "greeting = \"Hello\"\n"
+                                       "farewell = \"Bye\"\n"
+                                       "[nav]\n"
+                                       "home = \"Home\"\n"
+                                       "about = \"About\"\n");
+    write_text(dir.path() / "de.toml", "greeting = \"Hallo\"\n"
+                                       "[nav]\n"
+                                       "home = \"Start\"\n");
+
+    auto german = ssg::i18n::Catalog::load(dir.path(), "de", "en");
+    ASSERT_EQ(german.language(), "de");
+    ASSERT_EQ(german.size(), 4u);
+    ASSERT_EQ(german.translate("greeting"), "Hallo");
+    ASSERT_EQ(german.translate("nav.home"), "Start");
+    ASSERT_EQ(german.translate("farewell"), "Bye");
+    ASSERT_EQ(german.translate("nav.about"), "About");
+    ASSERT_EQ(german.translate("nav.missing"), "nav.missing");
+    ASSERT_TRUE(!german.find("nav").has_value());
+
+    auto french = ssg::i18n::Catalog::load(dir.path(), "fr", "en");
+    ASSERT_EQ(french.translate("greeting"), "Hello");
+    auto none = ssg::i18n::Catalog::load(dir.path() / "missing", "de", "en");
+    ASSERT_EQ(none.size(), 0u);
+    ASSERT_EQ(none.translate("greeting"), "greeting");
+
+    std::map<std::string, std::string> many;
+    for(int i = 0; i < 1000; ++i) {
+        many["key." + std::to_string(i)] = "value " + std::to_string(i);
+    }
+    auto large = ssg::i18n::Catalog::compile("en", {many, {{"key.7", "seven"}}});
+    size_t found = 0;
+    for(int i = 0; i < 1000; ++i) {
+        auto value = large.find("key." + std::to_string(i));
+        if(value && (i == 7 ? *value == "seven" : *value == "value " + std::to_string(i))) {
+            ++found;
+        }
+    }
+    ASSERT_EQ(found, 1000u);
+    ASSERT_TRUE(!large.find("key.1000").has_value());
+    std::cout << "Translations found, fallback and later layers applied, " << found << " keys in a large catalog";
+}
+
+TEST(BuildCacheSharesAcrossVariants) {
+    TempDir dir("chisel_core_build_cache");
+    auto path = dir.path() / "page.md";
+    write_text(path, "first");
+    write_text(dir.path() / "i18n/en.toml", "greeting = \"Hello\"\n");
+    write_text(dir.path() / "i18n/de.toml", "greeting = \"Hallo\"\n");
+
+    ssg::BuildCache cache;
+    auto first = cache.read_file(path);
+    auto again = cache.read_file(dir.path() / "." / "page.md");
+    ASSERT_TRUE(first == again);
+    ASSERT_EQ(cache.file_hits(), 1u);
+
+    write_text(path, "edited between variants");
+    ASSERT_EQ(*cache.read_file(path), "edited between variants");
+    ASSERT_EQ(*first, "first");
+
+    ASSERT_TRUE(cache.find_page(42) == nullptr);
+    auto page = std::make_shared<ssg::BuildCache::Page>();
+    page->rendered_html = "<p>shared</p>";
+    cache.store_page(42, page);
+    ASSERT_TRUE(cache.find_page(42) == page);
+    ASSERT_EQ(cache.page_hits(), 1u);
+
+    auto german = cache.catalog(dir.path() / "i18n", "de", "en");
+    ASSERT_TRUE(cache.catalog(dir.path() / "i18n", "de", "en") == german);
+    ASSERT_TRUE(cache.catalog(dir.path() / "i18n", "en", "en") != german);
+    ASSERT_EQ(german->translate("greeting"), "Hallo");
+    std::cout << "Files, pages and catalogs shared; edited files reread";
+}
+
+#ifdef ENABLE_TESTS
+int main() {
+    return Test::RunAllTests();
+    return 0;
+}
+#else
+int main() { return 0; }
+#endif
@@ -6,6 +6,10 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -13,6 +17,9 @@
 #include <unordered_map>
 #include <vector>
 
+#include "redirects.hpp"
+#include "tenants.hpp"
+
 #ifdef _WIN32
 #include <winsock2.h>
 #include <ws2tcpip.h>
@@ -49,6 +56,11 @@
 namespace http {
     enum class HttpStatus {
         OK = 200,
+        MOVED_PERMANENTLY = 301,
+        FOUND = 302,
+        SEE_OTHER = 303,
+        TEMPORARY_REDIRECT = 307,
+        PERMANENT_REDIRECT = 308,
         NOT_MODIFIED = 304,
         BAD_REQUEST = 400,
         NOT_FOUND = 404,
@@ -56,15 +68,6 @@ namespace http {
         INTERNAL_SERVER_ERROR = 500
     };
 
-    struct CacheEntry {
-        std::string content;
-        std::string content_type;
-        std::string etag;
-        std::filesystem::file_time_type last_modified;
-        std::chrono::system_clock::time_point cached_at;
-        size_t file_size;
-    };
-
     struct HttpRequest {
         std::string method;
         std::string path;
@@ -78,16 +81,24 @@ namespace http {
         }
     };
 
+    // Serves one site root, or many (preview builds of different branches, say) picked per request by Host header
+    // or path prefix. Either way file bodies go through one ContentCache keyed by content hash and size.
     class HttpServerAsync {
     public:
-        HttpServerAsync(int port, const std::string &root_dir)
+        static constexpr size_t DEFAULT_CACHE_BYTES = 50 * 1024 * 1024;
+
+        HttpServerAsync(int port, const std::string &root_dir, size_t cache_bytes = DEFAULT_CACHE_BYTES)
             : port_(port),
-              root_dir_(root_dir),
               server_fd_(INVALID_SOCKET_TYPE),
               running_(false),
-              current_cache_size_(0),
-              cache_max_size_(50 * 1024 * 1024),
-              cache_ttl_(std::chrono::minutes(30)) {
+              cache_(std::make_shared<ContentCache>(cache_bytes)),
+              default_tenant_(std::make_shared<Tenant>("", root_dir)) {
+            init_mime_types();
+        }
+
+        // No default site: every request has to name a tenant. The cache may be shared with other servers.
+        HttpServerAsync(int port, std::shared_ptr<ContentCache> cache)
+            : port_(port), server_fd_(INVALID_SOCKET_TYPE), running_(false), cache_(std::move(cache)) {
             init_mime_types();
         }
 
@@ -130,9 +141,14 @@ namespace http {
             server_thread_ = std::thread(&HttpServerAsync::run_event_loop, this);
 
             std::cout << "🌐 Development server running at http://localhost:" << port_ << std::endl;
-            std::cout << "📁 Serving files from: " << root_dir_ << std::endl;
+            if(default_tenant_) {
+                std::cout << "📁 Serving files from: " << default_tenant_->root().string() << std::endl;
+            } else {
+                std::cout << "📁 Serving " << tenant_names().size() << " sites by Host header or /<name>/ prefix"
+                          << std::endl;
+            }
             std::cout << "🚀 Features: MIME detection, ETag caching, Path resolution, Error handling" << std::endl;
-            std::cout << "💾 Cache: " << (cache_max_size_ / (1024 * 1024)) << "MB max, " << (cache_ttl_.count()) << "min TTL"
+            std::cout << "💾 Cache: " << (cache_->max_bytes() / (1024 * 1024)) << "MB max, shared by content hash"
                       << std::endl;
             std::cout << "Press Ctrl+C to stop..." << std::endl;
         }
@@ -153,17 +169,64 @@ namespace http {
 
         bool is_running() const { return running_; }
 
+        // Safe while the server runs. Re-adding a name points it at the new root with an empty file index; bodies
+        // already cached stay shared. Names are single path segments, since they double as "/<name>/" prefixes.
+        void add_tenant(const std::string &name, const std::filesystem::path &root, std::vector<std::string> hosts = {}) {
+            if(name.empty() || name.find_first_of("/?#%") != std::string::npos || name == "." || name == "..") {
+                throw std::invalid_argument("Invalid site name: '" + name + "'");
+            }
+            auto tenant = std::make_shared<Tenant>(name, root, std::move(hosts));
+            std::lock_guard<std::mutex> lock(tenants_mutex_);
+            tenants_[name] = std::move(tenant);
+            std::cout << "➕ Serving " << name << " from " << root.string() << std::endl;
+        }
+
+        // Requests already routed to the tenant finish normally.
+        bool remove_tenant(const std::string &name) {
+            std::lock_guard<std::mutex> lock(tenants_mutex_);
+            if(tenants_.erase(name) == 0) {
+                return false;
+            }
+            std::cout << "➖ Stopped serving " << name << std::endl;
+            return true;
+        }
+
+        std::vector<std::string> tenant_names() const {
+            std::lock_guard<std::mutex> lock(tenants_mutex_);
+            std::vector<std::string> names;
+            for(const auto &[name, tenant] : tenants_) {
+                names.push_back(name);
+            }
+            return names;
+        }
+
+        // Serves every subdirectory of `dir` as a tenant named after it. The directory is rescanned once a second,
+        // so a new branch build dropped there is served, and a deleted one dropped, without a restart.
+        void watch_tenants(const std::filesystem::path &dir) {
+            {
+                std::lock_guard<std::mutex> lock(tenants_mutex_);
+                tenant_dir_ = dir;
+            }
+            sync_tenant_dir();
+        }
+
+        const ContentCache &cache() const { return *cache_; }
+
     private:
         int port_;
-        std::string root_dir_;
         SOCKET_TYPE server_fd_;
         bool running_;
         std::thread server_thread_;
 
-        std::unordered_map<std::string, CacheEntry> file_cache_;
-        size_t current_cache_size_;
-        size_t cache_max_size_;
-        std::chrono::minutes cache_ttl_;
+        std::shared_ptr<ContentCache> cache_;
+        std::shared_ptr<Tenant> default_tenant_;
+
+        mutable std::mutex tenants_mutex_;
+        std::map<std::string, std::shared_ptr<Tenant>> tenants_;
+        std::filesystem::path tenant_dir_;
+        std::mutex tenant_dir_mutex_;
+        std::set<std::string> watched_tenants_;
+        std::chrono::steady_clock::time_point tenant_dir_checked_at_{};
 
         std::unordered_map<std::string, std::string> mime_types_;
 
@@ -178,6 +241,7 @@ namespace http {
             fds.push_back({server_fd_, POLLIN, 0});
 
             while(running_) {
+                sync_tenant_dir_if_due();
                 int ret = poll(fds.data(), static_cast<nfds_t>(fds.size()), 1000);
                 if(ret == SOCKET_ERROR_CODE) {
                     if(running_) {
@@ -288,7 +352,7 @@ namespace http {
             return request;
         }
 
-        std::string resolve_path(const std::string &path) {
+        std::string resolve_path(const std::string &path, const std::string &root_dir) {
             std::string resolved_path = path;
 
             if(resolved_path == "/") {
@@ -314,13 +378,13 @@ namespace http {
 
             if(resolved_path.find('.') == std::string::npos && resolved_path.back() != '/') {
                 std::string index_path = resolved_path + "/index.html";
-                std::string full_index_path = root_dir_ + index_path;
+                std::string full_index_path = root_dir + index_path;
                 if(std::filesystem::exists(full_index_path)) {
                     return index_path;
                 }
 
                 std::string html_path = resolved_path + ".html";
-                std::string full_html_path = root_dir_ + html_path;
+                std::string full_html_path = root_dir + html_path;
                 if(std::filesystem::exists(full_html_path)) {
                     return html_path;
                 }
@@ -329,6 +393,84 @@ namespace http {
             return resolved_path;
         }
 
+        void sync_tenant_dir_if_due() {
+            auto now = std::chrono::steady_clock::now();
+            if(now - tenant_dir_checked_at_ < std::chrono::seconds(1)) {
+                return;
+            }
+            tenant_dir_checked_at_ = now;
+            sync_tenant_dir();
+        }
+
+        // Only tenants this added are removed again; ones added through add_tenant are left alone.
+        void sync_tenant_dir() {
+            std::lock_guard<std::mutex> sync_lock(tenant_dir_mutex_);
+            std::filesystem::path dir;
+            {
+                std::lock_guard<std::mutex> lock(tenants_mutex_);
+                dir = tenant_dir_;
+            }
+            if(dir.empty()) {
+                return;
+            }
+
+            std::set<std::string> present;
+            std::error_code ec;
+            for(const auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+                std::string name = entry.path().filename().string();
+                if(entry.is_directory(ec) && name[0] != '.') {
+                    present.insert(name);
+                }
+            }
+
+            for(const auto &name : present) {
+                if(watched_tenants_.count(name) == 0) {
+                    try {
+                        add_tenant(name, dir / name);
+                        watched_tenants_.insert(name);
+                    } catch(const std::exception &e) {
+                        std::cerr << "⚠️  Skipping " << name << ": " << e.what() << std::endl;
+                    }
+                }
+            }
+            for(auto it = watched_tenants_.begin(); it != watched_tenants_.end();) {
+                if(present.count(*it) == 0) {
+                    remove_tenant(*it);
+                    it = watched_tenants_.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        // Host header first (port dropped, case folded), then a "/<name>" prefix, then the default site. `path` is
+        // left as the request path within the tenant.
+        std::shared_ptr<Tenant> route(const HttpRequest &request, std::string &path) {
+            path = request.path;
+            std::lock_guard<std::mutex> lock(tenants_mutex_);
+
+            auto host_it = request.headers.find("host");
+            if(host_it != request.headers.end() && !tenants_.empty()) {
+                std::string host = host_it->second.substr(0, host_it->second.find(':'));
+                std::transform(host.begin(), host.end(), host.begin(), ::tolower);
+                for(const auto &[name, tenant] : tenants_) {
+                    if(tenant->serves_host(host)) {
+                        return tenant;
+                    }
+                }
+            }
+
+            if(path.size() > 1 && path[0] == '/') {
+                size_t end = path.find_first_of("/?", 1);
+                auto it = tenants_.find(path.substr(1, end == std::string::npos ? std::string::npos : end - 1));
+                if(it != tenants_.end()) {
+                    path = end == std::string::npos ? "" : path.substr(end);
+                    return it->second;
+                }
+            }
+            return default_tenant_;
+        }
+
         void init_mime_types() {
             mime_types_[".html"] = "text/html; charset=utf-8";
             mime_types_[".htm"] = "text/html; charset=utf-8";
@@ -390,6 +532,16 @@ namespace http {
             switch(status) {
             case HttpStatus::OK:
                 return "OK";
+            case HttpStatus::MOVED_PERMANENTLY:
+                return "Moved Permanently";
+            case HttpStatus::FOUND:
+                return "Found";
+            case HttpStatus::SEE_OTHER:
+                return "See Other";
+            case HttpStatus::TEMPORARY_REDIRECT:
+                return "Temporary Redirect";
+            case HttpStatus::PERMANENT_REDIRECT:
+                return "Permanent Redirect";
             case HttpStatus::NOT_MODIFIED:
                 return "Not Modified";
             case HttpStatus::BAD_REQUEST:
@@ -405,52 +557,20 @@ namespace http {
             }
         }
 
-        std::string generate_etag(const std::filesystem::path &file_path, std::uintmax_t file_size) {
-            auto last_write = std::filesystem::last_write_time(file_path);
-            auto duration = last_write.time_since_epoch();
-            auto hash = std::hash<std::string>{}(file_path.string()) ^ std::hash<std::uintmax_t>{}(file_size) ^
-                        std::hash<long long>{}(duration.count());
-
+        // Bodies rewritten for a path prefix differ from the file, so they are tagged apart from it.
+        static std::string etag_for(const ContentCache::Key &key, const std::string &prefix = "") {
             std::stringstream ss;
-            ss << "\"" << std::hex << hash << "\"";
+            ss << "\"" << std::hex << key.hash << "-" << key.size << prefix << "\"";
             return ss.str();
         }
 
-        bool is_cache_valid(const CacheEntry &entry) {
-            auto now = std::chrono::system_clock::now();
-            return (now - entry.cached_at) < cache_ttl_;
-        }
-
-        void cleanup_cache() {
-            auto now = std::chrono::system_clock::now();
-            for(auto it = file_cache_.begin(); it != file_cache_.end();) {
-                if(!is_cache_valid(it->second)) {
-                    current_cache_size_ -= it->second.content.size();
-                    it = file_cache_.erase(it);
-                } else {
-                    ++it;
-                }
-            }
-        }
-
-        void evict_cache_if_needed(size_t new_content_size) {
-            while(current_cache_size_ + new_content_size > cache_max_size_ && !file_cache_.empty()) {
-                auto oldest = file_cache_.begin();
-                for(auto it = file_cache_.begin(); it != file_cache_.end(); ++it) {
-                    if(it->second.cached_at < oldest->second.cached_at) {
-                        oldest = it;
-                    }
-                }
-
-                current_cache_size_ -= oldest->second.content.size();
-                file_cache_.erase(oldest);
-            }
-        }
-
         std::string build_response(HttpStatus status, const std::string &content_type, const std::string &body,
-                                   const std::string &etag = "") {
+                                   const std::string &etag = "", const std::string &location = "") {
             std::stringstream response;
             response << "HTTP/1.1 " << static_cast<int>(status) << " " << get_status_text(status) << "\r\n";
+            if(!location.empty()) {
+                response << "Location: " << location << "\r\n";
+            }
             response << "Content-Type: " << content_type << "\r\n";
             response << "Content-Length: " << body.size() << "\r\n";
             response << "Server: ChiselHTTP/1.0\r\n";
@@ -469,6 +589,36 @@ namespace http {
             return response.str();
         }
 
+        // The body links to the target for clients that ignore Location. The target carries the request's query
+        // string, so it is escaped before it goes into the markup.
+        std::string redirect_response(HttpStatus status, const std::string &location) {
+            std::string href;
+            for(char c : location) {
+                switch(c) {
+                case '&':
+                    href += "&amp;";
+                    break;
+                case '<':
+                    href += "&lt;";
+                    break;
+                case '>':
+                    href += "&gt;";
+                    break;
+                case '"':
+                    href += "&quot;";
+                    break;
+                case '\'':
+                    href += "&#39;";
+                    break;
+                default:
+                    href += c;
+                    break;
+                }
+            }
+            return build_response(status, "text/html; charset=utf-8",
+                                  "<a href=\"" + href + "\">" + get_status_text(status) + "</a>", "", location);
+        }
+
         std::string generate_error_response(HttpStatus status, const std::string &message = "") {
             std::string body;
             std::string title = get_status_text(status);
@@ -512,77 +662,107 @@ namespace http {
                 return generate_error_response(HttpStatus::METHOD_NOT_ALLOWED);
             }
 
-            std::string resolved_path = resolve_path(request.path);
-            std::string file_path = root_dir_ + resolved_path;
+            std::string path;
+            std::shared_ptr<Tenant> tenant = route(request, path);
+            if(!tenant) {
+                std::cout << "❌ " << request.path << " - 404 Not Found (no site)" << std::endl;
+                return generate_error_response(HttpStatus::NOT_FOUND, "No site is served under this host or path.");
+            }
+            std::string label = tenant->name().empty() ? "" : "[" + tenant->name() + "] ";
+
+            // "/<name>" alone: relative links only resolve under the directory form.
+            if(!tenant->name().empty() && (path.empty() || path[0] == '?')) {
+                std::string location = "/" + tenant->name() + "/" + path;
+                std::cout << "↪️  " << request.path << " - 301 " << location << std::endl;
+                return redirect_response(HttpStatus::MOVED_PERMANENTLY, location);
+            }
+
+            if(auto redirect = tenant->redirects().find(path)) {
+                std::string location(redirect->first);
+                size_t query = path.find('?');
+                if(query != std::string::npos && location.find('?') == std::string::npos) {
+                    location += path.substr(query);
+                }
+                if(request.path != path && !location.empty() && location[0] == '/') {
+                    location = "/" + tenant->name() + location;
+                }
+                auto status = static_cast<HttpStatus>(redirect->second);
+                std::cout << "↪️  " << label << path << " - " << redirect->second << " " << location << std::endl;
+                return redirect_response(status, location);
+            }
+
+            std::string root_dir = tenant->root().string();
+            std::string resolved_path = resolve_path(path.substr(0, path.find('?')), root_dir);
+            std::string file_path = root_dir + resolved_path;
 
             if(!std::filesystem::exists(file_path) || std::filesystem::is_directory(file_path)) {
-                std::cout << "❌ " << resolved_path << " - 404 Not Found" << std::endl;
+                std::cout << "❌ " << label << resolved_path << " - 404 Not Found" << std::endl;
                 return generate_error_response(HttpStatus::NOT_FOUND);
             }
 
             try {
                 std::error_code ec;
                 auto file_size = std::filesystem::file_size(file_path, ec);
+                auto last_write = std::filesystem::last_write_time(file_path, ec);
                 if(ec) {
-                    std::cout << "❌ " << resolved_path << " - 500 Internal Server Error (file size)" << std::endl;
+                    std::cout << "❌ " << label << resolved_path << " - 500 Internal Server Error (file size)" << std::endl;
                     return generate_error_response(HttpStatus::INTERNAL_SERVER_ERROR);
                 }
-
-                std::string etag = generate_etag(file_path, file_size);
-
-                std::string client_etag = request.get_if_none_match();
-                if(!client_etag.empty() && client_etag == etag) {
-                    std::cout << "📄 " << resolved_path << " - 304 Not Modified" << std::endl;
-                    return build_response(HttpStatus::NOT_MODIFIED, "", "");
-                }
-
-                cleanup_cache();
-
-                auto cache_it = file_cache_.find(resolved_path);
-                if(cache_it != file_cache_.end() && is_cache_valid(cache_it->second)) {
-                    const auto &entry = cache_it->second;
-
-                    auto last_write = std::filesystem::last_write_time(file_path);
-                    if(last_write <= entry.last_modified) {
-                        std::cout << "📄 " << resolved_path << " - 200 OK (cached)" << std::endl;
-                        return build_response(HttpStatus::OK, entry.content_type, entry.content, entry.etag);
-                    } else {
-                        current_cache_size_ -= entry.content.size();
-                        file_cache_.erase(cache_it);
+                std::string content_type = get_content_type(resolved_path);
+                std::string prefix = request.path != path && prefixing::applies_to(content_type)
+                                         ? "/" + tenant->name()
+                                         : "";
+                auto serve = [&](const std::string &body) {
+                    return prefix.empty() ? body : prefixing::apply(body, content_type, prefix);
+                };
+
+                // A file seen before with the same size and mtime keeps its cache key, which is also its ETag. The
+                // cached body is used only while it is the one the file's bytes were compared against.
+                if(std::optional<Tenant::Known> known = tenant->known(resolved_path, file_size, last_write)) {
+                    std::string etag = etag_for(known->key, prefix);
+                    std::string client_etag = request.get_if_none_match();
+                    if(!client_etag.empty() && client_etag == etag) {
+                        std::cout << "📄 " << label << resolved_path << " - 304 Not Modified" << std::endl;
+                        return build_response(HttpStatus::NOT_MODIFIED, "", "");
+                    }
+                    ContentCache::Body body = cache_->find(known->key);
+                    if(body && body == known->body.lock()) {
+                        std::cout << "📄 " << label << resolved_path << " - 200 OK (cached)" << std::endl;
+                        return build_response(HttpStatus::OK, content_type, serve(*body), etag);
                     }
                 }
 
                 std::ifstream file(file_path, std::ios::binary);
                 if(!file.good()) {
-                    std::cout << "❌ " << resolved_path << " - 500 Internal Server Error (file read)" << std::endl;
+                    std::cout << "❌ " << label << resolved_path << " - 500 Internal Server Error (file read)" << std::endl;
                     return generate_error_response(HttpStatus::INTERNAL_SERVER_ERROR);
                 }
 
                 std::stringstream content_stream;
                 content_stream << file.rdbuf();
-                std::string content = content_stream.str();
-                std::string content_type = get_content_type(resolved_path);
+                auto body = std::make_shared<const std::string>(content_stream.str());
+                ContentCache::Key key = ContentCache::key_for(*body);
+                ContentCache::Body cached = cache_->insert(key, body);
+                if(!cached) {
+                    // Another file hashes to the same key; serve this one uncached and without an ETag.
+                    tenant->forget(resolved_path);
+                    std::cout << "📄 " << label << resolved_path << " - 200 OK (uncached, hash collision)" << std::endl;
+                    return build_response(HttpStatus::OK, content_type, serve(*body));
+                }
+                tenant->record(resolved_path, file_size, last_write, key, cached);
 
-                CacheEntry cache_entry;
-                cache_entry.content = content;
-                cache_entry.content_type = content_type;
-                cache_entry.etag = etag;
-                cache_entry.last_modified = std::filesystem::last_write_time(file_path);
-                cache_entry.cached_at = std::chrono::system_clock::now();
-                cache_entry.file_size = file_size;
-
-                size_t entry_size = content.size();
-                if(entry_size <= cache_max_size_) {
-                    evict_cache_if_needed(entry_size);
-                    current_cache_size_ += entry_size;
-                    file_cache_[resolved_path] = cache_entry;
+                std::string etag = etag_for(key, prefix);
+                std::string client_etag = request.get_if_none_match();
+                if(!client_etag.empty() && client_etag == etag) {
+                    std::cout << "📄 " << label << resolved_path << " - 304 Not Modified" << std::endl;
+                    return build_response(HttpStatus::NOT_MODIFIED, "", "");
                 }
 
-                std::cout << "📄 " << resolved_path << " - 200 OK" << std::endl;
-                return build_response(HttpStatus::OK, content_type, content, etag);
+                std::cout << "📄 " << label << resolved_path << " - 200 OK" << std::endl;
+                return build_response(HttpStatus::OK, content_type, serve(*body), etag);
 
             } catch(const std::exception &e) {
-                std::cout << "❌ " << resolved_path << " - 500 Internal Server Error: " << e.what() << std::endl;
+                std::cout << "❌ " << label << resolved_path << " - 500 Internal Server Error: " << e.what() << std::endl;
                 return generate_error_response(HttpStatus::INTERNAL_SERVER_ERROR);
             }
         }
@@ -0,0 +1,302 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace http {
+    struct Redirect {
+        std::string from;
+        std::string to;
+        int status = 301;
+    };
+
+    // Static redirect map behind a minimal perfect hash (hash and displace): a key's first hash picks a bucket,
+    // the bucket's seed picks its slot, so a lookup is two hashes and one key comparison whatever the table size.
+    // The same layout is the on-disk format, written by the generator next to the `_redirects` text file.
+    class RedirectTable {
+    public:
+        static constexpr const char *FILE_NAME = "_redirects.bin";
+        static constexpr const char *TEXT_FILE_NAME = "_redirects";
+        static constexpr char MAGIC[4] = {'C', 'H', 'R', 'D'};
+        static constexpr uint32_t VERSION = 1;
+
+        RedirectTable() = default;
+
+        // Later duplicates of a `from` path are dropped.
+        static RedirectTable build(std::vector<Redirect> redirects) {
+            RedirectTable table;
+            for(auto &redirect : redirects) {
+                redirect.from = normalize(redirect.from);
+            }
+            std::stable_sort(redirects.begin(), redirects.end(),
+                             [](const Redirect &a, const Redirect &b) { return a.from < b.from; });
+            redirects.erase(std::unique(redirects.begin(), redirects.end(),
+                                        [](const Redirect &a, const Redirect &b) { return a.from == b.from; }),
+                            redirects.end());
+
+            for(const auto &redirect : redirects) {
+                table.entries_.push_back({table.append_string(redirect.from), static_cast<uint32_t>(redirect.from.size()),
+                                          table.append_string(redirect.to), static_cast<uint32_t>(redirect.to.size()),
+                                          static_cast<uint32_t>(redirect.status)});
+            }
+            table.build_hash();
+            return table;
+        }
+
+        // Netlify-style lines: `from to [status]`; blank lines and # comments are skipped.
+        static RedirectTable parse_text(std::string_view text) {
+            std::vector<Redirect> redirects;
+            std::istringstream stream{std::string(text)};
+            std::string line;
+            while(std::getline(stream, line)) {
+                std::istringstream fields(line);
+                Redirect redirect;
+                if(!(fields >> redirect.from) || redirect.from[0] == '#' || !(fields >> redirect.to)) {
+                    continue;
+                }
+                std::string status;
+                if(fields >> status) {
+                    redirect.status = std::atoi(status.c_str());
+                    if(redirect.status < 300 || redirect.status > 399) {
+                        continue;
+                    }
+                }
+                redirects.push_back(std::move(redirect));
+            }
+            return build(std::move(redirects));
+        }
+
+        static std::string to_text(const std::vector<Redirect> &redirects) {
+            std::string out;
+            for(const auto &redirect : redirects) {
+                out += redirect.from + "  " + redirect.to + "  " + std::to_string(redirect.status) + "\n";
+            }
+            return out;
+        }
+
+        std::string serialize() const {
+            std::string out(MAGIC, sizeof(MAGIC));
+            put(out, VERSION);
+            put(out, static_cast<uint32_t>(entries_.size()));
+            put(out, static_cast<uint32_t>(seeds_.size()));
+            put(out, static_cast<uint32_t>(slots_.size()));
+            put(out, static_cast<uint32_t>(strings_.size()));
+            for(uint32_t seed : seeds_) {
+                put(out, seed);
+            }
+            for(uint32_t slot : slots_) {
+                put(out, slot);
+            }
+            for(const auto &entry : entries_) {
+                put(out, entry.from_offset);
+                put(out, entry.from_size);
+                put(out, entry.to_offset);
+                put(out, entry.to_size);
+                put(out, entry.status);
+            }
+            out += strings_;
+            return out;
+        }
+
+        static RedirectTable deserialize(std::string_view data) {
+            size_t pos = 0;
+            if(data.size() < sizeof(MAGIC) || data.substr(0, sizeof(MAGIC)) != std::string_view(MAGIC, sizeof(MAGIC))) {
+                throw std::runtime_error("Not a redirect table");
+            }
+            pos += sizeof(MAGIC);
+            if(get(data, pos) != VERSION) {
+                throw std::runtime_error("Unsupported redirect table version");
+            }
+
+            RedirectTable table;
+            uint32_t entry_count = get(data, pos);
+            uint32_t seed_count = get(data, pos);
+            uint32_t slot_count = get(data, pos);
+            uint32_t string_size = get(data, pos);
+            if((static_cast<uint64_t>(seed_count) + slot_count + entry_count * 5ull) * 4 > data.size()) {
+                throw std::runtime_error("Truncated redirect table");
+            }
+
+            table.seeds_.resize(seed_count);
+            for(auto &seed : table.seeds_) {
+                seed = get(data, pos);
+            }
+            table.slots_.resize(slot_count);
+            for(auto &slot : table.slots_) {
+                slot = get(data, pos);
+                if(slot != EMPTY && slot >= entry_count) {
+                    throw std::runtime_error("Corrupt redirect table slot");
+                }
+            }
+            table.entries_.resize(entry_count);
+            for(auto &entry : table.entries_) {
+                entry = {get(data, pos), get(data, pos), get(data, pos), get(data, pos), get(data, pos)};
+            }
+            if(data.size() - pos != string_size) {
+                throw std::runtime_error("Truncated redirect table strings");
+            }
+            table.strings_ = std::string(data.substr(pos));
+            for(const auto &entry : table.entries_) {
+                if(static_cast<uint64_t>(entry.from_offset) + entry.from_size > string_size ||
+                   static_cast<uint64_t>(entry.to_offset) + entry.to_size > string_size) {
+                    throw std::runtime_error("Corrupt redirect table entry");
+                }
+            }
+            if(entry_count > 0 && (seed_count == 0 || slot_count == 0)) {
+                throw std::runtime_error("Corrupt redirect table");
+            }
+            return table;
+        }
+
+        // `path` may carry a query string, which is ignored for matching.
+        std::optional<std::pair<std::string_view, int>> find(std::string_view path) const {
+            if(entries_.empty()) {
+                return std::nullopt;
+            }
+            std::string key = normalize(path.substr(0, path.find('?')));
+            uint32_t seed = seeds_[hash(key, 0) % seeds_.size()];
+            uint32_t slot = slots_[hash(key, seed) % slots_.size()];
+            if(slot == EMPTY) {
+                return std::nullopt;
+            }
+            const Entry &entry = entries_[slot];
+            if(std::string_view(strings_).substr(entry.from_offset, entry.from_size) != key) {
+                return std::nullopt;
+            }
+            return std::make_pair(std::string_view(strings_).substr(entry.to_offset, entry.to_size),
+                                  static_cast<int>(entry.status));
+        }
+
+        size_t size() const { return entries_.size(); }
+        bool empty() const { return entries_.empty(); }
+
+        // Leading slash added, trailing slash dropped, so "/old/" and "old" name the same alias.
+        static std::string normalize(std::string_view path) {
+            std::string out;
+            if(path.empty() || path[0] != '/') {
+                out += '/';
+            }
+            out += path;
+            while(out.size() > 1 && out.back() == '/') {
+                out.pop_back();
+            }
+            return out;
+        }
+
+    private:
+        static constexpr uint32_t EMPTY = 0xffffffffu;
+
+        struct Entry {
+            uint32_t from_offset;
+            uint32_t from_size;
+            uint32_t to_offset;
+            uint32_t to_size;
+            uint32_t status;
+        };
+
+        std::vector<uint32_t> seeds_;
+        std::vector<uint32_t> slots_;
+        std::vector<Entry> entries_;
+        std::string strings_;
+
+        static uint64_t hash(std::string_view key, uint32_t seed) {
+            uint64_t h = 14695981039346656037ull ^ (static_cast<uint64_t>(seed) * 0x9e3779b97f4a7c15ull);
+            for(unsigned char c : key) {
+                h ^= c;
+                h *= 1099511628211ull;
+            }
+            h ^= h >> 29;
+            h *= 0xbf58476d1ce4e5b9ull;
+            return h ^ (h >> 32);
+        }
+
+        uint32_t append_string(const std::string &value) {
+            uint32_t offset = static_cast<uint32_t>(strings_.size());
+            strings_ += value;
+            return offset;
+        }
+
+        std::string_view from(const Entry &entry) const {
+            return std::string_view(strings_).substr(entry.from_offset, entry.from_size);
+        }
+
+        // Buckets average four keys; the biggest are placed first while the slot array is still empty. A 20% slot
+        // surplus keeps the seed search short.
+        void build_hash() {
+            if(entries_.empty()) {
+                return;
+            }
+            size_t bucket_count = std::max<size_t>(1, entries_.size() / 4);
+            size_t slot_count = entries_.size() + entries_.size() / 5 + 1;
+            seeds_.assign(bucket_count, 0);
+            slots_.assign(slot_count, EMPTY);
+
+            std::vector<std::vector<uint32_t>> buckets(bucket_count);
+            for(uint32_t i = 0; i < entries_.size(); ++i) {
+                buckets[hash(from(entries_[i]), 0) % bucket_count].push_back(i);
+            }
+            std::vector<uint32_t> order(bucket_count);
+            for(uint32_t i = 0; i < bucket_count; ++i) {
+                order[i] = i;
+            }
+            std::stable_sort(order.begin(), order.end(),
+                             [&](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+            std::vector<size_t> placed;
+            for(uint32_t bucket : order) {
+                if(buckets[bucket].empty()) {
+                    break;
+                }
+                for(uint32_t seed = 1;; ++seed) {
+                    if(seed == 0) {
+                        throw std::runtime_error("Could not build a perfect hash for the redirect table");
+                    }
+                    placed.clear();
+                    bool fits = true;
+                    for(uint32_t entry : buckets[bucket]) {
+                        size_t slot = hash(from(entries_[entry]), seed) % slot_count;
+                        if(slots_[slot] != EMPTY) {
+                            fits = false;
+                            break;
+                        }
+                        slots_[slot] = entry;
+                        placed.push_back(slot);
+                    }
+                    if(fits) {
+                        seeds_[bucket] = seed;
+                        break;
+                    }
+                    for(size_t slot : placed) {
+                        slots_[slot] = EMPTY;
+                    }
+                }
+            }
+        }
+
+        static void put(std::string &out, uint32_t value) {
+            for(int i = 0; i < 4; ++i) {
+                out += static_cast<char>((value >> (8 * i)) & 0xff);
+            }
+        }
+
+        static uint32_t get(std::string_view data, size_t &pos) {
+            if(pos + 4 > data.size()) {
+                throw std::runtime_error("Truncated redirect table");
+            }
+            uint32_t value = 0;
+            for(int i = 0; i < 4; ++i) {
+                value |= static_cast<uint32_t>(static_cast<unsigned char>(data[pos + i])) << (8 * i);
+            }
+            pos += 4;
+            return value;
+        }
+    };
+} // namespace http
@@ -0,0 +1,336 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../parsers/html/rewriter.hpp"
+#include "redirects.hpp"
+
+namespace http {
+    // File bodies keyed by a hash and the size of their bytes, so the same file under any number of site roots is
+    // held once. The hash is not collision resistant, so a body only joins an entry whose bytes it equals. Least
+    // recently used bodies are dropped once the total passes max_bytes. Shared by every tenant of a server.
+    class ContentCache {
+    public:
+        using Body = std::shared_ptr<const std::string>;
+
+        struct Key {
+            uint64_t hash = 0;
+            uint64_t size = 0;
+
+            bool operator==(const Key &other) const { return hash == other.hash && size == other.size; }
+        };
+
+        explicit ContentCache(size_t max_bytes) : max_bytes_(max_bytes) {}
+
+        static uint64_t hash(std::string_view data) {
+            uint64_t h = 14695981039346656037ull;
+            for(unsigned char c : data) {
+                h ^= c;
+                h *= 1099511628211ull;
+            }
+            return h;
+        }
+
+        static Key key_for(std::string_view data) { return {hash(data), data.size()}; }
+
+        Body find(const Key &key) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = entries_.find(key);
+            if(it == entries_.end()) {
+                return nullptr;
+            }
+            lru_.splice(lru_.begin(), lru_, it->second.position);
+            return it->second.body;
+        }
+
+        // The body to serve for key: the cached one when it holds the same bytes, otherwise body itself. Null when
+        // another body with the same hash and size is cached; that file must bypass the cache. Bodies larger than
+        // the whole budget are served but never kept.
+        Body insert(const Key &key, Body body) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto existing = entries_.find(key);
+            if(existing != entries_.end()) {
+                if(*existing->second.body != *body) {
+                    return nullptr;
+                }
+                lru_.splice(lru_.begin(), lru_, existing->second.position);
+                return existing->second.body;
+            }
+            if(body->size() > max_bytes_) {
+                return body;
+            }
+            while(bytes_ + body->size() > max_bytes_ && !lru_.empty()) {
+                auto oldest = entries_.find(lru_.back());
+                bytes_ -= oldest->second.body->size();
+                entries_.erase(oldest);
+                lru_.pop_back();
+            }
+            lru_.push_front(key);
+            bytes_ += body->size();
+            entries_.emplace(key, Entry{body, lru_.begin()});
+            return body;
+        }
+
+        size_t max_bytes() const { return max_bytes_; }
+
+        size_t bytes() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return bytes_;
+        }
+
+        size_t size() const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return entries_.size();
+        }
+
+    private:
+        struct Entry {
+            Body body;
+            std::list<Key>::iterator position;
+        };
+
+        struct KeyHash {
+            size_t operator()(const Key &key) const { return static_cast<size_t>(key.hash ^ (key.size * 31)); }
+        };
+
+        mutable std::mutex mutex_;
+        std::unordered_map<Key, Entry, KeyHash> entries_;
+        std::list<Key> lru_;
+        size_t max_bytes_;
+        size_t bytes_ = 0;
+    };
+
+    // Sites are built to be served from "/", so a tenant reached through its "/<name>/" prefix would send the
+    // browser out of it on every root-relative URL. These add the prefix to such URLs in HTML attributes (href, src,
+    // action, poster, srcset) and CSS url()s; protocol-relative "//host" URLs are left alone.
+    namespace prefixing {
+        inline bool is_root_relative(std::string_view url) {
+            return !url.empty() && url[0] == '/' && (url.size() == 1 || url[1] != '/');
+        }
+
+        inline std::string css(std::string_view text, std::string_view prefix) {
+            std::string out;
+            out.reserve(text.size() + prefix.size() * 4);
+            size_t pos = 0;
+            size_t found;
+            while((found = text.find("url(", pos)) != std::string_view::npos) {
+                size_t url = found + 4;
+                while(url < text.size() && (text[url] == ' ' || text[url] == '\t')) {
+                    ++url;
+                }
+                if(url < text.size() && (text[url] == '"' || text[url] == '\'')) {
+                    ++url;
+                }
+                out.append(text.substr(pos, url - pos));
+                if(is_root_relative(text.substr(url))) {
+                    out.append(prefix);
+                }
+                pos = url;
+            }
+            out.append(text.substr(pos));
+            return out;
+        }
+
+        inline std::string srcset(std::string_view value, std::string_view prefix) {
+            std::string out;
+            size_t pos = 0;
+            while(pos <= value.size()) {
+                size_t comma = value.find(',', pos);
+                std::string_view candidate = value.substr(pos, comma == std::string_view::npos ? std::string_view::npos
+                                                                                               : comma - pos);
+                size_t url = candidate.find_first_not_of(" \t\n\r\f");
+                if(url != std::string_view::npos && is_root_relative(candidate.substr(url))) {
+                    out.append(candidate.substr(0, url));
+                    out.append(prefix);
+                    out.append(candidate.substr(url));
+                } else {
+                    out.append(candidate);
+                }
+                if(comma == std::string_view::npos) {
+                    break;
+                }
+                out += ',';
+                pos = comma + 1;
+            }
+            return out;
+        }
+
+        inline std::string html(std::string_view text, const std::string &prefix) {
+            html::Rewriter rewriter;
+            rewriter.on("[href^=/], [src^=/], [action^=/], [poster^=/], [srcset]", [&prefix](html::Element &element) {
+                for(const char *name : {"href", "src", "action", "poster"}) {
+                    auto value = element.get_attribute(name);
+                    if(value && is_root_relative(*value)) {
+                        element.set_attribute(name, prefix + html::unescape_html(std::string(*value)));
+                    }
+                }
+                if(auto value = element.get_attribute("srcset")) {
+                    std::string rewritten = srcset(*value, prefix);
+                    if(rewritten != *value) {
+                        element.set_attribute("srcset", html::unescape_html(rewritten));
+                    }
+                }
+            });
+            return rewriter.rewrite(text);
+        }
+
+        inline bool applies_to(std::string_view content_type) {
+            return content_type.starts_with("text/html") || content_type.starts_with("text/css");
+        }
+
+        // The body as it should be served under prefix; content types other than HTML and CSS are unchanged.
+        inline std::string apply(std::string_view body, std::string_view content_type, const std::string &prefix) {
+            if(content_type.starts_with("text/html")) {
+                return html(body, prefix);
+            }
+            if(content_type.starts_with("text/css")) {
+                return css(body, prefix);
+            }
+            return std::string(body);
+        }
+    } // namespace prefixing
+
+    // One served site root. Requests reach it by Host header (its name, one of its hosts, or "<name>." as the first
+    // label) or by a "/<name>/" path prefix, under which its HTML and CSS go through prefixing. Per file it remembers
+    // the cache key and which cached body it was served from, checked against size and mtime on every request; the
+    // bytes live in the shared ContentCache.
+    class Tenant {
+    public:
+        Tenant(std::string name, std::filesystem::path root, std::vector<std::string> hosts = {})
+            : name_(std::move(name)), root_(std::move(root)), hosts_(std::move(hosts)) {
+            load_redirects();
+        }
+
+        const std::string &name() const { return name_; }
+        const std::filesystem::path &root() const { return root_; }
+        const std::vector<std::string> &hosts() const { return hosts_; }
+
+        bool serves_host(std::string_view host) const {
+            if(name_.empty()) {
+                return false;
+            }
+            if(host == name_ || std::find(hosts_.begin(), hosts_.end(), host) != hosts_.end()) {
+                return true;
+            }
+            return host.size() > name_.size() && host.compare(0, name_.size(), name_) == 0 && host[name_.size()] == '.';
+        }
+
+        struct Known {
+            ContentCache::Key key;
+            // The body the file's bytes were compared against; a cache hit counts only if it is still this one.
+            std::weak_ptr<const std::string> body;
+        };
+
+        // What was recorded for the file, when its size and mtime still match.
+        std::optional<Known> known(const std::string &path, std::uintmax_t size,
+                                   std::filesystem::file_time_type mtime) const {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = files_.find(path);
+            if(it == files_.end() || it->second.size != size || it->second.mtime != mtime) {
+                return std::nullopt;
+            }
+            return it->second.known;
+        }
+
+        void record(const std::string &path, std::uintmax_t size, std::filesystem::file_time_type mtime,
+                    const ContentCache::Key &key, const ContentCache::Body &body) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            files_[path] = {size, mtime, {key, body}};
+        }
+
+        void forget(const std::string &path) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            files_.erase(path);
+        }
+
+        const RedirectTable &redirects() {
+            std::lock_guard<std::mutex> lock(mutex_);
+            reload_redirects_if_changed();
+            return redirects_;
+        }
+
+    private:
+        struct File {
+            std::uintmax_t size;
+            std::filesystem::file_time_type mtime;
+            Known known;
+        };
+
+        std::string name_;
+        std::filesystem::path root_;
+        std::vector<std::string> hosts_;
+
+        mutable std::mutex mutex_;
+        std::unordered_map<std::string, File> files_;
+        RedirectTable redirects_;
+        std::filesystem::file_time_type redirects_mtime_{};
+        std::chrono::steady_clock::time_point redirects_checked_at_{};
+
+        // Prefers the binary table the generator writes and falls back to parsing `_redirects`. A broken table
+        // leaves redirects off rather than stopping the server.
+        void load_redirects() {
+            std::filesystem::path binary = root_ / RedirectTable::FILE_NAME;
+            std::filesystem::path text = root_ / RedirectTable::TEXT_FILE_NAME;
+            redirects_ = RedirectTable();
+            redirects_mtime_ = {};
+
+            std::error_code ec;
+            try {
+                if(std::filesystem::exists(binary, ec)) {
+                    redirects_mtime_ = std::filesystem::last_write_time(binary, ec);
+                    redirects_ = RedirectTable::deserialize(read_whole_file(binary));
+                } else if(std::filesystem::exists(text, ec)) {
+                    redirects_mtime_ = std::filesystem::last_write_time(text, ec);
+                    redirects_ = RedirectTable::parse_text(read_whole_file(text));
+                }
+            } catch(const std::exception &e) {
+                std::cerr << "⚠️  Ignoring redirects in " << root_.string() << ": " << e.what() << std::endl;
+                redirects_ = RedirectTable();
+            }
+            redirects_checked_at_ = std::chrono::steady_clock::now();
+        }
+
+        // At most once a second, so a rebuild is picked up without a stat per request.
+        void reload_redirects_if_changed() {
+            auto now = std::chrono::steady_clock::now();
+            if(now - redirects_checked_at_ < std::chrono::seconds(1)) {
+                return;
+            }
+            redirects_checked_at_ = now;
+
+            std::error_code ec;
+            std::filesystem::path binary = root_ / RedirectTable::FILE_NAME;
+            std::filesystem::path text = root_ / RedirectTable::TEXT_FILE_NAME;
+            std::filesystem::path source = std::filesystem::exists(binary, ec) ? binary : text;
+            auto mtime = std::filesystem::last_write_time(source, ec);
+            if(ec) {
+                mtime = {};
+            }
+            if(mtime != redirects_mtime_) {
+                load_redirects();
+            }
+        }
+
+        static std::string read_whole_file(const std::filesystem::path &path) {
+            std::ifstream file(path, std::ios::binary);
+            std::stringstream content;
+            content << file.rdbuf();
+            return content.str();
+        }
+    };
+} // namespace http
@@ -0,0 +1,241 @@
+#include "../includes/tests.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "http_server.hpp"
+#include "redirects.hpp"
+
+namespace {
+    // One GET over a fresh connection; the whole response, headers included.
+    std::string fetch(int port, const std::string &target, const std::string &host = "localhost") {
+        SOCKET_TYPE fd = socket(AF_INET, SOCK_STREAM, 0);
+        if(fd == INVALID_SOCKET_TYPE) {
+            throw std::runtime_error("socket() failed");
+        }
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        if(connect(fd, (struct sockaddr *) &address, sizeof(address)) == SOCKET_ERROR_CODE) {
+            CLOSE_SOCKET(fd);
+            throw std::runtime_error("connect() failed");
+        }
+
+        std::string request = "GET " + target + " HTTP/1.1\r\nHost: " + host + "\r\nConnection: close\r\n\r\n";
+        send(fd, request.c_str(), static_cast<int>(request.size()), 0);
+
+        std::string response;
+        char buffer[4096];
+        int received;
+        while((received = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+            response.append(buffer, received);
+        }
+        CLOSE_SOCKET(fd);
+        return response;
+    }
+
+    void write_text(const std::filesystem::path &path, const std::string &text) {
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << text;
+    }
+
+    std::string body_of(const std::string &response) {
+        size_t end = response.find("\r\n\r\n");
+        return end == std::string::npos ? "" : response.substr(end + 4);
+    }
+
+    // The first href="..." value in html, as written.
+    std::string first_href(const std::string &html) {
+        size_t start = html.find("href=\"");
+        if(start == std::string::npos) {
+            return "";
+        }
+        start += 6;
+        return html.substr(start, html.find('"', start) - start);
+    }
+} // namespace
+
+TEST(RedirectBuildAndFind) {
+    http::RedirectTable table = http::RedirectTable::build({
+        {"/old/", "/new/", 301},
+        {"blog/2019", "/archive/2019/", 308},
+        {"/old", "/ignored/", 302},
+    });
+    ASSERT_EQ(table.size(), 2u);
+
+    auto old = table.find("/old");
+    ASSERT_TRUE(old.has_value());
+    ASSERT_EQ(old->first, "/new/");
+    ASSERT_EQ(old->second, 301);
+
+    auto with_query = table.find("old/?page=2");
+    ASSERT_TRUE(with_query.has_value());
+    ASSERT_EQ(with_query->first, "/new/");
+
+    auto blog = table.find("/blog/2019/");
+    ASSERT_TRUE(blog.has_value());
+    ASSERT_EQ(blog->second, 308);
+
+    ASSERT_TRUE(!table.find("/missing").has_value());
+    ASSERT_TRUE(!http::RedirectTable().find("/old").has_value());
+    std::cout << "Redirects normalized, first duplicate kept";
+}
+
+TEST(RedirectParseText) {
+    http::RedirectTable table = http::RedirectTable::parse_text("# moved pages\n"
+                                                                "\n"
+                                                                "/a  /b\n"
+                                                                "/c  /d  307\n"
+                                                                "/e  /f  200\n"
+                                                                "/lonely\n");
+    ASSERT_EQ(table.size(), 2u);
+    ASSERT_EQ(table.find("/a")->second, 301);
+    ASSERT_EQ(table.find("/c")->first, "/d");
+    ASSERT_EQ(table.find("/c")->second, 307);
+    ASSERT_TRUE(!table.find("/e").has_value());
+    ASSERT_TRUE(!table.find("/lonely").has_value());
+    std::cout << "Comments, non-redirect statuses and incomplete lines skipped";
+}
+
+TEST(RedirectSerializeRoundTrip) {
+    std::vector<http::Redirect> redirects;
+    for(int i = 0; i < 500; ++i) {
+        redirects.push_back({"/page-" + std::to_string(i), "/pages/" + std::to_string(i) + "/", 301 + i % 2});
+    }
+    http::RedirectTable table = http::RedirectTable::deserialize(http::RedirectTable::build(redirects).serialize());
+    ASSERT_EQ(table.size(), redirects.size());
+
+    size_t found = 0;
+    for(const auto &redirect : redirects) {
+        auto match = table.find(redirect.from);
+        if(match && match->first == redirect.to && match->second == redirect.status) {
+            ++found;
+        }
+    }
+    ASSERT_EQ(found, redirects.size());
+    ASSERT_TRUE(!table.find("/page-500").has_value());
+    std::cout << found << " redirects found after a serialize round trip";
+}
+
+TEST(RedirectDeserializeRejectsCorruptTables) {
+    std::string bytes = http::RedirectTable::build({{"/a", "/b", 301}}).serialize();
+
+    auto rejects = [](const std::string &data) {
+        try {
+            http::RedirectTable::deserialize(data);
+        } catch(const std::runtime_error &) {
+            return true;
+        }
+        return false;
+    };
+
+    std::string bad_magic = bytes;
+    bad_magic[0] = 'X';
+    std::string bad_version = bytes;
+    bad_version[4] = static_cast<char>(http::RedirectTable::VERSION + 1);
+
+    ASSERT_TRUE(rejects(""));
+    ASSERT_TRUE(rejects(bad_magic));
+    ASSERT_TRUE(rejects(bad_version));
+    ASSERT_TRUE(rejects(bytes.substr(0, bytes.size() - 1)));
+    ASSERT_TRUE(rejects(bytes.substr(0, 12)));
+    ASSERT_TRUE(!rejects(bytes));
+    std::cout << "Truncated and foreign tables rejected";
+}
+
+TEST(ServerRedirectEscapesTarget) {
+    auto root = std::filesystem::temp_directory_path() / "chisel_http_redirect_test";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    write_text(root / http::RedirectTable::TEXT_FILE_NAME, "/old  /new/  302\n");
+
+    const int port = 18093;
+    std::string moved;
+    std::string plain;
+    {
+        http::HttpServerAsync server(port, root.string());
+        server.start();
+        moved = fetch(port, "/old?q=\"><script>alert(1)</script>");
+        plain = fetch(port, "/old");
+        server.stop();
+    }
+    std::filesystem::remove_all(root);
+
+    ASSERT_TRUE(moved.rfind("HTTP/1.1 302", 0) == 0);
+    ASSERT_TRUE(moved.find("Location: /new/?q=\"><script>alert(1)</script>\r\n") != std::string::npos);
+    ASSERT_TRUE(moved.find("<script>", moved.find("\r\n\r\n")) == std::string::npos);
+    ASSERT_TRUE(moved.find("<a href=\"/new/?q=&quot;&gt;&lt;script&gt;alert(1)&lt;/script&gt;\">Found</a>") !=
+                std::string::npos);
+    ASSERT_TRUE(plain.find("Location: /new/\r\n") != std::string::npos);
+    ASSERT_TRUE(plain.find("<a href=\"/new/\">Found</a>") != std::string::npos);
+    std::cout << "Redirect body escapes the reflected query string";
+}
+
+TEST(PrefixRewritesRootRelativeUrls) {
+    std::string prefixed = http::prefixing::apply("<link rel=\"stylesheet\" href=\"/styles/main.css\">"
+                                                  "<a href=\"/posts/a/?x=1&amp;y=2\">a</a>"
+                                                  "<a href=\"//cdn.example.com/x.js\">b</a>"
+                                                  "<a href=\"post/\">c</a>"
+                                                  "<img src=/logo.png srcset=\"/logo-2x.png 2x, logo-3x.png 3x\">",
+                                                  "text/html; charset=utf-8", "/blog");
+    ASSERT_EQ(prefixed, "<link rel=\"stylesheet\" href=\"/blog/styles/main.css\">"
+                        "<a href=\"/blog/posts/a/?x=1&amp;y=2\">a</a>"
+                        "<a href=\"//cdn.example.com/x.js\">b</a>"
+                        "<a href=\"post/\">c</a>"
+                        "<img src=\"/blog/logo.png\" srcset=\"/blog/logo-2x.png 2x, logo-3x.png 3x\">");
+
+    ASSERT_EQ(http::prefixing::apply("a{background:url(/bg.png)} b{background:url( '/x.png')} c{background:url(//h/y.png)}",
+                                     "text/css; charset=utf-8", "/blog"),
+              "a{background:url(/blog/bg.png)} b{background:url( '/blog/x.png')} c{background:url(//h/y.png)}");
+    ASSERT_EQ(http::prefixing::apply("fetch('/api')", "application/javascript", "/blog"), "fetch('/api')");
+    std::cout << "Root-relative HTML attributes and CSS urls prefixed, others untouched";
+}
+
+TEST(ServerPrefixedTenantLinksResolve) {
+    auto root = std::filesystem::temp_directory_path() / "chisel_http_prefix_test";
+    std::filesystem::remove_all(root);
+    write_text(root / "index.html", "<link rel=\"stylesheet\" href=\"/styles/main.css\"><p>home</p>");
+    write_text(root / "styles/main.css", "body{background:url(/images/bg.png)}");
+    write_text(root / "images/bg.png", "png bytes");
+
+    const int port = 18098;
+    std::string page;
+    std::string style;
+    std::string image;
+    std::string by_host;
+    {
+        http::HttpServerAsync server(port, std::make_shared<http::ContentCache>(1024 * 1024));
+        server.add_tenant("blog", root);
+        server.start();
+        page = fetch(port, "/blog/");
+        style = fetch(port, first_href(body_of(page)));
+        image = fetch(port, "/blog/images/bg.png");
+        by_host = fetch(port, "/", "blog");
+        server.stop();
+    }
+    std::filesystem::remove_all(root);
+
+    ASSERT_EQ(first_href(body_of(page)), "/blog/styles/main.css");
+    ASSERT_TRUE(style.rfind("HTTP/1.1 200", 0) == 0);
+    ASSERT_EQ(body_of(style), "body{background:url(/blog/images/bg.png)}");
+    ASSERT_TRUE(image.rfind("HTTP/1.1 200", 0) == 0);
+    ASSERT_EQ(body_of(image), "png bytes");
+    ASSERT_EQ(first_href(body_of(by_host)), "/styles/main.css");
+    std::cout << "Stylesheet linked from a prefixed tenant's page fetched through the prefix";
+}
+
+#ifdef ENABLE_TESTS
+int main() {
+    return Test::RunAllTests();
+    return 0;
+}
+#else
+int main() { return 0; }
+#endif
@@ -1,15 +1,27 @@
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <csignal>
 #include <filesystem>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
 #include <string>
 #include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
 
 #include "config_cli.hpp"
 #include "core/config.hpp"
 #include "core/generator.hpp"
+#include "core/metadata_index.hpp"
 #include "http/http_server.hpp"
+#include "site_bench.hpp"
 
 std::atomic<bool> server_should_stop(false);
 
@@ -20,7 +32,93 @@ void signal_handler(int signal) {
     }
 }
 
-bool build_site(const std::filesystem::path &project_path, bool clean_first = false) {
+// Builds with whatever g_config currently holds; throws on failure.
+std::unique_ptr<ssg::SiteGenerator> generate_site(const std::filesystem::path &project_path, bool clean_first,
+                                                  const ssg::BuildOptions &options) {
+    std::optional<std::filesystem::path> output_dir = ssg::g_config.get_output_path();
+    if(options.sink) {
+        output_dir = options.sink->directory();
+    }
+    if(clean_first && output_dir && std::filesystem::exists(*output_dir)) {
+        std::cout << "\n🧹 Cleaning output directory..." << std::endl;
+        std::filesystem::remove_all(*output_dir);
+    }
+
+    ssg::BuildOptions build_options = options;
+    if(ssg::g_config.performance.streaming_build) {
+        build_options.streaming = true;
+    }
+
+    auto generator = std::make_unique<ssg::SiteGenerator>(project_path, build_options);
+
+    std::cout << "\n⚡ Generating site..." << std::endl;
+    generator->build();
+
+    std::cout << "\n✅ Site built successfully!" << std::endl;
+    std::cout << "📁 Output available in: "
+              << (options.sink ? options.sink->describe() : ssg::g_config.get_output_path().string()) << std::endl;
+
+    return generator;
+}
+
+// Builds the [[variants]] picked by `selection` (all when empty) one after another, switching g_config to each.
+// They share one BuildCache, so templates, stylesheets, pages rendered from the same sources and translation
+// catalogs are read, rendered and compiled once for the whole batch. Returns the last variant's generator.
+std::unique_ptr<ssg::SiteGenerator> build_variants(const std::filesystem::path &project_path, bool clean_first,
+                                                   const ssg::BuildOptions &options,
+                                                   const std::vector<std::string> &selection) {
+    const ssg::Config base = ssg::g_config;
+
+    std::vector<std::pair<std::string, ssg::Config>> variants;
+    for(auto &[name, config] : base.expand_variants(project_path)) {
+        bool selected = selection.empty() || std::any_of(selection.begin(), selection.end(), [&](const std::string &pick) {
+                            return name == pick || name.rfind(pick + "/", 0) == 0;
+                        });
+        if(selected) {
+            variants.emplace_back(name, std::move(config));
+        }
+    }
+    if(variants.empty()) {
+        throw std::runtime_error("No variant in chisel.config matches the --variant selection");
+    }
+    if(options.sink && variants.size() > 1) {
+        throw std::runtime_error("--out holds a single site; pick one of the " + std::to_string(variants.size()) +
+                                 " variants with --variant");
+    }
+
+    auto cache = std::make_shared<ssg::BuildCache>();
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<ssg::SiteGenerator> generator;
+    try {
+        for(const auto &[name, config] : variants) {
+            std::cout << "\n🌐 Variant " << name << " (" << config.site.language << ") -> " << config.get_output_path()
+                      << std::endl;
+            ssg::g_config = config;
+
+            ssg::BuildOptions variant_options = options;
+            variant_options.variant = name;
+            variant_options.cache = cache;
+            variant_options.fallback_language = base.site.language;
+            generator = generate_site(project_path, clean_first, variant_options);
+        }
+    } catch(...) {
+        ssg::g_config = base;
+        throw;
+    }
+    ssg::g_config = base;
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "\n🌐 Built " << variants.size() << (variants.size() == 1 ? " variant" : " variants") << " in "
+              << elapsed.count() << "s (" << cache->file_hits() << " shared file reads, " << cache->page_hits()
+              << " shared page renders)" << std::endl;
+    return generator;
+}
+
+// Returns the generator so `chisel dev` can re-render from it later; null if the build failed. With a variant
+// selection and [[variants]] in the config, builds those instead of the base site.
+std::unique_ptr<ssg::SiteGenerator> build_site(const std::filesystem::path &project_path, bool clean_first = false,
+                                               const ssg::BuildOptions &options = {},
+                                               const std::vector<std::string> *variant_selection = nullptr) {
     try {
         std::cout << "🔨 Chisel SSG - Building site from: " << project_path << std::endl;
 
@@ -32,25 +130,107 @@ bool build_site(const std::filesystem::path &project_path, bool clean_first = fa
             ssg::g_config.print_summary();
         }
 
-        if(clean_first && std::filesystem::exists(ssg::g_config.get_output_path())) {
-            std::cout << "\n🧹 Cleaning output directory..." << std::endl;
-            std::filesystem::remove_all(ssg::g_config.get_output_path());
+        if(variant_selection && !ssg::g_config.variants.empty()) {
+            return build_variants(project_path, clean_first, options, *variant_selection);
+        }
+        if(variant_selection && !variant_selection->empty()) {
+            throw std::runtime_error("--variant given, but chisel.config defines no [[variants]]");
         }
+        return generate_site(project_path, clean_first, options);
 
-        ssg::SiteGenerator generator(project_path);
+    } catch(const std::exception &e) {
+        std::cerr << "\n❌ Error: " << e.what() << std::endl;
+        return nullptr;
+    }
+}
 
-        std::cout << "\n🎨 Loading styles..." << std::endl;
-        generator.load_styles();
+// Command line flags win over chisel.config, which already includes the CHISEL_DEV_* environment overrides.
+int dev_server_port(const ssg::cli::Arguments &args) { return args.port ? *args.port : ssg::g_config.dev.port; }
 
-        std::cout << "\n📄 Loading layouts..." << std::endl;
-        generator.load_layouts();
+std::string dev_server_host(const ssg::cli::Arguments &args) { return args.host ? *args.host : ssg::g_config.dev.host; }
 
-        std::cout << "\n⚡ Generating site..." << std::endl;
-        generator.generate();
+size_t server_cache_bytes(const ssg::cli::Arguments &args) {
+    return args.cache_mb ? static_cast<size_t>(*args.cache_mb) * 1024 * 1024 : http::HttpServerAsync::DEFAULT_CACHE_BYTES;
+}
 
-        std::cout << "\n✅ Site built successfully!" << std::endl;
-        std::cout << "📁 Output available in: " << ssg::g_config.get_output_path() << std::endl;
+// Applies a chisel.config edit made while `chisel dev` runs, redoing only what the changed sections affect. An
+// invalid config is reported and the previous one stays in effect.
+void reload_config(const ssg::cli::Arguments &args, const ssg::BuildOptions &options,
+                   std::unique_ptr<ssg::SiteGenerator> &generator, std::unique_ptr<http::HttpServerAsync> &server,
+                   int &server_port) {
+    std::cout << "\n📋 chisel.config changed, reloading..." << std::endl;
+
+    ssg::Config next;
+    try {
+        next.load(args.project_path / "chisel.config", args.project_path);
+    } catch(const std::exception &e) {
+        std::cerr << "❌ " << e.what() << std::endl;
+        std::cerr << "⚠️  Keeping the previous configuration" << std::endl;
+        return;
+    }
+
+    ssg::ConfigChanges changes = next.diff(ssg::g_config);
+    std::filesystem::path previous_output = ssg::g_config.get_output_path();
+    ssg::g_config = next;
+    if(changes.empty()) {
+        std::cout << "📋 No effective configuration changes" << std::endl;
+        return;
+    }
+
+    try {
+        if(changes.build) {
+            std::cout << "🔨 Build settings changed, rebuilding the site..." << std::endl;
+            generator = generate_site(args.project_path, false, options);
+        } else if(changes.site || changes.global_styles || !changes.layouts.empty()) {
+            generator->apply_config_changes(changes);
+        }
+        if(changes.performance && !changes.build) {
+            std::cout << "⚙️  Performance settings take effect on the next full build" << std::endl;
+        }
+    } catch(const std::exception &e) { std::cerr << "❌ Rebuild failed: " << e.what() << std::endl; }
+
+    int port = dev_server_port(args);
+    std::filesystem::path output = ssg::g_config.get_output_path();
+    if(port == server_port && output == previous_output) {
+        if(changes.dev) {
+            std::cout << "🌐 Dev settings updated, server still at http://" << dev_server_host(args) << ":" << port
+                      << std::endl;
+        }
+        return;
+    }
 
+    // The old listener has to go first when the port stays the same.
+    server->stop();
+    try {
+        server = std::make_unique<http::HttpServerAsync>(port, output.string(), server_cache_bytes(args));
+        server->start();
+        server_port = port;
+        std::cout << "🌐 Development server restarted at http://" << dev_server_host(args) << ":" << port << std::endl;
+    } catch(const std::exception &e) {
+        std::cerr << "❌ Could not restart the server on port " << port << ": " << e.what() << std::endl;
+        server = std::make_unique<http::HttpServerAsync>(server_port, output.string(), server_cache_bytes(args));
+        server->start();
+    }
+}
+
+bool merge_shards(const std::filesystem::path &project_path, const std::vector<std::filesystem::path> &shard_dirs) {
+    try {
+        std::cout << "🧩 Chisel SSG - Merging " << shard_dirs.size() << " shards into: " << project_path << std::endl;
+
+        std::filesystem::path config_path = project_path / "chisel.config";
+        ssg::g_config.load(config_path, project_path);
+
+        ssg::BuildManifest manifest = ssg::merge_shards(shard_dirs, ssg::g_config.get_output_path());
+        ssg::ChangeSet changes = manifest.publish(project_path);
+
+        std::cout << "📦 Changes since last build: " << changes.added.size() << " added, " << changes.modified.size()
+                  << " modified, " << changes.removed.size() << " removed" << std::endl;
+        size_t stale = ssg::remove_stale_outputs(changes, ssg::g_config.get_output_path());
+        if(stale > 0) {
+            std::cout << "🧹 Removed " << stale << " stale output files" << std::endl;
+        }
+        std::cout << "\n✅ Shards merged successfully!" << std::endl;
+        std::cout << "📁 Output available in: " << ssg::g_config.get_output_path() << std::endl;
         return true;
 
     } catch(const std::exception &e) {
@@ -59,6 +239,91 @@ bool build_site(const std::filesystem::path &project_path, bool clean_first = fa
     }
 }
 
+// Prints one tab-separated line per matching page, its route and then the requested fields. Only rows go to
+// stdout; config logging and the summary go to stderr, so the output can be piped.
+bool run_query(const ssg::cli::Arguments &args) {
+    std::streambuf *stdout_buffer = std::cout.rdbuf(std::cerr.rdbuf());
+    try {
+        ssg::g_config.load(args.project_path / "chisel.config", args.project_path);
+        ssg::MetadataQuery query = ssg::MetadataQuery::parse(args.where);
+
+        ssg::MetadataIndex index;
+        std::filesystem::path index_path =
+            ssg::MetadataIndex::default_path(args.project_path, ssg::g_config.get_content_path());
+        index.load(index_path);
+        size_t previous_size = index.size();
+        ssg::utils::ThreadPool pool;
+        ssg::MetadataIndex::RefreshStats stats = index.refresh(ssg::g_config.get_content_path(), &pool);
+        if(stats.scanned > 0 || index.size() != previous_size) {
+            index.save(index_path);
+        }
+
+        std::vector<std::string> fields = args.fields.empty() ? std::vector<std::string>{"title"} : args.fields;
+        std::vector<const std::vector<std::string> *> columns;
+        for(const auto &field : fields) {
+            columns.push_back(index.column(field));
+        }
+
+        std::vector<size_t> rows = query.run(index);
+        std::cout.rdbuf(stdout_buffer);
+        for(size_t row : rows) {
+            std::cout << index.route(row);
+            for(const auto *column : columns) {
+                std::cout << '\t' << (column ? (*column)[row] : "");
+            }
+            std::cout << '\n';
+        }
+        std::cout.flush();
+
+        std::cerr << "🔎 " << rows.size() << " of " << index.size() << " pages matched (" << stats.scanned
+                  << " front matter blocks read, " << stats.reused << " unchanged)" << std::endl;
+        return true;
+
+    } catch(const std::exception &e) {
+        std::cout.rdbuf(stdout_buffer);
+        std::cerr << "❌ Error: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool run_bench(const ssg::cli::Arguments &args) {
+    try {
+        ssg::bench::BenchOptions options;
+        if(args.port) {
+            options.port = *args.port;
+        }
+        if(args.bench_pages) {
+            options.pages = static_cast<size_t>(*args.bench_pages);
+        }
+
+        std::filesystem::path project_path = args.project_path;
+        if(args.bench_corpus) {
+            project_path = *args.bench_corpus;
+            std::cout << "📝 Writing a synthetic site of " << options.pages << " pages to " << project_path << std::endl;
+            ssg::bench::write_corpus(project_path, options.pages);
+        }
+
+        std::optional<ssg::bench::BenchResults> baseline;
+        if(args.bench_baseline) {
+            baseline = ssg::bench::load_results(*args.bench_baseline);
+        }
+
+        std::cout << "🏁 Chisel SSG - Benchmarking: " << project_path << std::endl;
+        ssg::bench::BenchResults results = ssg::bench::run(project_path, options);
+        ssg::bench::print_results(results, baseline);
+
+        if(args.bench_save) {
+            ssg::bench::save_results(*args.bench_save, results);
+            std::cout << "💾 Results saved to " << *args.bench_save << std::endl;
+        }
+        return true;
+
+    } catch(const std::exception &e) {
+        std::cerr << "\n❌ Benchmark failed: " << e.what() << std::endl;
+        return false;
+    }
+}
+
 int main(int argc, char *argv[]) {
     auto args = ssg::cli::ArgumentParser::parse(argc, argv);
 
@@ -79,9 +344,62 @@ int main(int argc, char *argv[]) {
     }
 
     if(args.command == "build") {
-        return build_site(args.project_path, args.clean) ? 0 : 1;
+        ssg::BuildOptions options;
+        options.streaming = args.streaming;
+        options.only = args.only;
+        options.profile = args.profile;
+        if(args.shard) {
+            auto shard = ssg::ShardSpec::parse(*args.shard);
+            if(!shard) {
+                std::cerr << "❌ Error: Invalid --shard value '" << *args.shard << "', expected i/N with 1 <= i <= N"
+                          << std::endl;
+                return 1;
+            }
+            options.shard = *shard;
+        }
+        std::streambuf *stdout_buffer = nullptr;
+        try {
+            if(args.out && *args.out == "-") {
+#ifdef _WIN32
+                _setmode(_fileno(stdout), _O_BINARY);
+#endif
+                // The tar stream owns stdout from here on, so everything chisel logs goes to stderr instead.
+                stdout_buffer = std::cout.rdbuf();
+                options.sink = std::make_shared<ssg::TarSink>(stdout_buffer);
+                std::cout.rdbuf(std::cerr.rdbuf());
+            } else if(args.out) {
+                options.sink = ssg::OutputSink::open(std::filesystem::absolute(*args.out));
+            }
+        } catch(const std::exception &e) {
+            std::cerr << "❌ Error: " << e.what() << std::endl;
+            return 1;
+        }
+
+        bool built = build_site(args.project_path, args.clean, options, &args.variants) != nullptr;
+        if(built && options.sink) {
+            try {
+                options.sink->close();
+            } catch(const std::exception &e) {
+                std::cerr << "❌ Error: " << e.what() << std::endl;
+                built = false;
+            }
+        }
+        if(stdout_buffer) {
+            std::cout.rdbuf(stdout_buffer);
+        }
+        return built ? 0 : 1;
+    } else if(args.command == "merge-shards") {
+        return merge_shards(args.project_path, args.shard_dirs) ? 0 : 1;
+    } else if(args.command == "bench") {
+        return run_bench(args) ? 0 : 1;
+    } else if(args.command == "query") {
+        return run_query(args) ? 0 : 1;
     } else if(args.command == "dev") {
-        if(!build_site(args.project_path, args.clean)) {
+        ssg::BuildOptions options;
+        options.streaming = args.streaming;
+        options.profile = args.profile;
+        std::unique_ptr<ssg::SiteGenerator> generator = build_site(args.project_path, args.clean, options);
+        if(!generator) {
             return 1;
         }
 
@@ -95,18 +413,22 @@ int main(int argc, char *argv[]) {
             std::signal(SIGINT, signal_handler);
             std::signal(SIGTERM, signal_handler);
 
-            int server_port = ssg::cli::env::get_server_port(args);
-            std::string server_host = ssg::cli::env::get_server_host(args);
+            int server_port = dev_server_port(args);
+            std::string server_host = dev_server_host(args);
 
             std::cout << "🌐 Starting development server at http://" << server_host << ":" << server_port << std::endl;
-            http::HttpServerAsync server(server_port, dist_path.string());
-            server.start();
+            auto server = std::make_unique<http::HttpServerAsync>(server_port, dist_path.string(), server_cache_bytes(args));
+            server->start();
 
-            while(server.is_running() && !server_should_stop) {
+            ssg::FileWatcher config_watcher(args.project_path / "chisel.config");
+            while(server->is_running() && !server_should_stop) {
                 std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                if(ssg::g_config.dev.auto_reload && config_watcher.poll()) {
+                    reload_config(args, options, generator, server, server_port);
+                }
             }
 
-            server.stop();
+            server->stop();
             std::cout << "✅ Server stopped." << std::endl;
             return 0;
 
@@ -115,13 +437,17 @@ int main(int argc, char *argv[]) {
             return 1;
         }
     } else if(args.command == "serve") {
-        std::filesystem::path config_path = args.project_path / "chisel.config";
-        ssg::g_config.load(config_path, args.project_path);
-
-        std::filesystem::path dist_path = ssg::g_config.get_output_path();
-        if(!std::filesystem::exists(dist_path)) {
-            std::cerr << "❌ Error: Output directory not found. Build the site first with 'chisel build'." << std::endl;
-            return 1;
+        // With --tenants the sites are whatever builds sit in that directory; the project's own config is not needed.
+        std::filesystem::path dist_path;
+        if(!args.tenants_dir) {
+            std::filesystem::path config_path = args.project_path / "chisel.config";
+            ssg::g_config.load(config_path, args.project_path);
+
+            dist_path = ssg::g_config.get_output_path();
+            if(!std::filesystem::exists(dist_path)) {
+                std::cerr << "❌ Error: Output directory not found. Build the site first with 'chisel build'." << std::endl;
+                return 1;
+            }
         }
 
         try {
@@ -132,14 +458,21 @@ int main(int argc, char *argv[]) {
             std::string server_host = ssg::cli::env::get_server_host(args);
 
             std::cout << "🌐 Starting server at http://" << server_host << ":" << server_port << std::endl;
-            http::HttpServerAsync server(server_port, dist_path.string());
-            server.start();
+            std::unique_ptr<http::HttpServerAsync> server;
+            if(args.tenants_dir) {
+                server = std::make_unique<http::HttpServerAsync>(
+                    server_port, std::make_shared<http::ContentCache>(server_cache_bytes(args)));
+                server->watch_tenants(*args.tenants_dir);
+            } else {
+                server = std::make_unique<http::HttpServerAsync>(server_port, dist_path.string(), server_cache_bytes(args));
+            }
+            server->start();
 
-            while(server.is_running() && !server_should_stop) {
+            while(server->is_running() && !server_should_stop) {
                 std::this_thread::sleep_for(std::chrono::milliseconds(100));
             }
 
-            server.stop();
+            server->stop();
             std::cout << "✅ Server stopped." << std::endl;
             return 0;
 
@@ -0,0 +1,520 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "../../utils/file_utils.hpp"
+#include "../html/html.hpp"
+
+// Build-time syntax highlighting. Each language is a table (keywords, types, literals, comment and string
+// delimiters) driving one shared lexer; the tables are built once on first use and are read-only afterwards, so
+// any number of threads can highlight concurrently. Output is HTML-escaped code with tokens wrapped in
+// <span class="tok-keyword|tok-type|tok-literal|tok-string|tok-number|tok-comment|tok-preprocessor">.
+namespace highlight {
+    enum class TokenKind { Plain, Keyword, Type, Literal, String, Number, Comment, Preprocessor };
+
+    inline const char *css_class(TokenKind kind) {
+        switch(kind) {
+        case TokenKind::Keyword:
+            return "tok-keyword";
+        case TokenKind::Type:
+            return "tok-type";
+        case TokenKind::Literal:
+            return "tok-literal";
+        case TokenKind::String:
+            return "tok-string";
+        case TokenKind::Number:
+            return "tok-number";
+        case TokenKind::Comment:
+            return "tok-comment";
+        case TokenKind::Preprocessor:
+            return "tok-preprocessor";
+        case TokenKind::Plain:
+            break;
+        }
+        return "";
+    }
+
+    struct LanguageSpec {
+        std::string name;
+        std::unordered_set<std::string_view> keywords;
+        std::unordered_set<std::string_view> types;
+        std::unordered_set<std::string_view> literals;
+        std::vector<std::string_view> line_comments;
+        std::string_view block_comment_open;
+        std::string_view block_comment_close;
+        std::string_view quotes = "\"'";
+        bool triple_quoted_strings = false;
+        bool preprocessor_lines = false;
+        // '#' only starts a comment at the beginning of a word (shell: "a#b" is one word).
+        bool hash_comment_needs_boundary = false;
+    };
+
+    namespace detail {
+        enum CharClass : uint8_t { IDENT_START = 1, IDENT = 2, DIGIT = 4, SPACE = 8 };
+
+        inline const std::array<uint8_t, 256> &char_classes() {
+            static const std::array<uint8_t, 256> table = [] {
+                std::array<uint8_t, 256> t{};
+                for(int c = 0; c < 256; ++c) {
+                    bool alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '$' || c >= 0x80;
+                    bool digit = c >= '0' && c <= '9';
+                    t[c] = (alpha ? IDENT_START | IDENT : 0) | (digit ? DIGIT | IDENT : 0) |
+                           (c == ' ' || c == '\t' || c == '\n' || c == '\r' ? SPACE : 0);
+                }
+                return t;
+            }();
+            return table;
+        }
+
+        inline bool is_class(char c, uint8_t cls) { return (char_classes()[static_cast<unsigned char>(c)] & cls) != 0; }
+
+        inline bool starts_with_at(std::string_view text, size_t pos, std::string_view prefix) {
+            return !prefix.empty() && text.substr(pos, prefix.size()) == prefix;
+        }
+
+        inline LanguageSpec make_c_family(std::string name, std::initializer_list<std::string_view> keywords,
+                                          std::initializer_list<std::string_view> types,
+                                          std::initializer_list<std::string_view> literals) {
+            LanguageSpec spec;
+            spec.name = std::move(name);
+            spec.keywords = keywords;
+            spec.types = types;
+            spec.literals = literals;
+            spec.line_comments = {"//"};
+            spec.block_comment_open = "/*";
+            spec.block_comment_close = "*/";
+            return spec;
+        }
+
+        inline std::vector<LanguageSpec> build_languages() {
+            std::vector<LanguageSpec> languages;
+
+            LanguageSpec cpp = make_c_family(
+                "cpp",
+                {"alignas", "alignof", "auto",      "break",    "case",     "catch",    "class",     "co_await",
+                 "co_return", "co_yield", "const",  "constexpr", "consteval", "constinit", "continue", "decltype",
+                 "default", "delete",   "do",        "else",     "enum",     "explicit", "export",    "extern",
+                 "final",   "for",      "friend",    "goto",     "if",       "inline",   "mutable",   "namespace",
+                 "new",     "noexcept", "operator",  "override", "private",  "protected", "public",   "register",
+                 "requires", "return",  "sizeof",    "static",   "static_assert", "static_cast", "struct", "switch",
+                 "template", "this",    "throw",     "try",      "typedef",  "typename", "union",     "using",
+                 "virtual", "volatile", "while",     "dynamic_cast", "reinterpret_cast", "const_cast", "concept"},
+                {"bool", "char", "char8_t", "char16_t", "char32_t", "double", "float", "int", "long", "short",
+                 "signed", "unsigned", "void", "wchar_t", "size_t", "int8_t", "int16_t", "int32_t", "int64_t",
+                 "uint8_t", "uint16_t", "uint32_t", "uint64_t", "string", "string_view", "vector", "map"},
+                {"true", "false", "nullptr", "NULL"});
+            cpp.preprocessor_lines = true;
+            languages.push_back(cpp);
+
+            LanguageSpec javascript = make_c_family(
+                "javascript",
+                {"async",  "await",  "break",    "case",   "catch", "class",  "const",     "continue", "debugger",
+                 "default", "delete", "do",      "else",   "export", "extends", "finally", "for",      "from",
+                 "function", "get",   "if",      "import", "in",    "instanceof", "let",   "new",      "of",
+                 "return", "set",    "static",   "super",  "switch", "this",  "throw",     "try",      "typeof",
+                 "var",    "void",   "while",    "with",   "yield", "interface", "type",   "enum",     "implements",
+                 "declare", "readonly", "as",    "keyof",  "namespace", "abstract", "private", "public", "protected"},
+                {"string", "number", "boolean", "any", "unknown", "never", "object", "Array", "Promise", "Map", "Set"},
+                {"true", "false", "null", "undefined", "NaN", "Infinity"});
+            javascript.quotes = "\"'`";
+            languages.push_back(javascript);
+
+            LanguageSpec python;
+            python.name = "python";
+            python.keywords = {"and",   "as",     "assert", "async",  "await",    "break", "class", "continue",
+                               "def",   "del",    "elif",   "else",   "except",   "finally", "for", "from",
+                               "global", "if",    "import", "in",     "is",       "lambda", "nonlocal", "not",
+                               "or",    "pass",   "raise",  "return", "try",      "while", "with",  "yield",
+                               "match", "case"};
+            python.types = {"int", "float", "str", "bytes", "bool", "list", "dict", "set", "tuple", "object", "type"};
+            python.literals = {"True", "False", "None", "self"};
+            python.line_comments = {"#"};
+            python.triple_quoted_strings = true;
+            languages.push_back(python);
+
+            LanguageSpec rust = make_c_family(
+                "rust",
+                {"as",   "async", "await", "break", "const", "continue", "crate", "dyn",    "else",  "enum",
+                 "extern", "fn",  "for",   "if",    "impl",  "in",       "let",   "loop",   "match", "mod",
+                 "move", "mut",   "pub",   "ref",   "return", "static",  "struct", "super", "trait", "type",
+                 "unsafe", "use", "where", "while", "macro_rules"},
+                {"i8",  "i16", "i32", "i64", "i128", "isize", "u8",  "u16",    "u32", "u64", "u128", "usize",
+                 "f32", "f64", "bool", "char", "str", "String", "Vec", "Option", "Result", "Box", "Self"},
+                {"true", "false", "self", "None", "Some", "Ok", "Err"});
+            // Single quotes are lifetimes as often as char literals.
+            rust.quotes = "\"";
+            languages.push_back(rust);
+
+            LanguageSpec go = make_c_family(
+                "go",
+                {"break", "case", "chan", "const", "continue", "default", "defer", "else", "fallthrough", "for",
+                 "func",  "go",   "goto", "if",    "import",   "interface", "map", "package", "range", "return",
+                 "select", "struct", "switch", "type", "var"},
+                {"bool", "byte", "complex64", "complex128", "error", "float32", "float64", "int", "int8", "int16",
+                 "int32", "int64", "rune", "string", "uint", "uint8", "uint16", "uint32", "uint64", "uintptr", "any"},
+                {"true", "false", "nil", "iota"});
+            go.quotes = "\"'`";
+            languages.push_back(go);
+
+            LanguageSpec java = make_c_family(
+                "java",
+                {"abstract", "assert", "break",     "case",    "catch",     "class",   "continue", "default",
+                 "do",       "else",   "enum",      "extends", "final",     "finally", "for",      "if",
+                 "implements", "import", "instanceof", "interface", "native", "new",   "package",  "private",
+                 "protected", "public", "return",   "static",  "super",     "switch",  "synchronized", "this",
+                 "throw",    "throws", "transient", "try",     "volatile",  "while",   "var",      "record"},
+                {"boolean", "byte", "char", "double", "float", "int", "long", "short", "void", "String", "Object",
+                 "Integer", "List", "Map"},
+                {"true", "false", "null"});
+            languages.push_back(java);
+
+            LanguageSpec json;
+            json.name = "json";
+            json.literals = {"true", "false", "null"};
+            json.quotes = "\"";
+            languages.push_back(json);
+
+            LanguageSpec bash;
+            bash.name = "bash";
+            bash.keywords = {"if",     "then",   "else",  "elif",  "fi",     "for",    "while", "until", "do",
+                             "done",   "case",   "esac",  "in",    "function", "return", "local", "export",
+                             "readonly", "declare", "source", "exit", "set",  "unset"};
+            bash.types = {"echo", "cd", "printf", "read", "test", "shift", "eval", "exec"};
+            bash.literals = {"true", "false"};
+            bash.line_comments = {"#"};
+            bash.hash_comment_needs_boundary = true;
+            languages.push_back(bash);
+
+            return languages;
+        }
+
+        inline const std::vector<LanguageSpec> &languages() {
+            static const std::vector<LanguageSpec> all = build_languages();
+            return all;
+        }
+
+        inline const std::map<std::string, size_t, std::less<>> &aliases() {
+            static const std::map<std::string, size_t, std::less<>> table = [] {
+                std::map<std::string, size_t, std::less<>> t;
+                const auto &all = languages();
+                for(size_t i = 0; i < all.size(); ++i) {
+                    t[all[i].name] = i;
+                }
+                auto alias = [&](const char *name, const char *target) { t[name] = t.at(target); };
+                alias("c", "cpp");
+                alias("c++", "cpp");
+                alias("cc", "cpp");
+                alias("h", "cpp");
+                alias("hpp", "cpp");
+                alias("js", "javascript");
+                alias("jsx", "javascript");
+                alias("ts", "javascript");
+                alias("tsx", "javascript");
+                alias("typescript", "javascript");
+                alias("py", "python");
+                alias("rs", "rust");
+                alias("golang", "go");
+                alias("sh", "bash");
+                alias("shell", "bash");
+                alias("zsh", "bash");
+                return t;
+            }();
+            return table;
+        }
+    } // namespace detail
+
+    inline const LanguageSpec *find_language(std::string_view name) {
+        std::string lower(name);
+        std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+
+        const auto &aliases = detail::aliases();
+        auto it = aliases.find(lower);
+        if(it == aliases.end()) {
+            return nullptr;
+        }
+        return &detail::languages()[it->second];
+    }
+
+    class Lexer {
+    public:
+        struct Token {
+            TokenKind kind;
+            std::string_view text;
+        };
+
+        static std::vector<Token> tokenize(const LanguageSpec &spec, std::string_view code) {
+            std::vector<Token> tokens;
+            size_t pos = 0;
+            size_t plain_start = 0;
+            bool at_line_start = true;
+
+            auto flush_plain = [&](size_t end) {
+                if(end > plain_start) {
+                    tokens.push_back({TokenKind::Plain, code.substr(plain_start, end - plain_start)});
+                }
+            };
+            auto emit = [&](TokenKind kind, size_t start, size_t end) {
+                flush_plain(start);
+                tokens.push_back({kind, code.substr(start, end - start)});
+                plain_start = end;
+            };
+
+            while(pos < code.size()) {
+                char c = code[pos];
+                size_t start = pos;
+
+                if(c == '\n') {
+                    at_line_start = true;
+                    ++pos;
+                    continue;
+                }
+                if(detail::is_class(c, detail::SPACE)) {
+                    ++pos;
+                    continue;
+                }
+
+                bool line_start = at_line_start;
+                at_line_start = false;
+
+                if(spec.preprocessor_lines && line_start && c == '#') {
+                    pos = line_end(code, pos);
+                    emit(TokenKind::Preprocessor, start, pos);
+                    continue;
+                }
+
+                if(starts_line_comment(spec, code, pos)) {
+                    pos = line_end(code, pos);
+                    emit(TokenKind::Comment, start, pos);
+                    continue;
+                }
+
+                if(detail::starts_with_at(code, pos, spec.block_comment_open)) {
+                    size_t close = code.find(spec.block_comment_close, pos + spec.block_comment_open.size());
+                    pos = close == std::string_view::npos ? code.size() : close + spec.block_comment_close.size();
+                    emit(TokenKind::Comment, start, pos);
+                    continue;
+                }
+
+                if(spec.quotes.find(c) != std::string_view::npos) {
+                    pos = string_end(spec, code, pos);
+                    emit(TokenKind::String, start, pos);
+                    continue;
+                }
+
+                if(detail::is_class(c, detail::DIGIT) ||
+                   (c == '.' && pos + 1 < code.size() && detail::is_class(code[pos + 1], detail::DIGIT))) {
+                    pos = number_end(code, pos);
+                    emit(TokenKind::Number, start, pos);
+                    continue;
+                }
+
+                if(detail::is_class(c, detail::IDENT_START)) {
+                    while(pos < code.size() && detail::is_class(code[pos], detail::IDENT)) {
+                        ++pos;
+                    }
+                    std::string_view word = code.substr(start, pos - start);
+                    if(spec.keywords.count(word)) {
+                        emit(TokenKind::Keyword, start, pos);
+                    } else if(spec.types.count(word)) {
+                        emit(TokenKind::Type, start, pos);
+                    } else if(spec.literals.count(word)) {
+                        emit(TokenKind::Literal, start, pos);
+                    }
+                    continue;
+                }
+
+                ++pos;
+            }
+
+            flush_plain(code.size());
+            return tokens;
+        }
+
+    private:
+        static size_t line_end(std::string_view code, size_t pos) {
+            size_t end = code.find('\n', pos);
+            return end == std::string_view::npos ? code.size() : end;
+        }
+
+        static bool starts_line_comment(const LanguageSpec &spec, std::string_view code, size_t pos) {
+            for(std::string_view prefix : spec.line_comments) {
+                if(!detail::starts_with_at(code, pos, prefix)) {
+                    continue;
+                }
+                if(spec.hash_comment_needs_boundary && pos > 0 && !detail::is_class(code[pos - 1], detail::SPACE)) {
+                    continue;
+                }
+                return true;
+            }
+            return false;
+        }
+
+        static size_t string_end(const LanguageSpec &spec, std::string_view code, size_t pos) {
+            char quote = code[pos];
+
+            if(spec.triple_quoted_strings && code.substr(pos, 3) == std::string(3, quote)) {
+                size_t close = code.find(std::string(3, quote), pos + 3);
+                return close == std::string_view::npos ? code.size() : close + 3;
+            }
+
+            // Template literals may span lines; other strings end at the newline if left unterminated.
+            bool multiline = quote == '`';
+            for(size_t i = pos + 1; i < code.size(); ++i) {
+                if(code[i] == '\\') {
+                    ++i;
+                } else if(code[i] == quote) {
+                    return i + 1;
+                } else if(code[i] == '\n' && !multiline) {
+                    return i;
+                }
+            }
+            return code.size();
+        }
+
+        static size_t number_end(std::string_view code, size_t pos) {
+            bool hex = code.substr(pos, 2) == "0x" || code.substr(pos, 2) == "0X";
+            size_t i = pos;
+            while(i < code.size()) {
+                char c = code[i];
+                if(c == '.' && i + 1 < code.size() && code[i + 1] == '.') {
+                    break; // range operator, e.g. 0..10
+                }
+                bool exponent_sign = !hex && (c == '+' || c == '-') && (code[i - 1] == 'e' || code[i - 1] == 'E');
+                if(!detail::is_class(c, detail::IDENT) && c != '.' && !exponent_sign) {
+                    break;
+                }
+                ++i;
+            }
+            return i;
+        }
+    };
+
+    class Highlighter {
+    public:
+        struct CacheStats {
+            size_t hits = 0;
+            size_t misses = 0;
+            size_t entries = 0;
+        };
+
+        // Highlighted HTML for code, or nullopt when the language is not supported. Results are cached by
+        // (language, hash of code); a hash collision is detected by comparing the stored source.
+        static std::optional<std::string> highlight(std::string_view language, std::string_view code) {
+            const LanguageSpec *spec = find_language(language);
+            if(spec == nullptr) {
+                return std::nullopt;
+            }
+
+            Cache &cache = instance();
+            CacheKey key{spec, ssg::utils::HashUtils::fnv1a(code)};
+            {
+                std::shared_lock<std::shared_mutex> lock(cache.mutex);
+                auto it = cache.entries.find(key);
+                if(it != cache.entries.end() && it->second.source == code) {
+                    cache.hits.fetch_add(1, std::memory_order_relaxed);
+                    return it->second.html;
+                }
+            }
+
+            cache.misses.fetch_add(1, std::memory_order_relaxed);
+            std::string result = render(*spec, code);
+
+            std::unique_lock<std::shared_mutex> lock(cache.mutex);
+            if(cache.bytes + code.size() + result.size() > MAX_CACHE_BYTES) {
+                cache.entries.clear();
+                cache.bytes = 0;
+            }
+            auto &entry = cache.entries[key];
+            cache.bytes += code.size() + result.size();
+            cache.bytes -= entry.source.size() + entry.html.size();
+            entry.source = code;
+            entry.html = result;
+            return result;
+        }
+
+        static std::string render(const LanguageSpec &spec, std::string_view code) {
+            std::string out;
+            out.reserve(code.size() + code.size() / 2);
+            for(const auto &token : Lexer::tokenize(spec, code)) {
+                std::string escaped = html::escape_html(std::string(token.text));
+                if(token.kind == TokenKind::Plain) {
+                    out += escaped;
+                } else {
+                    out += "<span class=\"";
+                    out += css_class(token.kind);
+                    out += "\">";
+                    out += escaped;
+                    out += "</span>";
+                }
+            }
+            return out;
+        }
+
+        static CacheStats cache_stats() {
+            Cache &cache = instance();
+            std::shared_lock<std::shared_mutex> lock(cache.mutex);
+            CacheStats stats;
+            stats.hits = cache.hits.load(std::memory_order_relaxed);
+            stats.misses = cache.misses.load(std::memory_order_relaxed);
+            stats.entries = cache.entries.size();
+            return stats;
+        }
+
+        static void clear_cache() {
+            Cache &cache = instance();
+            std::unique_lock<std::shared_mutex> lock(cache.mutex);
+            cache.entries.clear();
+            cache.bytes = 0;
+            cache.hits = 0;
+            cache.misses = 0;
+        }
+
+    private:
+        static constexpr size_t MAX_CACHE_BYTES = 32 * 1024 * 1024;
+
+        struct CacheKey {
+            const LanguageSpec *language;
+            uint64_t hash;
+
+            bool operator==(const CacheKey &other) const { return language == other.language && hash == other.hash; }
+        };
+
+        struct CacheKeyHash {
+            size_t operator()(const CacheKey &key) const {
+                return static_cast<size_t>(key.hash ^ reinterpret_cast<uintptr_t>(key.language));
+            }
+        };
+
+        struct CacheEntry {
+            std::string source;
+            std::string html;
+        };
+
+        struct Cache {
+            std::shared_mutex mutex;
+            std::unordered_map<CacheKey, CacheEntry, CacheKeyHash> entries;
+            size_t bytes = 0;
+            std::atomic<size_t> hits{0};
+            std::atomic<size_t> misses{0};
+        };
+
+        static Cache &instance() {
+            static Cache cache;
+            return cache;
+        }
+    };
+} // namespace highlight
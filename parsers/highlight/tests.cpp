@@ -0,0 +1,85 @@
+#include "../../includes/tests.hpp"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "highlight.hpp"
+
+TEST(HighlightCppTokens) {
+    std::string code = "#include <vector>\nint main() {\n    return 0; // done\n}";
+    auto result = highlight::Highlighter::highlight("cpp", code);
+    ASSERT_TRUE(result.has_value());
+    ASSERT_EQ(*result, "<span class=\"tok-preprocessor\">#include &lt;vector&gt;</span>\n"
+                       "<span class=\"tok-type\">int</span> main() {\n"
+                       "    <span class=\"tok-keyword\">return</span> <span class=\"tok-number\">0</span>; "
+                       "<span class=\"tok-comment\">// done</span>\n}");
+    std::cout << "C++ snippet highlighted:\n" << *result;
+}
+
+TEST(HighlightStringsAndEscapes) {
+    std::string code = "const s = \"a \\\"<b>\\\"\"; let t = `x\ny`;";
+    auto result = highlight::Highlighter::highlight("js", code);
+    ASSERT_TRUE(result.has_value());
+    ASSERT_TRUE(result->find("<span class=\"tok-string\">&quot;a \\&quot;&lt;b&gt;\\&quot;&quot;</span>") !=
+                std::string::npos);
+    ASSERT_TRUE(result->find("<span class=\"tok-string\">`x\ny`</span>") != std::string::npos);
+    ASSERT_TRUE(result->find("<b>") == std::string::npos);
+    std::cout << "Strings highlighted and escaped: " << *result;
+}
+
+TEST(HighlightPythonAndShell) {
+    auto python = highlight::Highlighter::highlight("python", "def f():\n    \"\"\"doc\n\"\"\" # note\n    return None");
+    ASSERT_TRUE(python.has_value());
+    ASSERT_TRUE(python->find("<span class=\"tok-string\">&quot;&quot;&quot;doc\n&quot;&quot;&quot;</span>") !=
+                std::string::npos);
+    ASSERT_TRUE(python->find("<span class=\"tok-comment\"># note</span>") != std::string::npos);
+    ASSERT_TRUE(python->find("<span class=\"tok-literal\">None</span>") != std::string::npos);
+
+    auto shell = highlight::Highlighter::highlight("sh", "echo a#b # comment");
+    ASSERT_TRUE(shell.has_value());
+    ASSERT_TRUE(shell->find("a#b <span class=\"tok-comment\"># comment</span>") != std::string::npos);
+    std::cout << "Python and shell snippets highlighted.";
+}
+
+TEST(HighlightUnknownLanguage) {
+    ASSERT_TRUE(!highlight::Highlighter::highlight("brainfuck", "+++").has_value());
+    ASSERT_TRUE(highlight::find_language("TS") == highlight::find_language("ts"));
+    ASSERT_TRUE(highlight::find_language("ts") == highlight::find_language("typescript"));
+    std::cout << "Unknown languages are left to the caller.";
+}
+
+TEST(HighlightCacheSharedAcrossThreads) {
+    highlight::Highlighter::clear_cache();
+    std::string code = "fn main() { let x: u32 = 1_000; }";
+    std::string expected = *highlight::Highlighter::highlight("rust", code);
+
+    std::vector<std::thread> threads;
+    std::vector<std::string> results(8);
+    for(size_t i = 0; i < results.size(); ++i) {
+        threads.emplace_back([&, i] { results[i] = *highlight::Highlighter::highlight("rs", code); });
+    }
+    for(auto &thread : threads) {
+        thread.join();
+    }
+
+    for(const auto &result : results) {
+        ASSERT_EQ(result, expected);
+    }
+    auto stats = highlight::Highlighter::cache_stats();
+    ASSERT_EQ(stats.misses, 1);
+    ASSERT_EQ(stats.hits, 8);
+    ASSERT_EQ(stats.entries, 1);
+    std::cout << "Cache hits: " << stats.hits << ", misses: " << stats.misses;
+}
+
+#ifdef ENABLE_TESTS
+int main() {
+    return Test::RunAllTests();
+    return 0;
+}
+#else
+int main() { return 0; }
+#endif
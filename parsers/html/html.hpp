@@ -1,6 +1,7 @@
 #pragma once
 #include <algorithm>
 #include <cctype>
+#include <initializer_list>
 #include <map>
 #include <set>
 #include <sstream>
@@ -8,24 +9,138 @@
 #include <string>
 #include <vector>
 
+#include "../../utils/intern.hpp"
+#include "../../utils/simd.hpp"
+
 namespace html {
+    using Symbol = ssg::utils::Symbol;
+
+    // Interned tag and attribute names used on hot paths, so building and serializing nodes never has to look
+    // them up in the intern table.
+    namespace names {
+        inline const Symbol class_attr = "class";
+        inline const Symbol href = "href";
+        inline const Symbol src = "src";
+        inline const Symbol alt = "alt";
+        inline const Symbol width = "width";
+        inline const Symbol height = "height";
+        inline const Symbol loading = "loading";
+        inline const Symbol decoding = "decoding";
+
+        inline const Symbol div = "div";
+        inline const Symbol p = "p";
+        inline const Symbol pre = "pre";
+        inline const Symbol code = "code";
+        inline const Symbol strong = "strong";
+        inline const Symbol em = "em";
+        inline const Symbol a = "a";
+        inline const Symbol img = "img";
+        inline const Symbol ul = "ul";
+        inline const Symbol li = "li";
+        inline const Symbol blockquote = "blockquote";
+        inline const Symbol table = "table";
+        inline const Symbol tr = "tr";
+        inline const Symbol td = "td";
+        inline const Symbol br = "br";
+        inline const Symbol hr = "hr";
+        inline const Symbol span = "span";
+        inline const Symbol headings[] = {"h1", "h2", "h3", "h4", "h5", "h6"};
+    } // namespace names
+
+    // Attribute list keyed by interned names. Elements carry only a handful of attributes, so lookups are a
+    // linear scan of pointer compares; entries are kept sorted by name so serialization order is stable.
+    class Attributes {
+    public:
+        using value_type = std::pair<Symbol, std::string>;
+        using iterator = std::vector<value_type>::iterator;
+        using const_iterator = std::vector<value_type>::const_iterator;
+
+        Attributes() = default;
+        Attributes(std::initializer_list<value_type> items) {
+            for(const auto &[key, value] : items) {
+                (*this)[key] = value;
+            }
+        }
+        Attributes(const std::map<std::string, std::string> &items) {
+            for(const auto &[key, value] : items) {
+                (*this)[key] = value;
+            }
+        }
+
+        std::string &operator[](Symbol key) {
+            auto it = find(key);
+            if(it != items_.end()) {
+                return it->second;
+            }
+            auto position = std::lower_bound(items_.begin(), items_.end(), key, [](const value_type &item, Symbol k) {
+                return Symbol::ByName()(item.first, k);
+            });
+            return items_.insert(position, value_type(key, std::string()))->second;
+        }
+
+        iterator find(Symbol key) {
+            return std::find_if(items_.begin(), items_.end(), [key](const value_type &item) { return item.first == key; });
+        }
+
+        const_iterator find(Symbol key) const {
+            return std::find_if(items_.begin(), items_.end(), [key](const value_type &item) { return item.first == key; });
+        }
+
+        const std::string &at(Symbol key) const {
+            auto it = find(key);
+            if(it == items_.end()) {
+                throw std::out_of_range("Attribute not found: " + key.str());
+            }
+            return it->second;
+        }
+
+        size_t count(Symbol key) const { return find(key) != items_.end() ? 1 : 0; }
+
+        size_t erase(Symbol key) {
+            auto it = find(key);
+            if(it == items_.end()) {
+                return 0;
+            }
+            items_.erase(it);
+            return 1;
+        }
+
+        bool empty() const { return items_.empty(); }
+        size_t size() const { return items_.size(); }
+
+        iterator begin() { return items_.begin(); }
+        iterator end() { return items_.end(); }
+        const_iterator begin() const { return items_.begin(); }
+        const_iterator end() const { return items_.end(); }
+
+    private:
+        std::vector<value_type> items_;
+    };
+
     struct Node {
-        std::string tag;
+        Symbol tag;
         std::string text;
-        std::map<std::string, std::string> attributes;
+        Attributes attributes;
         std::vector<Node> children;
 
         Node() = default;
-        explicit Node(std::string t) : tag(std::move(t)) {}
-        Node(std::string t, std::string txt) : tag(std::move(t)), text(std::move(txt)) {}
-        Node(std::string t, std::map<std::string, std::string> attrs) : tag(std::move(t)), attributes(std::move(attrs)) {}
+        explicit Node(Symbol t) : tag(t) {}
+        Node(Symbol t, std::string txt) : tag(t), text(std::move(txt)) {}
+        Node(Symbol t, Attributes attrs) : tag(t), attributes(std::move(attrs)) {}
     };
 
     static std::string escape_html(const std::string &input) {
+        static constexpr ssg::utils::simd::ByteSet special("&<>\"'");
+
         std::string result;
         result.reserve(input.size());
-        for(char c : input) {
-            switch(c) {
+        std::string_view rest(input);
+        while(!rest.empty()) {
+            size_t run = ssg::utils::simd::copy_until(rest, special, result);
+            if(run == rest.size()) {
+                break;
+            }
+            switch(rest[run]) {
             case '&':
                 result += "&amp;";
                 break;
@@ -41,10 +156,8 @@ namespace html {
             case '\'':
                 result += "&#39;";
                 break;
-            default:
-                result += c;
-                break;
             }
+            rest.remove_prefix(run + 1);
         }
         return result;
     }
@@ -86,8 +199,8 @@ namespace html {
             const std::string indent(indent_level * 2, ' ');
 
             if(!node.tag.empty()) {
-                static const std::set<std::string> self_closing_tags = {"img", "hr", "br"};
-                static const std::set<std::string> inline_tags = {"strong", "em", "a", "code", "span"};
+                static const std::set<Symbol> self_closing_tags = {names::img, names::hr, names::br};
+                static const std::set<Symbol> inline_tags = {names::strong, names::em, names::a, names::code, names::span};
                 oss << indent << "<" << node.tag;
                 for(const auto &[key, value] : node.attributes) {
                     oss << " " << key << "=\"" << html::escape_html(value) << "\"";
@@ -101,8 +214,8 @@ namespace html {
                 oss << ">";
 
                 if(!node.text.empty()) {
-                    auto class_attr = node.attributes.find("class");
-                    if(node.tag == "code" && class_attr != node.attributes.end() && !class_attr->second.empty() &&
+                    auto class_attr = node.attributes.find(names::class_attr);
+                    if(node.tag == names::code && class_attr != node.attributes.end() && !class_attr->second.empty() &&
                        class_attr->second.find("language-") == 0) {
                         oss << node.text;
                     } else {
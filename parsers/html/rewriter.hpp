@@ -0,0 +1,847 @@
+#pragma once
+#include <cctype>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../../utils/simd.hpp"
+#include "html.hpp"
+
+// Streaming HTML rewriting without a DOM. The tokenizer slices the input into tags, text and comments as
+// string_views; the rewriter runs selector-matched handlers on them and writes every token nobody touched
+// straight through as part of one contiguous slice, so untouched markup costs about a memcpy.
+namespace html {
+    namespace detail {
+        inline bool is_space(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f'; }
+
+        inline bool iequals(std::string_view a, std::string_view b) {
+            if(a.size() != b.size()) {
+                return false;
+            }
+            for(size_t i = 0; i < a.size(); ++i) {
+                if(std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        inline bool is_void_element(std::string_view tag) {
+            static constexpr std::string_view void_elements[] = {"area", "base", "br",   "col",   "embed",  "hr",  "img",
+                                                                 "input", "link", "meta", "param", "source", "track", "wbr"};
+            for(auto name : void_elements) {
+                if(iequals(tag, name)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Elements whose content is not markup: everything up to the matching end tag is one text token.
+        inline bool is_raw_text_element(std::string_view tag) {
+            return iequals(tag, "script") || iequals(tag, "style") || iequals(tag, "textarea");
+        }
+    } // namespace detail
+
+    struct Token {
+        enum class Kind { Text, StartTag, EndTag, Comment, Doctype };
+
+        Kind kind = Kind::Text;
+        std::string_view raw;
+        std::string_view name;       // tags only, as written
+        std::string_view attributes; // start tags only: everything between the name and the closing '>' or '/>'
+        bool self_closing = false;
+        bool raw_text = false; // text inside script, style or textarea
+    };
+
+    class Tokenizer {
+    public:
+        explicit Tokenizer(std::string_view input) : input_(input) {}
+
+        bool next(Token &token) {
+            if(pos_ >= input_.size()) {
+                return false;
+            }
+            token = Token{};
+
+            if(!raw_text_tag_.empty()) {
+                size_t end = find_raw_text_end();
+                raw_text_tag_ = {};
+                if(end > pos_) {
+                    token.raw_text = true;
+                    return text(token, pos_, end);
+                }
+            }
+
+            size_t start = pos_;
+            if(input_[pos_] != '<') {
+                return text(token, start, next_lt(pos_));
+            }
+
+            std::string_view rest = input_.substr(pos_);
+            if(rest.starts_with("<!--")) {
+                size_t end = input_.find("-->", pos_ + 4);
+                end = end == std::string_view::npos ? input_.size() : end + 3;
+                return emit(token, Token::Kind::Comment, start, end);
+            }
+            if(rest.starts_with("<!") || rest.starts_with("<?")) {
+                size_t end = input_.find('>', pos_);
+                end = end == std::string_view::npos ? input_.size() : end + 1;
+                return emit(token, Token::Kind::Doctype, start, end);
+            }
+
+            bool closing = rest.size() > 1 && rest[1] == '/';
+            size_t name_start = pos_ + (closing ? 2 : 1);
+            if(name_start >= input_.size() || !std::isalpha(static_cast<unsigned char>(input_[name_start]))) {
+                // A stray '<' is text.
+                return text(token, start, next_lt(pos_ + 1));
+            }
+
+            size_t name_end = name_start;
+            while(name_end < input_.size() && !detail::is_space(input_[name_end]) && input_[name_end] != '>' &&
+                  input_[name_end] != '/') {
+                ++name_end;
+            }
+            token.name = input_.substr(name_start, name_end - name_start);
+
+            size_t end = tag_end(name_end);
+            if(closing) {
+                return emit(token, Token::Kind::EndTag, start, end);
+            }
+
+            size_t attributes_end = end;
+            if(attributes_end > name_end && input_[attributes_end - 1] == '>') {
+                --attributes_end;
+            }
+            if(attributes_end > name_end && input_[attributes_end - 1] == '/') {
+                --attributes_end;
+                token.self_closing = true;
+            }
+            token.attributes = input_.substr(name_end, attributes_end - name_end);
+            if(!token.self_closing && detail::is_raw_text_element(token.name)) {
+                raw_text_tag_ = token.name;
+            }
+            return emit(token, Token::Kind::StartTag, start, end);
+        }
+
+        size_t position() const { return pos_; }
+
+    private:
+        std::string_view input_;
+        size_t pos_ = 0;
+        std::string_view raw_text_tag_;
+
+        size_t next_lt(size_t from) const {
+            static constexpr ssg::utils::simd::ByteSet lt("<");
+            return from + ssg::utils::simd::find_first_of(input_.substr(std::min(from, input_.size())), lt);
+        }
+
+        bool text(Token &token, size_t start, size_t end) { return emit(token, Token::Kind::Text, start, end); }
+
+        bool emit(Token &token, Token::Kind kind, size_t start, size_t end) {
+            token.kind = kind;
+            token.raw = input_.substr(start, end - start);
+            pos_ = end;
+            return true;
+        }
+
+        // Index just past the '>' closing the tag, skipping quoted attribute values.
+        size_t tag_end(size_t from) const {
+            char quote = 0;
+            for(size_t i = from; i < input_.size(); ++i) {
+                char c = input_[i];
+                if(quote != 0) {
+                    if(c == quote) {
+                        quote = 0;
+                    }
+                } else if(c == '"' || c == '\'') {
+                    quote = c;
+                } else if(c == '>') {
+                    return i + 1;
+                }
+            }
+            return input_.size();
+        }
+
+        size_t find_raw_text_end() const {
+            size_t search = pos_;
+            while(true) {
+                size_t candidate = input_.find("</", search);
+                if(candidate == std::string_view::npos) {
+                    return input_.size();
+                }
+                size_t after = candidate + 2 + raw_text_tag_.size();
+                if(after <= input_.size() &&
+                   detail::iequals(input_.substr(candidate + 2, raw_text_tag_.size()), raw_text_tag_) &&
+                   (after == input_.size() || detail::is_space(input_[after]) || input_[after] == '>' ||
+                    input_[after] == '/')) {
+                    return candidate;
+                }
+                search = candidate + 2;
+            }
+        }
+    };
+
+    struct TagAttribute {
+        std::string_view name;
+        std::string_view value; // as written, entities not decoded
+        std::string_view raw;   // name through closing quote
+        bool has_value = false;
+    };
+
+    inline std::vector<TagAttribute> parse_tag_attributes(std::string_view text) {
+        std::vector<TagAttribute> attributes;
+        size_t i = 0;
+        while(i < text.size()) {
+            while(i < text.size() && (detail::is_space(text[i]) || text[i] == '/')) {
+                ++i;
+            }
+            if(i >= text.size()) {
+                break;
+            }
+
+            TagAttribute attribute;
+            size_t start = i;
+            while(i < text.size() && !detail::is_space(text[i]) && text[i] != '=' && text[i] != '/') {
+                ++i;
+            }
+            attribute.name = text.substr(start, i - start);
+
+            size_t after_name = i;
+            while(i < text.size() && detail::is_space(text[i])) {
+                ++i;
+            }
+            if(i < text.size() && text[i] == '=') {
+                ++i;
+                while(i < text.size() && detail::is_space(text[i])) {
+                    ++i;
+                }
+                attribute.has_value = true;
+                if(i < text.size() && (text[i] == '"' || text[i] == '\'')) {
+                    char quote = text[i];
+                    size_t close = text.find(quote, i + 1);
+                    close = close == std::string_view::npos ? text.size() : close;
+                    attribute.value = text.substr(i + 1, close - i - 1);
+                    i = std::min(close + 1, text.size());
+                } else {
+                    size_t value_start = i;
+                    while(i < text.size() && !detail::is_space(text[i])) {
+                        ++i;
+                    }
+                    attribute.value = text.substr(value_start, i - value_start);
+                }
+            } else {
+                i = after_name;
+            }
+            attribute.raw = text.substr(start, i - start);
+            attributes.push_back(attribute);
+        }
+        return attributes;
+    }
+
+    // A compound selector list: "a", "img.hero", "#main", "[href^=http]", "a[target=_blank], area". Supports type,
+    // universal, class, id and attribute selectors with =, ~=, ^=, $= and *=. Combinators need an element
+    // stack and are not supported.
+    class Selector {
+    public:
+        explicit Selector(std::string_view text) {
+            size_t start = 0;
+            while(start <= text.size()) {
+                size_t comma = text.find(',', start);
+                std::string_view part = text.substr(start, comma == std::string_view::npos ? std::string_view::npos
+                                                                                          : comma - start);
+                compounds_.push_back(parse_compound(trim(part), text));
+                if(comma == std::string_view::npos) {
+                    break;
+                }
+                start = comma + 1;
+            }
+        }
+
+        // Only looks at attributes when the tag name already matches.
+        template <typename AttributeLookup> bool matches(std::string_view tag, AttributeLookup &&attribute) const {
+            for(const auto &compound : compounds_) {
+                if(matches(compound, tag, attribute)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    private:
+        struct Condition {
+            enum class Op { Exists, Equals, Includes, Prefix, Suffix, Contains };
+
+            std::string name;
+            std::string value;
+            Op op = Op::Exists;
+        };
+
+        struct Compound {
+            std::string tag; // empty matches any element
+            std::vector<Condition> conditions;
+        };
+
+        std::vector<Compound> compounds_;
+
+        static std::string_view trim(std::string_view text) {
+            while(!text.empty() && detail::is_space(text.front())) {
+                text.remove_prefix(1);
+            }
+            while(!text.empty() && detail::is_space(text.back())) {
+                text.remove_suffix(1);
+            }
+            return text;
+        }
+
+        static bool is_name_char(char c) {
+            return std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_' || c == ':';
+        }
+
+        static Compound parse_compound(std::string_view text, std::string_view full) {
+            auto fail = [&full]() { return std::invalid_argument("Unsupported selector: " + std::string(full)); };
+            if(text.empty()) {
+                throw fail();
+            }
+
+            Compound compound;
+            size_t i = 0;
+            if(text[0] == '*') {
+                ++i;
+            } else {
+                while(i < text.size() && is_name_char(text[i])) {
+                    compound.tag += static_cast<char>(std::tolower(static_cast<unsigned char>(text[i])));
+                    ++i;
+                }
+            }
+
+            while(i < text.size()) {
+                char kind = text[i++];
+                size_t start = i;
+                while(i < text.size() && is_name_char(text[i])) {
+                    ++i;
+                }
+                std::string name(text.substr(start, i - start));
+
+                if(kind == '.' && !name.empty()) {
+                    compound.conditions.push_back({"class", name, Condition::Op::Includes});
+                } else if(kind == '#' && !name.empty()) {
+                    compound.conditions.push_back({"id", name, Condition::Op::Equals});
+                } else if(kind == '[' && !name.empty()) {
+                    Condition condition{name, "", Condition::Op::Exists};
+                    if(i < text.size() && text[i] != ']') {
+                        static constexpr std::string_view ops = "~^$*";
+                        size_t op_index = ops.find(text[i]);
+                        if(op_index != std::string_view::npos) {
+                            condition.op = static_cast<Condition::Op>(static_cast<int>(Condition::Op::Includes) + op_index);
+                            ++i;
+                        } else {
+                            condition.op = Condition::Op::Equals;
+                        }
+                        if(i >= text.size() || text[i] != '=') {
+                            throw fail();
+                        }
+                        size_t close = text.find(']', ++i);
+                        if(close == std::string_view::npos) {
+                            throw fail();
+                        }
+                        std::string_view value = text.substr(i, close - i);
+                        if(value.size() >= 2 && (value.front() == '"' || value.front() == '\'') &&
+                           value.back() == value.front()) {
+                            value = value.substr(1, value.size() - 2);
+                        }
+                        condition.value = value;
+                        i = close;
+                    }
+                    if(i >= text.size() || text[i] != ']') {
+                        throw fail();
+                    }
+                    ++i;
+                    compound.conditions.push_back(condition);
+                } else {
+                    throw fail();
+                }
+            }
+            return compound;
+        }
+
+        template <typename AttributeLookup>
+        static bool matches(const Compound &compound, std::string_view tag, AttributeLookup &attribute) {
+            if(!compound.tag.empty() && !detail::iequals(compound.tag, tag)) {
+                return false;
+            }
+            for(const auto &condition : compound.conditions) {
+                std::optional<std::string_view> value = attribute(condition.name);
+                if(!value) {
+                    return false;
+                }
+                switch(condition.op) {
+                case Condition::Op::Exists:
+                    break;
+                case Condition::Op::Equals:
+                    if(*value != condition.value) {
+                        return false;
+                    }
+                    break;
+                case Condition::Op::Includes: {
+                    bool found = false;
+                    size_t i = 0;
+                    while(i < value->size() && !found) {
+                        while(i < value->size() && detail::is_space((*value)[i])) {
+                            ++i;
+                        }
+                        size_t start = i;
+                        while(i < value->size() && !detail::is_space((*value)[i])) {
+                            ++i;
+                        }
+                        found = i > start && value->substr(start, i - start) == condition.value;
+                    }
+                    if(!found) {
+                        return false;
+                    }
+                    break;
+                }
+                case Condition::Op::Prefix:
+                    if(condition.value.empty() || !value->starts_with(condition.value)) {
+                        return false;
+                    }
+                    break;
+                case Condition::Op::Suffix:
+                    if(condition.value.empty() || !value->ends_with(condition.value)) {
+                        return false;
+                    }
+                    break;
+                case Condition::Op::Contains:
+                    if(condition.value.empty() || value->find(condition.value) == std::string_view::npos) {
+                        return false;
+                    }
+                    break;
+                }
+            }
+            return true;
+        }
+    };
+
+    // A start tag handed to an element handler. Reads see the attributes as written; edits are collected and
+    // only cause the tag to be re-serialized if there are any.
+    class Element {
+    public:
+        std::string_view tag() const { return token_.name; }
+        bool is_void() const { return token_.self_closing || detail::is_void_element(token_.name); }
+
+        std::optional<std::string_view> get_attribute(std::string_view name) const {
+            for(const auto &attribute : attributes()) {
+                if(!attribute.removed && detail::iequals(attribute.parsed.name, name)) {
+                    return attribute.replacement ? std::string_view(*attribute.replacement) : attribute.parsed.value;
+                }
+            }
+            for(const auto &[added_name, value] : added_) {
+                if(added_name == name) {
+                    return std::string_view(value);
+                }
+            }
+            return std::nullopt;
+        }
+
+        bool has_attribute(std::string_view name) const { return get_attribute(name).has_value(); }
+
+        // value is plain text; it is escaped on output.
+        void set_attribute(std::string_view name, std::string value) {
+            modified_ = true;
+            for(auto &attribute : attributes()) {
+                if(!attribute.removed && detail::iequals(attribute.parsed.name, name)) {
+                    attribute.replacement = std::move(value);
+                    return;
+                }
+            }
+            for(auto &[added_name, added_value] : added_) {
+                if(added_name == name) {
+                    added_value = std::move(value);
+                    return;
+                }
+            }
+            added_.emplace_back(std::string(name), std::move(value));
+        }
+
+        void remove_attribute(std::string_view name) {
+            for(auto &attribute : attributes()) {
+                if(detail::iequals(attribute.parsed.name, name)) {
+                    attribute.removed = true;
+                    modified_ = true;
+                }
+            }
+            std::erase_if(added_, [name](const auto &added) { return added.first == name; });
+        }
+
+        // Markup inserted verbatim around the element, or just inside it. prepend/append do nothing for void
+        // elements.
+        void before(std::string_view markup) { before_ += markup; }
+        void after(std::string_view markup) { after_.insert(0, markup); }
+        void prepend(std::string_view markup) { prepend_ += markup; }
+        void append(std::string_view markup) { append_.insert(0, markup); }
+
+        // Drops the element and everything inside it; before/after content is still written.
+        void remove() { removed_ = true; }
+
+    private:
+        friend class Rewriter;
+
+        struct ParsedAttribute {
+            TagAttribute parsed;
+            std::optional<std::string> replacement;
+            bool removed = false;
+        };
+
+        const Token &token_;
+        mutable std::optional<std::vector<ParsedAttribute>> attributes_;
+        std::vector<std::pair<std::string, std::string>> added_;
+        std::string before_, after_, prepend_, append_;
+        bool modified_ = false;
+        bool removed_ = false;
+
+        explicit Element(const Token &token) : token_(token) {}
+
+        std::vector<ParsedAttribute> &attributes() const {
+            if(!attributes_) {
+                attributes_.emplace();
+                for(const auto &attribute : parse_tag_attributes(token_.attributes)) {
+                    attributes_->push_back({attribute, std::nullopt, false});
+                }
+            }
+            return *attributes_;
+        }
+
+        void serialize_tag(std::string &out) const {
+            out += '<';
+            out += token_.name;
+            for(const auto &attribute : attributes()) {
+                if(attribute.removed) {
+                    continue;
+                }
+                out += ' ';
+                if(attribute.replacement) {
+                    out += attribute.parsed.name;
+                    out += "=\"" + escape_html(*attribute.replacement) + "\"";
+                } else {
+                    out += attribute.parsed.raw;
+                }
+            }
+            for(const auto &[name, value] : added_) {
+                out += ' ' + name + "=\"" + escape_html(value) + "\"";
+            }
+            out += token_.self_closing ? " />" : ">";
+        }
+    };
+
+    // A run of text between tags. In preformatted context (pre, textarea, script, style) whitespace matters.
+    class TextChunk {
+    public:
+        std::string_view text() const { return text_; }
+        bool preformatted() const { return preformatted_; }
+
+        // markup is written verbatim.
+        void replace(std::string markup) { replacement_ = std::move(markup); }
+        void remove() { replacement_ = std::string(); }
+
+    private:
+        friend class Rewriter;
+
+        std::string_view text_;
+        bool preformatted_;
+        std::optional<std::string> replacement_;
+
+        TextChunk(std::string_view text, bool preformatted) : text_(text), preformatted_(preformatted) {}
+    };
+
+    class Comment {
+    public:
+        std::string_view text() const { return text_; }
+        void remove() { removed_ = true; }
+
+    private:
+        friend class Rewriter;
+
+        std::string_view text_;
+        bool removed_ = false;
+
+        explicit Comment(std::string_view text) : text_(text) {}
+    };
+
+    class Rewriter {
+    public:
+        using Sink = std::function<void(std::string_view)>;
+        using ElementHandler = std::function<void(Element &)>;
+        using TextHandler = std::function<void(TextChunk &)>;
+        using CommentHandler = std::function<void(Comment &)>;
+
+        Rewriter &on(std::string_view selector, ElementHandler handler) {
+            element_handlers_.push_back({Selector(selector), std::move(handler)});
+            return *this;
+        }
+
+        Rewriter &on_text(TextHandler handler) {
+            text_handlers_.push_back(std::move(handler));
+            return *this;
+        }
+
+        Rewriter &on_comment(CommentHandler handler) {
+            comment_handlers_.push_back(std::move(handler));
+            return *this;
+        }
+
+        std::string rewrite(std::string_view input) const {
+            std::string out;
+            out.reserve(input.size() + input.size() / 16);
+            rewrite(input, [&out](std::string_view chunk) { out.append(chunk); });
+            return out;
+        }
+
+        // sink receives untouched input as the largest slices possible, interleaved with rewritten tokens.
+        void rewrite(std::string_view input, const Sink &sink) const {
+            Tokenizer tokenizer(input);
+            Token token;
+            size_t flushed = 0;
+            size_t token_start = 0;
+            size_t preformatted_depth = 0;
+            std::vector<OpenElement> open;
+            std::string scratch;
+
+            auto replace_token = [&](std::string_view replacement) {
+                if(token_start > flushed) {
+                    sink(input.substr(flushed, token_start - flushed));
+                }
+                if(!replacement.empty()) {
+                    sink(replacement);
+                }
+                flushed = tokenizer.position();
+            };
+
+            for(token_start = 0; tokenizer.next(token); token_start = tokenizer.position()) {
+                // While an element is being removed, only its nesting depth matters.
+                if(!open.empty() && open.back().removing) {
+                    OpenElement &removed = open.back();
+                    if(token.kind == Token::Kind::StartTag && !token.self_closing &&
+                       detail::iequals(token.name, removed.tag) && !detail::is_void_element(token.name)) {
+                        ++removed.depth;
+                    } else if(token.kind == Token::Kind::EndTag && detail::iequals(token.name, removed.tag) &&
+                              removed.depth-- == 0) {
+                        replace_token(removed.after);
+                        open.pop_back();
+                        continue;
+                    }
+                    replace_token({});
+                    continue;
+                }
+
+                switch(token.kind) {
+                case Token::Kind::StartTag: {
+                    bool preformatted = is_preformatted_element(token.name) && !token.self_closing;
+                    for(auto &element : open) {
+                        if(detail::iequals(element.tag, token.name)) {
+                            ++element.depth;
+                        }
+                    }
+                    if(preformatted) {
+                        ++preformatted_depth;
+                    }
+
+                    if(element_handlers_.empty()) {
+                        break;
+                    }
+
+                    Element element(token);
+                    auto lookup = [&element](std::string_view name) { return element.get_attribute(name); };
+                    bool matched = false;
+                    for(const auto &handler : element_handlers_) {
+                        if(handler.selector.matches(token.name, lookup)) {
+                            handler.callback(element);
+                            matched = true;
+                        }
+                    }
+                    if(!matched) {
+                        break;
+                    }
+
+                    bool is_void = element.is_void();
+                    bool needs_end = !is_void && (!element.append_.empty() || !element.after_.empty() || element.removed_);
+                    if(!element.modified_ && element.before_.empty() && element.prepend_.empty() && !needs_end &&
+                       element.after_.empty()) {
+                        break;
+                    }
+
+                    scratch = element.before_;
+                    if(element.removed_) {
+                        if(is_void) {
+                            scratch += element.after_;
+                        } else {
+                            open.push_back({token.name, 0, std::string(), element.after_, true});
+                            if(preformatted) {
+                                --preformatted_depth;
+                            }
+                        }
+                        replace_token(scratch);
+                        break;
+                    }
+
+                    if(element.modified_) {
+                        element.serialize_tag(scratch);
+                    } else {
+                        scratch += token.raw;
+                    }
+                    if(is_void) {
+                        scratch += element.after_;
+                    } else {
+                        scratch += element.prepend_;
+                        if(needs_end) {
+                            open.push_back({token.name, 0, element.append_, element.after_, false});
+                        }
+                    }
+                    replace_token(scratch);
+                    break;
+                }
+
+                case Token::Kind::EndTag: {
+                    if(is_preformatted_element(token.name) && preformatted_depth > 0) {
+                        --preformatted_depth;
+                    }
+                    // Closes the pending element with this name whose nesting depth has unwound, if any; the ones
+                    // further out just lose a level.
+                    std::optional<size_t> closed;
+                    for(size_t i = 0; i < open.size(); ++i) {
+                        if(!detail::iequals(open[i].tag, token.name)) {
+                            continue;
+                        }
+                        if(open[i].depth > 0) {
+                            --open[i].depth;
+                        } else {
+                            closed = i;
+                        }
+                    }
+                    if(closed) {
+                        OpenElement &element = open[*closed];
+                        scratch = element.append;
+                        scratch += token.raw;
+                        scratch += element.after;
+                        open.erase(open.begin() + static_cast<std::ptrdiff_t>(*closed));
+                        replace_token(scratch);
+                    }
+                    break;
+                }
+
+                case Token::Kind::Text: {
+                    if(text_handlers_.empty()) {
+                        break;
+                    }
+                    TextChunk chunk(token.raw, token.raw_text || preformatted_depth > 0);
+                    for(const auto &handler : text_handlers_) {
+                        handler(chunk);
+                        if(chunk.replacement_) {
+                            break;
+                        }
+                    }
+                    if(chunk.replacement_) {
+                        replace_token(*chunk.replacement_);
+                    }
+                    break;
+                }
+
+                case Token::Kind::Comment: {
+                    Comment comment(token.raw);
+                    for(const auto &handler : comment_handlers_) {
+                        handler(comment);
+                    }
+                    if(comment.removed_) {
+                        replace_token({});
+                    }
+                    break;
+                }
+
+                case Token::Kind::Doctype:
+                    break;
+                }
+            }
+
+            if(flushed < input.size()) {
+                sink(input.substr(flushed));
+            }
+            // Unclosed elements still get their trailing content.
+            for(size_t i = open.size(); i-- > 0;) {
+                if(!open[i].removing) {
+                    sink(open[i].append);
+                }
+                sink(open[i].after);
+            }
+        }
+
+    private:
+        struct ElementHandlerEntry {
+            Selector selector;
+            ElementHandler callback;
+        };
+
+        // An element whose end tag needs appended content, or whose content is being dropped.
+        struct OpenElement {
+            std::string_view tag;
+            size_t depth;
+            std::string append;
+            std::string after;
+            bool removing;
+        };
+
+        std::vector<ElementHandlerEntry> element_handlers_;
+        std::vector<TextHandler> text_handlers_;
+        std::vector<CommentHandler> comment_handlers_;
+
+        static bool is_preformatted_element(std::string_view tag) {
+            return detail::iequals(tag, "pre") || detail::iequals(tag, "textarea") || detail::iequals(tag, "script") ||
+                   detail::iequals(tag, "style");
+        }
+    };
+
+    // Collapses whitespace runs in text to one space (outside pre, textarea, script and style) and drops comments
+    // other than conditional ones, in a single streaming pass.
+    inline std::string minify(std::string_view input) {
+        static const Rewriter minifier = [] {
+            Rewriter rewriter;
+            rewriter.on_text([](TextChunk &chunk) {
+                if(chunk.preformatted()) {
+                    return;
+                }
+                std::string_view text = chunk.text();
+                bool collapsible = false;
+                for(size_t i = 0; i < text.size() && !collapsible; ++i) {
+                    collapsible = detail::is_space(text[i]) &&
+                                  (text[i] != ' ' || (i + 1 < text.size() && detail::is_space(text[i + 1])));
+                }
+                if(!collapsible) {
+                    return;
+                }
+                std::string collapsed;
+                collapsed.reserve(text.size());
+                bool in_space = false;
+                for(char c : text) {
+                    if(detail::is_space(c)) {
+                        if(!in_space) {
+                            collapsed += ' ';
+                        }
+                        in_space = true;
+                    } else {
+                        collapsed += c;
+                        in_space = false;
+                    }
+                }
+                chunk.replace(std::move(collapsed));
+            });
+            rewriter.on_comment([](Comment &comment) {
+                if(!comment.text().starts_with("<!--[if")) {
+                    comment.remove();
+                }
+            });
+            return rewriter;
+        }();
+        return minifier.rewrite(input);
+    }
+} // namespace html
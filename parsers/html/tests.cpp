@@ -3,8 +3,10 @@
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "html.hpp"
+#include "rewriter.hpp"
 
 TEST(ParsingSimpleTag) {
     std::string html_input = "<div>Hello World</div>";
@@ -109,6 +111,33 @@ TEST(SerializationWithEscapedCharacters) {
     }
 }
 
+TEST(InternedNamesShareStorage) {
+    html::Node first = html::Deserializer::deserialize(R"(<a href="/one" class="link">One</a>)");
+    html::Node second = html::Deserializer::deserialize(R"(<A HREF="/two">Two</A>)");
+
+    ASSERT_TRUE(first.tag == second.tag);
+    ASSERT_TRUE(first.tag.str().data() == second.tag.str().data());
+    ASSERT_TRUE(first.attributes.begin()->first == html::names::class_attr);
+    ASSERT_EQ(first.attributes.at(html::names::href), "/one");
+    ASSERT_EQ(second.attributes.at("href"), "/two");
+    ASSERT_EQ(html::Serializer::serialize(first), R"(<a class="link" href="/one">One</a>)");
+    std::cout << "Tags and attribute names are interned: " << first.tag << " (id " << first.tag.id() << ")";
+}
+
+TEST(EscapingLongText) {
+    // Long enough to cross several vector blocks, with specials at block edges and in the scalar tail.
+    std::string plain(40, 'a');
+    std::string input = plain + "<" + std::string(15, 'b') + "&" + std::string(31, 'c') + "\"'" + "tail>";
+    std::string expected = plain + "&lt;" + std::string(15, 'b') + "&amp;" + std::string(31, 'c') + "&quot;&#39;" +
+                           "tail&gt;";
+
+    ASSERT_EQ(html::escape_html(input), expected);
+    ASSERT_EQ(html::escape_html(plain), plain);
+    ASSERT_EQ(html::escape_html(""), "");
+    std::cout << "Long text escaped with " << ssg::utils::simd::level_name(ssg::utils::simd::active_level())
+              << " kernel";
+}
+
 TEST(ParsingSelfClosingTag) {
     std::string html_input = R"(<img src="image.png" alt="An image" />)";
     try {
@@ -138,6 +167,97 @@ TEST(ParsingInvalidHTML) {
     ASSERT_TRUE(exception_caught);
 }
 
+TEST(RewriterPassesThroughUntouchedInput) {
+    std::string page = "<!DOCTYPE html>\n<html><head><script>if(a<b){x='</div>';}</script></head>"
+                       "<body class=\"x\"><p>Hi &amp; <b>bye</b></p><!-- note --><img src=a.png></body></html>";
+    html::Rewriter rewriter;
+    rewriter.on("div", [](html::Element &element) { element.remove(); });
+
+    size_t chunks = 0;
+    std::string out;
+    rewriter.rewrite(page, [&](std::string_view chunk) {
+        out.append(chunk);
+        ++chunks;
+    });
+    ASSERT_EQ(out, page);
+    ASSERT_EQ(chunks, size_t(1));
+}
+
+TEST(RewriterEditsAttributes) {
+    html::Rewriter rewriter;
+    rewriter.on("a[href^=http]", [](html::Element &element) {
+        element.set_attribute("rel", "noopener");
+        element.set_attribute("title", "\"quoted\"");
+    });
+    rewriter.on("img", [](html::Element &element) { element.remove_attribute("style"); });
+
+    std::string out = rewriter.rewrite("<a href=\"https://x.org\" title=old>x</a> <a href=/local>y</a>"
+                                       "<img style='a' src=\"i.png\" />");
+    ASSERT_EQ(out, "<a href=\"https://x.org\" title=\"&quot;quoted&quot;\" rel=\"noopener\">x</a> <a href=/local>y</a>"
+                   "<img src=\"i.png\" />");
+}
+
+TEST(RewriterMatchesCompoundSelectors) {
+    html::Rewriter rewriter;
+    std::vector<std::string> matched;
+    rewriter.on("p.note, #main, [data-x=\"1\"]", [&](html::Element &element) { matched.emplace_back(element.tag()); });
+    rewriter.rewrite("<p class=\"a note\">1</p><p class=notes>2</p><div id=main></div><span data-x=1></span>");
+    ASSERT_EQ(matched.size(), size_t(3));
+    ASSERT_EQ(matched[0], "p");
+    ASSERT_EQ(matched[1], "div");
+    ASSERT_EQ(matched[2], "span");
+
+    bool threw = false;
+    try {
+        html::Selector selector("div > p");
+    } catch(const std::invalid_argument &) {
+        threw = true;
+    }
+    ASSERT_TRUE(threw);
+}
+
+TEST(RewriterInsertsContent) {
+    html::Rewriter rewriter;
+    rewriter.on("h2", [](html::Element &element) {
+        element.before("<hr>");
+        element.prepend("# ");
+        element.append(" ¶");
+        element.after("\n");
+    });
+    rewriter.on("br", [](html::Element &element) { element.after("<!--br-->"); });
+    std::string out = rewriter.rewrite("<h2>One<h2>Inner</h2></h2><br>");
+    ASSERT_EQ(out, "<hr><h2># One<hr><h2># Inner ¶</h2>\n ¶</h2>\n<br><!--br-->");
+}
+
+TEST(RewriterRemovesNestedElements) {
+    html::Rewriter rewriter;
+    rewriter.on("div.ad", [](html::Element &element) {
+        element.remove();
+        element.after("[removed]");
+    });
+    std::string out = rewriter.rewrite("<main><div class=ad><div>x</div><p>y</p></div><div>kept</div></main>");
+    ASSERT_EQ(out, "<main>[removed]<div>kept</div></main>");
+}
+
+TEST(RewriterTreatsScriptAsRawText) {
+    html::Rewriter rewriter;
+    size_t elements = 0;
+    std::vector<bool> preformatted;
+    rewriter.on("*", [&](html::Element &) { ++elements; });
+    rewriter.on_text([&](html::TextChunk &chunk) { preformatted.push_back(chunk.preformatted()); });
+    rewriter.rewrite("<SCRIPT>var s = '<b>x</b>';</script ><p>t</p>");
+    ASSERT_EQ(elements, size_t(2));
+    ASSERT_EQ(preformatted.size(), size_t(2));
+    ASSERT_TRUE(preformatted[0]);
+    ASSERT_TRUE(!preformatted[1]);
+}
+
+TEST(MinifyCollapsesWhitespaceOutsidePre) {
+    std::string page = "<div>\n    <p>a   b</p>\n<!-- gone --><!--[if IE]>kept<![endif]-->\n"
+                       "<pre>  keep\n   this</pre>\n</div>";
+    ASSERT_EQ(html::minify(page), "<div> <p>a b</p> <!--[if IE]>kept<![endif]--> <pre>  keep\n   this</pre> </div>");
+}
+
 #ifdef ENABLE_TESTS
 int main() {
     return Test::RunAllTests();
@@ -5,6 +5,8 @@
 #include <variant>
 #include <vector>
 
+#include "../../utils/simd.hpp"
+
 namespace json {
 
     class Value {
@@ -231,9 +233,12 @@ namespace json {
             if(get() != '"') {
                 throw std::runtime_error("Expected '\"' at start of string");
             }
+            static constexpr ssg::utils::simd::ByteSet special("\"\\");
+
             std::string result;
             result.reserve(32);
             while(true) {
+                _pos += ssg::utils::simd::copy_until(std::string_view(_input).substr(_pos), special, result);
                 char ch = get();
                 if(ch == '"') {
                     break;
@@ -32,6 +32,20 @@ TEST(ParsingString) {
     }
 }
 
+TEST(ParsingLongString) {
+    std::string body(70, 'x');
+    std::string json_str = "\"" + body + "\\\"" + body + "\\n\"";
+    try {
+        json::Value val = json::Parser::deserialize(json_str);
+        ASSERT_TRUE(val.is_string());
+        ASSERT_EQ(val.get_string(), body + "\"" + body + "\n");
+        std::cout << "Long string parsed successfully (" << val.get_string().size() << " bytes)";
+    } catch(const std::exception &e) {
+        std::cerr << "Exception during parsing: " << e.what() << std::endl;
+        ASSERT_TRUE(false);
+    }
+}
+
 TEST(ParsingArray) {
     std::string json_array = R"(  [null, true, 123, "text", [1, 2], {"key": "value"}]  )";
     try {
@@ -1,14 +1,26 @@
 #pragma once
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <condition_variable>
+#include <exception>
+#include <functional>
 #include <iostream>
+#include <iterator>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <regex>
+#include <span>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "../../utils/thread_pool.hpp"
+#include "../highlight/highlight.hpp"
 #include "../html/html.hpp"
 
 namespace markdown {
@@ -79,7 +91,7 @@ namespace markdown {
     struct Node {
         NodeType type;
         std::string text;
-        std::map<std::string, std::string> attributes;
+        html::Attributes attributes;
         std::vector<Node> children;
         int level = 0;
 
@@ -89,6 +101,105 @@ namespace markdown {
         Node(NodeType t, const std::string &txt, int lvl) : type(t), text(txt), level(lvl) {}
     };
 
+    struct ImageSize {
+        int width = 0;
+        int height = 0;
+    };
+
+    // Elements the HTML renderer gives a presentational class attribute.
+    enum class ElementClass {
+        Heading,
+        Paragraph,
+        CodeBlock,
+        InlineCode,
+        Bold,
+        Italic,
+        Link,
+        Image,
+        List,
+        ListItem,
+        Quote,
+        Table,
+        TableRow,
+        TableCell,
+        LineBreak,
+        HorizontalRule,
+        Count
+    };
+
+    // Class profiles are types, so the renderer is compiled once per profile instead of testing it on every node.
+    // `name()` gives the class for an element (empty leaves the attribute off); `enabled = false` drops the code.
+    struct ClassicClasses {
+        static constexpr bool enabled = true;
+        static constexpr std::string_view NAMES[] = {
+            "heading-primary", "paragraph", "code-block", "inline-code", "bold", "italic", "link", "image", "list",
+            "list-item", "quote", "table", "table-row", "table-cell", "line-break", "horizontal-rule",
+        };
+        static_assert(std::size(NAMES) == static_cast<size_t>(ElementClass::Count));
+
+        std::string_view name(ElementClass element) const { return NAMES[static_cast<size_t>(element)]; }
+    };
+
+    struct CompactClasses {
+        static constexpr bool enabled = false;
+
+        std::string_view name(ElementClass) const { return {}; }
+    };
+
+    // User-chosen names keyed by the classic ones, e.g. {"paragraph", "p"}; elements not listed get no class.
+    struct MappedClasses {
+        static constexpr bool enabled = true;
+        std::string names[static_cast<size_t>(ElementClass::Count)];
+
+        std::string_view name(ElementClass element) const { return names[static_cast<size_t>(element)]; }
+
+        static MappedClasses from(const std::map<std::string, std::string> &mapping) {
+            MappedClasses classes;
+            for(const auto &[classic, mapped] : mapping) {
+                auto it = std::find(std::begin(ClassicClasses::NAMES), std::end(ClassicClasses::NAMES), classic);
+                if(it == std::end(ClassicClasses::NAMES)) {
+                    throw std::invalid_argument("Unknown element class: " + classic);
+                }
+                classes.names[it - std::begin(ClassicClasses::NAMES)] = mapped;
+            }
+            return classes;
+        }
+    };
+
+    enum class ClassProfile { Classic, Compact, Mapped };
+
+    struct HtmlOptions {
+        // Highlight fenced code in supported languages at build time instead of leaving it to client-side JS.
+        bool highlight_code = false;
+        // Add loading="lazy" and decoding="async" to images.
+        bool lazy_images = false;
+        // Class attributes on rendered elements; Mapped uses class_names and falls back to Classic without them.
+        ClassProfile class_profile = ClassProfile::Classic;
+        std::shared_ptr<const MappedClasses> class_names;
+        // Intrinsic size of an image by its src, used for width/height attributes; unset or nullopt skips them.
+        std::function<std::optional<ImageSize>(const std::string &src)> image_size;
+    };
+
+    // How the HTML renderer reads a node, so it can walk an owning Node or a mapped snapshot view
+    // (snapshot::ViewAccess) without copying it into a Node first.
+    struct NodeAccess {
+        using Node = markdown::Node;
+
+        static NodeType type(const Node &node) { return node.type; }
+        static int level(const Node &node) { return node.level; }
+        static const std::string &text(const Node &node) { return node.text; }
+        static size_t child_count(const Node &node) { return node.children.size(); }
+        static const Node &child(const Node &node, size_t index) { return node.children[index]; }
+
+        static std::optional<std::string_view> attribute(const Node &node, html::Symbol name) {
+            auto it = node.attributes.find(name);
+            if(it == node.attributes.end()) {
+                return std::nullopt;
+            }
+            return it->second;
+        }
+    };
+
     class Serializer {
     public:
         static std::string markdown(const Node &node) {
@@ -97,193 +208,248 @@ namespace markdown {
             return oss.str();
         }
 
-        static std::string html(const Node &node) {
-            html::Node html_root = convert_to_html_node(node);
+        template <typename Access = NodeAccess>
+        static std::string html(const typename Access::Node &node, const HtmlOptions &options = {}) {
+            html::Node html_root = to_html_node<Access>(node, options);
             return html::Serializer::serialize(html_root);
         }
 
+        // One top-level block as it appears inside the document's <div>, for renderers that emit blocks one at a time.
+        static std::string html_block(const Node &block, const HtmlOptions &options = {}) {
+            return html::Serializer::serialize(to_html_node<NodeAccess>(block, options), 1);
+        }
+
     private:
-        static html::Node convert_to_html_node(const Node &md_node) {
+        // The class profile is picked here, once per call; the conversion itself is instantiated per profile.
+        template <typename Access>
+        static html::Node to_html_node(const typename Access::Node &md_node, const HtmlOptions &options) {
+            switch(options.class_profile) {
+            case ClassProfile::Compact:
+                return convert_to_html_node<Access>(md_node, options, CompactClasses{});
+            case ClassProfile::Mapped:
+                if(options.class_names) {
+                    return convert_to_html_node<Access>(md_node, options, *options.class_names);
+                }
+                break;
+            case ClassProfile::Classic:
+                break;
+            }
+            return convert_to_html_node<Access>(md_node, options, ClassicClasses{});
+        }
+
+        template <typename Classes>
+        static void set_class(html::Node &html_node, const Classes &classes, ElementClass element) {
+            if constexpr(Classes::enabled) {
+                std::string_view name = classes.name(element);
+                if(!name.empty()) {
+                    html_node.attributes[html::names::class_attr] = std::string(name);
+                }
+            }
+        }
+
+        static std::string_view required_attribute(std::optional<std::string_view> value, html::Symbol name) {
+            if(!value) {
+                throw std::out_of_range("Attribute not found: " + name.str());
+            }
+            return *value;
+        }
+
+        template <typename Access, typename Classes>
+        static void convert_children(html::Node &html_node, const typename Access::Node &md_node,
+                                     const HtmlOptions &options, const Classes &classes) {
+            size_t count = Access::child_count(md_node);
+            html_node.children.reserve(count);
+            for(size_t i = 0; i < count; ++i) {
+                html_node.children.push_back(convert_to_html_node<Access>(Access::child(md_node, i), options, classes));
+            }
+        }
+
+        template <typename Access, typename Classes>
+        static html::Node convert_to_html_node(const typename Access::Node &md_node, const HtmlOptions &options,
+                                               const Classes &classes) {
             html::Node html_node;
 
-            switch(md_node.type) {
+            switch(Access::type(md_node)) {
             case NodeType::Document: {
-                html_node.tag = "div";
-                for(const auto &child : md_node.children) {
-                    html_node.children.push_back(convert_to_html_node(child));
-                }
+                html_node.tag = html::names::div;
+                convert_children<Access>(html_node, md_node, options, classes);
                 break;
             }
 
             case NodeType::Heading: {
-                html_node.tag = "h" + std::to_string(md_node.level);
-                html_node.attributes["class"] = "heading-primary";
-                html_node.text = md_node.text;
+                int level = Access::level(md_node);
+                html_node.tag = level >= 1 && level <= 6 ? html::names::headings[level - 1]
+                                                         : html::Symbol("h" + std::to_string(level));
+                set_class(html_node, classes, ElementClass::Heading);
+                html_node.text = Access::text(md_node);
                 break;
             }
 
             case NodeType::Paragraph: {
-                html_node.tag = "p";
-                html_node.attributes["class"] = "paragraph";
-                for(const auto &child : md_node.children) {
-                    html_node.children.push_back(convert_to_html_node(child));
-                }
-                if(!md_node.text.empty()) {
+                html_node.tag = html::names::p;
+                set_class(html_node, classes, ElementClass::Paragraph);
+                convert_children<Access>(html_node, md_node, options, classes);
+                if(!Access::text(md_node).empty()) {
                     html::Node text_node;
-                    text_node.text = md_node.text;
+                    text_node.text = Access::text(md_node);
                     html_node.children.push_back(text_node);
                 }
                 break;
             }
 
             case NodeType::CodeBlock: {
-                html_node.tag = "pre";
-                html_node.attributes["class"] = "code-block";
+                html_node.tag = html::names::pre;
+                set_class(html_node, classes, ElementClass::CodeBlock);
 
                 html::Node code_node;
-                code_node.tag = "code";
-                if(md_node.attributes.count("language")) {
-                    code_node.attributes["class"] = "language-" + md_node.attributes.at("language");
+                code_node.tag = html::names::code;
+                code_node.text = Access::text(md_node);
+                if(auto language = Access::attribute(md_node, "language")) {
+                    code_node.attributes[html::names::class_attr] = "language-" + std::string(*language);
+
+                    if(options.highlight_code) {
+                        if(auto highlighted = highlight::Highlighter::highlight(*language, Access::text(md_node))) {
+                            code_node.attributes[html::names::class_attr] += " highlighted";
+                            code_node.text = std::move(*highlighted);
+                        }
+                    }
                 }
-                code_node.text = md_node.text;
                 html_node.children.push_back(code_node);
                 break;
             }
 
             case NodeType::InlineCode: {
-                html_node.tag = "code";
-                html_node.attributes["class"] = "inline-code";
-                html_node.text = md_node.text;
+                html_node.tag = html::names::code;
+                set_class(html_node, classes, ElementClass::InlineCode);
+                html_node.text = Access::text(md_node);
                 break;
             }
 
             case NodeType::Bold: {
-                html_node.tag = "strong";
-                html_node.attributes["class"] = "bold";
-                for(const auto &child : md_node.children) {
-                    html_node.children.push_back(convert_to_html_node(child));
-                }
-                if(!md_node.text.empty()) {
+                html_node.tag = html::names::strong;
+                set_class(html_node, classes, ElementClass::Bold);
+                convert_children<Access>(html_node, md_node, options, classes);
+                if(!Access::text(md_node).empty()) {
                     html::Node text_node;
-                    text_node.text = md_node.text;
+                    text_node.text = Access::text(md_node);
                     html_node.children.push_back(text_node);
                 }
                 break;
             }
 
             case NodeType::Italic: {
-                html_node.tag = "em";
-                html_node.attributes["class"] = "italic";
-                for(const auto &child : md_node.children) {
-                    html_node.children.push_back(convert_to_html_node(child));
-                }
-                if(!md_node.text.empty()) {
+                html_node.tag = html::names::em;
+                set_class(html_node, classes, ElementClass::Italic);
+                convert_children<Access>(html_node, md_node, options, classes);
+                if(!Access::text(md_node).empty()) {
                     html::Node text_node;
-                    text_node.text = md_node.text;
+                    text_node.text = Access::text(md_node);
                     html_node.children.push_back(text_node);
                 }
                 break;
             }
 
             case NodeType::Link: {
-                html_node.tag = "a";
-                html_node.attributes["href"] = md_node.attributes.at("href");
-                html_node.attributes["class"] = "link";
-                html_node.text = md_node.text;
+                html_node.tag = html::names::a;
+                html_node.attributes[html::names::href] =
+                    required_attribute(Access::attribute(md_node, html::names::href), html::names::href);
+                set_class(html_node, classes, ElementClass::Link);
+                html_node.text = Access::text(md_node);
                 break;
             }
 
             case NodeType::Image: {
-                html_node.tag = "img";
-                html_node.attributes["src"] = md_node.attributes.at("src");
-                html_node.attributes["alt"] = md_node.attributes.at("alt");
-                html_node.attributes["class"] = "image";
+                html_node.tag = html::names::img;
+                std::string_view src = required_attribute(Access::attribute(md_node, html::names::src), html::names::src);
+                html_node.attributes[html::names::src] = src;
+                html_node.attributes[html::names::alt] =
+                    required_attribute(Access::attribute(md_node, html::names::alt), html::names::alt);
+                set_class(html_node, classes, ElementClass::Image);
+
+                if(options.image_size) {
+                    if(auto size = options.image_size(std::string(src))) {
+                        html_node.attributes[html::names::width] = std::to_string(size->width);
+                        html_node.attributes[html::names::height] = std::to_string(size->height);
+                    }
+                }
+                if(options.lazy_images) {
+                    html_node.attributes[html::names::loading] = "lazy";
+                    html_node.attributes[html::names::decoding] = "async";
+                }
                 break;
             }
 
             case NodeType::List: {
-                html_node.tag = "ul";
-                html_node.attributes["class"] = "list";
-                for(const auto &child : md_node.children) {
-                    html_node.children.push_back(convert_to_html_node(child));
-                }
+                html_node.tag = html::names::ul;
+                set_class(html_node, classes, ElementClass::List);
+                convert_children<Access>(html_node, md_node, options, classes);
                 break;
             }
 
             case NodeType::ListItem: {
-                html_node.tag = "li";
-                html_node.attributes["class"] = "list-item";
-                for(const auto &child : md_node.children) {
-                    html_node.children.push_back(convert_to_html_node(child));
-                }
-                if(!md_node.text.empty()) {
+                html_node.tag = html::names::li;
+                set_class(html_node, classes, ElementClass::ListItem);
+                convert_children<Access>(html_node, md_node, options, classes);
+                if(!Access::text(md_node).empty()) {
                     html::Node text_node;
-                    text_node.text = md_node.text;
+                    text_node.text = Access::text(md_node);
                     html_node.children.push_back(text_node);
                 }
                 break;
             }
 
             case NodeType::Quote: {
-                html_node.tag = "blockquote";
-                html_node.attributes["class"] = "quote";
-                for(const auto &child : md_node.children) {
-                    html_node.children.push_back(convert_to_html_node(child));
-                }
-                if(!md_node.text.empty()) {
+                html_node.tag = html::names::blockquote;
+                set_class(html_node, classes, ElementClass::Quote);
+                convert_children<Access>(html_node, md_node, options, classes);
+                if(!Access::text(md_node).empty()) {
                     html::Node text_node;
-                    text_node.text = md_node.text;
+                    text_node.text = Access::text(md_node);
                     html_node.children.push_back(text_node);
                 }
                 break;
             }
 
             case NodeType::Table: {
-                html_node.tag = "table";
-                html_node.attributes["class"] = "table";
-                for(const auto &child : md_node.children) {
-                    html_node.children.push_back(convert_to_html_node(child));
-                }
+                html_node.tag = html::names::table;
+                set_class(html_node, classes, ElementClass::Table);
+                convert_children<Access>(html_node, md_node, options, classes);
                 break;
             }
 
             case NodeType::TableRow: {
-                html_node.tag = "tr";
-                html_node.attributes["class"] = "table-row";
-                for(const auto &child : md_node.children) {
-                    html_node.children.push_back(convert_to_html_node(child));
-                }
+                html_node.tag = html::names::tr;
+                set_class(html_node, classes, ElementClass::TableRow);
+                convert_children<Access>(html_node, md_node, options, classes);
                 break;
             }
 
             case NodeType::TableCell: {
-                html_node.tag = "td";
-                html_node.attributes["class"] = "table-cell";
-                for(const auto &child : md_node.children) {
-                    html_node.children.push_back(convert_to_html_node(child));
-                }
-                if(!md_node.text.empty()) {
+                html_node.tag = html::names::td;
+                set_class(html_node, classes, ElementClass::TableCell);
+                convert_children<Access>(html_node, md_node, options, classes);
+                if(!Access::text(md_node).empty()) {
                     html::Node text_node;
-                    text_node.text = md_node.text;
+                    text_node.text = Access::text(md_node);
                     html_node.children.push_back(text_node);
                 }
                 break;
             }
 
             case NodeType::Text: {
-                html_node.text = md_node.text;
+                html_node.text = Access::text(md_node);
                 break;
             }
 
             case NodeType::LineBreak: {
-                html_node.tag = "br";
-                html_node.attributes["class"] = "line-break";
+                html_node.tag = html::names::br;
+                set_class(html_node, classes, ElementClass::LineBreak);
                 break;
             }
 
             case NodeType::HorizontalRule: {
-                html_node.tag = "hr";
-                html_node.attributes["class"] = "horizontal-rule";
+                html_node.tag = html::names::hr;
+                set_class(html_node, classes, ElementClass::HorizontalRule);
                 break;
             }
             }
@@ -435,17 +601,15 @@ namespace markdown {
         }
     };
 
+    class StreamingDeserializer;
+
     class Deserializer {
+        friend class StreamingDeserializer;
+
     public:
         static Node deserialize(const std::string &markdown) {
             Node document(NodeType::Document);
-            std::istringstream iss(markdown);
-            std::string line;
-            std::vector<std::string> lines;
-
-            while(std::getline(iss, line)) {
-                lines.push_back(line);
-            }
+            std::vector<std::string> lines = split_lines(markdown);
 
             size_t pos = 0;
             while(pos < lines.size()) {
@@ -455,8 +619,221 @@ namespace markdown {
             return document;
         }
 
+        // Same result as deserialize, with the document cut at blank lines that start a block (never inside a
+        // fence, list or table) into chunks of roughly target_chunk_bytes that are parsed on the pool. The calling
+        // thread parses chunks too and never blocks on queued work, so this is safe to call from a pool task.
+        static Node deserialize_parallel(const std::string &markdown, ssg::utils::ThreadPool &pool,
+                                         size_t target_chunk_bytes = 256 * 1024) {
+            if(pool.size() < 2 || markdown.size() < 2 * target_chunk_bytes) {
+                return deserialize(markdown);
+            }
+
+            std::vector<std::string> lines = split_lines(markdown);
+            std::vector<size_t> boundaries = split_points(lines, target_chunk_bytes);
+            if(boundaries.size() <= 2) {
+                Node document(NodeType::Document);
+                size_t pos = 0;
+                while(pos < lines.size()) {
+                    parse_block(lines, pos, document);
+                }
+                return document;
+            }
+
+            struct Job {
+                std::span<const std::string> lines;
+                std::vector<size_t> boundaries;
+                std::vector<Node> chunks;
+                std::atomic<size_t> next_chunk{0};
+                std::mutex mutex;
+                std::condition_variable all_done;
+                size_t chunks_done = 0;
+                std::exception_ptr error;
+
+                void work() {
+                    size_t chunk_count = chunks.size();
+                    for(size_t i = next_chunk++; i < chunk_count; i = next_chunk++) {
+                        std::exception_ptr chunk_error;
+                        try {
+                            auto chunk_lines = lines.subspan(boundaries[i], boundaries[i + 1] - boundaries[i]);
+                            size_t pos = 0;
+                            while(pos < chunk_lines.size()) {
+                                parse_block(chunk_lines, pos, chunks[i]);
+                            }
+                        } catch(...) { chunk_error = std::current_exception(); }
+
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if(chunk_error && !error) {
+                            error = chunk_error;
+                        }
+                        if(++chunks_done == chunk_count) {
+                            all_done.notify_all();
+                        }
+                    }
+                }
+            };
+
+            // Helpers may only get scheduled after every chunk is done; they then find no work and just drop
+            // their reference, so the job state is shared rather than living on this stack frame.
+            auto job = std::make_shared<Job>();
+            job->lines = lines;
+            job->boundaries = std::move(boundaries);
+            job->chunks.assign(job->boundaries.size() - 1, Node(NodeType::Document));
+
+            size_t helpers = std::min(pool.size(), job->chunks.size() - 1);
+            for(size_t i = 0; i < helpers; ++i) {
+                pool.submit([job] { job->work(); });
+            }
+            job->work();
+
+            std::unique_lock<std::mutex> lock(job->mutex);
+            job->all_done.wait(lock, [&job] { return job->chunks_done == job->chunks.size(); });
+            if(job->error) {
+                std::rethrow_exception(job->error);
+            }
+
+            Node document(NodeType::Document);
+            size_t block_count = 0;
+            for(const auto &chunk : job->chunks) {
+                block_count += chunk.children.size();
+            }
+            document.children.reserve(block_count);
+            for(auto &chunk : job->chunks) {
+                std::move(chunk.children.begin(), chunk.children.end(), std::back_inserter(document.children));
+            }
+            return document;
+        }
+
     private:
-        static void parse_block(const std::vector<std::string> &lines, size_t &pos, Node &parent) {
+        using Lines = std::span<const std::string>;
+
+        // Splits like repeated std::getline: a trailing newline does not produce an empty last line.
+        static std::vector<std::string> split_lines(std::string_view text) {
+            std::vector<std::string> lines;
+            size_t start = 0;
+            while(start < text.size()) {
+                size_t newline = text.find('\n', start);
+                if(newline == std::string_view::npos) {
+                    lines.emplace_back(text.substr(start));
+                    break;
+                }
+                lines.emplace_back(text.substr(start, newline - start));
+                start = newline + 1;
+            }
+            return lines;
+        }
+
+        // Line classifiers shared by parse_block and block_end. Each checks a cheap necessary condition before
+        // running its regex, since most lines are plain paragraph text.
+        static size_t first_non_space(const std::string &line) { return line.find_first_not_of(" \t\n\v\f\r"); }
+
+        static bool starts_with_any(const std::string &line, std::string_view chars) {
+            size_t first = first_non_space(line);
+            return first != std::string::npos && chars.find(line[first]) != std::string_view::npos;
+        }
+
+        static bool is_horizontal_rule(const std::string &line) {
+            static const std::regex hr_regex(R"(^\s*[-*_]{3,}\s*$)");
+            return starts_with_any(line, "-*_") && std::regex_match(line, hr_regex);
+        }
+
+        static bool match_heading(const std::string &line, std::smatch &match) {
+            static const std::regex heading_regex(R"(^(#{1,6})\s+(.+)$)");
+            return !line.empty() && line[0] == '#' && std::regex_match(line, match, heading_regex);
+        }
+
+        static bool match_fence_open(const std::string &line, std::smatch &match) {
+            static const std::regex fence_open_regex(R"(^```(\w*)\s*$)");
+            return line.starts_with("```") && std::regex_match(line, match, fence_open_regex);
+        }
+
+        static bool is_fence_close(const std::string &line) {
+            static const std::regex fence_close_regex(R"(^```\s*$)");
+            return line.starts_with("```") && std::regex_match(line, fence_close_regex);
+        }
+
+        static bool match_quote(const std::string &line, std::smatch &match) {
+            static const std::regex quote_regex(R"(^\s*>\s*(.*)$)");
+            return starts_with_any(line, ">") && std::regex_match(line, match, quote_regex);
+        }
+
+        static bool match_unordered_item(const std::string &line, std::smatch &match) {
+            static const std::regex unordered_regex(R"(^(\s*)[-*+]\s+(.+)$)");
+            return starts_with_any(line, "-*+") && std::regex_match(line, match, unordered_regex);
+        }
+
+        static bool match_ordered_item(const std::string &line, std::smatch &match) {
+            static const std::regex ordered_regex(R"(^(\s*)\d+\.\s+(.+)$)");
+            return starts_with_any(line, "0123456789") && std::regex_match(line, match, ordered_regex);
+        }
+
+        static bool match_list_item(const std::string &line, std::smatch &match) {
+            return match_unordered_item(line, match) || match_ordered_item(line, match);
+        }
+
+        static bool breaks_paragraph(const std::string &line) {
+            static const std::regex heading_prefix_regex(R"(^#{1,6}\s+)");
+            return line.empty() || (line[0] == '#' && std::regex_match(line, heading_prefix_regex));
+        }
+
+        // Index just past the block parse_block would read starting at pos, without building any nodes.
+        static size_t block_end(Lines lines, size_t pos) {
+            const std::string &line = lines[pos];
+            std::smatch match;
+
+            if(line.empty() || is_horizontal_rule(line) || match_heading(line, match)) {
+                return pos + 1;
+            }
+            if(match_fence_open(line, match)) {
+                ++pos;
+                while(pos < lines.size() && !is_fence_close(lines[pos])) {
+                    ++pos;
+                }
+                return pos < lines.size() ? pos + 1 : pos;
+            }
+            if(match_quote(line, match)) {
+                return pos + 1;
+            }
+            if(match_list_item(line, match)) {
+                while(pos < lines.size() && match_list_item(lines[pos], match)) {
+                    ++pos;
+                }
+                return pos;
+            }
+            if(line.find('|') != std::string::npos) {
+                while(pos < lines.size() && lines[pos].find('|') != std::string::npos) {
+                    ++pos;
+                }
+                return pos;
+            }
+
+            ++pos;
+            while(pos < lines.size() && !breaks_paragraph(lines[pos])) {
+                ++pos;
+            }
+            return pos;
+        }
+
+        // Chunk boundaries for deserialize_parallel: 0, then blank lines that begin a block once the current chunk
+        // holds at least target_bytes, then lines.size().
+        static std::vector<size_t> split_points(Lines lines, size_t target_bytes) {
+            std::vector<size_t> boundaries = {0};
+            size_t chunk_bytes = 0;
+            size_t pos = 0;
+            while(pos < lines.size()) {
+                if(lines[pos].empty() && chunk_bytes >= target_bytes) {
+                    boundaries.push_back(pos);
+                    chunk_bytes = 0;
+                }
+                size_t end = block_end(lines, pos);
+                for(; pos < end; ++pos) {
+                    chunk_bytes += lines[pos].size() + 1;
+                }
+            }
+            boundaries.push_back(lines.size());
+            return boundaries;
+        }
+
+        static void parse_block(Lines lines, size_t &pos, Node &parent) {
             if(pos >= lines.size())
                 return;
 
@@ -467,14 +844,14 @@ namespace markdown {
                 return;
             }
 
-            if(std::regex_match(line, std::regex(R"(^\s*[-*_]{3,}\s*$)"))) {
+            if(is_horizontal_rule(line)) {
                 parent.children.emplace_back(NodeType::HorizontalRule);
                 ++pos;
                 return;
             }
 
             std::smatch heading_match;
-            if(std::regex_match(line, heading_match, std::regex(R"(^(#{1,6})\s+(.+)$)"))) {
+            if(match_heading(line, heading_match)) {
                 int level = heading_match[1].str().length();
                 std::string text = heading_match[2].str();
                 parent.children.emplace_back(NodeType::Heading, text, level);
@@ -483,12 +860,12 @@ namespace markdown {
             }
 
             std::smatch code_match;
-            if(std::regex_match(line, code_match, std::regex(R"(^```(\w*)\s*$)"))) {
+            if(match_fence_open(line, code_match)) {
                 std::string language = code_match[1].str();
                 ++pos;
                 std::ostringstream code_content;
 
-                while(pos < lines.size() && !std::regex_match(lines[pos], std::regex(R"(^```\s*$)"))) {
+                while(pos < lines.size() && !is_fence_close(lines[pos])) {
                     if(code_content.tellp() > 0)
                         code_content << "\n";
                     code_content << lines[pos];
@@ -506,9 +883,8 @@ namespace markdown {
                 return;
             }
 
-            if(std::regex_match(line, std::regex(R"(^\s*>\s*(.*)$)"))) {
-                std::smatch quote_match;
-                std::regex_match(line, quote_match, std::regex(R"(^\s*>\s*(.*)$)"));
+            std::smatch quote_match;
+            if(match_quote(line, quote_match)) {
                 Node quote_node(NodeType::Quote);
                 parse_inline(quote_match[1].str(), quote_node);
                 parent.children.push_back(quote_node);
@@ -517,19 +893,16 @@ namespace markdown {
             }
 
             std::smatch list_match;
-            if(std::regex_match(line, list_match, std::regex(R"(^(\s*)[-*+]\s+(.+)$)")) ||
-               std::regex_match(line, list_match, std::regex(R"(^(\s*)\d+\.\s+(.+)$)"))) {
-
+            if(match_list_item(line, list_match)) {
                 Node list_node(NodeType::List);
-                bool is_ordered = std::regex_match(line, std::regex(R"(^(\s*)\d+\.\s+(.+)$)"));
+                std::smatch ordered_match;
+                bool is_ordered = match_ordered_item(line, ordered_match);
 
                 while(pos < lines.size()) {
                     const std::string &current_line = lines[pos];
                     std::smatch item_match;
 
-                    if(std::regex_match(current_line, item_match, std::regex(R"(^(\s*)[-*+]\s+(.+)$)")) ||
-                       std::regex_match(current_line, item_match, std::regex(R"(^(\s*)\d+\.\s+(.+)$)"))) {
-
+                    if(match_list_item(current_line, item_match)) {
                         Node item_node(NodeType::ListItem);
                         if(is_ordered) {
                             item_node.attributes["ordered"] = "true";
@@ -547,18 +920,19 @@ namespace markdown {
             }
 
             if(line.find('|') != std::string::npos) {
+                static const std::regex separator_regex(R"(^\s*\|[\s\-\|]*\|\s*$)");
+                static const std::regex cell_regex(R"(\|([^|]*))");
                 Node table_node(NodeType::Table);
 
                 while(pos < lines.size() && lines[pos].find('|') != std::string::npos) {
                     const std::string &table_line = lines[pos];
 
-                    if(std::regex_match(table_line, std::regex(R"(^\s*\|[\s\-\|]*\|\s*$)"))) {
+                    if(std::regex_match(table_line, separator_regex)) {
                         ++pos;
                         continue;
                     }
 
                     Node row_node(NodeType::TableRow);
-                    std::regex cell_regex(R"(\|([^|]*))");
                     std::sregex_iterator iter(table_line.begin(), table_line.end(), cell_regex);
                     std::sregex_iterator end;
 
@@ -589,7 +963,7 @@ namespace markdown {
             std::string paragraph_text = line;
             ++pos;
 
-            while(pos < lines.size() && !lines[pos].empty() && !std::regex_match(lines[pos], std::regex(R"(^#{1,6}\s+)"))) {
+            while(pos < lines.size() && !breaks_paragraph(lines[pos])) {
                 paragraph_text += " " + lines[pos];
                 ++pos;
             }
@@ -602,10 +976,19 @@ namespace markdown {
             if(text.empty())
                 return;
 
+            // Every inline construct below starts with one of these; plain runs skip the regex searches.
+            static constexpr ssg::utils::simd::ByteSet markers("*`[");
+
             std::string remaining = text;
             size_t pos = 0;
 
             while(pos < remaining.length()) {
+                std::string_view unscanned = std::string_view(remaining).substr(pos);
+                if(ssg::utils::simd::find_first_of(unscanned, markers) == unscanned.size()) {
+                    parent.children.emplace_back(NodeType::Text, std::string(unscanned));
+                    break;
+                }
+
                 std::regex bold_regex(R"(\*\*(.*?)\*\*)");
                 std::smatch bold_match;
                 if(std::regex_search(remaining.cbegin() + pos, remaining.cend(), bold_match, bold_regex)) {
@@ -667,17 +1050,27 @@ namespace markdown {
                 std::smatch link_match;
                 if(std::regex_search(remaining.cbegin() + pos, remaining.cend(), link_match, link_regex)) {
                     size_t match_pos = pos + link_match.prefix().length();
+                    // "![alt](src)" also matches the link pattern one character in; it is an image.
+                    bool is_image = match_pos > pos && remaining[match_pos - 1] == '!';
+                    size_t text_end = is_image ? match_pos - 1 : match_pos;
 
-                    if(match_pos > pos) {
-                        std::string before = remaining.substr(pos, match_pos - pos);
+                    if(text_end > pos) {
+                        std::string before = remaining.substr(pos, text_end - pos);
                         if(!before.empty()) {
                             parent.children.emplace_back(NodeType::Text, before);
                         }
                     }
 
-                    Node link_node(NodeType::Link, link_match[1].str());
-                    link_node.attributes["href"] = link_match[2].str();
-                    parent.children.push_back(link_node);
+                    if(is_image) {
+                        Node img_node(NodeType::Image);
+                        img_node.attributes[html::names::alt] = link_match[1].str();
+                        img_node.attributes[html::names::src] = link_match[2].str();
+                        parent.children.push_back(img_node);
+                    } else {
+                        Node link_node(NodeType::Link, link_match[1].str());
+                        link_node.attributes[html::names::href] = link_match[2].str();
+                        parent.children.push_back(link_node);
+                    }
 
                     pos = match_pos + link_match.length();
                     continue;
@@ -696,8 +1089,8 @@ namespace markdown {
                     }
 
                     Node img_node(NodeType::Image);
-                    img_node.attributes["alt"] = img_match[1].str();
-                    img_node.attributes["src"] = img_match[2].str();
+                    img_node.attributes[html::names::alt] = img_match[1].str();
+                    img_node.attributes[html::names::src] = img_match[2].str();
                     parent.children.push_back(img_node);
 
                     pos = match_pos + img_match.length();
@@ -716,4 +1109,121 @@ namespace markdown {
             }
         }
     };
+
+    // Parses markdown fed in arbitrary chunks and hands each top-level block to on_block as soon as the line after
+    // it shows the block cannot continue. Only the lines of the block still open are buffered, so memory stays
+    // proportional to the largest block rather than the document. The blocks are exactly those
+    // Deserializer::deserialize would produce for the concatenated input.
+    class StreamingDeserializer {
+    public:
+        using BlockHandler = std::function<void(Node &&block)>;
+
+        explicit StreamingDeserializer(BlockHandler on_block) : on_block_(std::move(on_block)) {}
+
+        void feed(std::string_view chunk) {
+            while(!chunk.empty()) {
+                size_t newline = chunk.find('\n');
+                if(newline == std::string_view::npos) {
+                    partial_.append(chunk);
+                    break;
+                }
+                partial_.append(chunk.substr(0, newline));
+                push_line(std::move(partial_));
+                partial_.clear();
+                chunk.remove_prefix(newline + 1);
+            }
+            peak_buffered_bytes_ = std::max(peak_buffered_bytes_, buffered_bytes_ + partial_.size());
+        }
+
+        void finish() {
+            if(!partial_.empty()) {
+                push_line(std::move(partial_));
+                partial_.clear();
+            }
+            drain(true);
+        }
+
+        // Largest amount of input text held at once, for checking the memory bound.
+        size_t peak_buffered_bytes() const { return peak_buffered_bytes_; }
+
+        static void deserialize(std::istream &input, const BlockHandler &on_block, size_t chunk_size = 64 * 1024) {
+            StreamingDeserializer parser(on_block);
+            std::string buffer(chunk_size, '\0');
+            while(input.read(buffer.data(), buffer.size()) || input.gcount() > 0) {
+                parser.feed(std::string_view(buffer.data(), static_cast<size_t>(input.gcount())));
+            }
+            parser.finish();
+        }
+
+    private:
+        BlockHandler on_block_;
+        std::vector<std::string> pending_;
+        std::string partial_;
+        size_t buffered_bytes_ = 0;
+        size_t peak_buffered_bytes_ = 0;
+        size_t next_attempt_ = 1;
+
+        void push_line(std::string line) {
+            buffered_bytes_ += line.size();
+            pending_.push_back(std::move(line));
+            // A block that is still open gets re-parsed from its first line, so retries back off geometrically
+            // to keep the total work linear in the block size.
+            if(pending_.size() >= next_attempt_) {
+                drain(false);
+            }
+        }
+
+        void drain(bool at_end) {
+            size_t pos = 0;
+            while(pos < pending_.size()) {
+                size_t start = pos;
+                Node scratch(NodeType::Document);
+                Deserializer::parse_block(pending_, pos, scratch);
+                if(!at_end && pos >= pending_.size()) {
+                    // The block reached the last buffered line, so the next line may still extend it.
+                    pos = start;
+                    break;
+                }
+                for(auto &block : scratch.children) {
+                    on_block_(std::move(block));
+                }
+            }
+
+            for(size_t i = 0; i < pos; ++i) {
+                buffered_bytes_ -= pending_[i].size();
+            }
+            pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(pos));
+            next_attempt_ = std::max(pending_.size() * 2, pending_.size() + 1);
+        }
+    };
+
+    // Writes the same markup as Serializer::html on a Document, one block at a time.
+    class HtmlStreamWriter {
+    public:
+        using Sink = std::function<void(std::string_view)>;
+
+        explicit HtmlStreamWriter(Sink sink, HtmlOptions options = {})
+            : sink_(std::move(sink)), options_(std::move(options)) {
+            sink_("<div>");
+        }
+
+        void block(const Node &node) {
+            std::string markup = "\n" + Serializer::html_block(node, options_);
+            sink_(markup);
+            ++blocks_;
+        }
+
+        void finish() { sink_(blocks_ > 0 ? "\n</div>" : "</div>"); }
+
+    private:
+        Sink sink_;
+        HtmlOptions options_;
+        size_t blocks_ = 0;
+    };
+
+    inline void render_html_stream(std::istream &input, std::ostream &output, const HtmlOptions &options = {}) {
+        HtmlStreamWriter writer([&output](std::string_view markup) { output << markup; }, options);
+        StreamingDeserializer::deserialize(input, [&writer](Node &&block) { writer.block(block); });
+        writer.finish();
+    }
 } // namespace markdown
\ No newline at end of file
@@ -0,0 +1,373 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "markdown.hpp"
+
+// Binary snapshots of parsed markdown, so a page can be brought back without running the parser again.
+//
+// Layout (native byte order, rejected on a mismatch), every section 8-byte aligned:
+//   Header | NodeRecord[node_count] | AttributeRecord[attribute_count] | string bytes
+// Nodes are stored breadth-first, so the children of any node are one contiguous range of the node array and
+// always come after their parent. All references are offsets into the file, never pointers, which lets a
+// mapped file be walked in place.
+namespace markdown::snapshot {
+    inline constexpr char MAGIC[8] = {'C', 'H', 'M', 'D', 'A', 'S', 'T', '\0'};
+    // Bump whenever the encoding or the parser's output for the same input changes.
+    inline constexpr uint32_t FORMAT_VERSION = 1;
+    inline constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+    struct StringRef {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t source_hash;
+        uint64_t total_size;
+        uint32_t node_count;
+        uint32_t attribute_count;
+        uint64_t nodes_offset;
+        uint64_t attributes_offset;
+        uint64_t strings_offset;
+        uint64_t strings_size;
+    };
+
+    struct NodeRecord {
+        uint32_t type;
+        int32_t level;
+        StringRef text;
+        uint32_t first_child;
+        uint32_t child_count;
+        uint32_t first_attribute;
+        uint32_t attribute_count;
+    };
+
+    struct AttributeRecord {
+        StringRef name;
+        StringRef value;
+    };
+
+    static_assert(sizeof(Header) == 72 && sizeof(NodeRecord) == 32 && sizeof(AttributeRecord) == 16);
+
+    namespace detail {
+        inline size_t align8(size_t size) { return (size + 7) & ~size_t(7); }
+
+        class StringTable {
+        public:
+            StringRef add(const std::string &text) {
+                auto it = offsets_.find(text);
+                if(it != offsets_.end()) {
+                    return {it->second, static_cast<uint32_t>(text.size())};
+                }
+                auto offset = static_cast<uint32_t>(bytes_.size());
+                bytes_ += text;
+                offsets_.emplace(text, offset);
+                return {offset, static_cast<uint32_t>(text.size())};
+            }
+
+            const std::string &bytes() const { return bytes_; }
+
+        private:
+            std::string bytes_;
+            std::map<std::string, uint32_t, std::less<>> offsets_;
+        };
+
+        // Read-only view of a snapshot file: mmap where available, a heap copy otherwise.
+        class Mapping {
+        public:
+            static std::unique_ptr<Mapping> open(const std::filesystem::path &path) {
+                auto mapping = std::unique_ptr<Mapping>(new Mapping());
+#ifdef _WIN32
+                std::ifstream file(path, std::ios::binary | std::ios::ate);
+                if(!file) {
+                    return nullptr;
+                }
+                mapping->size_ = static_cast<size_t>(file.tellg());
+                mapping->buffer_.reset(new uint64_t[(mapping->size_ + 7) / 8]);
+                file.seekg(0);
+                if(!file.read(reinterpret_cast<char *>(mapping->buffer_.get()), mapping->size_)) {
+                    return nullptr;
+                }
+                mapping->data_ = reinterpret_cast<const char *>(mapping->buffer_.get());
+#else
+                int fd = ::open(path.c_str(), O_RDONLY);
+                if(fd < 0) {
+                    return nullptr;
+                }
+                struct stat info;
+                if(::fstat(fd, &info) != 0 || info.st_size <= 0) {
+                    ::close(fd);
+                    return nullptr;
+                }
+                mapping->size_ = static_cast<size_t>(info.st_size);
+                void *data = ::mmap(nullptr, mapping->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                ::close(fd);
+                if(data == MAP_FAILED) {
+                    return nullptr;
+                }
+                mapping->data_ = static_cast<const char *>(data);
+#endif
+                return mapping;
+            }
+
+            ~Mapping() {
+#ifndef _WIN32
+                if(data_ != nullptr) {
+                    ::munmap(const_cast<char *>(data_), size_);
+                }
+#endif
+            }
+
+            Mapping(const Mapping &) = delete;
+            Mapping &operator=(const Mapping &) = delete;
+
+            const char *data() const { return data_; }
+            size_t size() const { return size_; }
+
+        private:
+            const char *data_ = nullptr;
+            size_t size_ = 0;
+#ifdef _WIN32
+            std::unique_ptr<uint64_t[]> buffer_;
+#endif
+
+            Mapping() = default;
+        };
+    } // namespace detail
+
+    inline std::string encode(const Node &root, uint64_t source_hash) {
+        std::vector<const Node *> order = {&root};
+        std::vector<NodeRecord> nodes;
+        std::vector<AttributeRecord> attributes;
+        detail::StringTable strings;
+
+        for(size_t i = 0; i < order.size(); ++i) {
+            const Node &node = *order[i];
+            NodeRecord record{};
+            record.type = static_cast<uint32_t>(node.type);
+            record.level = node.level;
+            record.text = strings.add(node.text);
+            record.first_child = static_cast<uint32_t>(order.size());
+            record.child_count = static_cast<uint32_t>(node.children.size());
+            record.first_attribute = static_cast<uint32_t>(attributes.size());
+            record.attribute_count = static_cast<uint32_t>(node.attributes.size());
+            for(const auto &[name, value] : node.attributes) {
+                attributes.push_back({strings.add(name), strings.add(value)});
+            }
+            for(const auto &child : node.children) {
+                order.push_back(&child);
+            }
+            nodes.push_back(record);
+        }
+
+        Header header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = FORMAT_VERSION;
+        header.byte_order = BYTE_ORDER_MARK;
+        header.source_hash = source_hash;
+        header.node_count = static_cast<uint32_t>(nodes.size());
+        header.attribute_count = static_cast<uint32_t>(attributes.size());
+        header.nodes_offset = detail::align8(sizeof(Header));
+        header.attributes_offset = detail::align8(header.nodes_offset + nodes.size() * sizeof(NodeRecord));
+        header.strings_offset = detail::align8(header.attributes_offset + attributes.size() * sizeof(AttributeRecord));
+        header.strings_size = strings.bytes().size();
+        header.total_size = header.strings_offset + header.strings_size;
+
+        std::string out(header.total_size, '\0');
+        std::memcpy(out.data(), &header, sizeof(Header));
+        std::memcpy(out.data() + header.nodes_offset, nodes.data(), nodes.size() * sizeof(NodeRecord));
+        std::memcpy(out.data() + header.attributes_offset, attributes.data(),
+                    attributes.size() * sizeof(AttributeRecord));
+        std::memcpy(out.data() + header.strings_offset, strings.bytes().data(), strings.bytes().size());
+        return out;
+    }
+
+    // Written to a temporary name and renamed, so a concurrent reader sees either the old or the new snapshot.
+    inline bool write(const std::filesystem::path &path, const Node &root, uint64_t source_hash) {
+        std::string bytes = encode(root, source_hash);
+        std::filesystem::path temp_path = path;
+        temp_path += ".tmp";
+
+        std::error_code error;
+        std::filesystem::create_directories(path.parent_path(), error);
+        {
+            std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+            if(!file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()))) {
+                return false;
+            }
+        }
+        std::filesystem::rename(temp_path, path, error);
+        return !error;
+    }
+
+    class NodeView {
+    public:
+        NodeType type() const { return static_cast<NodeType>(record_->type); }
+        int level() const { return record_->level; }
+        std::string_view text() const { return string(record_->text); }
+
+        size_t child_count() const { return record_->child_count; }
+        NodeView child(size_t index) const { return NodeView(base_, &base_.nodes[record_->first_child + index]); }
+
+        size_t attribute_count() const { return record_->attribute_count; }
+
+        std::pair<std::string_view, std::string_view> attribute(size_t index) const {
+            const AttributeRecord &attribute = base_.attributes[record_->first_attribute + index];
+            return {string(attribute.name), string(attribute.value)};
+        }
+
+        std::optional<std::string_view> attribute(std::string_view name) const {
+            for(size_t i = 0; i < attribute_count(); ++i) {
+                auto [key, value] = attribute(i);
+                if(key == name) {
+                    return value;
+                }
+            }
+            return std::nullopt;
+        }
+
+        // Copies this subtree into an owning Node, for code that needs the regular AST.
+        Node to_node() const {
+            Node node(type(), std::string(text()), level());
+            for(size_t i = 0; i < attribute_count(); ++i) {
+                auto [key, value] = attribute(i);
+                node.attributes[html::Symbol(key)] = std::string(value);
+            }
+            node.children.reserve(child_count());
+            for(size_t i = 0; i < child_count(); ++i) {
+                node.children.push_back(child(i).to_node());
+            }
+            return node;
+        }
+
+    private:
+        friend class Snapshot;
+
+        struct Base {
+            const NodeRecord *nodes;
+            const AttributeRecord *attributes;
+            const char *strings;
+        };
+
+        Base base_;
+        const NodeRecord *record_;
+
+        NodeView(Base base, const NodeRecord *record) : base_(base), record_(record) {}
+
+        std::string_view string(StringRef ref) const { return std::string_view(base_.strings + ref.offset, ref.size); }
+    };
+
+    // Lets Serializer::html<ViewAccess> render a view in place: text and attributes are read straight out of the
+    // mapping, and no markdown::Node is built.
+    struct ViewAccess {
+        using Node = NodeView;
+
+        static NodeType type(const NodeView &node) { return node.type(); }
+        static int level(const NodeView &node) { return node.level(); }
+        static std::string_view text(const NodeView &node) { return node.text(); }
+        static size_t child_count(const NodeView &node) { return node.child_count(); }
+        static NodeView child(const NodeView &node, size_t index) { return node.child(index); }
+
+        static std::optional<std::string_view> attribute(const NodeView &node, html::Symbol name) {
+            return node.attribute(name.view());
+        }
+    };
+
+    // A mapped snapshot. Views stay valid for as long as the Snapshot (or whatever it was moved into) lives.
+    class Snapshot {
+    public:
+        // nullopt if the file is missing, truncated, from another format version or byte order, or (when
+        // expected_source_hash is given) was taken from different source text.
+        static std::optional<Snapshot> open(const std::filesystem::path &path,
+                                            std::optional<uint64_t> expected_source_hash = std::nullopt) {
+            auto mapping = detail::Mapping::open(path);
+            if(!mapping || mapping->size() < sizeof(Header)) {
+                return std::nullopt;
+            }
+
+            Header header;
+            std::memcpy(&header, mapping->data(), sizeof(Header));
+            if(std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != FORMAT_VERSION ||
+               header.byte_order != BYTE_ORDER_MARK || header.total_size != mapping->size()) {
+                return std::nullopt;
+            }
+            if(expected_source_hash && header.source_hash != *expected_source_hash) {
+                return std::nullopt;
+            }
+
+            Snapshot snapshot(std::move(mapping), header);
+            if(!snapshot.valid()) {
+                return std::nullopt;
+            }
+            return snapshot;
+        }
+
+        NodeView root() const { return NodeView(base_, base_.nodes); }
+        size_t node_count() const { return header_.node_count; }
+        uint64_t source_hash() const { return header_.source_hash; }
+
+    private:
+        std::unique_ptr<detail::Mapping> mapping_;
+        Header header_;
+        NodeView::Base base_;
+
+        Snapshot(std::unique_ptr<detail::Mapping> mapping, const Header &header)
+            : mapping_(std::move(mapping)), header_(header) {
+            const char *data = mapping_->data();
+            base_.nodes = reinterpret_cast<const NodeRecord *>(data + header_.nodes_offset);
+            base_.attributes = reinterpret_cast<const AttributeRecord *>(data + header_.attributes_offset);
+            base_.strings = data + header_.strings_offset;
+        }
+
+        // Bounds-checks every offset once, so walking the views afterwards cannot leave the mapping.
+        bool valid() const {
+            const Header &h = header_;
+            if(h.node_count == 0 || h.nodes_offset % 8 != 0 || h.attributes_offset % 8 != 0 ||
+               h.nodes_offset < sizeof(Header) ||
+               h.nodes_offset + uint64_t(h.node_count) * sizeof(NodeRecord) > h.attributes_offset ||
+               h.attributes_offset + uint64_t(h.attribute_count) * sizeof(AttributeRecord) > h.strings_offset ||
+               h.strings_offset + h.strings_size != h.total_size) {
+                return false;
+            }
+
+            auto string_ok = [&h](StringRef ref) { return uint64_t(ref.offset) + ref.size <= h.strings_size; };
+            for(uint32_t i = 0; i < h.node_count; ++i) {
+                const NodeRecord &node = base_.nodes[i];
+                if(node.type > static_cast<uint32_t>(NodeType::HorizontalRule) || !string_ok(node.text) ||
+                   uint64_t(node.attribute_count) + node.first_attribute > h.attribute_count) {
+                    return false;
+                }
+                if(node.child_count > 0 &&
+                   (node.first_child <= i || uint64_t(node.first_child) + node.child_count > h.node_count)) {
+                    return false;
+                }
+            }
+            for(uint32_t i = 0; i < h.attribute_count; ++i) {
+                if(!string_ok(base_.attributes[i].name) || !string_ok(base_.attributes[i].value)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+} // namespace markdown::snapshot
@@ -1,10 +1,18 @@
 #include "../../includes/tests.hpp"
 
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 
 #include "markdown.hpp"
+#include "snapshot.hpp"
 
 std::string normalize_html(const std::string &html) {
     std::string result;
@@ -230,6 +238,235 @@ TEST(HtmlSerialization) {
     }
 }
 
+TEST(HtmlSerializationWithHighlighting) {
+    markdown::Node document = markdown::Deserializer::deserialize("```cpp\nreturn a < b;\n```\n\n```text\nplain <b>\n```");
+    markdown::HtmlOptions options;
+    options.highlight_code = true;
+
+    std::string html_output = markdown::Serializer::html(document, options);
+    std::cout << "HTML with highlighted code:\n" << html_output;
+
+    ASSERT_TRUE(html_output.find("<code class=\"language-cpp highlighted\"><span class=\"tok-keyword\">return</span> a "
+                                 "&lt; b;</code>") != std::string::npos);
+    ASSERT_TRUE(html_output.find("<code class=\"language-text\">plain <b></code>") != std::string::npos);
+}
+
+TEST(HtmlSerializationWithImageSizes) {
+    markdown::Node document =
+        markdown::Deserializer::deserialize("See [the docs](/docs) and ![A chart](chart.png) or ![Remote](https://x/y.png)");
+    markdown::HtmlOptions options;
+    options.lazy_images = true;
+    options.image_size = [](const std::string &src) -> std::optional<markdown::ImageSize> {
+        if(src == "chart.png") {
+            return markdown::ImageSize{640, 480};
+        }
+        return std::nullopt;
+    };
+
+    std::string html_output = markdown::Serializer::html(document, options);
+    std::cout << "HTML with sized images:\n" << html_output;
+
+    ASSERT_TRUE(html_output.find("<a class=\"link\" href=\"/docs\">the docs</a>") != std::string::npos);
+    ASSERT_TRUE(html_output.find("<img alt=\"A chart\" class=\"image\" decoding=\"async\" height=\"480\" loading=\"lazy\" "
+                                 "src=\"chart.png\" width=\"640\" />") != std::string::npos);
+    ASSERT_TRUE(html_output.find("<img alt=\"Remote\" class=\"image\" decoding=\"async\" loading=\"lazy\" "
+                                 "src=\"https://x/y.png\" />") != std::string::npos);
+    ASSERT_TRUE(html_output.find("!<") == std::string::npos);
+}
+
+TEST(HtmlClassProfiles) {
+    markdown::Node document =
+        markdown::Deserializer::deserialize("# Title\n\nSome **bold** text\n\n```cpp\nint x;\n```\n\n- item");
+
+    markdown::HtmlOptions compact;
+    compact.class_profile = markdown::ClassProfile::Compact;
+    std::string compact_html = markdown::Serializer::html(document, compact);
+    std::cout << "Compact HTML:\n" << compact_html;
+
+    ASSERT_TRUE(compact_html.find("<h1>Title</h1>") != std::string::npos);
+    ASSERT_TRUE(compact_html.find("<strong>bold</strong>") != std::string::npos);
+    ASSERT_TRUE(compact_html.find("<pre>") != std::string::npos);
+    ASSERT_TRUE(compact_html.find("<code class=\"language-cpp\">int x;</code>") != std::string::npos);
+    ASSERT_TRUE(compact_html.find("<li>") != std::string::npos);
+    ASSERT_TRUE(compact_html.find("class=\"paragraph\"") == std::string::npos);
+
+    markdown::HtmlOptions mapped;
+    mapped.class_profile = markdown::ClassProfile::Mapped;
+    mapped.class_names = std::make_shared<const markdown::MappedClasses>(
+        markdown::MappedClasses::from({{"paragraph", "p"}, {"code-block", "code"}}));
+    std::string mapped_html = markdown::Serializer::html(document, mapped);
+
+    ASSERT_TRUE(mapped_html.find("<p class=\"p\">") != std::string::npos);
+    ASSERT_TRUE(mapped_html.find("<pre class=\"code\">") != std::string::npos);
+    ASSERT_TRUE(mapped_html.find("<h1>Title</h1>") != std::string::npos);
+    ASSERT_EQ(markdown::Serializer::html(document), markdown::Serializer::html(document, markdown::HtmlOptions{}));
+
+    bool rejected = false;
+    try {
+        markdown::MappedClasses::from({{"para", "p"}});
+    } catch(const std::invalid_argument &) {
+        rejected = true;
+    }
+    ASSERT_TRUE(rejected);
+}
+
+TEST(StreamingMatchesSerialParser) {
+    std::string input = "# Title\n\nFirst paragraph\ncontinues here with **bold**.\n\n```cpp\nint x;\n\nint y;\n```\n"
+                        "- one\n- two\n1. three\n\n| a | b |\n|---|---|\n| 1 | 2 |\n> quote\n---\nTrailing line";
+    std::string expected = markdown::Serializer::html(markdown::Deserializer::deserialize(input));
+
+    for(size_t chunk_size : {size_t(1), size_t(3), size_t(7), size_t(64), input.size()}) {
+        std::string output;
+        markdown::HtmlStreamWriter writer([&output](std::string_view markup) { output.append(markup); });
+        markdown::StreamingDeserializer parser([&writer](markdown::Node &&block) { writer.block(block); });
+        for(size_t i = 0; i < input.size(); i += chunk_size) {
+            parser.feed(std::string_view(input).substr(i, chunk_size));
+        }
+        parser.finish();
+        writer.finish();
+        ASSERT_EQ(output, expected);
+    }
+
+    std::istringstream stream(input);
+    std::ostringstream streamed;
+    markdown::render_html_stream(stream, streamed);
+    ASSERT_EQ(streamed.str(), expected);
+    std::cout << "Streaming output matches serial output for every chunk size";
+}
+
+TEST(StreamingBuffersOnlyOpenBlock) {
+    std::string input;
+    for(int i = 0; i < 2000; ++i) {
+        input += "## Section " + std::to_string(i) + "\n\nSome text for section " + std::to_string(i) + ".\n\n";
+    }
+
+    size_t blocks = 0;
+    markdown::StreamingDeserializer parser([&blocks](markdown::Node &&) { ++blocks; });
+    for(size_t i = 0; i < input.size(); i += 4096) {
+        parser.feed(std::string_view(input).substr(i, 4096));
+    }
+    parser.finish();
+
+    ASSERT_EQ(blocks, size_t(4000));
+    ASSERT_TRUE(parser.peak_buffered_bytes() < 4096 + 256);
+    std::cout << "Peak buffered: " << parser.peak_buffered_bytes() << " of " << input.size() << " bytes";
+}
+
+TEST(ParallelMatchesSerialParser) {
+    std::string input;
+    for(int i = 0; i < 40; ++i) {
+        std::string n = std::to_string(i);
+        input += "## Part " + n + "\n\nText " + n + " with *emphasis*\nand a second line.\n\n";
+        input += "```python\ndef f" + n + "():\n\n    return 1\n```\n\n";
+        input += "- a\n- b\n\n| x | y |\n|---|---|\n| " + n + " | 2 |\n\n";
+        input += "Paragraph that mentions\n```\n\nnot a fence above\n\n> quote " + n + "\n***\n";
+    }
+
+    markdown::Node serial = markdown::Deserializer::deserialize(input);
+    ssg::utils::ThreadPool pool(4);
+    markdown::Node parallel = markdown::Deserializer::deserialize_parallel(input, pool, 64);
+
+    ASSERT_EQ(parallel.children.size(), serial.children.size());
+    ASSERT_EQ(markdown::Serializer::html(parallel), markdown::Serializer::html(serial));
+    ASSERT_EQ(markdown::Serializer::markdown(parallel), markdown::Serializer::markdown(serial));
+    std::cout << "Parallel parse produced the same " << parallel.children.size() << " blocks";
+}
+
+TEST(ParallelParseFromInsidePoolTask) {
+    std::string input;
+    for(int i = 0; i < 200; ++i) {
+        input += "Line " + std::to_string(i) + "\n\n";
+    }
+    std::string expected = markdown::Serializer::html(markdown::Deserializer::deserialize(input));
+
+    // Every worker is busy with the outer job, so the caller has to parse the chunks itself.
+    ssg::utils::ThreadPool pool(2);
+    std::mutex mutex;
+    std::condition_variable done;
+    int finished = 0;
+    std::string results[2];
+    for(int i = 0; i < 2; ++i) {
+        pool.submit([&, i] {
+            results[i] = markdown::Serializer::html(markdown::Deserializer::deserialize_parallel(input, pool, 16));
+            std::lock_guard<std::mutex> lock(mutex);
+            ++finished;
+            done.notify_all();
+        });
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [&] { return finished == 2; });
+    ASSERT_EQ(results[0], expected);
+    ASSERT_EQ(results[1], expected);
+    std::cout << "Nested parallel parses completed without waiting on the busy pool";
+}
+
+TEST(SnapshotRoundTrip) {
+    std::string input = "# Title\n\nSome **bold** and [a link](/x).\n\n```cpp\nint x;\n```\n- one\n- two\n\n| a | b |\n| 1 | 2 |\n\n![pic](/p.png)";
+    markdown::Node document = markdown::Deserializer::deserialize(input);
+    auto path = std::filesystem::temp_directory_path() / "chisel_snapshot_test.mdast";
+    ASSERT_TRUE(markdown::snapshot::write(path, document, 42));
+
+    auto snapshot = markdown::snapshot::Snapshot::open(path, 42);
+    ASSERT_TRUE(snapshot.has_value());
+
+    auto root = snapshot->root();
+    ASSERT_EQ(root.type(), markdown::NodeType::Document);
+    ASSERT_EQ(root.child_count(), document.children.size());
+    ASSERT_EQ(root.child(0).text(), "Title");
+    ASSERT_EQ(root.child(0).level(), 1);
+    ASSERT_TRUE(root.child(2).attribute("language") == std::optional<std::string_view>("cpp"));
+    ASSERT_EQ(markdown::Serializer::html(root.to_node()), markdown::Serializer::html(document));
+    ASSERT_EQ(markdown::Serializer::html<markdown::snapshot::ViewAccess>(root), markdown::Serializer::html(document));
+
+    markdown::HtmlOptions options;
+    options.highlight_code = true;
+    options.lazy_images = true;
+    options.class_profile = markdown::ClassProfile::Compact;
+    ASSERT_EQ(markdown::Serializer::html<markdown::snapshot::ViewAccess>(root, options),
+              markdown::Serializer::html(document, options));
+    std::cout << "Snapshot of " << snapshot->node_count() << " nodes walked in place";
+
+    std::filesystem::remove(path);
+}
+
+TEST(SnapshotRejectsStaleFiles) {
+    markdown::Node document = markdown::Deserializer::deserialize("Hello *world*");
+    auto path = std::filesystem::temp_directory_path() / "chisel_snapshot_stale.mdast";
+    std::string bytes = markdown::snapshot::encode(document, 7);
+
+    auto write_bytes = [&path](const std::string &data) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    };
+
+    write_bytes(bytes);
+    ASSERT_TRUE(markdown::snapshot::Snapshot::open(path).has_value());
+    ASSERT_TRUE(!markdown::snapshot::Snapshot::open(path, 8).has_value());
+
+    std::string old_version = bytes;
+    old_version[8] = static_cast<char>(markdown::snapshot::FORMAT_VERSION + 1);
+    write_bytes(old_version);
+    ASSERT_TRUE(!markdown::snapshot::Snapshot::open(path).has_value());
+
+    write_bytes(bytes.substr(0, bytes.size() - 1));
+    ASSERT_TRUE(!markdown::snapshot::Snapshot::open(path).has_value());
+
+    std::string bad_child = bytes;
+    markdown::snapshot::Header header;
+    std::memcpy(&header, bad_child.data(), sizeof(header));
+    markdown::snapshot::NodeRecord root_record;
+    std::memcpy(&root_record, bad_child.data() + header.nodes_offset, sizeof(root_record));
+    root_record.child_count = 1000;
+    std::memcpy(bad_child.data() + header.nodes_offset, &root_record, sizeof(root_record));
+    write_bytes(bad_child);
+    ASSERT_TRUE(!markdown::snapshot::Snapshot::open(path).has_value());
+
+    std::filesystem::remove(path);
+    ASSERT_TRUE(!markdown::snapshot::Snapshot::open(path).has_value());
+    std::cout << "Stale, truncated and corrupt snapshots are rejected";
+}
+
 TEST(HtmlEscaping) {
     markdown::Node document(markdown::NodeType::Document);
 
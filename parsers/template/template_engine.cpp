@@ -1,15 +1,94 @@
 #include "template_engine.hpp"
 
 #include <algorithm>
+#include <cstdlib>
 #include <ctime>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <sstream>
+#include <stdexcept>
+
+#include "../../utils/simd.hpp"
 
 namespace ssg::template_engine {
     std::map<std::string, TemplateHelper> TemplateEngine::helpers_;
+    std::map<std::string, TemplateValueHelper> TemplateEngine::value_helpers_;
     std::function<std::string(const std::string &)> TemplateEngine::partial_loader_;
 
+    namespace {
+        std::vector<std::string> split_key(const std::string &key) {
+            std::vector<std::string> parts;
+            std::stringstream ss(key);
+            std::string part;
+            while(std::getline(ss, part, '.')) {
+                if(!part.empty()) {
+                    parts.push_back(part);
+                }
+            }
+            return parts;
+        }
+
+        bool values_equal(const TemplateValue &a, const TemplateValue &b) {
+            if(a.type == TemplateValue::NUMBER && b.type == TemplateValue::NUMBER) {
+                return a.number_value == b.number_value;
+            }
+            return a.to_string() == b.to_string();
+        }
+
+        // Numbers and dates order numerically and before everything else, which orders by its text.
+        struct SortKey {
+            bool numeric = false;
+            double number = 0.0;
+            std::string text;
+
+            explicit SortKey(const TemplateValue &value) {
+                if(value.type == TemplateValue::NUMBER) {
+                    numeric = true;
+                    number = value.number_value;
+                } else if(value.type == TemplateValue::DATE) {
+                    numeric = true;
+                    number = std::chrono::duration<double>(value.date_value.time_since_epoch()).count();
+                } else {
+                    text = value.to_string();
+                }
+            }
+
+            bool operator<(const SortKey &other) const {
+                if(numeric != other.numeric) {
+                    return numeric;
+                }
+                return numeric ? number < other.number : text < other.text;
+            }
+        };
+
+        CollectionView as_view(const TemplateValue &value) {
+            if(value.type == TemplateValue::VIEW && value.view_value) {
+                return *value.view_value;
+            }
+            // A plain array gets a private collection, so its sort orders are not shared with anything.
+            std::vector<TemplateValue> items;
+            if(value.type == TemplateValue::ARRAY) {
+                items = value.array_value;
+            }
+            return CollectionView(std::make_shared<const TemplateCollection>(std::move(items)));
+        }
+
+        size_t as_count(const TemplateValue &value) {
+            double count = 0.0;
+            if(value.type == TemplateValue::NUMBER) {
+                count = value.number_value;
+            } else {
+                try {
+                    count = std::stod(value.to_string());
+                } catch(...) {
+                    throw std::runtime_error("expected a count, got '" + value.to_string() + "'");
+                }
+            }
+            return count > 0.0 ? static_cast<size_t>(count) : 0;
+        }
+    } // namespace
+
     TemplateValue TemplateValue::get_nested_property(const std::vector<std::string> &path) const {
         if(path.empty()) {
             return *this;
@@ -33,14 +112,185 @@ namespace ssg::template_engine {
         return it->second.get_nested_property(remaining_path);
     }
 
-    std::string TemplateEngine::render(const std::string &template_str,
-                                       const std::map<std::string, TemplateValue> &context) {
-        if(helpers_.empty()) {
-            register_default_helpers();
+    TemplateValue TemplateValue::collection(std::vector<TemplateValue> items) {
+        return TemplateValue(
+            std::make_shared<const CollectionView>(std::make_shared<const TemplateCollection>(std::move(items))));
+    }
+
+    void TemplateValue::for_each_item(const std::function<bool(const TemplateValue &)> &visit) const {
+        if(type == ARRAY) {
+            for(const auto &item : array_value) {
+                if(!visit(item)) {
+                    return;
+                }
+            }
+        } else if(type == VIEW && view_value) {
+            view_value->for_each(visit);
         }
+    }
 
-        Parser parser(template_str, context);
-        std::string result = parser.parse();
+    bool TemplateValue::view_is_empty() const {
+        bool empty = true;
+        for_each_item([&empty](const TemplateValue &) {
+            empty = false;
+            return false;
+        });
+        return empty;
+    }
+
+    std::shared_ptr<const std::vector<uint32_t>> TemplateCollection::order_by(const std::string &key,
+                                                                              bool descending) const {
+        // Held while sorting: pages asking for the same order wait for the first one instead of repeating it.
+        std::lock_guard<std::mutex> lock(orders_mutex_);
+        auto &order = orders_[{key, descending}];
+        if(order) {
+            return order;
+        }
+
+        std::vector<std::string> path = split_key(key);
+        std::vector<SortKey> keys;
+        keys.reserve(items_.size());
+        for(const auto &item : items_) {
+            keys.emplace_back(item.get_nested_property(path));
+        }
+
+        auto indices = std::make_shared<std::vector<uint32_t>>(items_.size());
+        for(uint32_t i = 0; i < indices->size(); ++i) {
+            (*indices)[i] = i;
+        }
+        std::stable_sort(indices->begin(), indices->end(), [&](uint32_t a, uint32_t b) {
+            return descending ? keys[b] < keys[a] : keys[a] < keys[b];
+        });
+        order = indices;
+        return order;
+    }
+
+    CollectionView CollectionView::where(const std::string &key, const std::optional<TemplateValue> &value) const {
+        CollectionView view = *this;
+        view.stages_.push_back({Stage::WHERE, split_key(key), value});
+        return view;
+    }
+
+    CollectionView CollectionView::sort_by(const std::string &key, bool descending) const {
+        // Filters commute with sorting, so they stay lazy on top of the shared order; once the view has been
+        // sliced, only its own items can be reordered and they get a collection of their own.
+        bool sliced =
+            std::any_of(stages_.begin(), stages_.end(), [](const Stage &stage) { return stage.kind != Stage::WHERE; });
+        CollectionView view = sliced ? CollectionView(std::make_shared<const TemplateCollection>(materialize())) : *this;
+        view.order_ = view.source_->order_by(key, descending);
+        return view;
+    }
+
+    CollectionView CollectionView::offset(size_t count) const {
+        CollectionView view = *this;
+        view.stages_.push_back({Stage::OFFSET, {}, std::nullopt, count});
+        return view;
+    }
+
+    CollectionView CollectionView::limit(size_t count) const {
+        CollectionView view = *this;
+        view.stages_.push_back({Stage::LIMIT, {}, std::nullopt, count});
+        return view;
+    }
+
+    void CollectionView::for_each(const std::function<bool(const TemplateValue &)> &visit) const {
+        const auto &items = source_->items();
+
+        // Offsets ahead of any filter skip by index instead of visiting the items.
+        size_t position = 0;
+        size_t first_stage = 0;
+        while(first_stage < stages_.size() && stages_[first_stage].kind == Stage::OFFSET) {
+            position += stages_[first_stage++].count;
+        }
+
+        std::vector<size_t> passed(stages_.size(), 0);
+        for(; position < items.size(); ++position) {
+            const TemplateValue &item = items[order_ ? (*order_)[position] : position];
+            bool keep = true;
+            for(size_t i = first_stage; keep && i < stages_.size(); ++i) {
+                const Stage &stage = stages_[i];
+                switch(stage.kind) {
+                case Stage::WHERE: {
+                    TemplateValue property = item.get_nested_property(stage.path);
+                    keep = stage.value ? values_equal(property, *stage.value) : property.is_truthy();
+                    break;
+                }
+                case Stage::OFFSET:
+                    keep = passed[i]++ >= stage.count;
+                    break;
+                case Stage::LIMIT:
+                    // Nothing later in the source can get past a full limit.
+                    if(passed[i] >= stage.count) {
+                        return;
+                    }
+                    passed[i]++;
+                    break;
+                }
+            }
+            if(keep && !visit(item)) {
+                return;
+            }
+        }
+    }
+
+    size_t CollectionView::size() const {
+        size_t count = 0;
+        for_each([&count](const TemplateValue &) {
+            count++;
+            return true;
+        });
+        return count;
+    }
+
+    std::vector<TemplateValue> CollectionView::materialize() const {
+        std::vector<TemplateValue> items;
+        for_each([&items](const TemplateValue &item) {
+            items.push_back(item);
+            return true;
+        });
+        return items;
+    }
+
+    void RenderOutput::append(std::string_view text) {
+        buffer_.append(text.data(), text.size());
+        if(!writer_ || buffer_.size() < chunk_size_) {
+            return;
+        }
+        size_t written = 0;
+        for(; buffer_.size() - written >= chunk_size_; written += chunk_size_) {
+            writer_(std::string_view(buffer_).substr(written, chunk_size_));
+        }
+        buffer_.erase(0, written);
+    }
+
+    void RenderOutput::flush() {
+        if(writer_ && !buffer_.empty()) {
+            writer_(buffer_);
+            buffer_.clear();
+        }
+    }
+
+    void TemplateEngine::render_into(const std::string &template_str,
+                                     const std::map<std::string, TemplateValue> &context, RenderOutput &out) {
+        // Pages render concurrently, so the lazy default registration must happen exactly once.
+        // Helpers registered before that keep precedence over defaults of the same name.
+        static std::once_flag default_helpers_once;
+        std::call_once(default_helpers_once, [] {
+            auto custom_helpers = std::move(helpers_);
+            auto custom_value_helpers = std::move(value_helpers_);
+            helpers_.clear();
+            value_helpers_.clear();
+            register_default_helpers();
+            for(auto &[name, helper] : custom_helpers) {
+                helpers_[name] = std::move(helper);
+            }
+            for(auto &[name, helper] : custom_value_helpers) {
+                value_helpers_[name] = std::move(helper);
+            }
+        });
+
+        Parser parser(template_str, context, out);
+        parser.parse();
 
         if(!parser.errors.empty()) {
             std::cerr << "Template rendering errors:\n";
@@ -48,8 +298,20 @@ namespace ssg::template_engine {
                 std::cerr << "  Error at position " << error.position << ": " << error.message << "\n";
             }
         }
+    }
 
-        return result;
+    std::string TemplateEngine::render(const std::string &template_str,
+                                       const std::map<std::string, TemplateValue> &context) {
+        RenderOutput out;
+        render_into(template_str, context, out);
+        return out.take();
+    }
+
+    void TemplateEngine::render(const std::string &template_str, const std::map<std::string, TemplateValue> &context,
+                                const ChunkWriter &write_chunk, size_t chunk_size) {
+        RenderOutput out(write_chunk, chunk_size);
+        render_into(template_str, context, out);
+        out.flush();
     }
 
     std::string TemplateEngine::render_with_layout(const std::string &layout_path, const std::string &content_template,
@@ -73,49 +335,60 @@ namespace ssg::template_engine {
 
     void TemplateEngine::register_helper(const std::string &name, TemplateHelper helper) { helpers_[name] = helper; }
 
+    void TemplateEngine::register_value_helper(const std::string &name, TemplateValueHelper helper) {
+        value_helpers_[name] = helper;
+    }
+
     void TemplateEngine::set_partial_loader(std::function<std::string(const std::string &)> loader) {
         partial_loader_ = loader;
     }
 
-    std::string TemplateEngine::Parser::parse() {
-        std::string result;
+    void TemplateEngine::Parser::parse() {
         pos = 0;
 
+        static constexpr utils::simd::ByteSet open_brace("{");
+
         while(!at_end()) {
+            std::string_view rest = std::string_view(template_str).substr(pos);
+            size_t run = utils::simd::find_first_of(rest, open_brace);
+            out.append(rest.substr(0, run));
+            pos += run;
+            if(at_end()) {
+                break;
+            }
             if(match("{{")) {
-                result += parse_block();
+                parse_block();
             } else {
-                result += advance();
+                out.append(advance());
             }
         }
-
-        return result;
     }
 
-    std::string TemplateEngine::Parser::parse_block() {
+    void TemplateEngine::Parser::parse_block() {
         skip_whitespace();
 
         if(match_keyword("#if")) {
-            return parse_if_block();
+            parse_if_block();
         } else if(match_keyword("#each")) {
-            return parse_each_block();
+            parse_each_block();
         } else if(match_keyword("#for")) {
-            return parse_for_block();
+            parse_for_block();
         } else if(match_keyword(">")) {
-            return parse_partial();
+            parse_partial();
         } else if(peek() == '#') {
-            return parse_helper_call();
+            parse_helper_call();
         } else {
-            return parse_variable();
+            parse_variable();
         }
     }
 
-    std::string TemplateEngine::Parser::parse_if_block() {
+    void TemplateEngine::Parser::parse_if_block() {
         skip_whitespace();
         std::string condition = extract_condition();
 
         if(!match("}}")) {
-            return "{{#if " + condition;
+            out.append("{{#if " + condition);
+            return;
         }
 
         std::string true_content = extract_until("{{/if}}");
@@ -127,90 +400,86 @@ namespace ssg::template_engine {
             true_content = true_content.substr(0, else_pos);
         }
 
-        TemplateValue condition_value = resolve_variable(condition);
+        TemplateValue condition_value = evaluate(condition);
 
         if(condition_value.is_truthy()) {
-            Parser sub_parser(true_content, context);
-            return sub_parser.parse();
+            Parser sub_parser(true_content, context, out);
+            sub_parser.parse();
         } else if(!false_content.empty()) {
-            Parser sub_parser(false_content, context);
-            return sub_parser.parse();
+            Parser sub_parser(false_content, context, out);
+            sub_parser.parse();
         }
-
-        return "";
     }
 
-    std::string TemplateEngine::Parser::parse_each_block() {
+    void TemplateEngine::Parser::parse_each_block() {
         skip_whitespace();
         std::string collection_name = extract_collection_name();
 
         if(!match("}}")) {
-            return "{{#each " + collection_name;
+            out.append("{{#each " + collection_name);
+            return;
         }
 
         std::string loop_content = extract_until("{{/each}}");
-        TemplateValue collection = resolve_variable(collection_name);
-
-        if(collection.type != TemplateValue::ARRAY) {
-            return "";
-        }
+        TemplateValue collection = evaluate(collection_name);
 
-        std::string result;
-        for(const auto &item : collection.array_value) {
+        collection.for_each_item([&](const TemplateValue &item) {
             std::map<std::string, TemplateValue> loop_context = context;
             loop_context["this"] = item;
 
-            Parser sub_parser(loop_content, loop_context);
-            result += sub_parser.parse();
-        }
-
-        return result;
+            Parser sub_parser(loop_content, loop_context, out);
+            sub_parser.parse();
+            return true;
+        });
     }
 
-    std::string TemplateEngine::Parser::parse_for_block() {
+    void TemplateEngine::Parser::parse_for_block() {
         skip_whitespace();
         std::string var_name = extract_variable_name();
         skip_whitespace();
 
         if(!match("in")) {
-            return "{{#for " + var_name;
+            out.append("{{#for " + var_name);
+            return;
         }
 
         skip_whitespace();
         std::string collection_name = extract_collection_name();
 
         if(!match("}}")) {
-            return "{{#for " + var_name + " in " + collection_name;
+            out.append("{{#for " + var_name + " in " + collection_name);
+            return;
         }
 
         std::string loop_content = extract_until("{{/for}}");
-        TemplateValue collection = resolve_variable(collection_name);
-
-        if(collection.type != TemplateValue::ARRAY) {
-            return "";
-        }
+        TemplateValue collection = evaluate(collection_name);
 
-        std::string result;
-        for(const auto &item : collection.array_value) {
+        collection.for_each_item([&](const TemplateValue &item) {
             std::map<std::string, TemplateValue> loop_context = context;
             loop_context[var_name] = item;
 
-            Parser sub_parser(loop_content, loop_context);
-            result += sub_parser.parse();
-        }
-
-        return result;
+            Parser sub_parser(loop_content, loop_context, out);
+            sub_parser.parse();
+            return true;
+        });
     }
 
-    std::string TemplateEngine::Parser::parse_variable() {
+    void TemplateEngine::Parser::parse_variable() {
         std::string var_name = extract_variable_name();
 
         if(!match("}}")) {
-            return "{{" + var_name;
+            out.append("{{" + var_name);
+            return;
         }
 
-        TemplateValue value = resolve_variable(var_name);
-        return value.to_string();
+        // Plain strings (the page body above all) are written from the context without a copy.
+        auto it = context.find(var_name);
+        if(it != context.end() && it->second.type == TemplateValue::STRING) {
+            out.append(it->second.string_value);
+            return;
+        }
+
+        out.append(resolve_variable(var_name).to_string());
     }
 
     bool TemplateEngine::Parser::match(const std::string &pattern) {
@@ -287,7 +556,31 @@ namespace ssg::template_engine {
         return template_str.substr(start_pos, pos - start_pos);
     }
 
-    std::string TemplateEngine::Parser::extract_collection_name() { return extract_variable_name(); }
+    std::string TemplateEngine::Parser::extract_collection_name() {
+        skip_whitespace();
+        if(peek() != '(') {
+            return extract_variable_name();
+        }
+
+        size_t start_pos = pos;
+        int depth = 0;
+        char quote = '\0';
+        while(!at_end()) {
+            char c = advance();
+            if(quote) {
+                quote = c == quote ? '\0' : quote;
+            } else if(c == '"' || c == '\'') {
+                quote = c;
+            } else if(c == '(') {
+                depth++;
+            } else if(c == ')' && --depth == 0) {
+                break;
+            }
+        }
+        std::string expression = template_str.substr(start_pos, pos - start_pos);
+        skip_whitespace();
+        return expression;
+    }
 
     void TemplateEngine::Parser::skip_whitespace() {
         while(!at_end() && std::isspace(peek())) {
@@ -324,6 +617,61 @@ namespace ssg::template_engine {
         return TemplateValue("");
     }
 
+    TemplateValue TemplateEngine::Parser::evaluate(const std::string &expression) {
+        size_t begin = expression.find_first_not_of(" \t\r\n");
+        if(begin == std::string::npos) {
+            return TemplateValue("");
+        }
+        size_t end = expression.find_last_not_of(" \t\r\n");
+        std::string term = expression.substr(begin, end - begin + 1);
+
+        if(term.front() == '(' && term.back() == ')') {
+            return evaluate_subexpression(term.substr(1, term.length() - 2));
+        }
+        if(term.length() >= 2 && (term.front() == '"' || term.front() == '\'') && term.back() == term.front()) {
+            return TemplateValue(term.substr(1, term.length() - 2));
+        }
+        if(std::isdigit(static_cast<unsigned char>(term.front())) ||
+           (term.length() > 1 && term.front() == '-' && std::isdigit(static_cast<unsigned char>(term[1])))) {
+            char *number_end = nullptr;
+            double number = std::strtod(term.c_str(), &number_end);
+            if(number_end == term.c_str() + term.length()) {
+                return TemplateValue(number);
+            }
+        }
+        return resolve_variable(term);
+    }
+
+    TemplateValue TemplateEngine::Parser::evaluate_subexpression(const std::string &expression) {
+        std::vector<std::string> terms = split_arguments(expression);
+        if(terms.empty()) {
+            return TemplateValue("");
+        }
+
+        const std::string &helper_name = terms[0];
+        std::vector<TemplateValue> args;
+        for(size_t i = 1; i < terms.size(); ++i) {
+            args.push_back(evaluate(terms[i]));
+        }
+
+        try {
+            auto value_helper_it = value_helpers_.find(helper_name);
+            if(value_helper_it != value_helpers_.end()) {
+                return value_helper_it->second(args);
+            }
+            auto helper_it = helpers_.find(helper_name);
+            if(helper_it != helpers_.end()) {
+                return TemplateValue(helper_it->second(args));
+            }
+        } catch(const std::exception &e) {
+            add_error(TemplateError::HELPER_ERROR, "Helper '" + helper_name + "' error: " + e.what());
+            return TemplateValue("");
+        }
+
+        add_error(TemplateError::HELPER_ERROR, "Unknown helper: " + helper_name);
+        return TemplateValue("");
+    }
+
     TemplateValue TemplateEngine::Parser::resolve_nested_variable(const std::string &path) const {
         std::vector<std::string> path_parts = split_path(path);
         if(path_parts.empty()) {
@@ -343,7 +691,7 @@ namespace ssg::template_engine {
         return it->second.get_nested_property(nested_path);
     }
 
-    std::string TemplateEngine::Parser::parse_helper_call() {
+    void TemplateEngine::Parser::parse_helper_call() {
         advance();
         std::string helper_name = extract_variable_name();
         skip_whitespace();
@@ -352,47 +700,48 @@ namespace ssg::template_engine {
 
         if(!match("}}")) {
             add_error(TemplateError::SYNTAX_ERROR, "Unclosed helper call: " + helper_name);
-            return "{{#" + helper_name + " " + args_str;
+            out.append("{{#" + helper_name + " " + args_str);
+            return;
         }
 
         auto helper_it = helpers_.find(helper_name);
         if(helper_it == helpers_.end()) {
             add_error(TemplateError::HELPER_ERROR, "Unknown helper: " + helper_name);
-            return "";
+            return;
         }
 
         std::vector<TemplateValue> args = parse_helper_arguments(args_str);
 
         try {
-            return helper_it->second(args);
+            out.append(helper_it->second(args));
         } catch(const std::exception &e) {
             add_error(TemplateError::HELPER_ERROR, "Helper '" + helper_name + "' error: " + e.what());
-            return "";
         }
     }
 
-    std::string TemplateEngine::Parser::parse_partial() {
+    void TemplateEngine::Parser::parse_partial() {
         skip_whitespace();
         std::string partial_name = extract_variable_name();
 
         if(!match("}}")) {
             add_error(TemplateError::SYNTAX_ERROR, "Unclosed partial: " + partial_name);
-            return "{{>" + partial_name;
+            out.append("{{>" + partial_name);
+            return;
         }
 
         if(!partial_loader_) {
             add_error(TemplateError::PARSE_ERROR, "No partial loader configured");
-            return "";
+            return;
         }
 
         std::string partial_content = partial_loader_(partial_name);
         if(partial_content.empty()) {
             add_error(TemplateError::PARSE_ERROR, "Partial not found: " + partial_name);
-            return "";
+            return;
         }
 
-        Parser sub_parser(partial_content, context);
-        return sub_parser.parse();
+        Parser sub_parser(partial_content, context, out);
+        sub_parser.parse();
     }
 
     std::string TemplateEngine::Parser::extract_helper_args() {
@@ -429,21 +778,42 @@ namespace ssg::template_engine {
         return parts;
     }
 
-    std::vector<TemplateValue> TemplateEngine::Parser::parse_helper_arguments(const std::string &args_str) const {
-        std::vector<TemplateValue> args;
-        std::stringstream ss(args_str);
-        std::string arg;
-
-        while(ss >> arg) {
-            if(arg.front() == '"' && arg.back() == '"') {
-                args.emplace_back(arg.substr(1, arg.length() - 2));
-            } else if(arg.front() == '\'' && arg.back() == '\'') {
-                args.emplace_back(arg.substr(1, arg.length() - 2));
-            } else {
-                args.push_back(resolve_variable(arg));
+    std::vector<std::string> TemplateEngine::Parser::split_arguments(const std::string &args_str) const {
+        std::vector<std::string> terms;
+        std::string term;
+        int depth = 0;
+        char quote = '\0';
+
+        for(char c : args_str) {
+            if(quote) {
+                quote = c == quote ? '\0' : quote;
+            } else if(c == '"' || c == '\'') {
+                quote = c;
+            } else if(c == '(') {
+                depth++;
+            } else if(c == ')') {
+                depth--;
+            } else if(depth == 0 && std::isspace(static_cast<unsigned char>(c))) {
+                if(!term.empty()) {
+                    terms.push_back(term);
+                    term.clear();
+                }
+                continue;
             }
+            term += c;
         }
+        if(!term.empty()) {
+            terms.push_back(term);
+        }
+
+        return terms;
+    }
 
+    std::vector<TemplateValue> TemplateEngine::Parser::parse_helper_arguments(const std::string &args_str) {
+        std::vector<TemplateValue> args;
+        for(const auto &term : split_arguments(args_str)) {
+            args.push_back(evaluate(term));
+        }
         return args;
     }
 
@@ -515,6 +885,8 @@ namespace ssg::template_engine {
                 return std::to_string(value.string_value.length());
             case TemplateValue::ARRAY:
                 return std::to_string(value.array_value.size());
+            case TemplateValue::VIEW:
+                return std::to_string(value.view_value ? value.view_value->size() : 0);
             case TemplateValue::OBJECT:
                 return std::to_string(value.object_value.size());
             default:
@@ -543,7 +915,7 @@ namespace ssg::template_engine {
         });
 
         register_helper("join", [](const std::vector<TemplateValue> &args) -> std::string {
-            if(args.empty() || args[0].type != TemplateValue::ARRAY)
+            if(args.empty() || (args[0].type != TemplateValue::ARRAY && args[0].type != TemplateValue::VIEW))
                 return "";
 
             std::string separator = ", ";
@@ -552,12 +924,14 @@ namespace ssg::template_engine {
             }
 
             std::string result;
-            const auto &array = args[0].array_value;
-            for(size_t i = 0; i < array.size(); ++i) {
-                if(i > 0)
+            bool first = true;
+            args[0].for_each_item([&](const TemplateValue &item) {
+                if(!first)
                     result += separator;
-                result += array[i].to_string();
-            }
+                first = false;
+                result += item.to_string();
+                return true;
+            });
 
             return result;
         });
@@ -609,6 +983,37 @@ namespace ssg::template_engine {
 
             return std::to_string(result);
         });
+
+        // Collection views: {{#each (limit (sort_by (where pages "section" section) "date" "desc") 5)}}.
+        register_value_helper("where", [](const std::vector<TemplateValue> &args) -> TemplateValue {
+            if(args.size() < 2)
+                throw std::runtime_error("usage: where collection key [value]");
+            std::optional<TemplateValue> value;
+            if(args.size() > 2) {
+                value = args[2];
+            }
+            return std::make_shared<const CollectionView>(as_view(args[0]).where(args[1].to_string(), value));
+        });
+
+        register_value_helper("sort_by", [](const std::vector<TemplateValue> &args) -> TemplateValue {
+            if(args.empty())
+                throw std::runtime_error("usage: sort_by collection [key] [\"asc\"|\"desc\"]");
+            std::string key = args.size() > 1 ? args[1].to_string() : "";
+            bool descending = args.size() > 2 && args[2].to_string() == "desc";
+            return std::make_shared<const CollectionView>(as_view(args[0]).sort_by(key, descending));
+        });
+
+        register_value_helper("offset", [](const std::vector<TemplateValue> &args) -> TemplateValue {
+            if(args.size() < 2)
+                throw std::runtime_error("usage: offset collection count");
+            return std::make_shared<const CollectionView>(as_view(args[0]).offset(as_count(args[1])));
+        });
+
+        register_value_helper("limit", [](const std::vector<TemplateValue> &args) -> TemplateValue {
+            if(args.size() < 2)
+                throw std::runtime_error("usage: limit collection count");
+            return std::make_shared<const CollectionView>(as_view(args[0]).limit(as_count(args[1])));
+        });
     }
 
 } // namespace ssg::template_engine
\ No newline at end of file
@@ -1,20 +1,28 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 #include <functional>
 #include <iomanip>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <regex>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace ssg::template_engine {
     class TemplateEngine;
+    class CollectionView;
     struct TemplateValue;
 
     using TemplateHelper = std::function<std::string(const std::vector<TemplateValue> &)>;
+    // Used inside (subexpressions), whose result feeds another helper or a loop rather than the output.
+    using TemplateValueHelper = std::function<TemplateValue(const std::vector<TemplateValue> &)>;
+    using ChunkWriter = std::function<void(std::string_view)>;
 
     struct TemplateError {
         enum Type { SYNTAX_ERROR, VARIABLE_NOT_FOUND, HELPER_ERROR, PARSE_ERROR };
@@ -26,7 +34,7 @@ namespace ssg::template_engine {
     };
 
     struct TemplateValue {
-        enum Type { STRING, ARRAY, BOOLEAN, OBJECT, NUMBER, DATE };
+        enum Type { STRING, ARRAY, BOOLEAN, OBJECT, NUMBER, DATE, VIEW };
         Type type;
         std::string string_value;
         std::vector<TemplateValue> array_value;
@@ -34,6 +42,7 @@ namespace ssg::template_engine {
         std::map<std::string, TemplateValue> object_value;
         double number_value;
         std::chrono::system_clock::time_point date_value;
+        std::shared_ptr<const CollectionView> view_value;
 
         TemplateValue() : type(STRING), boolean_value(false), number_value(0.0) {}
         TemplateValue(const std::string &str) : type(STRING), string_value(str), boolean_value(false), number_value(0.0) {}
@@ -58,6 +67,11 @@ namespace ssg::template_engine {
                 object_value[key] = TemplateValue(value);
             }
         }
+        TemplateValue(std::shared_ptr<const CollectionView> view)
+            : type(VIEW), boolean_value(false), number_value(0.0), view_value(std::move(view)) {}
+
+        // A view over a new shared collection; copies of the value share the items and their sort orders.
+        static TemplateValue collection(std::vector<TemplateValue> items);
 
         bool is_truthy() const {
             switch(type) {
@@ -67,6 +81,8 @@ namespace ssg::template_engine {
                 return !string_value.empty();
             case ARRAY:
                 return !array_value.empty();
+            case VIEW:
+                return !view_is_empty();
             case OBJECT:
                 return !object_value.empty();
             case NUMBER:
@@ -95,6 +111,7 @@ namespace ssg::template_engine {
                 return ss.str();
             }
             case ARRAY:
+            case VIEW:
                 return "[array]";
             case OBJECT:
                 return "[object]";
@@ -103,39 +120,125 @@ namespace ssg::template_engine {
         }
 
         TemplateValue get_nested_property(const std::vector<std::string> &path) const;
+
+        // Visits the items of an ARRAY or VIEW in order until `visit` returns false; other types have none.
+        void for_each_item(const std::function<bool(const TemplateValue &)> &visit) const;
+
+    private:
+        bool view_is_empty() const;
+    };
+
+    // Immutable items shared by every view and every page of a build. Sort orders are computed on first use
+    // and kept for the collection's lifetime, so "latest posts" costs one sort per key, not one per page.
+    class TemplateCollection {
+    public:
+        explicit TemplateCollection(std::vector<TemplateValue> items) : items_(std::move(items)) {}
+
+        const std::vector<TemplateValue> &items() const { return items_; }
+
+        // Stable order of item indices by the dotted property `key` (the item itself when empty).
+        std::shared_ptr<const std::vector<uint32_t>> order_by(const std::string &key, bool descending) const;
+
+    private:
+        std::vector<TemplateValue> items_;
+        mutable std::mutex orders_mutex_;
+        mutable std::map<std::pair<std::string, bool>, std::shared_ptr<const std::vector<uint32_t>>> orders_;
+    };
+
+    // Lazy pipeline over a TemplateCollection: an optional memoized order followed by where/offset/limit stages
+    // that run per item as it is pulled, so a loop stops as soon as its limit is reached and nothing is copied.
+    // Every operation returns a new view and leaves this one untouched.
+    class CollectionView {
+    public:
+        explicit CollectionView(std::shared_ptr<const TemplateCollection> source) : source_(std::move(source)) {}
+
+        // Keeps items whose property `key` equals `value`, or is truthy when no value is given.
+        CollectionView where(const std::string &key, const std::optional<TemplateValue> &value) const;
+        CollectionView sort_by(const std::string &key, bool descending) const;
+        CollectionView offset(size_t count) const;
+        CollectionView limit(size_t count) const;
+
+        void for_each(const std::function<bool(const TemplateValue &)> &visit) const;
+        size_t size() const;
+        std::vector<TemplateValue> materialize() const;
+
+    private:
+        struct Stage {
+            enum Kind { WHERE, OFFSET, LIMIT };
+            Kind kind;
+            std::vector<std::string> path;
+            std::optional<TemplateValue> value;
+            size_t count = 0;
+        };
+
+        std::shared_ptr<const TemplateCollection> source_;
+        std::shared_ptr<const std::vector<uint32_t>> order_;
+        std::vector<Stage> stages_;
+    };
+
+    // Where a render's text goes. Without a writer everything is kept for take(); with one, the text is handed
+    // over in pieces of exactly chunk_size bytes (the last one shorter, on flush), so memory stays bounded
+    // however large the page.
+    class RenderOutput {
+    public:
+        static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+        RenderOutput() = default;
+        explicit RenderOutput(ChunkWriter writer, size_t chunk_size = DEFAULT_CHUNK_SIZE)
+            : writer_(std::move(writer)), chunk_size_(chunk_size > 0 ? chunk_size : DEFAULT_CHUNK_SIZE) {}
+
+        void append(std::string_view text);
+        void append(char c) { append(std::string_view(&c, 1)); }
+        void flush();
+        std::string take() { return std::move(buffer_); }
+
+    private:
+        ChunkWriter writer_;
+        size_t chunk_size_ = DEFAULT_CHUNK_SIZE;
+        std::string buffer_;
     };
 
     class TemplateEngine {
     public:
         static std::string render(const std::string &template_str, const std::map<std::string, TemplateValue> &context);
+        // Streams the result to `write_chunk` as it is produced instead of building it in one string.
+        static void render(const std::string &template_str, const std::map<std::string, TemplateValue> &context,
+                           const ChunkWriter &write_chunk, size_t chunk_size = RenderOutput::DEFAULT_CHUNK_SIZE);
         static std::string render_with_layout(const std::string &layout_path, const std::string &content_template,
                                               const std::map<std::string, TemplateValue> &context);
 
         static void register_helper(const std::string &name, TemplateHelper helper);
+        static void register_value_helper(const std::string &name, TemplateValueHelper helper);
         static void register_default_helpers();
         static void set_partial_loader(std::function<std::string(const std::string &)> loader);
 
     private:
         static std::map<std::string, TemplateHelper> helpers_;
+        static std::map<std::string, TemplateValueHelper> value_helpers_;
         static std::function<std::string(const std::string &)> partial_loader_;
 
+        static void render_into(const std::string &template_str, const std::map<std::string, TemplateValue> &context,
+                                RenderOutput &out);
+
+        // Nested blocks get sub-parsers sharing the same output, so text is never gathered per block.
         struct Parser {
             const std::string &template_str;
             std::map<std::string, TemplateValue> context;
+            RenderOutput &out;
             size_t pos;
             std::vector<TemplateError> errors;
 
-            Parser(const std::string &tmpl, const std::map<std::string, TemplateValue> &ctx)
-                : template_str(tmpl), context(ctx), pos(0) {}
+            Parser(const std::string &tmpl, const std::map<std::string, TemplateValue> &ctx, RenderOutput &output)
+                : template_str(tmpl), context(ctx), out(output), pos(0) {}
 
-            std::string parse();
-            std::string parse_block();
-            std::string parse_if_block();
-            std::string parse_each_block();
-            std::string parse_for_block();
-            std::string parse_variable();
-            std::string parse_helper_call();
-            std::string parse_partial();
+            void parse();
+            void parse_block();
+            void parse_if_block();
+            void parse_each_block();
+            void parse_for_block();
+            void parse_variable();
+            void parse_helper_call();
+            void parse_partial();
 
             bool match(const std::string &pattern);
             bool match_keyword(const std::string &keyword);
@@ -144,6 +247,7 @@ namespace ssg::template_engine {
             std::string extract_variable_name();
             std::string extract_collection_name();
             std::string extract_helper_args();
+            std::vector<std::string> split_arguments(const std::string &args_str) const;
             std::vector<std::string> split_path(const std::string &path) const;
             void skip_whitespace();
             char peek(size_t offset = 0) const;
@@ -152,7 +256,9 @@ namespace ssg::template_engine {
 
             TemplateValue resolve_variable(const std::string &var_name) const;
             TemplateValue resolve_nested_variable(const std::string &path) const;
-            std::vector<TemplateValue> parse_helper_arguments(const std::string &args_str) const;
+            TemplateValue evaluate(const std::string &expression);
+            TemplateValue evaluate_subexpression(const std::string &expression);
+            std::vector<TemplateValue> parse_helper_arguments(const std::string &args_str);
 
             void add_error(TemplateError::Type type, const std::string &message);
         };
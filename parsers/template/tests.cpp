@@ -0,0 +1,115 @@
+#include "../../includes/tests.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "template_engine.hpp"
+
+using namespace ssg::template_engine;
+
+namespace {
+    TemplateValue make_post(const std::string &title, const std::string &section, const std::string &date) {
+        std::map<std::string, TemplateValue> post;
+        post["title"] = TemplateValue(title);
+        post["section"] = TemplateValue(section);
+        post["date"] = TemplateValue(date);
+        return TemplateValue(post);
+    }
+
+    std::map<std::string, TemplateValue> site_context() {
+        std::vector<TemplateValue> posts = {
+            make_post("A", "/blog", "2024-03-01"), make_post("B", "/docs", "2024-01-15"),
+            make_post("C", "/blog", "2025-06-30"), make_post("D", "/blog", "2023-11-02"),
+            make_post("E", "/blog", "2025-01-10"),
+        };
+        std::map<std::string, TemplateValue> context;
+        context["pages"] = TemplateValue::collection(posts);
+        context["section"] = TemplateValue("/blog");
+        return context;
+    }
+} // namespace
+
+TEST(EachOverPlainArray) {
+    std::map<std::string, TemplateValue> context;
+    context["tags"] = TemplateValue(std::vector<std::string>{"a", "b", "c"});
+    ASSERT_EQ(std::string("a;b;c;"), TemplateEngine::render("{{#each tags}}{{this}};{{/each}}", context));
+}
+
+TEST(WhereFiltersByProperty) {
+    std::string out = TemplateEngine::render("{{#each (where pages \"section\" section)}}{{this.title}}{{/each}}",
+                                             site_context());
+    ASSERT_EQ(std::string("ACDE"), out);
+}
+
+TEST(SortByDescendingThenLimit) {
+    std::string tmpl = "{{#each (limit (sort_by (where pages \"section\" section) \"date\" \"desc\") 3)}}"
+                       "{{this.title}}{{/each}}";
+    ASSERT_EQ(std::string("CEA"), TemplateEngine::render(tmpl, site_context()));
+}
+
+TEST(OffsetAndLimitCompose) {
+    std::string tmpl = "{{#for post in (limit (offset (sort_by pages \"title\") 1) 2)}}{{post.title}}{{/for}}";
+    ASSERT_EQ(std::string("BC"), TemplateEngine::render(tmpl, site_context()));
+}
+
+TEST(SortAfterSliceOnlyReordersTheSlice) {
+    std::string tmpl = "{{#each (sort_by (limit pages 3) \"date\")}}{{this.title}}{{/each}}";
+    ASSERT_EQ(std::string("BAC"), TemplateEngine::render(tmpl, site_context()));
+}
+
+TEST(ViewsWorkWithHelpersAndConditions) {
+    auto context = site_context();
+    ASSERT_EQ(std::string("4"), TemplateEngine::render("{{#length (where pages \"section\" \"/blog\")}}", context));
+    ASSERT_EQ(std::string("none"),
+              TemplateEngine::render("{{#if (where pages \"section\" \"/news\")}}some{{else}}none{{/if}}", context));
+}
+
+TEST(SortOrderIsMemoizedPerKey) {
+    std::vector<TemplateValue> items = {make_post("x", "", "2"), make_post("y", "", "1")};
+    auto collection = std::make_shared<const TemplateCollection>(items);
+    auto first = collection->order_by("date", false);
+    auto second = collection->order_by("date", false);
+    ASSERT_TRUE(first == second);
+    ASSERT_TRUE(first != collection->order_by("date", true));
+    ASSERT_EQ(1u, (*first)[0]);
+}
+
+TEST(LimitStopsPullingItems) {
+    std::vector<TemplateValue> items;
+    for(int i = 0; i < 1000; ++i) {
+        items.emplace_back(i);
+    }
+    CollectionView view = CollectionView(std::make_shared<const TemplateCollection>(items)).offset(10).limit(2);
+    std::vector<TemplateValue> taken = view.materialize();
+    ASSERT_EQ(static_cast<size_t>(2), taken.size());
+    ASSERT_EQ(10.0, taken[0].number_value);
+    ASSERT_EQ(11.0, taken[1].number_value);
+}
+
+TEST(StreamedRenderMatchesStringRender) {
+    std::map<std::string, TemplateValue> context = site_context();
+    context["body"] = TemplateValue(std::string(10000, 'x'));
+    std::string tmpl = "<main>{{body}}</main>{{#each pages}}<p>{{this.title}}</p>{{/each}}";
+
+    std::string streamed;
+    std::vector<size_t> chunk_sizes;
+    TemplateEngine::render(
+        tmpl, context,
+        [&](std::string_view chunk) {
+            chunk_sizes.push_back(chunk.size());
+            streamed.append(chunk);
+        },
+        4096);
+
+    ASSERT_EQ(TemplateEngine::render(tmpl, context), streamed);
+    ASSERT_EQ(static_cast<size_t>(3), chunk_sizes.size());
+    ASSERT_EQ(static_cast<size_t>(4096), chunk_sizes[0]);
+    ASSERT_EQ(static_cast<size_t>(4096), chunk_sizes[1]);
+}
+
+#ifdef ENABLE_TESTS
+int main() { return Test::RunAllTests(); }
+#else
+int main() { return 0; }
+#endif
@@ -0,0 +1,109 @@
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "legacy.hpp"
+#include "toml.hpp"
+
+// Compares the arena parser against the parser it replaced on the three shapes of TOML chisel reads: the site
+// config, per-page frontmatter and data files. The documents stick to what the old parser understood (no bare
+// dates, for one).
+
+namespace {
+    std::string config_document() {
+        return R"(# Site configuration
+[site]
+name = "Example Site"
+base_url = "https://example.com"
+description = "A site about things"
+author = "example"
+language = "en"
+
+[build]
+output_dir = "dist"
+content_dir = "content"
+templates_dir = "templates"
+minify_html = true
+global_styles = ["base", "typography", "code"]
+
+[build.layout_styles]
+post = ["post", "comments"]
+page = ["page"]
+
+[dev]
+port = 3000
+host = "localhost"
+live_reload = true
+
+[performance]
+enable_cache = true
+parallel_workers = 8
+)";
+    }
+
+    std::string frontmatter_document() {
+        return R"(title = "Parsing TOML quickly"
+date = "2024-03-01T09:30:00Z"
+layout = "post"
+tags = ["parsing", "performance", "c++"]
+draft = false
+weight = 10
+summary = "Zero-copy parsing with an arena"
+)";
+    }
+
+    std::string data_document(size_t items) {
+        std::string out;
+        for(size_t i = 0; i < items; ++i) {
+            out += "[[items]]\n";
+            out += "id = " + std::to_string(i) + "\n";
+            out += "name = \"Item number " + std::to_string(i) + "\"\n";
+            out += "price = " + std::to_string(i) + ".99\n";
+            out += "tags = [\"a\", \"b\", \"c\"]\n";
+            out += "dimensions = { width = 10, height = 20, depth = 30 }\n\n";
+        }
+        return out;
+    }
+
+    double seconds_per_run(const std::function<void()> &run) {
+        using clock = std::chrono::steady_clock;
+        size_t iterations = 1;
+        while(true) {
+            auto start = clock::now();
+            for(size_t i = 0; i < iterations; ++i) {
+                run();
+            }
+            double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+            if(elapsed > 0.25) {
+                return elapsed / static_cast<double>(iterations);
+            }
+            iterations *= 2;
+        }
+    }
+
+    void compare(const std::string &name, const std::string &source) {
+        volatile size_t sink = 0;
+        double legacy =
+            seconds_per_run([&] { sink = sink + toml::legacy::Parser::deserialize(source).get_object().size(); });
+        double document = seconds_per_run([&] { sink = sink + toml::Document::parse(source).root().size(); });
+        double value = seconds_per_run([&] { sink = sink + toml::Parser::deserialize(source).get_object().size(); });
+
+        auto throughput = [&](double seconds) { return static_cast<double>(source.size()) / seconds / (1024.0 * 1024.0); };
+        std::cout << "📊 " << name << " (" << source.size() << " bytes)\n" << std::fixed << std::setprecision(1);
+        std::cout << "   legacy Value:   " << std::setw(10) << legacy * 1e6 << " µs  " << std::setw(8) << throughput(legacy)
+                  << " MB/s\n";
+        std::cout << "   Document:       " << std::setw(10) << document * 1e6 << " µs  " << std::setw(8)
+                  << throughput(document) << " MB/s  (" << legacy / document << "x)\n";
+        std::cout << "   Document→Value: " << std::setw(10) << value * 1e6 << " µs  " << std::setw(8) << throughput(value)
+                  << " MB/s  (" << legacy / value << "x)\n";
+    }
+} // namespace
+
+int main() {
+    compare("config", config_document());
+    compare("frontmatter", frontmatter_document());
+    compare("data file", data_document(2000));
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include "../../includes/tests.hpp"
 
 #include <iostream>
+#include <limits>
 #include <stdexcept>
 #include <string>
 
@@ -129,6 +130,123 @@ TEST(FullParsingTest) {
     }
 }
 
+TEST(DocumentTypesAndZeroCopy) {
+    std::string source = R"(
+        plain = "no escapes"
+        escaped = "tab\there \u00e9 \U0001F600"
+        literal = 'C:\path'
+        hex = 0xDEAD_beef
+        octal = 0o755
+        binary = -1_000
+        float = 6.626e-34
+        infinity = -inf
+        multi = """
+first \
+          second"""
+        raw = '''
+keep \n this'''
+        date = 1979-05-27
+        moment = 1979-05-27T07:32:00.999999-07:00
+        local = 07:32:00
+    )";
+    toml::Document document = toml::Document::parse(source);
+    const toml::Node &root = document.root();
+
+    std::string_view plain = root.find("plain")->as_string();
+    ASSERT_EQ(plain, "no escapes");
+    ASSERT_TRUE(plain.data() >= source.data() && plain.data() < source.data() + source.size());
+    ASSERT_EQ(root.find("escaped")->as_string(), "tab\there \xC3\xA9 \xF0\x9F\x98\x80");
+    ASSERT_EQ(root.find("literal")->as_string(), "C:\\path");
+    ASSERT_EQ(root.find("hex")->as_integer(), int64_t(0xDEADBEEF));
+    ASSERT_EQ(root.find("octal")->as_integer(), int64_t(0755));
+    ASSERT_EQ(root.find("binary")->as_integer(), int64_t(-1000));
+    ASSERT_TRUE(root.find("float")->is_float() && root.find("float")->as_float() == 6.626e-34);
+    ASSERT_TRUE(root.find("infinity")->as_float() == -std::numeric_limits<double>::infinity());
+    ASSERT_EQ(root.find("multi")->as_string(), "first second");
+    ASSERT_EQ(root.find("raw")->as_string(), "keep \\n this");
+
+    const toml::DateTime &date = root.find("date")->as_datetime();
+    ASSERT_TRUE(date.has_date && !date.has_time && date.year == 1979 && date.month == 5 && date.day == 27);
+    const toml::DateTime &moment = root.find("moment")->as_datetime();
+    ASSERT_TRUE(moment.has_offset && moment.offset_minutes == -420 && moment.nanosecond == 999999000);
+    ASSERT_EQ(root.find("moment")->as_string(), "1979-05-27T07:32:00.999999-07:00");
+    ASSERT_TRUE(!root.find("local")->as_datetime().has_date && root.find("local")->as_datetime().hour == 7);
+}
+
+TEST(DocumentTablesKeepSourceOrder) {
+    std::string source = R"(
+        [server]
+        b = 1
+        a.x = 2
+        a.y = 3
+
+        [[server.routes]]
+        path = "/"
+
+        [[server.routes]]
+        path = "/blog"
+
+        [server.routes.options]
+        cache = true
+    )";
+    toml::Document document = toml::Document::parse(source);
+    const toml::Node &server = *document.root().find("server");
+    ASSERT_EQ(server.entries()[0].key, "b");
+    ASSERT_EQ(server.entries()[1].key, "a");
+    ASSERT_EQ(server.find("a")->size(), size_t(2));
+
+    const toml::Node &routes = *server.find("routes");
+    ASSERT_EQ(routes.size(), size_t(2));
+    ASSERT_EQ(routes[1].find("path")->as_string(), "/blog");
+    ASSERT_TRUE(routes[1].find("options")->find("cache")->as_bool());
+    ASSERT_EQ(document.location(routes[1]).line, size_t(10));
+}
+
+TEST(LargeTablesFindEveryKey) {
+    std::string source = "[data]\n";
+    for(int i = 0; i < 5000; ++i) {
+        source += "key" + std::to_string(i) + " = " + std::to_string(i) + "\n";
+    }
+    source += "nested.inner = true\n";
+    toml::Document document = toml::Document::parse(source);
+    const toml::Node &data = *document.root().find("data");
+    ASSERT_EQ(data.size(), size_t(5001));
+    ASSERT_EQ(data.entries()[4999].key, "key4999");
+    ASSERT_EQ(data.find("key0")->as_integer(), 0);
+    ASSERT_EQ(data.find("key4321")->as_integer(), 4321);
+    ASSERT_TRUE(data.find("nested")->find("inner")->as_bool());
+    ASSERT_TRUE(data.find("key5000") == nullptr);
+
+    size_t duplicate_line = 0;
+    try {
+        toml::Document::parse(source + "key2500 = 1\n");
+    } catch(const toml::ParseError &e) {
+        duplicate_line = e.line();
+    }
+    ASSERT_EQ(duplicate_line, size_t(5003));
+    std::cout << "5000-key table searched and checked for duplicates through its index";
+}
+
+TEST(ParseErrorsCarryLineAndColumn) {
+    auto error_at = [](const std::string &source) -> std::pair<size_t, size_t> {
+        try {
+            toml::Document::parse(source);
+        } catch(const toml::ParseError &e) {
+            std::cout << e.what() << "\n";
+            return {e.line(), e.column()};
+        }
+        return {0, 0};
+    };
+
+    ASSERT_TRUE(error_at("a = 1\nb = \"open\n") == std::make_pair(size_t(2), size_t(10)));
+    ASSERT_TRUE(error_at("a = 1\na = 2") == std::make_pair(size_t(2), size_t(1)));
+    ASSERT_TRUE(error_at("[t]\nx = 1\n[t]\n") == std::make_pair(size_t(3), size_t(1)));
+    ASSERT_TRUE(error_at("x = 1 y = 2") == std::make_pair(size_t(1), size_t(7)));
+    ASSERT_TRUE(error_at("n = 012") == std::make_pair(size_t(1), size_t(5)));
+    ASSERT_TRUE(error_at("d = 2023-02-29") == std::make_pair(size_t(1), size_t(5)));
+    ASSERT_TRUE(error_at("t = {a = 1}\n[t]") == std::make_pair(size_t(2), size_t(1)));
+}
+
 #ifdef ENABLE_TESTS
 int main() {
     return Test::RunAllTests();
@@ -1,7 +1,16 @@
 #pragma once
 #include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <variant>
 #include <vector>
@@ -18,8 +27,6 @@ namespace toml {
     private:
         Variant _value;
 
-        friend class Parser;
-
     public:
         Value() : _value(nullptr) {}
         Value(std::nullptr_t) : _value(nullptr) {}
@@ -28,7 +35,9 @@ namespace toml {
         Value(const std::string &s) : _value(s) {}
         Value(std::string &&s) : _value(std::move(s)) {}
         Value(const Array &a) : _value(a) {}
+        Value(Array &&a) : _value(std::move(a)) {}
         Value(const Object &o) : _value(o) {}
+        Value(Object &&o) : _value(std::move(o)) {}
 
         Value &operator[](const std::string &key) {
             if(!std::holds_alternative<Object>(_value)) {
@@ -127,335 +136,969 @@ namespace toml {
         }
     };
 
-    class Parser {
+    struct DateTime {
+        int year, month, day;
+        int hour, minute, second, nanosecond;
+        int offset_minutes;
+        bool has_date, has_time, has_offset;
+    };
+
+    class Node;
+
+    // Array entries have an empty key.
+    struct Entry {
+        std::string_view key;
+        Node *value;
+    };
+
+    // A parsed value. Nodes, their entry lists and any unescaped strings live in the owning Document's arena; other
+    // strings point straight into the source text.
+    class Node {
     public:
-        static Value deserialize(const std::string &input) {
-            Parser parser(input);
-            return parser.parse();
-        }
+        enum class Type { Null, Boolean, Integer, Float, String, DateTime, Array, Table };
 
-    private:
-        const std::string &_input;
-        size_t _pos;
-        Parser(const std::string &input) : _input(input), _pos(0) {}
+        Type type() const { return _type; }
+        bool is_null() const { return _type == Type::Null; }
+        bool is_bool() const { return _type == Type::Boolean; }
+        bool is_integer() const { return _type == Type::Integer; }
+        bool is_float() const { return _type == Type::Float; }
+        bool is_number() const { return is_integer() || is_float(); }
+        bool is_string() const { return _type == Type::String; }
+        bool is_datetime() const { return _type == Type::DateTime; }
+        bool is_array() const { return _type == Type::Array; }
+        bool is_table() const { return _type == Type::Table; }
 
-        void skip_whitespace_and_comments() {
-            while(_pos < _input.size()) {
-                if(std::isspace(_input[_pos])) {
-                    _pos++;
-                } else if(_input[_pos] == '#') {
-                    while(_pos < _input.size() && _input[_pos] != '\n') {
-                        _pos++;
-                    }
-                } else {
-                    break;
+        bool as_bool() const { return _scalar.boolean; }
+        int64_t as_integer() const { return _scalar.integer; }
+        double as_float() const { return _scalar.floating; }
+        double as_number() const { return is_integer() ? static_cast<double>(_scalar.integer) : _scalar.floating; }
+        // For date-times this is the text as written.
+        std::string_view as_string() const { return _text; }
+        const DateTime &as_datetime() const { return _scalar.datetime; }
+
+        size_t size() const { return _items.size(); }
+        const Node &operator[](size_t index) const { return *_items.at(index).value; }
+        std::span<const Entry> entries() const { return {_items.data(), _items.size()}; }
+
+        const Node *find(std::string_view key) const { return lookup(key); }
+
+        // Byte offset of the value in the source; Document::location turns it into a line and column.
+        size_t offset() const { return _offset; }
+
+        Value to_value() const {
+            switch(_type) {
+            case Type::Null:
+                return Value(nullptr);
+            case Type::Boolean:
+                return Value(_scalar.boolean);
+            case Type::Integer:
+            case Type::Float:
+                return Value(as_number());
+            case Type::String:
+            case Type::DateTime:
+                return Value(std::string(_text));
+            case Type::Array: {
+                Value::Array array;
+                array.reserve(_items.size());
+                for(const auto &entry : _items) {
+                    array.push_back(entry.value->to_value());
+                }
+                return Value(std::move(array));
+            }
+            case Type::Table: {
+                Value::Object object;
+                object.reserve(_items.size());
+                for(const auto &entry : _items) {
+                    object.emplace(entry.key, entry.value->to_value());
                 }
+                return Value(std::move(object));
+            }
             }
+            return Value();
         }
 
-        char peek() const {
-            if(_pos >= _input.size()) {
-                throw std::runtime_error("Unexpected end of input");
+    private:
+        friend class Parser;
+
+        // Tables with more keys than this also get a key index, so adding or finding a key stays O(1) and building
+        // a large data table stays linear. Smaller tables are scanned, which is cheaper at that size.
+        static constexpr size_t INDEX_THRESHOLD = 16;
+        using Index = std::pmr::unordered_map<std::string_view, Node *>;
+
+        Type _type;
+        uint32_t _offset;
+        // Tables opened by a [header] may not be opened again; inline tables and static arrays are closed once
+        // written. Arrays of tables are the only arrays [[headers]] may append to.
+        bool _defined = false;
+        bool _sealed = false;
+        bool _array_of_tables = false;
+        union {
+            bool boolean;
+            int64_t integer;
+            double floating;
+            DateTime datetime;
+        } _scalar{};
+        std::string_view _text;
+        std::pmr::vector<Entry> _items;
+        // Built in the arena once a table passes INDEX_THRESHOLD keys; never destroyed, like the node itself.
+        Index *_index = nullptr;
+
+        Node(Type type, size_t offset, std::pmr::memory_resource *arena)
+            : _type(type), _offset(static_cast<uint32_t>(offset)), _items(arena) {}
+
+        Node *lookup(std::string_view key) const {
+            if(_index != nullptr) {
+                auto it = _index->find(key);
+                return it == _index->end() ? nullptr : it->second;
             }
-            return _input[_pos];
+            for(const auto &entry : _items) {
+                if(entry.key == key) {
+                    return entry.value;
+                }
+            }
+            return nullptr;
         }
 
-        char get() {
-            if(_pos >= _input.size()) {
-                throw std::runtime_error("Unexpected end of input");
+        // Adds a table entry; the caller has checked that the key is new.
+        void insert(std::string_view key, Node *value) {
+            _items.push_back({key, value});
+            if(_index != nullptr) {
+                _index->emplace(key, value);
+            } else if(_items.size() > INDEX_THRESHOLD) {
+                std::pmr::memory_resource *arena = _items.get_allocator().resource();
+                std::pmr::polymorphic_allocator<Index> allocator(arena);
+                _index = allocator.allocate(1);
+                ::new(_index) Index(_items.size() * 2, arena);
+                for(const auto &entry : _items) {
+                    _index->emplace(entry.key, entry.value);
+                }
             }
-            return _input[_pos++];
         }
+    };
 
-        Value parse() {
-            Value::Object root;
-            Value::Object *current_table = &root;
+    class Document {
+    public:
+        struct Location {
+            size_t line;
+            size_t column;
+        };
 
-            while(_pos < _input.size()) {
-                skip_whitespace_and_comments();
-                if(_pos >= _input.size()) {
-                    break;
-                }
+        // The source must outlive the document: strings without escapes are views into it.
+        static Document parse(std::string_view source);
 
-                if(peek() == '[') {
-                    current_table = parse_table_header(root);
+        const Node &root() const { return *_root; }
+        std::string_view source() const { return _source; }
+
+        Location location(const Node &node) const { return locate(_source, node.offset()); }
+
+        // 1-based; columns count bytes.
+        static Location locate(std::string_view source, size_t offset) {
+            Location location{1, 1};
+            for(size_t i = 0; i < offset && i < source.size(); ++i) {
+                if(source[i] == '\n') {
+                    ++location.line;
+                    location.column = 1;
                 } else {
-                    parse_key_value(*current_table);
+                    ++location.column;
                 }
             }
-            return Value(root);
+            return location;
+        }
+
+    private:
+        friend class Parser;
+
+        std::unique_ptr<std::pmr::monotonic_buffer_resource> _arena;
+        std::string_view _source;
+        Node *_root = nullptr;
+    };
+
+    class ParseError : public std::runtime_error {
+    public:
+        ParseError(const std::string &message, size_t line, size_t column)
+            : std::runtime_error("line " + std::to_string(line) + ", column " + std::to_string(column) + ": " + message),
+              _line(line), _column(column) {}
+
+        size_t line() const { return _line; }
+        size_t column() const { return _column; }
+
+    private:
+        size_t _line;
+        size_t _column;
+    };
+
+    class Parser {
+    public:
+        static Document parse(std::string_view input) {
+            Document document;
+            // Most of what a document allocates is proportional to its size, so one upstream block usually suffices.
+            document._arena = std::make_unique<std::pmr::monotonic_buffer_resource>(input.size() * 2 + 1024);
+            document._source = input;
+            Parser parser(input, document._arena.get());
+            document._root = parser.parse();
+            return document;
+        }
+
+        static Value deserialize(std::string_view input) { return parse(input).root().to_value(); }
+
+    private:
+        std::string_view _input;
+        size_t _pos = 0;
+        std::pmr::memory_resource *_arena;
+        std::vector<std::string_view> _keys;
+        std::string _scratch;
+
+        Parser(std::string_view input, std::pmr::memory_resource *arena) : _input(input), _arena(arena) {}
+
+        [[noreturn]] void fail(const std::string &message, size_t at) const {
+            auto location = Document::locate(_input, at);
+            throw ParseError(message, location.line, location.column);
+        }
+        [[noreturn]] void fail(const std::string &message) const { fail(message, _pos); }
+
+        bool at_end() const { return _pos >= _input.size(); }
+        char peek(size_t ahead = 0) const { return _pos + ahead < _input.size() ? _input[_pos + ahead] : '\0'; }
+
+        void expect(char c, const char *message) {
+            if(peek() != c || at_end()) {
+                fail(message);
+            }
+            ++_pos;
         }
 
-        Value::Object *parse_table_header(Value::Object &root) {
-            if(get() != '[') {
-                throw std::runtime_error("Expected '[' for table header");
+        static bool is_bare_key_char(char c) {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+        }
+
+        static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+        void skip_whitespace() {
+            while(_pos < _input.size() && (_input[_pos] == ' ' || _input[_pos] == '\t')) {
+                ++_pos;
             }
-            bool is_array = peek() == '[';
-            if(is_array) {
-                get();
+        }
+
+        void skip_comment() {
+            if(peek() == '#') {
+                size_t newline = _input.find('\n', _pos);
+                _pos = newline == std::string_view::npos ? _input.size() : newline;
             }
+        }
 
-            std::vector<std::string> keys = parse_dotted_keys();
-            if(is_array) {
-                if(get() != ']' || get() != ']') {
-                    throw std::runtime_error("Expected ']]' for array of tables");
+        void skip_whitespace_comments_and_newlines() {
+            while(true) {
+                skip_whitespace();
+                skip_comment();
+                if(peek() == '\n') {
+                    ++_pos;
+                } else if(peek() == '\r' && peek(1) == '\n') {
+                    _pos += 2;
+                } else {
+                    return;
                 }
+            }
+        }
+
+        void expect_line_end() {
+            skip_whitespace();
+            skip_comment();
+            if(at_end()) {
+                return;
+            }
+            if(peek() == '\n') {
+                ++_pos;
+            } else if(peek() == '\r' && peek(1) == '\n') {
+                _pos += 2;
             } else {
-                if(get() != ']') {
-                    throw std::runtime_error("Expected ']' for table header");
-                }
+                fail("Expected a newline");
             }
+        }
 
-            Value::Object *table = &root;
-            for(size_t i = 0; i < keys.size() - 1; ++i) {
-                auto &key = keys[i];
-                if(!table->count(key) || !(*table)[key].is_object()) {
-                    (*table)[key] = Value::Object{};
-                }
-                table = &std::get<Value::Object>((*table)[key]._value);
+        Node *make(Node::Type type, size_t offset) {
+            std::pmr::polymorphic_allocator<Node> allocator(_arena);
+            Node *node = allocator.allocate(1);
+            ::new(node) Node(type, offset, _arena);
+            if(type == Node::Type::Table || type == Node::Type::Array) {
+                node->_items.reserve(4);
+            }
+            return node;
+        }
+
+        std::string_view store(std::string_view text) {
+            char *copy = static_cast<char *>(_arena->allocate(text.size(), 1));
+            std::memcpy(copy, text.data(), text.size());
+            return {copy, text.size()};
+        }
+
+        Node *parse() {
+            Node *root = make(Node::Type::Table, 0);
+            Node *current = root;
+
+            // A UTF-8 byte order mark is allowed and ignored.
+            if(_input.starts_with("\xEF\xBB\xBF")) {
+                _pos = 3;
             }
 
-            const std::string &last_key = keys.back();
-            if(is_array) {
-                if(!table->count(last_key) || !(*table)[last_key].is_array()) {
-                    (*table)[last_key] = Value::Array{};
+            while(true) {
+                skip_whitespace_comments_and_newlines();
+                if(at_end()) {
+                    break;
                 }
-                auto &arr = std::get<Value::Array>((*table)[last_key]._value);
-                arr.emplace_back(Value::Object{});
-                return &std::get<Value::Object>(arr.back()._value);
-            } else {
-                if(!table->count(last_key) || !(*table)[last_key].is_object()) {
-                    (*table)[last_key] = Value::Object{};
+                if(peek() == '[') {
+                    current = parse_table_header(root);
+                } else {
+                    parse_key_value(current);
                 }
-                return &std::get<Value::Object>((*table)[last_key]._value);
+                expect_line_end();
             }
+            return root;
         }
 
-        std::vector<std::string> parse_dotted_keys() {
-            std::vector<std::string> keys;
+        // Fills _keys with the parts of a possibly dotted key.
+        void parse_dotted_key() {
+            _keys.clear();
             while(true) {
-                skip_whitespace_and_comments();
-                keys.push_back(parse_key());
-                skip_whitespace_and_comments();
+                skip_whitespace();
+                _keys.push_back(parse_key());
+                skip_whitespace();
                 if(peek() != '.') {
-                    break;
+                    return;
                 }
-                get();
+                ++_pos;
             }
-            return keys;
         }
 
-        std::string parse_key() {
-            std::string key;
-            if(peek() == '"' || peek() == '\'') {
-                key = parse_string().get_string();
-            } else {
-                while(_pos < _input.size() && (std::isalnum(_input[_pos]) || _input[_pos] == '_' || _input[_pos] == '-')) {
-                    key += get();
-                }
-                if(key.empty()) {
-                    throw std::runtime_error("Invalid key");
+        std::string_view parse_key() {
+            char c = peek();
+            if(c == '"' || c == '\'') {
+                if(peek(1) == c && peek(2) == c) {
+                    fail("Multi-line strings cannot be keys");
                 }
+                return c == '"' ? parse_basic_string() : parse_literal_string();
+            }
+            size_t start = _pos;
+            while(_pos < _input.size() && is_bare_key_char(_input[_pos])) {
+                ++_pos;
+            }
+            if(_pos == start) {
+                fail("Invalid key");
             }
-            return key;
+            return _input.substr(start, _pos - start);
         }
 
-        void parse_key_value(Value::Object &table) {
-            skip_whitespace_and_comments();
-            std::vector<std::string> keys = parse_dotted_keys();
-            skip_whitespace_and_comments();
-            if(get() != '=') {
-                throw std::runtime_error("Expected '=' after key");
+        // Walks to the table a dotted key or header path leads to, creating implicit tables on the way.
+        Node *descend(Node *table, std::string_view key, size_t offset, bool from_header, bool sealed) {
+            Node *child = table->lookup(key);
+            if(child == nullptr) {
+                child = make(Node::Type::Table, offset);
+                child->_sealed = sealed;
+                table->insert(key, child);
+                return child;
+            }
+            if(child->is_array() && child->_array_of_tables && from_header) {
+                return child->_items.back().value;
+            }
+            if(!child->is_table() || (child->_sealed && !sealed)) {
+                fail("Key '" + std::string(key) + "' is already defined", offset);
+            }
+            return child;
+        }
+
+        Node *parse_table_header(Node *root) {
+            size_t start = _pos;
+            ++_pos;
+            bool array_of_tables = peek() == '[';
+            if(array_of_tables) {
+                ++_pos;
+            }
+
+            parse_dotted_key();
+            if(array_of_tables) {
+                expect(']', "Expected ']]' to close the array of tables header");
+                expect(']', "Expected ']]' to close the array of tables header");
+            } else {
+                expect(']', "Expected ']' to close the table header");
+            }
+
+            Node *table = root;
+            for(size_t i = 0; i + 1 < _keys.size(); ++i) {
+                table = descend(table, _keys[i], start, true, false);
             }
-            skip_whitespace_and_comments();
 
-            Value value = parse_value();
-            Value::Object *target = &table;
-            for(size_t i = 0; i < keys.size() - 1; ++i) {
-                auto &key = keys[i];
-                if(!target->count(key) || !(*target)[key].is_object()) {
-                    (*target)[key] = Value::Object{};
+            std::string_view last = _keys.back();
+            Node *existing = table->lookup(last);
+            if(array_of_tables) {
+                if(existing == nullptr) {
+                    existing = make(Node::Type::Array, start);
+                    existing->_array_of_tables = true;
+                    table->insert(last, existing);
+                } else if(!existing->is_array() || !existing->_array_of_tables) {
+                    fail("Key '" + std::string(last) + "' is already defined", start);
                 }
-                target = &std::get<Value::Object>((*target)[key]._value);
+                Node *element = make(Node::Type::Table, start);
+                element->_defined = true;
+                existing->_items.push_back({{}, element});
+                return element;
+            }
+
+            if(existing == nullptr) {
+                existing = make(Node::Type::Table, start);
+                table->insert(last, existing);
+            } else if(!existing->is_table() || existing->_defined || existing->_sealed) {
+                fail("Table '" + std::string(last) + "' is already defined", start);
+            }
+            existing->_defined = true;
+            return existing;
+        }
+
+        void parse_key_value(Node *table, bool sealed = false) {
+            size_t start = _pos;
+            parse_dotted_key();
+            if(peek() != '=') {
+                fail("Expected '=' after key");
+            }
+            ++_pos;
+            skip_whitespace();
+
+            // The value is parsed before the key path is resolved, so save the path from nested inline tables.
+            std::string_view keys_inline[8];
+            std::vector<std::string_view> keys_heap;
+            std::span<std::string_view> keys;
+            if(_keys.size() <= 8) {
+                std::copy(_keys.begin(), _keys.end(), keys_inline);
+                keys = std::span(keys_inline, _keys.size());
+            } else {
+                keys_heap = _keys;
+                keys = keys_heap;
+            }
+
+            Node *value = parse_value();
+
+            Node *target = table;
+            for(size_t i = 0; i + 1 < keys.size(); ++i) {
+                target = descend(target, keys[i], start, false, sealed);
+            }
+            if(target->lookup(keys.back()) != nullptr) {
+                fail("Duplicate key '" + std::string(keys.back()) + "'", start);
             }
-            (*target)[keys.back()] = value;
+            target->insert(keys.back(), value);
         }
 
-        Value parse_value() {
-            skip_whitespace_and_comments();
-            char ch = peek();
-            if(ch == 't' || ch == 'f') {
-                return parse_bool();
-            } else if(ch == '-' || std::isdigit(ch)) {
-                return parse_number();
-            } else if(ch == '"' || ch == '\'') {
-                return parse_string();
-            } else if(ch == '[') {
+        Node *parse_value() {
+            size_t start = _pos;
+            char c = peek();
+            if(at_end() || c == '\n' || c == '\r' || c == '#') {
+                fail("Expected a value");
+            }
+
+            Node *node;
+            if(c == '"' || c == '\'') {
+                node = make(Node::Type::String, start);
+                bool multiline = peek(1) == c && peek(2) == c;
+                if(c == '"') {
+                    node->_text = multiline ? parse_multiline_basic_string() : parse_basic_string();
+                } else {
+                    node->_text = multiline ? parse_multiline_literal_string() : parse_literal_string();
+                }
+                return node;
+            }
+            if(c == '[') {
                 return parse_array();
-            } else if(ch == '{') {
+            }
+            if(c == '{') {
                 return parse_inline_table();
-            } else if(_input.substr(_pos, 4) == "null") {
-                _pos += 4;
-                return Value(nullptr);
             }
-            throw std::runtime_error("Invalid TOML value");
+            if(match_keyword("true")) {
+                node = make(Node::Type::Boolean, start);
+                node->_scalar.boolean = true;
+                return node;
+            }
+            if(match_keyword("false")) {
+                node = make(Node::Type::Boolean, start);
+                node->_scalar.boolean = false;
+                return node;
+            }
+            // Not TOML, but older chisel configs may use it.
+            if(match_keyword("null")) {
+                return make(Node::Type::Null, start);
+            }
+            if(looks_like_datetime()) {
+                return parse_datetime();
+            }
+            return parse_number();
+        }
+
+        bool match_keyword(std::string_view keyword) {
+            if(!_input.substr(_pos).starts_with(keyword) || is_bare_key_char(peek(keyword.size()))) {
+                return false;
+            }
+            _pos += keyword.size();
+            return true;
+        }
+
+        bool looks_like_datetime() const {
+            auto digits = [this](size_t from, size_t count) {
+                for(size_t i = from; i < from + count; ++i) {
+                    if(!is_digit(peek(i))) {
+                        return false;
+                    }
+                }
+                return true;
+            };
+            return (digits(0, 4) && peek(4) == '-') || (digits(0, 2) && peek(2) == ':');
         }
 
-        Value parse_bool() {
-            if(_input.substr(_pos, 4) == "true") {
-                _pos += 4;
-                return Value(true);
-            } else if(_input.substr(_pos, 5) == "false") {
-                _pos += 5;
-                return Value(false);
+        // Strings.
+
+        std::string_view parse_literal_string() {
+            size_t start = ++_pos;
+            while(_pos < _input.size() && _input[_pos] != '\'') {
+                if(_input[_pos] == '\n') {
+                    fail("Newline in single-line string");
+                }
+                ++_pos;
+            }
+            if(at_end()) {
+                fail("Unterminated string", start - 1);
             }
-            throw std::runtime_error("Invalid boolean value");
+            return _input.substr(start, _pos++ - start);
         }
 
-        Value parse_number() {
+        std::string_view parse_multiline_literal_string() {
+            size_t open = _pos;
+            _pos += 3;
+            skip_leading_newline();
             size_t start = _pos;
-            if(_input[_pos] == '-') {
-                _pos++;
+            size_t end = _input.find("'''", _pos);
+            if(end == std::string_view::npos) {
+                fail("Unterminated multi-line string", open);
             }
-            while(_pos < _input.size() && std::isdigit(_input[_pos])) {
-                _pos++;
+            // Up to two quotes directly before the closing delimiter belong to the string.
+            for(size_t extra = 0; extra < 2 && end + 3 < _input.size() && _input[end + 3] == '\''; ++extra) {
+                ++end;
             }
-            if(_pos < _input.size() && _input[_pos] == '.') {
-                _pos++;
-                while(_pos < _input.size() && std::isdigit(_input[_pos])) {
-                    _pos++;
+            _pos = end + 3;
+            return _input.substr(start, end - start);
+        }
+
+        std::string_view parse_basic_string() {
+            size_t start = ++_pos;
+            // Fast path: no escapes, so the value is a view into the source.
+            while(_pos < _input.size()) {
+                char c = _input[_pos];
+                if(c == '"') {
+                    return _input.substr(start, _pos++ - start);
+                }
+                if(c == '\\') {
+                    break;
+                }
+                if(c == '\n') {
+                    fail("Newline in single-line string");
                 }
+                ++_pos;
             }
-            if(_pos < _input.size() && (_input[_pos] == 'e' || _input[_pos] == 'E')) {
-                _pos++;
-                if(_input[_pos] == '+' || _input[_pos] == '-') {
-                    _pos++;
+            if(at_end()) {
+                fail("Unterminated string", start - 1);
+            }
+
+            _scratch.assign(_input.substr(start, _pos - start));
+            while(true) {
+                if(at_end()) {
+                    fail("Unterminated string", start - 1);
+                }
+                char c = _input[_pos];
+                if(c == '"') {
+                    ++_pos;
+                    return store(_scratch);
                 }
-                while(_pos < _input.size() && std::isdigit(_input[_pos])) {
-                    _pos++;
+                if(c == '\n') {
+                    fail("Newline in single-line string");
+                }
+                if(c == '\\') {
+                    parse_escape();
+                } else {
+                    _scratch += c;
+                    ++_pos;
                 }
             }
-            try {
-                double number = std::stod(_input.substr(start, _pos - start));
-                return Value(number);
-            } catch(...) { throw std::runtime_error("Invalid number"); }
         }
 
-        Value parse_string() {
-            char quote = get();
-            if(quote != '"' && quote != '\'') {
-                throw std::runtime_error("Expected '\"' or '\'' at start of string");
-            }
-            std::string result;
-            result.reserve(32);
+        std::string_view parse_multiline_basic_string() {
+            size_t open = _pos;
+            _pos += 3;
+            skip_leading_newline();
+            size_t start = _pos;
+            bool escaped = false;
+            _scratch.clear();
+
             while(true) {
-                char ch = get();
-                if(ch == quote) {
-                    break;
-                } else if(ch == '\\') {
-                    char esc = get();
-                    switch(esc) {
-                    case '"':
-                        result += '"';
-                        break;
-                    case '\\':
-                        result += '\\';
-                        break;
-                    case '/':
-                        result += '/';
-                        break;
-                    case 'b':
-                        result += '\b';
-                        break;
-                    case 'f':
-                        result += '\f';
-                        break;
-                    case 'n':
-                        result += '\n';
-                        break;
-                    case 'r':
-                        result += '\r';
-                        break;
-                    case 't':
-                        result += '\t';
-                        break;
-                    case 'u': {
-                        std::string hex;
-                        for(int i = 0; i < 4; i++) {
-                            hex += get();
-                        }
-                        char16_t code = static_cast<char16_t>(std::stoi(hex, nullptr, 16));
-                        if(code <= 0x7F) {
-                            result += static_cast<char>(code);
-                        } else {
-                            throw std::runtime_error("Unicode characters > 0x7F not supported");
-                        }
-                        break;
+                if(at_end()) {
+                    fail("Unterminated multi-line string", open);
+                }
+                char c = _input[_pos];
+                if(c == '"' && peek(1) == '"' && peek(2) == '"') {
+                    // Up to two quotes directly before the closing delimiter belong to the string.
+                    size_t extra = 0;
+                    while(extra < 2 && peek(3 + extra) == '"') {
+                        ++extra;
                     }
-                    default:
-                        throw std::runtime_error("Invalid escape sequence");
+                    size_t end = _pos + extra;
+                    if(escaped) {
+                        _scratch.append(extra, '"');
                     }
-                } else {
-                    result += ch;
+                    _pos = end + 3;
+                    return escaped ? store(_scratch) : _input.substr(start, end - start);
+                }
+                if(c != '\\') {
+                    if(escaped) {
+                        _scratch += c;
+                    }
+                    ++_pos;
+                    continue;
+                }
+
+                if(!escaped) {
+                    _scratch.assign(_input.substr(start, _pos - start));
+                    escaped = true;
+                }
+                // A backslash at the end of a line trims the newline and any whitespace that follows.
+                size_t after = _pos + 1;
+                while(after < _input.size() && (_input[after] == ' ' || _input[after] == '\t')) {
+                    ++after;
                 }
+                if(after < _input.size() && (_input[after] == '\n' || _input[after] == '\r')) {
+                    _pos = after;
+                    while(_pos < _input.size() && (_input[_pos] == ' ' || _input[_pos] == '\t' ||
+                                                   _input[_pos] == '\n' || _input[_pos] == '\r')) {
+                        ++_pos;
+                    }
+                    continue;
+                }
+                parse_escape();
+            }
+        }
+
+        void skip_leading_newline() {
+            if(peek() == '\n') {
+                ++_pos;
+            } else if(peek() == '\r' && peek(1) == '\n') {
+                _pos += 2;
             }
-            return Value(result);
         }
 
-        Value parse_array() {
-            if(get() != '[') {
-                throw std::runtime_error("Expected '[' at start of array");
+        // Appends the escape at _pos to _scratch.
+        void parse_escape() {
+            size_t start = _pos++;
+            char c = peek();
+            ++_pos;
+            switch(c) {
+            case '"':
+                _scratch += '"';
+                return;
+            case '\\':
+                _scratch += '\\';
+                return;
+            case '/':
+                _scratch += '/';
+                return;
+            case 'b':
+                _scratch += '\b';
+                return;
+            case 'e':
+                _scratch += '\x1B';
+                return;
+            case 'f':
+                _scratch += '\f';
+                return;
+            case 'n':
+                _scratch += '\n';
+                return;
+            case 'r':
+                _scratch += '\r';
+                return;
+            case 't':
+                _scratch += '\t';
+                return;
+            case 'u':
+            case 'U': {
+                size_t length = c == 'u' ? 4 : 8;
+                uint32_t code = 0;
+                auto hex = _input.substr(_pos, length);
+                auto [end, error] = std::from_chars(hex.data(), hex.data() + hex.size(), code, 16);
+                if(hex.size() != length || error != std::errc() || end != hex.data() + length) {
+                    fail("Invalid unicode escape", start);
+                }
+                if(code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) {
+                    fail("Unicode escape is not a scalar value", start);
+                }
+                _pos += length;
+                append_utf8(code);
+                return;
             }
-            Value::Array arr;
-            skip_whitespace_and_comments();
-            if(peek() == ']') {
-                get();
-                return Value(arr);
+            default:
+                fail("Invalid escape sequence", start);
             }
-            while(true) {
-                arr.push_back(parse_value());
-                skip_whitespace_and_comments();
-                char ch = get();
-                if(ch == ']') {
-                    break;
-                } else if(ch != ',') {
-                    throw std::runtime_error("Expected ',' or ']' in array");
+        }
+
+        void append_utf8(uint32_t code) {
+            if(code < 0x80) {
+                _scratch += static_cast<char>(code);
+            } else if(code < 0x800) {
+                _scratch += static_cast<char>(0xC0 | (code >> 6));
+                _scratch += static_cast<char>(0x80 | (code & 0x3F));
+            } else if(code < 0x10000) {
+                _scratch += static_cast<char>(0xE0 | (code >> 12));
+                _scratch += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                _scratch += static_cast<char>(0x80 | (code & 0x3F));
+            } else {
+                _scratch += static_cast<char>(0xF0 | (code >> 18));
+                _scratch += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                _scratch += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                _scratch += static_cast<char>(0x80 | (code & 0x3F));
+            }
+        }
+
+        // Numbers.
+
+        Node *parse_number() {
+            size_t start = _pos;
+            while(_pos < _input.size() && (is_bare_key_char(_input[_pos]) || _input[_pos] == '+' || _input[_pos] == '.')) {
+                ++_pos;
+            }
+            std::string_view token = _input.substr(start, _pos - start);
+            if(token.empty()) {
+                fail("Invalid value");
+            }
+
+            std::string_view digits = token;
+            bool negative = false;
+            if(token[0] == '+' || token[0] == '-') {
+                negative = token[0] == '-';
+                digits.remove_prefix(1);
+            }
+
+            if(digits == "inf" || digits == "nan") {
+                Node *node = make(Node::Type::Float, start);
+                double value =
+                    digits == "inf" ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+                node->_scalar.floating = negative ? -value : value;
+                return node;
+            }
+
+            int base = 10;
+            if(digits.size() > 2 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'o' || digits[1] == 'b')) {
+                if(digits.size() != token.size()) {
+                    fail("Only decimal integers may have a sign", start);
+                }
+                base = digits[1] == 'x' ? 16 : digits[1] == 'o' ? 8 : 2;
+                digits.remove_prefix(2);
+            }
+            bool is_float = base == 10 && digits.find_first_of(".eE") != std::string_view::npos;
+
+            auto is_base_digit = [base](char c) {
+                return base == 16 ? std::isxdigit(static_cast<unsigned char>(c)) != 0 : is_digit(c);
+            };
+            if(digits.empty() || !is_base_digit(digits[0])) {
+                fail("Invalid value", start);
+            }
+            if(base == 10 && digits.size() > 1 && digits[0] == '0' && is_digit(digits[1])) {
+                fail("Leading zeros are not allowed", start);
+            }
+            if(is_float) {
+                size_t dot = digits.find('.');
+                if(dot != std::string_view::npos && (dot + 1 == digits.size() || !is_digit(digits[dot + 1]))) {
+                    fail("A decimal point must be followed by digits", start);
+                }
+            }
+
+            // from_chars takes neither digit separators nor a leading '+', so only those tokens are copied.
+            const char *first = negative ? digits.data() - 1 : digits.data();
+            const char *last = digits.data() + digits.size();
+            char buffer[128];
+            if(digits.find('_') != std::string_view::npos) {
+                size_t length = 0;
+                if(negative) {
+                    buffer[length++] = '-';
                 }
-                skip_whitespace_and_comments();
+                for(size_t i = 0; i < digits.size(); ++i) {
+                    if(digits[i] != '_') {
+                        if(length == sizeof(buffer)) {
+                            fail("Number is too long", start);
+                        }
+                        buffer[length++] = digits[i];
+                    } else if(i == 0 || i + 1 == digits.size() || !is_base_digit(digits[i - 1]) ||
+                              !is_base_digit(digits[i + 1])) {
+                        fail("'_' must separate digits", start);
+                    }
+                }
+                first = buffer;
+                last = buffer + length;
+            }
+
+            Node *node;
+            std::from_chars_result result;
+            if(is_float) {
+                node = make(Node::Type::Float, start);
+                result = std::from_chars(first, last, node->_scalar.floating);
+            } else {
+                node = make(Node::Type::Integer, start);
+                result = std::from_chars(first, last, node->_scalar.integer, base);
+            }
+            if(result.ec == std::errc::result_out_of_range) {
+                fail("Number is out of range", start);
+            }
+            if(result.ec != std::errc() || result.ptr != last) {
+                fail("Invalid number '" + std::string(token) + "'", start);
             }
-            return Value(arr);
+            return node;
         }
 
-        Value parse_inline_table() {
-            if(get() != '{') {
-                throw std::runtime_error("Expected '{' at start of inline table");
+        // Date-times.
+
+        int fixed_digits(size_t count, int max, const char *what) {
+            int value = 0;
+            auto text = _input.substr(_pos, count);
+            for(char c : text) {
+                if(!is_digit(c)) {
+                    fail(std::string("Invalid ") + what);
+                }
             }
-            Value::Object obj;
-            skip_whitespace_and_comments();
+            auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+            if(text.size() != count || error != std::errc() || value > max) {
+                fail(std::string("Invalid ") + what);
+            }
+            _pos += count;
+            return value;
+        }
+
+        static int days_in_month(int year, int month) {
+            static constexpr int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+            bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+            return month == 2 && leap ? 29 : days[month - 1];
+        }
+
+        Node *parse_datetime() {
+            size_t start = _pos;
+            Node *node = make(Node::Type::DateTime, start);
+            DateTime &value = node->_scalar.datetime = DateTime{};
+
+            if(peek(2) != ':') {
+                value.has_date = true;
+                value.year = fixed_digits(4, 9999, "year");
+                expect('-', "Expected '-' in date");
+                value.month = fixed_digits(2, 12, "month");
+                expect('-', "Expected '-' in date");
+                value.day = fixed_digits(2, 31, "day");
+                if(value.month == 0 || value.day == 0 || value.day > days_in_month(value.year, value.month)) {
+                    fail("Invalid date", start);
+                }
+                bool has_time = peek() == 'T' || peek() == 't' || (peek() == ' ' && is_digit(peek(1)));
+                if(!has_time) {
+                    node->_text = _input.substr(start, _pos - start);
+                    return node;
+                }
+                ++_pos;
+            }
+
+            value.has_time = true;
+            value.hour = fixed_digits(2, 23, "hour");
+            expect(':', "Expected ':' in time");
+            value.minute = fixed_digits(2, 59, "minute");
+            if(peek() == ':') {
+                ++_pos;
+                value.second = fixed_digits(2, 60, "second");
+            }
+            if(peek() == '.') {
+                ++_pos;
+                size_t digits = 0;
+                int scale = 100000000;
+                while(is_digit(peek())) {
+                    // Precision beyond nanoseconds is dropped.
+                    if(digits++ < 9) {
+                        value.nanosecond += (peek() - '0') * scale;
+                        scale /= 10;
+                    }
+                    ++_pos;
+                }
+                if(digits == 0) {
+                    fail("Expected digits after '.' in time");
+                }
+            }
+
+            if(value.has_date) {
+                if(peek() == 'Z' || peek() == 'z') {
+                    ++_pos;
+                    value.has_offset = true;
+                } else if(peek() == '+' || peek() == '-') {
+                    int sign = peek() == '-' ? -1 : 1;
+                    ++_pos;
+                    int hours = fixed_digits(2, 23, "offset hour");
+                    expect(':', "Expected ':' in offset");
+                    int minutes = fixed_digits(2, 59, "offset minute");
+                    value.offset_minutes = sign * (hours * 60 + minutes);
+                    value.has_offset = true;
+                }
+            }
+            node->_text = _input.substr(start, _pos - start);
+            return node;
+        }
+
+        // Containers.
+
+        Node *parse_array() {
+            Node *array = make(Node::Type::Array, _pos);
+            array->_sealed = true;
+            ++_pos;
+            while(true) {
+                skip_whitespace_comments_and_newlines();
+                if(peek() == ']') {
+                    ++_pos;
+                    return array;
+                }
+                array->_items.push_back({{}, parse_value()});
+                skip_whitespace_comments_and_newlines();
+                if(peek() == ',') {
+                    ++_pos;
+                } else if(peek() == ']') {
+                    ++_pos;
+                    return array;
+                } else {
+                    fail("Expected ',' or ']' in array");
+                }
+            }
+        }
+
+        // Newlines are accepted between entries, as TOML 1.1 does.
+        Node *parse_inline_table() {
+            Node *table = make(Node::Type::Table, _pos);
+            table->_sealed = true;
+            ++_pos;
+            skip_whitespace_comments_and_newlines();
             if(peek() == '}') {
-                get();
-                return Value(obj);
+                ++_pos;
+                return table;
             }
             while(true) {
-                skip_whitespace_and_comments();
-                std::string key = parse_key();
-                skip_whitespace_and_comments();
-                if(get() != '=') {
-                    throw std::runtime_error("Expected '=' after key in inline table");
-                }
-                skip_whitespace_and_comments();
-                obj[key] = parse_value();
-                skip_whitespace_and_comments();
-                char ch = get();
-                if(ch == '}') {
-                    break;
-                } else if(ch != ',') {
-                    throw std::runtime_error("Expected ',' or '}' in inline table");
+                skip_whitespace_comments_and_newlines();
+                parse_key_value(table, true);
+                skip_whitespace_comments_and_newlines();
+                if(peek() == ',') {
+                    ++_pos;
+                    skip_whitespace_comments_and_newlines();
+                    if(peek() == '}') {
+                        ++_pos;
+                        return table;
+                    }
+                } else if(peek() == '}') {
+                    ++_pos;
+                    return table;
+                } else {
+                    fail("Expected ',' or '}' in inline table");
                 }
-                skip_whitespace_and_comments();
             }
-            return Value(obj);
         }
     };
 
-} // namespace toml
\ No newline at end of file
+    inline Document Document::parse(std::string_view source) { return Parser::parse(source); }
+
+} // namespace toml
@@ -165,6 +165,23 @@ function M.define_program_rules_for_target(program_info, target_name, target_con
 		end
 	end
 
+	-- Most targets carry cxxflags/ldflags that this prelude has never passed on; only targets that opt in with
+	-- target_flags = true (the PGO builds) get theirs.
+	if target_config.target_flags then
+		for _, flag in ipairs(target_config.cxxflags or {}) do
+			table.insert(args, flag)
+		end
+
+		for _, flag in ipairs(target_config.ldflags or {}) do
+			table.insert(args, flag)
+		end
+	end
+
+	-- Rules that have to run first without producing an input, e.g. a PGO training run.
+	for _, rule_name in ipairs(target_config.after or {}) do
+		table.insert(dep_rules, rule_name)
+	end
+
 	local inputs = {}
 	for _, src in ipairs(sources) do
 		table.insert(inputs, to_absolute_path(src, program_path))
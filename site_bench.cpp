@@ -0,0 +1,483 @@
+#include "site_bench.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "core/config.hpp"
+#include "core/generator.hpp"
+#include "http/http_server.hpp"
+#include "parsers/toml/toml.hpp"
+#include "utils/file_utils.hpp"
+
+namespace ssg {
+    namespace bench {
+        namespace {
+            const char *const WORDS[] = {"chisel",  "static",   "site",     "render",  "template", "parser",   "stream",
+                                         "arena",   "layout",   "content",  "markdown", "cache",   "build",    "graph",
+                                         "thread",  "pool",     "symbol",   "intern",  "output",   "manifest", "shard",
+                                         "request", "response", "header",   "socket",  "buffer",   "string",   "view",
+                                         "vector",  "profile",  "optimize", "branch",  "inline",   "compile",  "link"};
+
+            // Marks a directory write_corpus produced, the only kind of non-empty directory it will replace.
+            const char *const CORPUS_MARKER = ".chisel-bench-corpus";
+
+            const char *const CONFIG = R"(# Synthetic benchmark site written by `chisel bench --corpus`
+
+[site]
+name = "Chisel Bench"
+base_url = "http://localhost"
+description = "Synthetic corpus for benchmarks and PGO training"
+author = "chisel"
+language = "en"
+
+[build]
+output_dir = "dist"
+content_dir = "content"
+templates_dir = "templates"
+syntax_highlighting = true
+lazy_images = false
+)";
+
+            const char *const DEFAULT_LAYOUT = R"(<!DOCTYPE html>
+<html lang="en">
+  <head>
+    <meta charset="utf-8" />
+    <title>{{title}} - {{site_name}}</title>
+  </head>
+  <body>
+    <header><h1>{{site_name}}</h1></header>
+    <main>{{content}}</main>
+    <footer><small>&copy; {{year}} {{site_name}}</small></footer>
+  </body>
+</html>
+)";
+
+            const char *const POST_LAYOUT = R"(<!DOCTYPE html>
+<html lang="en">
+  <head>
+    <meta charset="utf-8" />
+    <title>{{title}} - {{site_name}}</title>
+  </head>
+  <body>
+    <header><a href="/">{{site_name}}</a></header>
+    <main>
+      <article>
+        <h1 class="post-title">{{title}}</h1>
+        {{#if date}}<div class="meta">{{date}}</div>{{/if}}
+        {{#if description}}<p class="summary">{{description}}</p>{{/if}}
+        <div class="post-body">{{content}}</div>
+      </article>
+    </main>
+    <footer><small>&copy; {{year}} {{site_name}}</small></footer>
+  </body>
+</html>
+)";
+
+            class CorpusWriter {
+            public:
+                explicit CorpusWriter(uint32_t seed) : rng_(seed) {}
+
+                std::string page(size_t index) {
+                    std::ostringstream out;
+                    bool post = index % 3 != 0;
+                    out << "---\n";
+                    out << "title: \"" << capitalized(sentence(3, 6)) << " " << index << "\"\n";
+                    if(post) {
+                        out << "layout: post\n";
+                        out << "date: 2024-" << std::setw(2) << std::setfill('0') << (index % 12 + 1) << "-"
+                            << std::setw(2) << (index % 28 + 1) << std::setfill(' ') << "\n";
+                        out << "description: \"" << sentence(8, 14) << "\"\n";
+                    }
+                    out << "tags: [" << word() << ", " << word() << "]\n";
+                    out << "---\n\n";
+
+                    out << "# " << capitalized(sentence(2, 5)) << "\n\n";
+                    size_t sections = pick(3, 6);
+                    for(size_t s = 0; s < sections; ++s) {
+                        out << "## " << capitalized(sentence(2, 4)) << "\n\n";
+                        for(size_t p = pick(1, 3); p > 0; --p) {
+                            out << paragraph() << "\n\n";
+                        }
+                        switch(pick(0, 4)) {
+                        case 0:
+                            for(size_t item = pick(3, 6); item > 0; --item) {
+                                out << "- " << inline_text(4, 10) << "\n";
+                                if(item % 2 == 0) {
+                                    out << "  - " << inline_text(2, 6) << "\n";
+                                }
+                            }
+                            out << "\n";
+                            break;
+                        case 1:
+                            for(size_t item = 1, n = pick(3, 5); item <= n; ++item) {
+                                out << item << ". " << inline_text(4, 9) << "\n";
+                            }
+                            out << "\n";
+                            break;
+                        case 2:
+                            out << "```cpp\n" << cpp_snippet() << "```\n\n";
+                            break;
+                        case 3:
+                            out << "| Name | Value | Notes |\n|------|------:|-------|\n";
+                            for(size_t row = pick(3, 6); row > 0; --row) {
+                                out << "| " << word() << " | " << pick(1, 9999) << " | " << inline_text(2, 5) << " |\n";
+                            }
+                            out << "\n";
+                            break;
+                        default:
+                            out << "> " << inline_text(10, 20) << "\n\n";
+                            break;
+                        }
+                    }
+                    return out.str();
+                }
+
+            private:
+                std::mt19937 rng_;
+
+                // Not uniform_int_distribution: its output differs between standard libraries, and the corpus has to
+                // be identical for the baseline and PGO binaries whatever they were built with.
+                size_t pick(size_t low, size_t high) { return low + rng_() % (high - low + 1); }
+
+                std::string word() { return WORDS[pick(0, std::size(WORDS) - 1)]; }
+
+                std::string sentence(size_t low, size_t high) {
+                    std::string out = word();
+                    for(size_t n = pick(low, high); n > 1; --n) {
+                        out += " " + word();
+                    }
+                    return out;
+                }
+
+                static std::string capitalized(std::string text) {
+                    if(!text.empty()) {
+                        text[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(text[0])));
+                    }
+                    return text;
+                }
+
+                std::string inline_text(size_t low, size_t high) {
+                    std::string out;
+                    for(size_t n = pick(low, high); n > 0; --n) {
+                        if(!out.empty()) {
+                            out += ' ';
+                        }
+                        switch(pick(0, 9)) {
+                        case 0:
+                            out += "**" + word() + "**";
+                            break;
+                        case 1:
+                            out += "*" + word() + "*";
+                            break;
+                        case 2:
+                            out += "`" + word() + "()`";
+                            break;
+                        case 3:
+                            out += "[" + word() + "](/" + word() + "/" + word() + ")";
+                            break;
+                        default:
+                            out += word();
+                            break;
+                        }
+                    }
+                    return out;
+                }
+
+                std::string paragraph() {
+                    std::string out;
+                    for(size_t n = pick(3, 6); n > 0; --n) {
+                        out += capitalized(inline_text(6, 16)) + ". ";
+                    }
+                    out.pop_back();
+                    return out;
+                }
+
+                std::string cpp_snippet() {
+                    std::string name = word();
+                    std::ostringstream out;
+                    out << "// " << sentence(4, 8) << "\n";
+                    out << "std::vector<int> " << name << "(const std::string &input) {\n";
+                    out << "    std::vector<int> result;\n";
+                    out << "    for(size_t i = 0; i < input.size(); ++i) {\n";
+                    out << "        if(input[i] == '" << static_cast<char>('a' + pick(0, 25)) << "') {\n";
+                    out << "            result.push_back(static_cast<int>(i) * " << pick(2, 64) << ");\n";
+                    out << "        }\n    }\n";
+                    out << "    return result; /* " << word() << " */\n}\n";
+                    return out.str();
+                }
+            };
+
+            // Swallows the generator's and server's per-page logging while timing.
+            class QuietScope {
+            public:
+                QuietScope() : previous_(std::cout.rdbuf(&null_)) {}
+                ~QuietScope() { std::cout.rdbuf(previous_); }
+
+            private:
+                class NullBuffer : public std::streambuf {
+                protected:
+                    int overflow(int c) override { return c; }
+                    std::streamsize xsputn(const char *, std::streamsize n) override { return n; }
+                };
+
+                NullBuffer null_;
+                std::streambuf *previous_;
+            };
+
+            // A scratch copy of the project, removed again when the benchmark ends.
+            class Workspace {
+            public:
+                Workspace() {
+                    std::random_device random;
+                    std::ostringstream name;
+                    name << "chisel-bench-" << std::hex << random() << random();
+                    path_ = std::filesystem::temp_directory_path() / name.str();
+                    std::filesystem::create_directories(path_);
+                }
+
+                ~Workspace() {
+                    std::error_code error;
+                    std::filesystem::remove_all(path_, error);
+                }
+
+                Workspace(const Workspace &) = delete;
+                Workspace &operator=(const Workspace &) = delete;
+
+                const std::filesystem::path &path() const { return path_; }
+
+            private:
+                std::filesystem::path path_;
+            };
+
+            // Everything but the project's build output and .chisel state, which the timed clean builds delete.
+            void copy_sources(const std::filesystem::path &from, const std::filesystem::path &to,
+                              const std::filesystem::path &output) {
+                std::filesystem::path skip_output = std::filesystem::weakly_canonical(output);
+                std::filesystem::path skip_state = std::filesystem::weakly_canonical(BuildManifest::state_dir(from));
+                for(auto it = std::filesystem::recursive_directory_iterator(from);
+                    it != std::filesystem::recursive_directory_iterator(); ++it) {
+                    std::filesystem::path path = std::filesystem::weakly_canonical(it->path());
+                    if(path == skip_output || path == skip_state) {
+                        it.disable_recursion_pending();
+                        continue;
+                    }
+                    std::filesystem::path target = to / std::filesystem::relative(it->path(), from);
+                    if(it->is_directory()) {
+                        std::filesystem::create_directories(target);
+                    } else if(it->is_regular_file()) {
+                        std::filesystem::copy_file(it->path(), target);
+                    }
+                }
+            }
+
+            double median(std::vector<double> values) {
+                std::sort(values.begin(), values.end());
+                size_t mid = values.size() / 2;
+                return values.size() % 2 ? values[mid] : (values[mid - 1] + values[mid]) / 2.0;
+            }
+
+            std::vector<std::string> page_urls(const std::filesystem::path &output) {
+                std::vector<std::string> urls;
+                for(const auto &entry : std::filesystem::recursive_directory_iterator(output)) {
+                    if(entry.is_regular_file() && entry.path().extension() == ".html") {
+                        urls.push_back("/" + std::filesystem::relative(entry.path(), output).generic_string());
+                    }
+                }
+                std::sort(urls.begin(), urls.end());
+                return urls;
+            }
+
+            // One request per connection, matching the server's Connection: close. Returns false on any failure.
+            bool fetch(int port, const std::string &url) {
+                SOCKET_TYPE fd = socket(AF_INET, SOCK_STREAM, 0);
+                if(fd == INVALID_SOCKET_TYPE) {
+                    return false;
+                }
+                struct sockaddr_in address;
+                memset(&address, 0, sizeof(address));
+                address.sin_family = AF_INET;
+                address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                address.sin_port = htons(port);
+                if(connect(fd, (struct sockaddr *) &address, sizeof(address)) == SOCKET_ERROR_CODE) {
+                    CLOSE_SOCKET(fd);
+                    return false;
+                }
+
+                std::string request = "GET " + url + " HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+                if(send(fd, request.c_str(), static_cast<int>(request.size()), 0) == SOCKET_ERROR_CODE) {
+                    CLOSE_SOCKET(fd);
+                    return false;
+                }
+
+                char buffer[16384];
+                std::string head;
+                int received;
+                while((received = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+                    if(head.size() < 16) {
+                        head.append(buffer, std::min<size_t>(received, 16));
+                    }
+                }
+                CLOSE_SOCKET(fd);
+                return head.compare(0, 12, "HTTP/1.1 200") == 0;
+            }
+
+            double serve_requests(const std::filesystem::path &output, const std::vector<std::string> &urls,
+                                  const BenchOptions &options) {
+                QuietScope quiet;
+                http::HttpServerAsync server(options.port, output.string());
+                server.start();
+
+                std::atomic<size_t> next(0);
+                std::atomic<size_t> failed(0);
+                auto start = std::chrono::steady_clock::now();
+                std::vector<std::thread> clients;
+                for(size_t c = 0; c < std::max<size_t>(options.clients, 1); ++c) {
+                    clients.emplace_back([&] {
+                        for(size_t i = next++; i < options.requests; i = next++) {
+                            if(!fetch(options.port, urls[i % urls.size()])) {
+                                ++failed;
+                            }
+                        }
+                    });
+                }
+                for(auto &client : clients) {
+                    client.join();
+                }
+                double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                server.stop();
+
+                if(failed > 0) {
+                    throw std::runtime_error(std::to_string(failed.load()) + " of " + std::to_string(options.requests) +
+                                             " benchmark requests failed");
+                }
+                return elapsed;
+            }
+
+            double number_field(const toml::Node &root, std::string_view key, const std::filesystem::path &file) {
+                const toml::Node *node = root.find(key);
+                if(node == nullptr || !(node->is_integer() || node->is_float())) {
+                    throw std::runtime_error(file.string() + ": missing numeric '" + std::string(key) + "'");
+                }
+                return node->as_number();
+            }
+        } // namespace
+
+        void write_corpus(const std::filesystem::path &dir, size_t pages) {
+            if(std::filesystem::exists(dir)) {
+                if(!std::filesystem::is_directory(dir) ||
+                   (!std::filesystem::is_empty(dir) && !std::filesystem::exists(dir / CORPUS_MARKER))) {
+                    throw std::runtime_error(dir.string() +
+                                             " is not empty and holds no earlier benchmark corpus; refusing to replace it");
+                }
+            }
+            std::filesystem::remove_all(dir);
+            std::filesystem::create_directories(dir / "content" / "posts");
+            std::filesystem::create_directories(dir / "templates");
+
+            utils::FileUtils::write_file(dir / CORPUS_MARKER, "");
+            utils::FileUtils::write_file(dir / "chisel.config", CONFIG);
+            utils::FileUtils::write_file(dir / "templates" / "default.html", DEFAULT_LAYOUT);
+            utils::FileUtils::write_file(dir / "templates" / "post.html", POST_LAYOUT);
+
+            CorpusWriter writer(0xC415E1);
+            utils::FileUtils::write_file(dir / "content" / "index.md", writer.page(0));
+            for(size_t i = 1; i < pages; ++i) {
+                utils::FileUtils::write_file(dir / "content" / "posts" / ("post-" + std::to_string(i) + ".md"),
+                                             writer.page(i));
+            }
+        }
+
+        BenchResults run(const std::filesystem::path &source_path, const BenchOptions &options) {
+            g_config.load(source_path / "chisel.config", source_path);
+            Workspace workspace;
+            std::filesystem::path project_path = workspace.path() / "site";
+            copy_sources(source_path, project_path, g_config.get_output_path());
+
+            g_config.load(project_path / "chisel.config", project_path);
+            std::filesystem::path output = g_config.get_output_path();
+
+            BenchResults results;
+            std::vector<double> build_times;
+            for(int i = 0; i < std::max(options.build_runs, 1); ++i) {
+                std::filesystem::remove_all(output);
+                std::filesystem::remove_all(BuildManifest::state_dir(project_path));
+
+                auto start = std::chrono::steady_clock::now();
+                {
+                    QuietScope quiet;
+                    SiteGenerator generator(project_path);
+                    generator.build();
+                }
+                build_times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+                std::cout << "⏱️  Build " << (i + 1) << ": " << std::fixed << std::setprecision(1)
+                          << build_times.back() * 1000.0 << " ms" << std::endl;
+            }
+            results.build_seconds = median(build_times);
+
+            std::vector<std::string> urls = page_urls(output);
+            if(urls.empty()) {
+                throw std::runtime_error("No pages to request in " + output.string());
+            }
+            results.pages = urls.size();
+            results.requests = options.requests;
+            results.requests_per_second = static_cast<double>(options.requests) / serve_requests(output, urls, options);
+            return results;
+        }
+
+        void save_results(const std::filesystem::path &file, const BenchResults &results) {
+            std::ostringstream out;
+            out << std::setprecision(9);
+            out << "pages = " << results.pages << "\n";
+            out << "build_seconds = " << results.build_seconds << "\n";
+            out << "requests = " << results.requests << "\n";
+            out << "requests_per_second = " << results.requests_per_second << "\n";
+            if(file.has_parent_path()) {
+                std::filesystem::create_directories(file.parent_path());
+            }
+            utils::FileUtils::write_file(file, out.str());
+        }
+
+        BenchResults load_results(const std::filesystem::path &file) {
+            std::string source = utils::FileUtils::read_file(file);
+            toml::Document document = toml::Document::parse(source);
+            BenchResults results;
+            results.pages = static_cast<size_t>(number_field(document.root(), "pages", file));
+            results.build_seconds = number_field(document.root(), "build_seconds", file);
+            results.requests = static_cast<size_t>(number_field(document.root(), "requests", file));
+            results.requests_per_second = number_field(document.root(), "requests_per_second", file);
+            return results;
+        }
+
+        void print_results(const BenchResults &results, const std::optional<BenchResults> &baseline) {
+            std::cout << "\n📊 Benchmark results" << std::endl;
+            std::cout << std::fixed << std::setprecision(1);
+            std::cout << "   build: " << std::setw(10) << results.build_seconds * 1000.0 << " ms  (" << results.pages
+                      << " pages, median)";
+            if(baseline && results.build_seconds > 0.0) {
+                std::cout << "  " << std::setprecision(2) << baseline->build_seconds / results.build_seconds
+                          << "x vs baseline" << std::setprecision(1);
+            }
+            std::cout << std::endl;
+            std::cout << "   http:  " << std::setw(10) << results.requests_per_second << " req/s  (" << results.requests
+                      << " requests)";
+            if(baseline && baseline->requests_per_second > 0.0) {
+                std::cout << "  " << std::setprecision(2) << results.requests_per_second / baseline->requests_per_second
+                          << "x vs baseline";
+            }
+            std::cout << std::endl;
+            if(baseline && baseline->pages != results.pages) {
+                std::cout << "⚠️  Baseline was measured on " << baseline->pages << " pages" << std::endl;
+            }
+        }
+    } // namespace bench
+} // namespace ssg
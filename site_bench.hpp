@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+
+namespace ssg {
+    namespace bench {
+        struct BenchOptions {
+            // Where the synthetic site is (re)generated; unset means benchmark the project as it is.
+            std::optional<std::filesystem::path> corpus;
+            size_t pages = 400;
+            int build_runs = 5;
+            int port = 8089;
+            size_t requests = 4000;
+            size_t clients = 4;
+            std::optional<std::filesystem::path> save;
+            std::optional<std::filesystem::path> baseline;
+        };
+
+        struct BenchResults {
+            size_t pages = 0;
+            double build_seconds = 0.0;
+            size_t requests = 0;
+            double requests_per_second = 0.0;
+        };
+
+        // Writes a deterministic site of `pages` markdown pages exercising frontmatter, block and inline markdown,
+        // fenced code for the highlighter, and both example layouts. `dir` must be missing, empty or an earlier
+        // corpus, which is replaced; any other directory is refused with std::runtime_error.
+        void write_corpus(const std::filesystem::path &dir, size_t pages);
+
+        // Median wall time of clean builds of `project_path`, then GET throughput of HttpServerAsync over the
+        // pages it produced. The builds run on a copy in a temporary directory, so the project's own output and
+        // .chisel state are left alone. Used as the PGO training run as well as for the release benchmark.
+        BenchResults run(const std::filesystem::path &project_path, const BenchOptions &options);
+
+        void save_results(const std::filesystem::path &file, const BenchResults &results);
+        BenchResults load_results(const std::filesystem::path &file);
+
+        void print_results(const BenchResults &results, const std::optional<BenchResults> &baseline);
+    } // namespace bench
+} // namespace ssg
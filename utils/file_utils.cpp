@@ -7,6 +7,8 @@
 #include <regex>
 #include <sstream>
 
+#include "../parsers/toml/toml.hpp"
+
 namespace ssg::utils {
 
     std::string FileUtils::read_file(const std::filesystem::path &path) {
@@ -75,6 +77,24 @@ namespace ssg::utils {
         }
     }
 
+    std::string FileUtils::relative_output_path(const std::filesystem::path &path, const std::filesystem::path &base_dir) {
+        std::string relative = std::filesystem::relative(path, base_dir).generic_string();
+        if(relative.empty() || relative == ".") {
+            return path.filename().generic_string();
+        }
+        return relative;
+    }
+
+    std::string HashUtils::to_hex(uint64_t hash) {
+        static const char digits[] = "0123456789abcdef";
+        std::string hex(16, '0');
+        for(int i = 15; i >= 0; --i) {
+            hex[i] = digits[hash & 0xF];
+            hash >>= 4;
+        }
+        return hex;
+    }
+
     std::string StringUtils::trim(const std::string &str) {
         auto start = str.find_first_not_of(" \t\r\n");
         if(start == std::string::npos)
@@ -139,14 +159,109 @@ namespace ssg::utils {
             result.push_back((*i)[1].str());
         }
 
+        // Bare YAML flow items: [a, /b/c]
+        if(result.empty() && array_str.size() > 2 && array_str.front() == '[' && array_str.back() == ']') {
+            std::stringstream items(array_str.substr(1, array_str.size() - 2));
+            std::string item;
+            while(std::getline(items, item, ',')) {
+                item = trim(item);
+                if(!item.empty()) {
+                    result.push_back(item);
+                }
+            }
+        }
+
         return result;
     }
 
+    // Runs the pattern as a state machine over the text, tracking every pattern position that is still live, so
+    // it never backtracks: time is O(pattern x text) however many stars the pattern has.
+    bool StringUtils::glob_match(std::string_view pattern, std::string_view text) {
+        enum class Token { Literal, AnyChar, Star, Globstar, GlobstarDir };
+        std::vector<std::pair<Token, char>> tokens;
+        for(size_t i = 0; i < pattern.size(); ++i) {
+            if(pattern.substr(i, 3) == "**/") {
+                tokens.emplace_back(Token::GlobstarDir, 0);
+                i += 2;
+            } else if(pattern.substr(i, 2) == "**") {
+                tokens.emplace_back(Token::Globstar, 0);
+                ++i;
+            } else if(pattern[i] == '*') {
+                tokens.emplace_back(Token::Star, 0);
+            } else if(pattern[i] == '?') {
+                tokens.emplace_back(Token::AnyChar, 0);
+            } else {
+                tokens.emplace_back(Token::Literal, pattern[i]);
+            }
+        }
+
+        // Entering a wildcard also enters whatever follows it, since every wildcard can match nothing ('**/'
+        // matching zero directories included).
+        std::vector<char> current(tokens.size() + 1, 0);
+        std::vector<char> next(tokens.size() + 1, 0);
+        auto enter = [&](std::vector<char> &states, size_t state) {
+            while(!states[state]) {
+                states[state] = 1;
+                if(state == tokens.size() || tokens[state].first == Token::Literal ||
+                   tokens[state].first == Token::AnyChar) {
+                    break;
+                }
+                ++state;
+            }
+        };
+
+        enter(current, 0);
+        for(char c : text) {
+            std::fill(next.begin(), next.end(), 0);
+            for(size_t state = 0; state < tokens.size(); ++state) {
+                if(!current[state]) {
+                    continue;
+                }
+                auto [token, literal] = tokens[state];
+                switch(token) {
+                case Token::Literal:
+                    if(c == literal) {
+                        enter(next, state + 1);
+                    }
+                    break;
+                case Token::AnyChar:
+                    if(c != '/') {
+                        enter(next, state + 1);
+                    }
+                    break;
+                case Token::Star:
+                    if(c != '/') {
+                        enter(next, state);
+                    }
+                    break;
+                case Token::Globstar:
+                    enter(next, state);
+                    break;
+                case Token::GlobstarDir:
+                    // Stays inside the '**/' and only leaves it right after a '/'.
+                    next[state] = 1;
+                    if(c == '/') {
+                        enter(next, state + 1);
+                    }
+                    break;
+                }
+            }
+            if(std::find(next.begin(), next.end(), 1) == next.end()) {
+                return false;
+            }
+            current.swap(next);
+        }
+        return current[tokens.size()] != 0;
+    }
+
     FrontmatterParser::ParseResult FrontmatterParser::parse(const std::string &input) {
         ParseResult result;
         result.content_start_pos = 0;
         result.content = input;
 
+        if(starts_with(input, "+++")) {
+            return parse_toml(input);
+        }
         if(!starts_with(input, "---")) {
             return result;
         }
@@ -178,6 +293,121 @@ namespace ssg::utils {
         return result;
     }
 
+    std::optional<std::string> FrontmatterParser::read_header(const std::filesystem::path &path, size_t max_bytes) {
+        static constexpr size_t BLOCK_SIZE = 4096;
+
+        std::ifstream file(path, std::ios::binary);
+        if(!file.is_open()) {
+            throw std::runtime_error("Cannot open file: " + path.string());
+        }
+
+        std::string header(3, '\0');
+        file.read(header.data(), 3);
+        if(file.gcount() < 3 || (header != "---" && header != "+++")) {
+            return "";
+        }
+
+        std::string closing = "\n" + header;
+        size_t searched = 3;
+        char block[BLOCK_SIZE];
+        while(true) {
+            size_t end_pos = header.find(closing, searched);
+            if(end_pos != std::string::npos) {
+                size_t line_end = header.find('\n', end_pos + closing.size());
+                if(line_end != std::string::npos) {
+                    return header.substr(0, line_end + 1);
+                }
+            }
+            if(!file) {
+                return header;
+            }
+            if(header.size() > max_bytes) {
+                return std::nullopt;
+            }
+
+            // A delimiter may straddle two blocks, so the next search starts just before the new data.
+            if(end_pos != std::string::npos) {
+                searched = end_pos;
+            } else if(header.size() > closing.size() + 3) {
+                searched = header.size() - closing.size();
+            }
+            file.read(block, BLOCK_SIZE);
+            header.append(block, static_cast<size_t>(file.gcount()));
+        }
+    }
+
+    // Hugo-style TOML frontmatter between +++ lines. Values are flattened to the strings the "---" format produces:
+    // arrays become ["a", "b"] and nested tables dotted keys.
+    FrontmatterParser::ParseResult FrontmatterParser::parse_toml(const std::string &input) {
+        ParseResult result;
+        result.content_start_pos = 0;
+        result.content = input;
+
+        auto end_pos = input.find("\n+++", 3);
+        if(end_pos == std::string::npos) {
+            return result;
+        }
+
+        std::string_view frontmatter = std::string_view(input).substr(3, end_pos - 3);
+        try {
+            auto document = toml::Document::parse(frontmatter);
+            flatten_toml(document.root(), "", result.metadata);
+        } catch(const toml::ParseError &e) {
+            // The parsed text starts right after the opening +++, so its line numbers are the file's.
+            throw std::runtime_error("Invalid TOML frontmatter: " + std::string(e.what()));
+        }
+
+        result.content_start_pos = input.find('\n', end_pos + 4);
+        if(result.content_start_pos != std::string::npos) {
+            result.content = StringUtils::trim(input.substr(result.content_start_pos + 1));
+        } else {
+            result.content_start_pos = input.length();
+            result.content = "";
+        }
+
+        return result;
+    }
+
+    void FrontmatterParser::flatten_toml(const toml::Node &table, const std::string &prefix,
+                                         std::map<std::string, std::string> &metadata) {
+        auto scalar = [](const toml::Node &node) -> std::string {
+            switch(node.type()) {
+            case toml::Node::Type::Boolean:
+                return node.as_bool() ? "true" : "false";
+            case toml::Node::Type::Integer:
+                return std::to_string(node.as_integer());
+            case toml::Node::Type::Float: {
+                std::ostringstream out;
+                out << node.as_float();
+                return out.str();
+            }
+            case toml::Node::Type::String:
+            case toml::Node::Type::DateTime:
+                return std::string(node.as_string());
+            default:
+                return "";
+            }
+        };
+
+        for(const auto &entry : table.entries()) {
+            std::string key = prefix + std::string(entry.key);
+            const toml::Node &value = *entry.value;
+            if(value.is_table()) {
+                flatten_toml(value, key + ".", metadata);
+            } else if(value.is_array()) {
+                std::string list = "[";
+                for(const auto &item : value.entries()) {
+                    if(!item.value->is_table() && !item.value->is_array()) {
+                        list += (list.size() > 1 ? ", \"" : "\"") + scalar(*item.value) + "\"";
+                    }
+                }
+                metadata[key] = list + "]";
+            } else {
+                metadata[key] = scalar(value);
+            }
+        }
+    }
+
     void FrontmatterParser::parse_line(const std::string &line, std::map<std::string, std::string> &metadata) {
         auto colon_pos = line.find(':');
         if(colon_pos == std::string::npos)
@@ -1,13 +1,20 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
 #include <fstream>
 #include <map>
+#include <optional>
 #include <regex>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <vector>
 
+namespace toml {
+    class Node;
+}
+
 namespace ssg::utils {
     inline bool starts_with(const std::string &str, const std::string &prefix) {
         return str.size() >= prefix.size() && str.compare(0, prefix.size(), prefix) == 0;
@@ -30,6 +37,23 @@ namespace ssg::utils {
         static std::string path_to_slug(const std::filesystem::path &file_path);
 
         static void ensure_directory(const std::filesystem::path &dir);
+
+        static std::string relative_output_path(const std::filesystem::path &path, const std::filesystem::path &base_dir);
+    };
+
+    class HashUtils {
+    public:
+        // Defined here so header-only modules can use it without linking file_utils.cpp.
+        static uint64_t fnv1a(std::string_view data, uint64_t seed = 14695981039346656037ull) {
+            uint64_t hash = seed;
+            for(unsigned char c : data) {
+                hash ^= c;
+                hash *= 1099511628211ull;
+            }
+            return hash;
+        }
+
+        static std::string to_hex(uint64_t hash);
     };
 
     class StringUtils {
@@ -45,6 +69,9 @@ namespace ssg::utils {
         static std::string slugify(const std::string &text);
 
         static std::vector<std::string> parse_array(const std::string &array_str);
+
+        // Shell-style glob: '*' and '?' stop at '/', '**' also matches across directories.
+        static bool glob_match(std::string_view pattern, std::string_view text);
     };
 
     class CSSProcessor {
@@ -66,9 +93,20 @@ namespace ssg::utils {
             size_t content_start_pos;
         };
 
+        static constexpr size_t MAX_HEADER_BYTES = 256 * 1024;
+
         static ParseResult parse(const std::string &input);
 
+        // The front matter block of a file, up to and including its closing delimiter line, read in small blocks
+        // so the body is never loaded. parse() of the result gives the file's metadata with empty content. Files
+        // without front matter give "", and a block still open after max_bytes gives nullopt.
+        static std::optional<std::string> read_header(const std::filesystem::path &path,
+                                                      size_t max_bytes = MAX_HEADER_BYTES);
+
     private:
+        static ParseResult parse_toml(const std::string &input);
+        static void flatten_toml(const toml::Node &table, const std::string &prefix,
+                                 std::map<std::string, std::string> &metadata);
         static void parse_line(const std::string &line, std::map<std::string, std::string> &metadata);
     };
 } // namespace ssg::utils
\ No newline at end of file
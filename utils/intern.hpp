@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ssg::utils {
+    // Process-wide table of unique strings. Entries are never freed, so the text behind a Symbol stays valid for
+    // the lifetime of the program. Lookups of already-interned strings only take a shared lock.
+    class InternTable {
+    public:
+        struct Entry {
+            std::string text;
+            uint32_t id;
+        };
+
+        static InternTable &global() {
+            static InternTable table;
+            return table;
+        }
+
+        const Entry *intern(std::string_view text) {
+            {
+                std::shared_lock<std::shared_mutex> lock(mutex_);
+                auto it = index_.find(text);
+                if(it != index_.end()) {
+                    return it->second;
+                }
+            }
+
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            auto it = index_.find(text);
+            if(it != index_.end()) {
+                return it->second;
+            }
+            entries_.push_back(Entry{std::string(text), static_cast<uint32_t>(entries_.size())});
+            const Entry *entry = &entries_.back();
+            index_.emplace(std::string_view(entry->text), entry);
+            return entry;
+        }
+
+        const Entry *empty_entry() const { return empty_; }
+
+        size_t size() const {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            return entries_.size();
+        }
+
+    private:
+        mutable std::shared_mutex mutex_;
+        std::deque<Entry> entries_;
+        std::unordered_map<std::string_view, const Entry *> index_;
+        const Entry *empty_;
+
+        InternTable() { empty_ = intern(""); }
+    };
+
+    // Handle to an interned string: one pointer wide, and equal symbols always share an entry, so comparing two
+    // symbols is a pointer compare. Ordering with operator< is by intern id (stable within a process, not
+    // alphabetical); use Symbol::ByName where output order matters.
+    class Symbol {
+    public:
+        Symbol() : entry_(InternTable::global().empty_entry()) {}
+        Symbol(std::string_view text) : entry_(InternTable::global().intern(text)) {}
+        Symbol(const std::string &text) : Symbol(std::string_view(text)) {}
+        Symbol(const char *text) : Symbol(std::string_view(text)) {}
+
+        const std::string &str() const { return entry_->text; }
+        std::string_view view() const { return entry_->text; }
+        uint32_t id() const { return entry_->id; }
+        bool empty() const { return entry_->text.empty(); }
+        size_t size() const { return entry_->text.size(); }
+
+        operator const std::string &() const { return entry_->text; }
+
+        friend bool operator==(Symbol a, Symbol b) { return a.entry_ == b.entry_; }
+        friend bool operator==(Symbol a, std::string_view b) { return a.view() == b; }
+        friend bool operator==(Symbol a, const std::string &b) { return a.view() == b; }
+        friend bool operator==(Symbol a, const char *b) { return a.view() == b; }
+        friend bool operator<(Symbol a, Symbol b) { return a.entry_->id < b.entry_->id; }
+
+        friend std::ostream &operator<<(std::ostream &os, Symbol symbol) { return os << symbol.view(); }
+        friend std::string operator+(const std::string &lhs, Symbol rhs) { return lhs + rhs.str(); }
+        friend std::string operator+(Symbol lhs, const std::string &rhs) { return lhs.str() + rhs; }
+
+        struct ByName {
+            bool operator()(Symbol a, Symbol b) const { return a != b && a.view() < b.view(); }
+        };
+
+        struct Hash {
+            size_t operator()(Symbol symbol) const { return std::hash<const void *>()(symbol.entry_); }
+        };
+
+        static std::vector<Symbol> intern_all(const std::vector<std::string> &texts) {
+            return std::vector<Symbol>(texts.begin(), texts.end());
+        }
+
+        static std::vector<std::string> to_strings(const std::vector<Symbol> &symbols) {
+            return std::vector<std::string>(symbols.begin(), symbols.end());
+        }
+
+    private:
+        const InternTable::Entry *entry_;
+    };
+} // namespace ssg::utils
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#if(defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+#define CHISEL_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define CHISEL_SIMD_X86 0
+#endif
+
+// Byte-scanning kernels shared by the parsers and escapers. Callers describe the few "special" bytes they care
+// about with a ByteSet; the kernels skip over everything else 16 or 32 bytes at a time. SSE2 is the x86-64
+// baseline, AVX2 is picked at runtime when the CPU supports it, and every other target uses the scalar loop.
+namespace ssg::utils::simd {
+    enum class Level { Scalar, SSE2, AVX2 };
+
+    class ByteSet {
+    public:
+        static constexpr size_t MAX_SIZE = 8;
+
+        // More than MAX_SIZE distinct bytes is a compile error for a constexpr set and std::length_error otherwise.
+        constexpr ByteSet(std::string_view chars) : table_{}, chars_{}, size_(0) {
+            for(char c : chars) {
+                auto byte = static_cast<unsigned char>(c);
+                if(table_[byte]) {
+                    continue;
+                }
+                if(size_ == MAX_SIZE) {
+                    throw std::length_error("simd::ByteSet holds at most 8 distinct bytes");
+                }
+                table_[byte] = true;
+                chars_[size_++] = c;
+            }
+        }
+
+        constexpr bool contains(char c) const { return table_[static_cast<unsigned char>(c)]; }
+        constexpr size_t size() const { return size_; }
+        constexpr char operator[](size_t i) const { return chars_[i]; }
+
+    private:
+        bool table_[256];
+        char chars_[MAX_SIZE];
+        size_t size_;
+    };
+
+    namespace detail {
+        using FindFn = size_t (*)(const char *data, size_t size, const ByteSet &set);
+
+        inline size_t find_scalar(const char *data, size_t size, const ByteSet &set) {
+            for(size_t i = 0; i < size; ++i) {
+                if(set.contains(data[i])) {
+                    return i;
+                }
+            }
+            return size;
+        }
+
+#if CHISEL_SIMD_X86
+        inline size_t find_sse2(const char *data, size_t size, const ByteSet &set) {
+            __m128i needles[ByteSet::MAX_SIZE];
+            for(size_t k = 0; k < set.size(); ++k) {
+                needles[k] = _mm_set1_epi8(set[k]);
+            }
+
+            size_t i = 0;
+            for(; i + 16 <= size; i += 16) {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                __m128i hits = _mm_setzero_si128();
+                for(size_t k = 0; k < set.size(); ++k) {
+                    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, needles[k]));
+                }
+                int mask = _mm_movemask_epi8(hits);
+                if(mask != 0) {
+                    return i + static_cast<size_t>(__builtin_ctz(static_cast<unsigned>(mask)));
+                }
+            }
+            return i + find_scalar(data + i, size - i, set);
+        }
+
+        __attribute__((target("avx2"))) inline size_t find_avx2(const char *data, size_t size, const ByteSet &set) {
+            __m256i needles[ByteSet::MAX_SIZE];
+            for(size_t k = 0; k < set.size(); ++k) {
+                needles[k] = _mm256_set1_epi8(set[k]);
+            }
+
+            size_t i = 0;
+            for(; i + 32 <= size; i += 32) {
+                __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+                __m256i hits = _mm256_setzero_si256();
+                for(size_t k = 0; k < set.size(); ++k) {
+                    hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, needles[k]));
+                }
+                auto mask = static_cast<unsigned>(_mm256_movemask_epi8(hits));
+                if(mask != 0) {
+                    return i + static_cast<size_t>(__builtin_ctz(mask));
+                }
+            }
+            return i + find_sse2(data + i, size - i, set);
+        }
+#endif
+
+        inline Level detect_level() {
+#if CHISEL_SIMD_X86
+            __builtin_cpu_init();
+            if(__builtin_cpu_supports("avx2")) {
+                return Level::AVX2;
+            }
+            return Level::SSE2;
+#else
+            return Level::Scalar;
+#endif
+        }
+
+        inline FindFn find_for(Level level) {
+#if CHISEL_SIMD_X86
+            if(level == Level::AVX2) {
+                return find_avx2;
+            }
+            if(level == Level::SSE2) {
+                return find_sse2;
+            }
+#endif
+            return find_scalar;
+        }
+    } // namespace detail
+
+    inline Level active_level() {
+        static const Level level = detail::detect_level();
+        return level;
+    }
+
+    inline const char *level_name(Level level) {
+        switch(level) {
+        case Level::AVX2:
+            return "avx2";
+        case Level::SSE2:
+            return "sse2";
+        case Level::Scalar:
+            return "scalar";
+        }
+        return "scalar";
+    }
+
+    // Index of the first byte of text that is in set, or text.size() if there is none.
+    inline size_t find_first_of(std::string_view text, const ByteSet &set) {
+        static const detail::FindFn find = detail::find_for(active_level());
+        return find(text.data(), text.size(), set);
+    }
+
+    // Same as find_first_of with an explicit kernel, for comparing implementations.
+    inline size_t find_first_of(std::string_view text, const ByteSet &set, Level level) {
+        return detail::find_for(level)(text.data(), text.size(), set);
+    }
+
+    // Appends the run of ordinary bytes at the start of text to out and returns its length; text[result] (if
+    // any) is the first special byte.
+    inline size_t copy_until(std::string_view text, const ByteSet &set, std::string &out) {
+        size_t run = find_first_of(text, set);
+        out.append(text.data(), run);
+        return run;
+    }
+} // namespace ssg::utils::simd
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ssg::utils {
+    // Fixed-size pool of worker threads consuming a FIFO job queue. Jobs must not throw; callers that need
+    // error propagation wrap their work (see TaskGraph).
+    class ThreadPool {
+    public:
+        explicit ThreadPool(size_t thread_count = default_thread_count()) {
+            thread_count = std::max<size_t>(thread_count, 1);
+            workers_.reserve(thread_count);
+            for(size_t i = 0; i < thread_count; ++i) {
+                workers_.emplace_back([this] { worker_loop(); });
+            }
+        }
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            job_available_.notify_all();
+            for(auto &worker : workers_) {
+                worker.join();
+            }
+        }
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        void submit(std::function<void()> job) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                jobs_.push_back(std::move(job));
+            }
+            job_available_.notify_one();
+        }
+
+        size_t size() const { return workers_.size(); }
+
+        static size_t default_thread_count() {
+            unsigned int hardware = std::thread::hardware_concurrency();
+            return hardware == 0 ? 4 : hardware;
+        }
+
+    private:
+        std::vector<std::thread> workers_;
+        std::deque<std::function<void()>> jobs_;
+        std::mutex mutex_;
+        std::condition_variable job_available_;
+        bool stopping_ = false;
+
+        void worker_loop() {
+            while(true) {
+                std::function<void()> job;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    job_available_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+                    if(jobs_.empty()) {
+                        return;
+                    }
+                    job = std::move(jobs_.front());
+                    jobs_.pop_front();
+                }
+                job();
+            }
+        }
+    };
+} // namespace ssg::utils